@@ -19,8 +19,12 @@ set(eoserv_UNITY_HANDLER_FILES
 set(eoserv_ALL_SOURCE_FILES
 	src/arena.cpp
 	src/arena.hpp
+	src/ban_index.cpp
+	src/ban_index.hpp
 	src/character.cpp
 	src/character.hpp
+	src/character_index.cpp
+	src/character_index.hpp
 	src/command_source.cpp
 	src/command_source.hpp
 	src/commands/commands.cpp
@@ -55,6 +59,10 @@ set(eoserv_ALL_SOURCE_FILES
 	src/eoserver.hpp
 	src/extra/seose_compat.cpp
 	src/extra/seose_compat.hpp
+	src/filecache.cpp
+	src/filecache.hpp
+	src/formulas.cpp
+	src/formulas.hpp
 	src/fwd/arena.hpp
 	src/fwd/character.hpp
 	src/fwd/command_source.hpp
@@ -66,6 +74,8 @@ set(eoserv_ALL_SOURCE_FILES
 	src/fwd/eodata.hpp
 	src/fwd/eoplus.hpp
 	src/fwd/eoserver.hpp
+	src/fwd/filecache.hpp
+	src/fwd/formulas.hpp
 	src/fwd/guild.hpp
 	src/fwd/hook.hpp
 	src/fwd/i18n.hpp
@@ -109,6 +119,8 @@ set(eoserv_ALL_SOURCE_FILES
 	src/player.hpp
 	src/quest.cpp
 	src/quest.hpp
+	src/quest_index.cpp
+	src/quest_index.hpp
 	src/sha256.c
 	src/sha256.h
 	src/sln.cpp
@@ -121,11 +133,18 @@ set(eoserv_ALL_SOURCE_FILES
 	src/util.cpp
 	src/util.hpp
 	src/util/async.hpp
+	src/util/id_pool.hpp
+	src/util/mpsc_queue.hpp
+	src/util/nav_grid.cpp
+	src/util/nav_grid.hpp
+	src/util/ring_buffer.cpp
+	src/util/ring_buffer.hpp
 	src/util/rpn.cpp
 	src/util/rpn.hpp
 	src/util/secure_string.hpp
 	src/util/semaphore.cpp
 	src/util/semaphore.hpp
+	src/util/spatial_grid.hpp
 	src/util/threadpool.cpp
 	src/util/threadpool.hpp
 	src/util/variant.cpp
@@ -279,11 +298,24 @@ set(ExtraFiles
 )
 
 set(TestFiles
+	src/test/ban_index_test.cpp
+	src/test/character_test.cpp
 	src/test/config_test.cpp
 	src/test/database_test.cpp
+	src/test/filecache_test.cpp
+	src/test/packet_test.cpp
+	src/test/player_test.cpp
+	src/test/quest_test.cpp
+	src/test/timer_test.cpp
 	src/test/worlddump_test.cpp
 	src/test/handlers/Login_test.cpp
+	src/test/util/id_pool_test.cpp
+	src/test/util/mpsc_queue_test.cpp
+	src/test/util/nav_grid_test.cpp
+	src/test/util/ring_buffer_test.cpp
+	src/test/util/rpn_test.cpp
 	src/test/util/semaphore_test.cpp
+	src/test/util/spatial_grid_test.cpp
 	src/test/util/threadpool_test.cpp
 )
 
@@ -0,0 +1,178 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "ban_index.hpp"
+
+#include "util.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Permanent bans (0) outlast any temporary ban
+static int ban_longest(int a, int b)
+{
+	if (a == 0 || b == 0)
+		return 0;
+
+	return std::max(a, b);
+}
+
+template <class T> static void ban_index_set(std::unordered_map<T, int> &index, const T &key, int expires)
+{
+	auto result = index.insert(std::make_pair(key, expires));
+
+	if (!result.second)
+		result.first->second = ban_longest(result.first->second, expires);
+}
+
+// Only removes the key if no longer ban on it has been added since
+template <class T> static void ban_index_expire(std::unordered_map<T, int> &index, const T &key, int expires)
+{
+	auto it = index.find(key);
+
+	if (it != index.end() && it->second == expires)
+		index.erase(it);
+}
+
+template <class T> static void ban_index_check(const std::unordered_map<T, int> &index, const T &key, int &result)
+{
+	auto it = index.find(key);
+
+	if (it == index.end())
+		return;
+
+	result = (result == -1) ? it->second : ban_longest(result, it->second);
+}
+
+BanIndex::BanIndex()
+	: loaded(false)
+	, refreshing(false)
+{ }
+
+void BanIndex::Index(const Ban &ban)
+{
+	if (!ban.username.empty())
+		ban_index_set(this->by_username, ban.username, ban.expires);
+
+	if (ban.ip != 0)
+		ban_index_set(this->by_ip, ban.ip, ban.expires);
+
+	if (ban.hdid != 0)
+		ban_index_set(this->by_hdid, ban.hdid, ban.expires);
+
+	if (ban.expires != 0)
+		this->expiry.insert(std::make_pair(ban.expires, ban));
+}
+
+void BanIndex::Add(const Ban &ban, int now)
+{
+	if (this->refreshing)
+		this->added_during_refresh.push_back(ban);
+
+	if (ban.expires != 0 && ban.expires <= now)
+		return;
+
+	this->Index(ban);
+}
+
+void BanIndex::Replace(const std::vector<Ban> &bans, int now)
+{
+	this->by_username.clear();
+	this->by_ip.clear();
+	this->by_hdid.clear();
+	this->expiry.clear();
+	this->loaded = true;
+
+	UTIL_FOREACH_CREF(bans, ban)
+	{
+		if (ban.expires != 0 && ban.expires <= now)
+			continue;
+
+		this->Index(ban);
+	}
+}
+
+void BanIndex::BeginRefresh()
+{
+	this->refreshing = true;
+	this->added_during_refresh.clear();
+}
+
+void BanIndex::FinishRefresh(const std::vector<Ban> &bans, int now)
+{
+	this->refreshing = false;
+	this->Replace(bans, now);
+
+	// The reload may have started reading before these were saved
+	UTIL_FOREACH_CREF(this->added_during_refresh, ban)
+		this->Add(ban, now);
+
+	this->added_during_refresh.clear();
+}
+
+void BanIndex::AbortRefresh()
+{
+	this->refreshing = false;
+	this->added_during_refresh.clear();
+}
+
+bool BanIndex::Refreshing() const
+{
+	return this->refreshing;
+}
+
+bool BanIndex::Loaded() const
+{
+	return this->loaded;
+}
+
+void BanIndex::Expire(int now)
+{
+	auto end = this->expiry.upper_bound(now);
+
+	for (auto it = this->expiry.begin(); it != end; ++it)
+	{
+		const Ban &ban = it->second;
+
+		if (!ban.username.empty())
+			ban_index_expire(this->by_username, ban.username, ban.expires);
+
+		if (ban.ip != 0)
+			ban_index_expire(this->by_ip, ban.ip, ban.expires);
+
+		if (ban.hdid != 0)
+			ban_index_expire(this->by_hdid, ban.hdid, ban.expires);
+	}
+
+	this->expiry.erase(this->expiry.begin(), end);
+}
+
+int BanIndex::Check(const std::string *username, const int *ip, const int *hdid, int now)
+{
+	this->Expire(now);
+
+	int result = -1;
+
+	if (username)
+		ban_index_check(this->by_username, *username, result);
+
+	if (ip)
+		ban_index_check(this->by_ip, *ip, result);
+
+	if (hdid)
+		ban_index_check(this->by_hdid, *hdid, result);
+
+	return result;
+}
+
+std::size_t BanIndex::Size() const
+{
+	return this->by_username.size() + this->by_ip.size() + this->by_hdid.size();
+}
@@ -0,0 +1,86 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef BAN_INDEX_HPP_INCLUDED
+#define BAN_INDEX_HPP_INCLUDED
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Hash indexes of the active bans by username, IP address and HDID.
+ * An empty username, or an IP address or HDID of 0, is not indexed.
+ * Expiry times are unix timestamps, 0 is a permanent ban.
+ */
+class BanIndex
+{
+	public:
+		struct Ban
+		{
+			std::string username;
+			int ip;
+			int hdid;
+			int expires;
+		};
+
+	private:
+		// Latest expiry time of any ban on each key
+		std::unordered_map<std::string, int> by_username;
+		std::unordered_map<int, int> by_ip;
+		std::unordered_map<int, int> by_hdid;
+
+		// Temporary bans ordered by expiry time, so expired bans can be dropped without a scan
+		std::multimap<int, Ban> expiry;
+
+		bool loaded;
+		bool refreshing;
+		std::vector<Ban> added_during_refresh;
+
+		void Index(const Ban &ban);
+
+	public:
+		BanIndex();
+
+		/**
+		 * Adds a ban unless it has already expired.
+		 */
+		void Add(const Ban &ban, int now);
+
+		/**
+		 * Replaces every ban with a list loaded from the database.
+		 */
+		void Replace(const std::vector<Ban> &bans, int now);
+
+		/**
+		 * Marks the start of a reload, bans added until it finishes are kept when it is applied.
+		 */
+		void BeginRefresh();
+		void FinishRefresh(const std::vector<Ban> &bans, int now);
+		void AbortRefresh();
+		bool Refreshing() const;
+
+		/**
+		 * Returns true once a list of bans has been loaded from the database by Replace or FinishRefresh.
+		 */
+		bool Loaded() const;
+
+		/**
+		 * Drops every ban that expired at or before now.
+		 */
+		void Expire(int now);
+
+		/**
+		 * Returns the expiry time of the longest ban matching any of the non-null arguments, or -1 if there is none.
+		 */
+		int Check(const std::string *username, const int *ip, const int *hdid, int now);
+
+		std::size_t Size() const;
+};
+
+#endif // BAN_INDEX_HPP_INCLUDED
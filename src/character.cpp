@@ -24,7 +24,6 @@
 
 #include "console.hpp"
 #include "util.hpp"
-#include "util/rpn.hpp"
 #include "util/variant.hpp"
 
 #include <algorithm>
@@ -34,8 +33,10 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -365,7 +366,30 @@ Character::Character(World * world)
 {
 }
 
+static const char *character_columns = "`name`, `title`, `home`, `fiance`, `partner`, `admin`, `class`, `gender`, `race`, `hairstyle`, `haircolor`,"
+	"`map`, `x`, `y`, `direction`, `level`, `exp`, `hp`, `tp`, `str`, `int`, `wis`, `agi`, `con`, `cha`, `statpoints`, `skillpoints`, "
+	"`karma`, `sitting`, `hidden`, `bankmax`, `goldbank`, `usage`, `inventory`, `bank`, `paperdoll`, `spells`, `guild`, `guild_rank`, `guild_rank_string`, `quest`, `vars`, "
+	"`nointeract`";
+
+static std::unordered_map<std::string, util::variant> character_load_row(const std::string& name, World *world, Database *database)
+{
+	auto db_ptr = database ? database : world->db.get();
+
+	Database_Result res = db_ptr->Query((std::string("SELECT ") + character_columns + " FROM `characters` WHERE `name` = '$'").c_str(), name.c_str());
+
+	if (res.empty())
+	{
+		throw std::runtime_error("Character not found (" + name + ")");
+	}
+
+	return res.front();
+}
+
 Character::Character(std::string name, World *world, Database *database)
+	: Character(character_load_row(name, world, database), world, database)
+{ }
+
+Character::Character(std::unordered_map<std::string, util::variant> row, World *world, Database *database)
 	: muted_until(0)
 	, bot(false)
 	, cosmetic_paperdoll{{}}
@@ -379,18 +403,12 @@ Character::Character(std::string name, World *world, Database *database)
 {
 	{
 		std::vector<std::string> bot_characters = BotListUnserialize(this->world->config["BotCharacters"]);
-		auto bot_it = std::find(UTIL_CRANGE(bot_characters), util::lowercase(name));
+		auto bot_it = std::find(UTIL_CRANGE(bot_characters), util::lowercase(GetRow<std::string>(row, "name")));
 		this->bot = bot_it != bot_characters.end();
 	}
 
 	auto db_ptr = database ? database : this->world->db.get();
 
-	Database_Result res = db_ptr->Query("SELECT `name`, `title`, `home`, `fiance`, `partner`, `admin`, `class`, `gender`, `race`, `hairstyle`, `haircolor`,"
-		"`map`, `x`, `y`, `direction`, `level`, `exp`, `hp`, `tp`, `str`, `int`, `wis`, `agi`, `con`, `cha`, `statpoints`, `skillpoints`, "
-		"`karma`, `sitting`, `hidden`, `bankmax`, `goldbank`, `usage`, `inventory`, `bank`, `paperdoll`, `spells`, `guild`, `guild_rank`, `guild_rank_string`, `quest`, `vars`, "
-		"`nointeract` FROM `characters` WHERE `name` = '$'", name.c_str());
-	std::unordered_map<std::string, util::variant> row = res.front();
-
 	this->login_time = static_cast<int>(std::time(0));
 
 	this->online = false;
@@ -513,6 +531,43 @@ Character::Character(std::string name, World *world, Database *database)
 	}
 }
 
+std::vector<Character *> Character::LoadAccount(const std::string& account, World *world, Database *database)
+{
+	auto db_ptr = database ? database : world->db.get();
+
+	Database_Result res = Character::QueryAccount(account, *db_ptr);
+
+	std::vector<std::string> guild_tags;
+
+	UTIL_FOREACH_REF(res, row)
+	{
+		guild_tags.push_back(row["guild"]);
+	}
+
+	// Holds the guilds in the cache until the characters take their own references
+	std::vector<std::shared_ptr<Guild>> guilds = world->guildmanager->LoadGuilds(guild_tags, db_ptr);
+
+	return Character::LoadAccount(res, world);
+}
+
+Database_Result Character::QueryAccount(const std::string& account, Database& database)
+{
+	return database.Query((std::string("SELECT ") + character_columns + " FROM `characters` WHERE `account` = '$' ORDER BY `exp` DESC").c_str(), account.c_str());
+}
+
+std::vector<Character *> Character::LoadAccount(Database_Result& rows, World *world)
+{
+	std::vector<Character *> characters;
+	characters.reserve(rows.size());
+
+	UTIL_FOREACH_REF(rows, row)
+	{
+		characters.push_back(new Character(std::move(row), world));
+	}
+
+	return characters;
+}
+
 unsigned int Character::PlayerID() const
 {
 	return this->player->id;
@@ -742,7 +797,8 @@ bool Character::AddItem(short item, int amount)
 
 			it->amount = std::min<int>(it->amount, this->world->config["MaxItem"]);
 
-			this->CalculateStats();
+			this->CalculateStats(false);
+			this->CheckQuestItemRules(item);
 
 			return true;
 		}
@@ -754,7 +810,8 @@ bool Character::AddItem(short item, int amount)
 
 	this->inventory.push_back(newitem);
 
-	this->CalculateStats();
+	this->CalculateStats(false);
+	this->CheckQuestItemRules(item);
 
 	return true;
 }
@@ -779,7 +836,8 @@ bool Character::DelItem(short item, int amount)
 				it->amount -= amount;
 			}
 
-			this->CalculateStats();
+			this->CalculateStats(false);
+			this->CheckQuestItemRules(item);
 
 			return true;
 		}
@@ -795,6 +853,8 @@ std::list<Character_Item>::iterator Character::DelItem(std::list<Character_Item>
 		return ++it;
 	}
 
+	short item = it->id;
+
 	if (it->amount < 0 || it->amount - amount <= 0)
 	{
 		it = this->inventory.erase(it);
@@ -805,7 +865,8 @@ std::list<Character_Item>::iterator Character::DelItem(std::list<Character_Item>
 		++it;
 	}
 
-	this->CalculateStats();
+	this->CalculateStats(false);
+	this->CheckQuestItemRules(item);
 
 	return it;
 }
@@ -814,7 +875,7 @@ int Character::CanHoldItem(short itemid, int max_amount)
 {
 	int amount = max_amount;
 
-	if (int(this->world->config["EnforceWeight"]) >= 2
+	if (this->world->settings.enforce_weight >= 2
 	 && SourceDutyAccess() < static_cast<int>(world->admin_config["unlimitedweight"]))
 	{
 		const EIF_Data &item = this->world->eif->Get(itemid);
@@ -886,7 +947,7 @@ bool Character::AddTradeItem(short item, int amount)
 	newitem.amount = amount;
 
 	this->trade_inventory.push_back(newitem);
-	this->CheckQuestRules();
+	this->CheckQuestRules(QUEST_EVENT_ITEMS);
 
 	return true;
 }
@@ -898,7 +959,7 @@ bool Character::DelTradeItem(short item)
 		if (it->id == item)
 		{
 			this->trade_inventory.erase(it);
-			this->CheckQuestRules();
+			this->CheckQuestRules(QUEST_EVENT_ITEMS);
 			return true;
 		}
 	}
@@ -916,7 +977,7 @@ bool Character::AddSpell(short spell)
 
 	this->spells.push_back(Character_Spell(spell, 0));
 
-	this->CheckQuestRules();
+	this->CheckQuestRules(QUEST_EVENT_SPELLS);
 
 	return true;
 }
@@ -927,7 +988,7 @@ bool Character::DelSpell(short spell)
 	bool removed = (remove_it != this->spells.end());
 	this->spells.erase(remove_it, this->spells.end());
 
-	this->CheckQuestRules();
+	this->CheckQuestRules(QUEST_EVENT_SPELLS);
 
 	return removed;
 }
@@ -1014,13 +1075,10 @@ void Character::SpellAct()
 			return;
 	}
 
-	UTIL_FOREACH(this->quests, q)
+	this->world->quest_triggers.Dispatch(this, QuestTriggerIndex::UsedSpell, spell_id, [spell_id](Quest_Context& quest)
 	{
-		if (!q.second || q.second->GetQuest()->Disabled())
-			continue;
-
-		q.second->UsedSpell(spell_id);
-	}
+		quest.UsedSpell(spell_id);
+	});
 }
 
 double Character::SpellCooldownTime() const
@@ -1048,6 +1106,7 @@ bool Character::Unequip(short item, unsigned char subloc)
 			if (((i == Character::Ring2 || i == Character::Armlet2 || i == Character::Bracer2) ? 1 : 0) == subloc)
 			{
 				this->paperdoll[i] = 0;
+				this->InvalidateAvatar();
 				this->AddItem(item, 1);
 				this->CalculateStats();
 				return true;
@@ -1068,6 +1127,7 @@ static bool character_equip_oneslot(Character *character, short item, unsigned c
 	}
 
 	character->paperdoll[slot] = item;
+	character->InvalidateAvatar();
 	character->DelItem(item, 1);
 
 	character->CalculateStats();
@@ -1084,6 +1144,7 @@ static bool character_equip_twoslot(Character *character, short item, unsigned c
 		}
 
 		character->paperdoll[slot1] = item;
+		character->InvalidateAvatar();
 		character->DelItem(item, 1);
 	}
 	else
@@ -1094,6 +1155,7 @@ static bool character_equip_twoslot(Character *character, short item, unsigned c
 		}
 
 		character->paperdoll[slot2] = item;
+		character->InvalidateAvatar();
 		character->DelItem(item, 1);
 	}
 
@@ -1229,7 +1291,7 @@ void Character::Warp(short map, unsigned char x, unsigned char y, WarpAnimation
 		builder.AddChar(WARP_SWITCH);
 		builder.AddShort(map);
 
-		if (this->world->config["GlobalPK"] && !this->world->PKExcept(map))
+		if (this->world->settings.global_pk && !this->world->PKExcept(map))
 		{
 			builder.AddByte(0xFF);
 			builder.AddByte(0x01);
@@ -1279,8 +1341,8 @@ void Character::Warp(short map, unsigned char x, unsigned char y, WarpAnimation
 		this->trade_partner->trade_inventory.clear();
 		this->trade_agree = false;
 
-		this->CheckQuestRules();
-		this->trade_partner->CheckQuestRules();
+		this->CheckQuestRules(QUEST_EVENT_ITEMS);
+		this->trade_partner->CheckQuestRules(QUEST_EVENT_ITEMS);
 
 		this->trade_partner->trade_partner = 0;
 		this->trade_partner = 0;
@@ -1311,31 +1373,33 @@ void Character::Refresh()
 {
 	std::vector<Character *> updatecharacters;
 	std::vector<NPC *> updatenpcs;
-	std::vector<std::shared_ptr<Map_Item>> updateitems;
+	std::vector<Map_Item *> updateitems;
 
-	UTIL_FOREACH(this->map->characters, character)
+	const int seedistance = this->world->settings.see_distance;
+
+	this->map->character_grid.ForEach(this->x, this->y, seedistance, [&](Character *character)
 	{
 		if (this->InRange(character))
 		{
 			updatecharacters.push_back(character);
 		}
-	}
+	});
 
-	UTIL_FOREACH(this->map->npcs, npc)
+	this->map->npc_grid.ForEach(this->x, this->y, seedistance, [&](NPC *npc)
 	{
 		if (this->InRange(npc) && npc->alive)
 		{
 			updatenpcs.push_back(npc);
 		}
-	}
+	});
 
-	UTIL_FOREACH(this->map->items, item)
+	this->map->item_grid.ForEach(this->x, this->y, seedistance, [&](Map_Item *item)
 	{
 		if (this->InRange(*item))
 		{
 			updateitems.push_back(item);
 		}
-	}
+	});
 
 	PacketBuilder builder(PACKET_REFRESH, PACKET_REPLY, 3 + updatecharacters.size() * 60 + updatenpcs.size() * 6 + updateitems.size() * 9);
 	builder.AddChar(static_cast<char>(updatecharacters.size())); // Number of players
@@ -1343,28 +1407,7 @@ void Character::Refresh()
 
 	UTIL_FOREACH(updatecharacters, character)
 	{
-		builder.AddBreakString(character->SourceName());
-		builder.AddShort(character->PlayerID());
-		builder.AddShort(character->mapid);
-		builder.AddShort(character->x);
-		builder.AddShort(character->y);
-		builder.AddChar(character->direction);
-		builder.AddChar(6); // ?
-		builder.AddString(character->PaddedGuildTag());
-		builder.AddChar(character->level);
-		builder.AddChar(character->gender);
-		builder.AddChar(character->hairstyle);
-		builder.AddChar(character->haircolor);
-		builder.AddChar(character->race);
-		builder.AddShort(character->maxhp);
-		builder.AddShort(character->hp);
-		builder.AddShort(character->maxtp);
-		builder.AddShort(character->tp);
-		// equipment
-		character->AddPaperdollData(builder, "B000A0HSW");
-
-		builder.AddChar(character->sitting);
-		builder.AddChar(character->IsHideInvisible());
+		character->AddAvatarData(builder);
 		builder.AddByte(255);
 	}
 
@@ -1519,17 +1562,34 @@ unsigned char Character::SpawnY()
 	return this->world->GetHome(this)->y;
 }
 
-void Character::CheckQuestRules()
+void Character::CheckQuestRules(unsigned events)
 {
 	UTIL_FOREACH(this->quests, q)
 	{
 		if (!q.second || q.second->GetQuest()->Disabled())
 			continue;
 
-		q.second->CheckRules();
+		q.second->CheckRules(events);
 	}
 }
 
+/**
+ * Only quests whose current state has a GotItems or LostItems rule for the item, an IsWearing rule or a rule on weight
+ *  are checked
+ */
+void Character::CheckQuestItemRules(short item)
+{
+	this->world->quest_triggers.Dispatch(this, QuestTriggerIndex::Item, item, [](Quest_Context& quest)
+	{
+		quest.CheckRules(QUEST_EVENT_ITEMS);
+	});
+
+	this->world->quest_triggers.Dispatch(this, QuestTriggerIndex::Inventory, 0, [](Quest_Context& quest)
+	{
+		quest.CheckRules(QUEST_EVENT_ITEMS | QUEST_EVENT_CHARACTER);
+	});
+}
+
 void Character::CalculateStats(bool trigger_quests)
 {
 	const ECF_Data& ecf = world->ecf->Get(this->clas);
@@ -1589,13 +1649,15 @@ void Character::CalculateStats(bool trigger_quests)
 		this->weight = 250;
 	}
 
-	std::unordered_map<std::string, double> formula_vars;
-	this->FormulaVars(formula_vars);
+	const Formulas &formulas = this->world->formulas;
+	std::vector<double> formula_vars;
+	formulas.ResetVars(formula_vars);
+	this->FormulaVars(formula_vars, formulas.character_slots);
 
-	this->maxhp += static_cast<short>(rpn_eval(rpn_parse(this->world->formulas_config["hp"]), formula_vars));
-	this->maxtp += static_cast<short>(rpn_eval(rpn_parse(this->world->formulas_config["tp"]), formula_vars));
-	this->maxsp += static_cast<short>(rpn_eval(rpn_parse(this->world->formulas_config["sp"]), formula_vars));
-	this->maxweight = static_cast<short>(rpn_eval(rpn_parse(this->world->formulas_config["weight"]), formula_vars));
+	this->maxhp += static_cast<short>(formulas.hp.eval(formula_vars));
+	this->maxtp += static_cast<short>(formulas.tp.eval(formula_vars));
+	this->maxsp += static_cast<short>(formulas.sp.eval(formula_vars));
+	this->maxweight = static_cast<short>(formulas.weight.eval(formula_vars));
 
 	if (this->hp > this->maxhp || this->tp > this->maxtp)
 	{
@@ -1624,13 +1686,18 @@ void Character::CalculateStats(bool trigger_quests)
 
 	if (this->world->config["UseClassFormulas"])
 	{
-		auto dam = static_cast<short>(rpn_eval(rpn_parse(this->world->formulas_config["class." + util::to_string(ecf.type) + ".damage"]), formula_vars));
+		const Formulas::Class_Formulas *class_formulas = formulas.Class(ecf.type);
 
-		this->mindam += dam;
-		this->maxdam += dam;
-		this->armor += static_cast<short>(rpn_eval(rpn_parse(this->world->formulas_config["class." + util::to_string(ecf.type) + ".defence"]), formula_vars));
-		this->accuracy += static_cast<short>(rpn_eval(rpn_parse(this->world->formulas_config["class." + util::to_string(ecf.type) + ".accuracy"]), formula_vars));
-		this->evade += static_cast<short>(rpn_eval(rpn_parse(this->world->formulas_config["class." + util::to_string(ecf.type) + ".evade"]), formula_vars));
+		if (class_formulas)
+		{
+			auto dam = static_cast<short>(class_formulas->damage.eval(formula_vars));
+
+			this->mindam += dam;
+			this->maxdam += dam;
+			this->armor += static_cast<short>(class_formulas->defence.eval(formula_vars));
+			this->accuracy += static_cast<short>(class_formulas->accuracy.eval(formula_vars));
+			this->evade += static_cast<short>(class_formulas->evade.eval(formula_vars));
+		}
 	}
 	else
 	{
@@ -1648,7 +1715,7 @@ void Character::CalculateStats(bool trigger_quests)
 		this->maxdam += int(this->world->config["BaseMaxDamage"]);
 
 	if (trigger_quests)
-		this->CheckQuestRules();
+		this->CheckQuestRules(QUEST_EVENT_ITEMS | QUEST_EVENT_SPELLS | QUEST_EVENT_CHARACTER);
 
 	if (this->party)
 	{
@@ -1848,7 +1915,7 @@ void Character::SpikeDamage(int amount)
 {
 	int limitamount = std::min(amount, int(this->hp));
 
-	if (this->world->config["LimitDamage"])
+	if (this->world->settings.limit_damage)
 	{
 		amount = limitamount;
 	}
@@ -1869,7 +1936,7 @@ void Character::SpikeDamage(int amount)
 
 	this->Send(builder2);
 
-	for (Character* watcher : this->map->CharactersInRange(this->x, this->y, static_cast<int>(this->world->config["SeeDistance"])))
+	for (Character* watcher : this->map->CharactersInRange(this->x, this->y, this->world->settings.see_distance))
 	{
 		if (watcher == this)
 			continue;
@@ -1919,31 +1986,61 @@ void Character::PlaySound(unsigned char id)
 	this->Send(builder);
 }
 
+#define CHARACTER_FORMULA_VARS \
+	v(level) vv(exp, "experience") v(hp) v(maxhp) v(tp) v(maxtp) v(maxsp) \
+	v(weight) v(maxweight) v(karma) v(mindam) v(maxdam) \
+	vv(adj_str, "str") vv(adj_intl, "int") vv(adj_wis, "wis") vv(adj_agi, "agi") vv(adj_con, "con") vv(adj_cha, "cha") \
+	vv(str, "base_str") vv(intl, "base_int") vv(wis, "base_wis") vv(agi, "base_agi") vv(con, "base_con") vv(cha, "base_cha") \
+	v(display_str) vv(display_intl, "display_int") v(display_wis) v(display_agi) v(display_con) v(display_cha) \
+	v(accuracy) v(evade) v(armor) v(admin) v(bot) v(usage) \
+	vv(clas, "class") v(gender) v(race) v(hairstyle) v(haircolor) \
+	v(mapid) v(x) v(y) v(direction) v(sitting) v(hidden) v(whispers) v(goldbank) \
+	v(statpoints) v(skillpoints)
+
 #define v(x) vars[prefix + #x] = x;
 #define vv(x, n) vars[prefix + n] = x;
 
 void Character::FormulaVars(std::unordered_map<std::string, double> &vars, std::string prefix)
 {
-	v(level) vv(exp, "experience") v(hp) v(maxhp) v(tp) v(maxtp) v(maxsp)
-	v(weight) v(maxweight) v(karma) v(mindam) v(maxdam)
-	vv(adj_str, "str") vv(adj_intl, "int") vv(adj_wis, "wis") vv(adj_agi, "agi") vv(adj_con, "con") vv(adj_cha, "cha")
-	vv(str, "base_str") vv(intl, "base_int") vv(wis, "base_wis") vv(agi, "base_agi") vv(con, "base_con") vv(cha, "base_cha")
-	v(display_str) vv(display_intl, "display_int") v(display_wis) v(display_agi) v(display_con) v(display_cha)
-	v(accuracy) v(evade) v(armor) v(admin) v(bot) v(usage)
-	vv(clas, "class") v(gender) v(race) v(hairstyle) v(haircolor)
-	v(mapid) v(x) v(y) v(direction) v(sitting) v(hidden) v(whispers) v(goldbank)
-	v(statpoints) v(skillpoints)
+	CHARACTER_FORMULA_VARS
 }
 
 #undef vv
 #undef v
 
+#define v(x) vars[*slot++] = x;
+#define vv(x, n) vars[*slot++] = x;
+
+void Character::FormulaVars(std::vector<double> &vars, const std::vector<std::size_t> &slots)
+{
+	auto slot = slots.begin();
+	CHARACTER_FORMULA_VARS
+}
+
+#undef vv
+#undef v
+
+#define v(x) names.push_back(#x);
+#define vv(x, n) names.push_back(n);
+
+std::vector<std::string> Character::FormulaVarNames()
+{
+	std::vector<std::string> names;
+	CHARACTER_FORMULA_VARS
+	return names;
+}
+
+#undef vv
+#undef v
+#undef CHARACTER_FORMULA_VARS
+
 void Character::Dress(EquipLocation loc, unsigned short gfx_id)
 {
 	if (gfx_id == 0)
 		gfx_id = 65535;
 
 	this->cosmetic_paperdoll[loc] = gfx_id;
+	this->InvalidateAvatar();
 
 	PacketBuilder builder(PACKET_AVATAR, PACKET_AGREE, 14);
 	builder.AddShort(this->PlayerID());
@@ -1965,6 +2062,8 @@ void Character::Undress()
 	for (std::size_t i = 0; i < cosmetic_paperdoll.size(); ++i)
 		this->cosmetic_paperdoll[i] = 0;
 
+	this->InvalidateAvatar();
+
 	PacketBuilder builder(PACKET_AVATAR, PACKET_AGREE, 14);
 	builder.AddShort(this->PlayerID());
 	builder.AddChar(SLOT_CLOTHES);
@@ -1983,6 +2082,7 @@ void Character::Undress()
 void Character::Undress(EquipLocation loc)
 {
 	this->cosmetic_paperdoll[loc] = 0;
+	this->InvalidateAvatar();
 
 	PacketBuilder builder(PACKET_AVATAR, PACKET_AGREE, 14);
 	builder.AddShort(this->PlayerID());
@@ -2038,6 +2138,44 @@ void Character::AddPaperdollData(PacketBuilder& builder, const char* format)
 	}
 }
 
+void Character::AddAvatarData(PacketBuilder& builder)
+{
+	if (this->avatar_data_generation != this->world->avatar_generation || this->avatar_data_version != this->avatar_version)
+	{
+		PacketBuilder paperdoll(PACKET_F_INIT, PACKET_A_INIT, 18);
+		this->AddPaperdollData(paperdoll, "B000A0HSW");
+
+		this->avatar_name = this->SourceName();
+		this->avatar_guild_tag = this->PaddedGuildTag();
+		// Strip the length and ID header
+		this->avatar_paperdoll = paperdoll.Get().substr(4);
+		this->avatar_data_generation = this->world->avatar_generation;
+		this->avatar_data_version = this->avatar_version;
+	}
+
+	builder.AddBreakString(this->avatar_name);
+	builder.AddShort(this->PlayerID());
+	builder.AddShort(this->mapid);
+	builder.AddShort(this->x);
+	builder.AddShort(this->y);
+	builder.AddChar(this->direction);
+	builder.AddChar(6); // ?
+	builder.AddString(this->avatar_guild_tag);
+	builder.AddChar(this->level);
+	builder.AddChar(this->gender);
+	builder.AddChar(this->hairstyle);
+	builder.AddChar(this->haircolor);
+	builder.AddChar(this->race);
+	builder.AddShort(this->maxhp);
+	builder.AddShort(this->hp);
+	builder.AddShort(this->maxtp);
+	builder.AddShort(this->tp);
+	// equipment
+	builder.AddString(this->avatar_paperdoll);
+	builder.AddChar(this->sitting);
+	builder.AddChar(this->IsHideInvisible());
+}
+
 void Character::AddChatLog(std::string marker, std::string name, std::string msg)
 {
 	if (int(chat_log.size()) >= int(this->world->config["ReportChatLogSize"]))
@@ -2064,6 +2202,11 @@ void Character::Send(const PacketBuilder &builder)
 	this->player->Send(builder);
 }
 
+void Character::Send(const PacketBroadcast &packet)
+{
+	this->player->Send(packet);
+}
+
 // thanks cirras <3
 void Character::ShowInfoBox(const std::string& title, const std::vector<std::string>& lines)
 {
@@ -2213,8 +2356,8 @@ void Character::Logout()
 		this->trade_partner->trade_inventory.clear();
 		this->trade_agree = false;
 
-		this->CheckQuestRules();
-		this->trade_partner->CheckQuestRules();
+		this->CheckQuestRules(QUEST_EVENT_ITEMS);
+		this->trade_partner->CheckQuestRules(QUEST_EVENT_ITEMS);
 
 		this->trade_partner->trade_partner = 0;
 		this->trade_partner = 0;
@@ -2252,34 +2395,107 @@ void Character::Logout()
 
 void Character::Save()
 {
-	const std::string & quest_data = (!this->quest_string.empty())
-								   ? this->quest_string
-								   : QuestSerialize(this->quests, this->quests_inactive);
+#ifdef DEBUG
+	Console::Dbg("Saving character '%s' (session lasted %i minutes)", this->real_name.c_str(), int(std::time(0) - this->login_time) / 60);
+#endif // DEBUG
+
+	std::shared_ptr<World_Save_Batch> batch = std::make_shared<World_Save_Batch>();
+	batch->characters.push_back(this->SaveData());
+
+	// Queued behind a running background save so an older copy from it can not land after this one
+	if (!this->world->QueueSave(batch))
+		batch->characters.back().Save(*this->world->db);
+
+	this->last_save = std::make_shared<const Character_Save_Data>(batch->characters.back());
+}
+
+Character_Save_Data Character::SaveData()
+{
+	Character_Save_Data data;
 
 	int nointeract = this->nointeract;
 
 	if (!(nointeract & NoInteractCustom))
 		nointeract = 0;
 
-#ifdef DEBUG
-	Console::Dbg("Saving character '%s' (session lasted %i minutes)", this->real_name.c_str(), int(std::time(0) - this->login_time) / 60);
-#endif // DEBUG
-	this->world->db->Query("UPDATE `characters` SET `title` = '$', `home` = '$', `fiance` = '$', `partner` = '$', `admin` = #, `class` = #, `gender` = #, `race` = #, "
+	data.real_name = this->real_name;
+	data.title = this->title;
+	data.home = this->home;
+	data.fiance = this->fiance;
+	data.partner = this->partner;
+	data.admin = int(this->admin);
+	data.clas = this->clas;
+	data.gender = int(this->gender);
+	data.race = int(this->race);
+	data.hairstyle = this->hairstyle;
+	data.haircolor = this->haircolor;
+	data.mapid = this->mapid;
+	data.x = this->x;
+	data.y = this->y;
+	data.direction = int(this->direction);
+	data.level = this->level;
+	data.exp = this->exp;
+	data.hp = this->hp;
+	data.tp = this->tp;
+	data.str = this->str;
+	data.intl = this->intl;
+	data.wis = this->wis;
+	data.agi = this->agi;
+	data.con = this->con;
+	data.cha = this->cha;
+	data.statpoints = this->statpoints;
+	data.skillpoints = this->skillpoints;
+	data.karma = this->karma;
+	data.sitting = int(this->sitting);
+	data.hidden = int(this->hidden);
+	data.nointeract = nointeract;
+	data.bankmax = this->bankmax;
+	data.goldbank = this->goldbank;
+	data.usage = this->Usage();
+	data.inventory = ItemSerialize(this->inventory);
+	data.bank = ItemSerialize(this->bank);
+	data.paperdoll = DollSerialize(this->paperdoll);
+	data.spells = SpellSerialize(this->spells);
+	data.guild = this->guild ? this->guild->tag : "";
+	data.guild_rank = this->guild_rank;
+	data.guild_rank_string = this->guild_rank_string;
+	data.quest = (!this->quest_string.empty())
+	           ? this->quest_string
+	           : QuestSerialize(this->quests, this->quests_inactive);
+
+	return data;
+}
+
+bool Character_Save_Data::operator ==(const Character_Save_Data& rhs) const
+{
+	return std::tie(real_name, title, home, fiance, partner, admin, clas, gender, race, hairstyle, haircolor,
+	                mapid, x, y, direction, level, exp, hp, tp, str, intl, wis, agi, con, cha,
+	                statpoints, skillpoints, karma, sitting, hidden, nointeract, bankmax, goldbank,
+	                inventory, bank, paperdoll, spells, guild, guild_rank, guild_rank_string, quest)
+	    == std::tie(rhs.real_name, rhs.title, rhs.home, rhs.fiance, rhs.partner, rhs.admin, rhs.clas, rhs.gender, rhs.race, rhs.hairstyle, rhs.haircolor,
+	                rhs.mapid, rhs.x, rhs.y, rhs.direction, rhs.level, rhs.exp, rhs.hp, rhs.tp, rhs.str, rhs.intl, rhs.wis, rhs.agi, rhs.con, rhs.cha,
+	                rhs.statpoints, rhs.skillpoints, rhs.karma, rhs.sitting, rhs.hidden, rhs.nointeract, rhs.bankmax, rhs.goldbank,
+	                rhs.inventory, rhs.bank, rhs.paperdoll, rhs.spells, rhs.guild, rhs.guild_rank, rhs.guild_rank_string, rhs.quest);
+}
+
+void Character_Save_Data::Save(Database& db) const
+{
+	db.Execute("UPDATE `characters` SET `title` = '$', `home` = '$', `fiance` = '$', `partner` = '$', `admin` = #, `class` = #, `gender` = #, `race` = #, "
 		"`hairstyle` = #, `haircolor` = #, `map` = #, `x` = #, `y` = #, `direction` = #, `level` = #, `exp` = #, `hp` = #, `tp` = #, "
 		"`str` = #, `int` = #, `wis` = #, `agi` = #, `con` = #, `cha` = #, `statpoints` = #, `skillpoints` = #, `karma` = #, `sitting` = #, `hidden` = #, "
 		"`nointeract` = #, `bankmax` = #, `goldbank` = #, `usage` = #, `inventory` = '$', `bank` = '$', `paperdoll` = '$', "
 		"`spells` = '$', `guild` = '$', `guild_rank` = #, `guild_rank_string` = '$', `quest` = '$', `vars` = '$' WHERE `name` = '$'",
-		this->title.c_str(), this->home.c_str(), this->fiance.c_str(), this->partner.c_str(), int(this->admin), this->clas, int(this->gender), int(this->race),
-		this->hairstyle, this->haircolor, this->mapid, this->x, this->y, int(this->direction), this->level, this->exp, this->hp, this->tp,
-		this->str, this->intl, this->wis, this->agi, this->con, this->cha, this->statpoints, this->skillpoints, this->karma, int(this->sitting), int(this->hidden),
-		nointeract, this->bankmax, this->goldbank, this->Usage(), ItemSerialize(this->inventory).c_str(), ItemSerialize(this->bank).c_str(),
-		DollSerialize(this->paperdoll).c_str(), SpellSerialize(this->spells).c_str(), (this->guild ? this->guild->tag.c_str() : ""),
-		this->guild_rank, this->guild_rank_string.c_str(), quest_data.c_str(), "", this->real_name.c_str());
+		title.c_str(), home.c_str(), fiance.c_str(), partner.c_str(), admin, clas, gender, race,
+		hairstyle, haircolor, mapid, x, y, direction, level, exp, hp, tp,
+		str, intl, wis, agi, con, cha, statpoints, skillpoints, karma, sitting, hidden,
+		nointeract, bankmax, goldbank, usage, inventory.c_str(), bank.c_str(),
+		paperdoll.c_str(), spells.c_str(), guild.c_str(),
+		guild_rank, guild_rank_string.c_str(), quest.c_str(), "", real_name.c_str());
 }
 
 AdminLevel Character::SourceAccess() const
 {
-	return world->config["UseDutyAdmin"] ? player->Admin() : admin;
+	return world->settings.use_duty_admin ? player->Admin() : admin;
 }
 
 AdminLevel Character::SourceDutyAccess() const
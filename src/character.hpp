@@ -22,6 +22,7 @@
 #include "command_source.hpp"
 #include "eodata.hpp"
 #include "map.hpp"
+#include "util/variant.hpp"
 
 #include <array>
 #include <deque>
@@ -31,6 +32,7 @@
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 struct Timestamp
 {
@@ -134,6 +136,39 @@ struct Character_QuestState
 	}
 };
 
+/**
+ * Copy of the values Character::Save writes to the characters table
+ * Taken on the main thread so it can be compared with the last save and written from another thread
+ */
+struct Character_Save_Data
+{
+	std::string real_name;
+	std::string title;
+	std::string home;
+	std::string fiance;
+	std::string partner;
+	int admin, clas, gender, race, hairstyle, haircolor;
+	int mapid, x, y, direction;
+	int level, exp, hp, tp;
+	int str, intl, wis, agi, con, cha;
+	int statpoints, skillpoints, karma, sitting, hidden, nointeract;
+	int bankmax, goldbank, usage;
+	std::string inventory;
+	std::string bank;
+	std::string paperdoll;
+	std::string spells;
+	std::string guild;
+	int guild_rank;
+	std::string guild_rank_string;
+	std::string quest;
+
+	// Leaves out usage, which grows every minute a character is online, so it is only written along with other changes or on logout
+	bool operator ==(const Character_Save_Data& rhs) const;
+	bool operator !=(const Character_Save_Data& rhs) const { return !(*this == rhs); }
+
+	void Save(Database& db) const;
+};
+
 class Character : public Command_Source
 {
 	public:
@@ -284,6 +319,27 @@ class Character : public Command_Source
 		Character(World *);
 		Character(std::string name, World *, Database * = nullptr);
 
+		/**
+		 * Constructs a character from a row of the characters table
+		 */
+		Character(std::unordered_map<std::string, util::variant> row, World *, Database * = nullptr);
+
+		/**
+		 * Loads every character on an account, highest experience first.
+		 * All characters are read with one query, and their guilds are loaded together before the characters are built.
+		 */
+		static std::vector<Character *> LoadAccount(const std::string& account, World *, Database * = nullptr);
+
+		/**
+		 * Reads the rows LoadAccount builds characters from. Only touches the database, so it is safe to call from any thread.
+		 */
+		static Database_Result QueryAccount(const std::string& account, Database& database);
+
+		/**
+		 * Builds the characters from rows read by QueryAccount. Their guilds must already be cached.
+		 */
+		static std::vector<Character *> LoadAccount(Database_Result& rows, World *);
+
 		bool IsHideInvisible() const { return hidden & HideInvisible; }
 		bool IsHideOnline() const { return hidden & HideOnline; }
 		bool IsHideNpc() const { return hidden & HideNpc; }
@@ -344,7 +400,8 @@ class Character : public Command_Source
 		short SpawnMap();
 		unsigned char SpawnX();
 		unsigned char SpawnY();
-		void CheckQuestRules();
+		void CheckQuestRules(unsigned events = QUEST_EVENT_ALL);
+		void CheckQuestItemRules(short item);
 		void CalculateStats(bool trigger_quests = true);
 		void DropAll(Character *killer);
 		void Hide(int setflags);
@@ -361,15 +418,29 @@ class Character : public Command_Source
 
 		void FormulaVars(std::unordered_map<std::string, double> &vars, std::string prefix = "");
 
+		/**
+		 * Fills in formula variables by slot, in the order of FormulaVarNames
+		 */
+		void FormulaVars(std::vector<double> &vars, const std::vector<std::size_t> &slots);
+
+		static std::vector<std::string> FormulaVarNames();
+
 		void Dress(EquipLocation, unsigned short gfx_id);
 		void Undress();
 		void Undress(EquipLocation);
 		void AddPaperdollData(PacketBuilder&, const char* format);
 
+		/**
+		 * Adds the character as other players see it on the map, as used by refresh, enter and warp packets.
+		 * The bytes are cached and only rebuilt when something that goes in to them has changed.
+		 */
+		void AddAvatarData(PacketBuilder&);
+
 		void AddChatLog(std::string marker, std::string name, std::string msg);
 		std::string GetChatLogDump();
 
 		void Send(const PacketBuilder &);
+		void Send(const PacketBroadcast &);
 
 		void ShowInfoBox(const std::string& title, const std::vector<std::string>& lines);
 		void ShowInfoBox(const std::string& title, const std::string& content);
@@ -377,6 +448,26 @@ class Character : public Command_Source
 		void Logout();
 		void Save();
 
+		Character_Save_Data SaveData();
+
+		/**
+		 * Values last queued or written by World::TimedSave, used to skip characters that have not changed
+		 */
+		std::shared_ptr<const Character_Save_Data> last_save;
+
+		// Parts of AddAvatarData that only change with avatar_version or World::avatar_generation, encoded once until either does
+		std::string avatar_name;
+		std::string avatar_guild_tag;
+		std::string avatar_paperdoll;
+		unsigned int avatar_data_generation = 0;
+		unsigned int avatar_data_version = 0;
+		unsigned int avatar_version = 0;
+
+		/**
+		 * Must be called after changing the name shown, guild or paperdoll, so AddAvatarData rebuilds its cached parts
+		 */
+		void InvalidateAvatar() { ++this->avatar_version; }
+
 		AdminLevel SourceAccess() const;
 		AdminLevel SourceDutyAccess() const;
 		std::string SourceName() const;
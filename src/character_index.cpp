@@ -0,0 +1,75 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "character_index.hpp"
+
+#include "character.hpp"
+
+#include <string>
+#include <unordered_map>
+
+template <class Key> static Character *character_index_find(const std::unordered_map<Key, Character *> &index, const Key &key)
+{
+	auto it = index.find(key);
+	return (it != index.end()) ? it->second : nullptr;
+}
+
+template <class Key> static void character_index_erase(std::unordered_map<Key, Character *> &index, const Key &key, Character *character)
+{
+	auto it = index.find(key);
+
+	if (it != index.end() && it->second == character)
+	{
+		index.erase(it);
+		return;
+	}
+
+	// The key has changed since the character was added, fall back to searching for it
+	for (it = index.begin(); it != index.end(); ++it)
+	{
+		if (it->second == character)
+		{
+			index.erase(it);
+			return;
+		}
+	}
+}
+
+void CharacterIndex::Add(Character *character)
+{
+	this->by_name[character->SourceName()] = character;
+	this->by_real_name[character->real_name] = character;
+	this->by_pid[character->PlayerID()] = character;
+	this->by_cid[character->id] = character;
+}
+
+void CharacterIndex::Remove(Character *character)
+{
+	character_index_erase(this->by_name, character->SourceName(), character);
+	character_index_erase(this->by_real_name, character->real_name, character);
+	character_index_erase(this->by_pid, character->PlayerID(), character);
+	character_index_erase(this->by_cid, character->id, character);
+}
+
+Character *CharacterIndex::GetName(const std::string &name) const
+{
+	return character_index_find(this->by_name, name);
+}
+
+Character *CharacterIndex::GetRealName(const std::string &real_name) const
+{
+	return character_index_find(this->by_real_name, real_name);
+}
+
+Character *CharacterIndex::GetPID(unsigned int id) const
+{
+	return character_index_find(this->by_pid, id);
+}
+
+Character *CharacterIndex::GetCID(unsigned int id) const
+{
+	return character_index_find(this->by_cid, id);
+}
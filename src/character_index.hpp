@@ -0,0 +1,49 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef CHARACTER_INDEX_HPP_INCLUDED
+#define CHARACTER_INDEX_HPP_INCLUDED
+
+#include "fwd/character.hpp"
+
+#include <string>
+#include <unordered_map>
+
+/**
+ * Hash indexes of a list of characters by name, real name, player ID and character ID.
+ * Must be kept in sync with the list it indexes.
+ */
+class CharacterIndex
+{
+	private:
+		std::unordered_map<std::string, Character *> by_name;
+		std::unordered_map<std::string, Character *> by_real_name;
+		std::unordered_map<unsigned int, Character *> by_pid;
+		std::unordered_map<unsigned int, Character *> by_cid;
+
+	public:
+		void Add(Character *character);
+
+		/**
+		 * Removes a character from every index, even if its name has changed since it was added.
+		 */
+		void Remove(Character *character);
+
+		/**
+		 * Finds a character by the name it is shown as (SourceName). name must already be lowercase.
+		 */
+		Character *GetName(const std::string &name) const;
+
+		/**
+		 * Finds a character by its real name. real_name must already be lowercase.
+		 */
+		Character *GetRealName(const std::string &real_name) const;
+
+		Character *GetPID(unsigned int id) const;
+		Character *GetCID(unsigned int id) const;
+};
+
+#endif // CHARACTER_INDEX_HPP_INCLUDED
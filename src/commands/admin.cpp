@@ -98,6 +98,7 @@ void Duty(const std::vector<std::string>& arguments, Character* from)
 	}
 
 	swap->faux_name = from->SourceName();
+	swap->InvalidateAvatar();
 
 	world->Login(swap);
 	swap->CalculateStats();
@@ -280,26 +281,7 @@ void Duty(const std::vector<std::string>& arguments, Character* from)
 		reply.AddChar(1); // Number of players
 		reply.AddByte(255);
 
-		reply.AddBreakString(swap->SourceName());
-		reply.AddShort(swap->PlayerID());
-		reply.AddShort(swap->mapid);
-		reply.AddShort(swap->x);
-		reply.AddShort(swap->y);
-		reply.AddChar(swap->direction);
-		reply.AddChar(6); // ?
-		reply.AddString(swap->PaddedGuildTag());
-		reply.AddChar(swap->level);
-		reply.AddChar(swap->gender);
-		reply.AddChar(swap->hairstyle);
-		reply.AddChar(swap->haircolor);
-		reply.AddChar(swap->race);
-		reply.AddShort(swap->maxhp);
-		reply.AddShort(swap->hp);
-		reply.AddShort(swap->maxtp);
-		reply.AddShort(swap->tp);
-		swap->AddPaperdollData(reply, "B000A0HSW");
-		reply.AddChar(swap->sitting);
-		reply.AddChar(swap->IsHideInvisible());
+		swap->AddAvatarData(reply);
 		reply.AddByte(255);
 
 		reply.AddByte(255);
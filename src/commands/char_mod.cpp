@@ -193,7 +193,7 @@ void SetXLimited(const std::vector<std::string>& arguments, Command_Source* from
 
 			if (!stats && !skillpoints && !appearance)
 			{
-				victim->CheckQuestRules();
+				victim->CheckQuestRules(QUEST_EVENT_CHARACTER);
 			}
 		}
 	}
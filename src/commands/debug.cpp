@@ -100,7 +100,10 @@ void SpawnNPC(const std::vector<std::string>& arguments, Character* from)
 		unsigned char index = from->map->GenerateNPCIndex();
 
 		if (index > 250)
+		{
+			from->map->npc_indexes.Release(index);
 			break;
+		}
 
 		NPC *npc = new NPC(from->map, id, from->x, from->y, speed, direction, index, true);
 		from->map->npcs.push_back(npc);
@@ -16,8 +16,11 @@
 
 #include "../console.hpp"
 #include "../util.hpp"
+#include "../util/threadpool.hpp"
 
+#include <algorithm>
 #include <csignal>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -178,6 +181,43 @@ void Uptime(const std::vector<std::string>& arguments, Command_Source* from)
 	from->ServerMsg(buffer);
 }
 
+void ThreadPoolStats(const std::vector<std::string>& arguments, Command_Source* from)
+{
+	(void)arguments;
+
+	static const char* lane_names[util::ThreadPool::PriorityCount] = {"Interactive", "Background"};
+
+	util::ThreadPool::Stats stats = util::ThreadPool::GetStats();
+
+	from->ServerMsg("Threads: " + std::to_string(stats.threads) + ", steals: " + std::to_string(stats.steals));
+
+	for (int lane = 0; lane < util::ThreadPool::PriorityCount; ++lane)
+	{
+		const util::ThreadPool::LaneStats& lane_stats = stats.lanes[lane];
+		std::uint64_t started = std::max<std::uint64_t>(lane_stats.completed, 1);
+
+		from->ServerMsg(std::string(lane_names[lane]) + ": " + std::to_string(lane_stats.depth) + " waiting, "
+		 + std::to_string(lane_stats.completed) + "/" + std::to_string(lane_stats.queued) + " done");
+
+		from->ServerMsg("  wait avg " + std::to_string(lane_stats.wait_total_us / started / 1000) + "ms max "
+		 + std::to_string(lane_stats.wait_max_us / 1000) + "ms, run avg " + std::to_string(lane_stats.run_total_us / started / 1000) + "ms");
+	}
+}
+
+void LoginStats(const std::vector<std::string>& arguments, Command_Source* from)
+{
+	(void)arguments;
+
+	LoginManager::Stats stats = from->SourceWorld()->LoginStats();
+	std::uint64_t hashes = std::max<std::uint64_t>(stats.hashes, 1);
+
+	from->ServerMsg("Logins: " + std::to_string(stats.running) + " running, " + std::to_string(stats.waiting) + " waiting");
+	from->ServerMsg("  " + std::to_string(stats.admitted) + " admitted, " + std::to_string(stats.busy) + " busy, "
+	 + std::to_string(stats.rate_limited) + " rate limited, " + std::to_string(stats.cache_hits) + " cached");
+	from->ServerMsg("  " + std::to_string(stats.hashes) + " hashes, avg " + std::to_string(stats.hash_total_us / hashes / 1000) + "ms max "
+	 + std::to_string(stats.hash_max_us / 1000) + "ms");
+}
+
 COMMAND_HANDLER_REGISTER(server)
 	RegisterCharacter({"remap", {}, {"mapid"}, 3}, ReloadMap);
 	Register({"repub", {}, {"announce"}, 3}, ReloadPub);
@@ -187,6 +227,8 @@ COMMAND_HANDLER_REGISTER(server)
 	Register({"reload", {}, {}, 6}, Reload);
 	Register({"cancel", {}, {}, 6}, Cancel);
 	Register({"uptime"}, Uptime);
+	Register({"threadpool"}, ThreadPoolStats);
+	Register({"logins"}, LoginStats);
 COMMAND_HANDLER_REGISTER_END(server)
 
 }
@@ -6,9 +6,20 @@
 
 #include "console.hpp"
 
+#include "util/mpsc_queue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
+#include <cstddef>
 #include <cstdio>
+#include <cstdlib>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "platform.h"
 
@@ -23,6 +34,25 @@ bool Styled[2] = {true, true};
 
 static bool OutputSuppressed = false;
 
+static std::atomic<int> MinLevel(LEVEL_DEBUG);
+
+struct Line
+{
+	Stream stream;
+	Color color;
+	bool bold;
+	std::string text;
+};
+
+// Held while writing to stdout/stderr so lines from the writer thread and direct writes never interleave
+static std::mutex WriteLock;
+
+static util::MPSCQueue<Line> Pending;
+static std::atomic<bool> AsyncRunning(false);
+static std::thread Writer;
+static std::mutex WakeLock;
+static std::condition_variable WakeCondition;
+
 #ifdef WIN32
 
 static HANDLE Handles[2];
@@ -78,25 +108,106 @@ void ResetTextColor(Stream stream)
 
 #endif // WIN32
 
+static std::string Format(const char *prefix, const char *f, va_list args)
+{
+	// Each thread formats into its own buffer, nothing is shared until the line is queued
+	thread_local std::vector<char> buffer(256);
+
+	va_list measure;
+	va_copy(measure, args);
+	int length = std::vsnprintf(buffer.data(), buffer.size(), f, measure);
+	va_end(measure);
+
+	if (length < 0)
+		length = 0;
+
+	if (std::size_t(length) >= buffer.size())
+	{
+		buffer.resize(length + 1);
+		std::vsnprintf(buffer.data(), buffer.size(), f, args);
+	}
+
+	std::string text;
+	text.reserve(length + 7);
+	text += '[';
+	text += prefix;
+	text += "] ";
+	text.append(buffer.data(), length);
+	text += '\n';
+
+	return text;
+}
+
+static void WriteLine(const Line &line)
+{
+	if (Styled[line.stream]) SetTextColor(line.stream, line.color, line.bold);
+	std::fputs(line.text.c_str(), (line.stream == STREAM_OUT) ? stdout : stderr);
+	if (Styled[line.stream]) ResetTextColor(line.stream);
+}
+
+static void Emit(Line &&line)
+{
+	if (line.stream == STREAM_OUT && AsyncRunning)
+	{
+		Pending.Push(std::move(line));
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(WriteLock);
+	WriteLine(line);
+	std::fflush((line.stream == STREAM_OUT) ? stdout : stderr);
+}
+
+// Must only run on one thread at a time: the writer thread, or StopAsync once the writer has been joined
+static void Drain()
+{
+	Line line;
+	bool wrote = false;
+
+	std::lock_guard<std::mutex> guard(WriteLock);
+
+	while (Pending.Pop(line))
+	{
+		WriteLine(line);
+		wrote = true;
+	}
+
+	if (wrote)
+		std::fflush(stdout);
+}
+
+static void WriterProc()
+{
+	while (AsyncRunning)
+	{
+		{
+			std::unique_lock<std::mutex> wake(WakeLock);
+			WakeCondition.wait_for(wake, std::chrono::milliseconds(10), []() { return !AsyncRunning; });
+		}
+
+		// Everything queued in the last interval goes out as a single write
+		Drain();
+	}
+}
+
 #define CONSOLE_GENERIC_OUT(prefix, stream, color, bold) \
 do { \
-	if (Styled[stream]) SetTextColor(stream, color, bold); \
 	va_list args; \
 	va_start(args, f); \
-	std::vfprintf((stream == STREAM_OUT) ? stdout : stderr, (std::string("[" prefix "] ") + f + "\n").c_str(), args); \
+	std::string text = Format(prefix, f, args); \
 	va_end(args); \
-	if (Styled[stream]) ResetTextColor(stream); \
+	Emit(Line{stream, color, bold, std::move(text)}); \
 } while (false)
 
 void Out(const char* f, ...)
 {
-	if (OutputSuppressed) return;
+	if (OutputSuppressed || MinLevel > LEVEL_INFO) return;
 	CONSOLE_GENERIC_OUT("   ", STREAM_OUT, COLOR_GREY, true);
 }
 
 void Wrn(const char* f, ...)
 {
-	if (OutputSuppressed) return;
+	if (OutputSuppressed || MinLevel > LEVEL_WARNING) return;
 	CONSOLE_GENERIC_OUT("WRN", STREAM_OUT, COLOR_YELLOW, true);
 }
 
@@ -104,17 +215,22 @@ void Err(const char* f, ...)
 {
 	if (OutputSuppressed) return;
 
+	va_list args;
+	va_start(args, f);
+	std::string text = Format("ERR", f, args);
+	va_end(args);
+
 	if (!Styled[STREAM_ERR])
 	{
-		CONSOLE_GENERIC_OUT("ERR", STREAM_OUT, COLOR_RED, true);
+		Emit(Line{STREAM_OUT, COLOR_RED, true, text});
 	}
 
-	CONSOLE_GENERIC_OUT("ERR", STREAM_ERR, COLOR_RED, true);
+	Emit(Line{STREAM_ERR, COLOR_RED, true, std::move(text)});
 }
 
 void Dbg(const char* f, ...)
 {
-	if (OutputSuppressed) return;
+	if (OutputSuppressed || MinLevel > LEVEL_DEBUG) return;
 	CONSOLE_GENERIC_OUT("DBG", STREAM_OUT, COLOR_GREY, false);
 }
 
@@ -123,5 +239,51 @@ void SuppressOutput(bool suppress)
 	OutputSuppressed = suppress;
 }
 
+void SetLevel(Level level)
+{
+	MinLevel = level;
+}
+
+void StartAsync()
+{
+	if (AsyncRunning)
+		return;
+
+	// Catches the std::exit calls that skip Cleanup, the writer must not be left running when statics are destroyed
+	static bool registered = false;
+
+	if (!registered)
+	{
+		std::atexit(StopAsync);
+		registered = true;
+	}
+
+	AsyncRunning = true;
+	Writer = std::thread(WriterProc);
+}
+
+void StopAsync()
+{
+	if (!AsyncRunning)
+		return;
+
+	{
+		std::lock_guard<std::mutex> wake(WakeLock);
+		AsyncRunning = false;
+	}
+
+	WakeCondition.notify_one();
+
+	// The crash handler can end up here on the writer thread itself
+	if (Writer.get_id() == std::this_thread::get_id())
+	{
+		Writer.detach();
+		return;
+	}
+
+	Writer.join();
+
+	Drain();
 }
 
+}
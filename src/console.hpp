@@ -34,6 +34,17 @@ enum Stream
 	STREAM_ERR
 };
 
+/**
+ * Lowest severity that is written, anything below is dropped before it is formatted
+ */
+enum Level
+{
+	LEVEL_DEBUG,
+	LEVEL_INFO,
+	LEVEL_WARNING,
+	LEVEL_ERROR
+};
+
 void Out(const char* f, ...);
 void Wrn(const char* f, ...);
 void Err(const char* f, ...);
@@ -41,6 +52,19 @@ void Dbg(const char* f, ...);
 
 void SuppressOutput(bool suppress);
 
+void SetLevel(Level level);
+
+/**
+ * Hands output to a background writer thread instead of writing it on the calling thread
+ * Errors sent to stderr are always written immediately
+ */
+void StartAsync();
+
+/**
+ * Stops the writer thread and writes anything it left queued, must be called before redirecting or exiting
+ */
+void StopAsync();
+
 }
 
 #endif // CONSOLE_HPP_INCLUDED
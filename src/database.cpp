@@ -17,14 +17,20 @@
 #include "util/variant.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
 #include <exception>
 #include <fstream>
 #include <list>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 #include "database_impl.hpp"
 
@@ -44,6 +50,9 @@
 #define SQLSERVER_SUCCEEDED(x) (x == SQL_SUCCESS || x == SQL_SUCCESS_WITH_INFO)
 #endif
 
+// Thrown by Database::ExecutePrepared when the server connection was lost, so the statement can be retried after reconnecting
+struct database_statement_connection_lost { };
+
 struct Database::impl_
 {
 	union
@@ -80,6 +89,57 @@ struct Database::impl_
 SQLHENV Database::impl_::hEnv = SQL_NULL_HENV;
 #endif //DATABASE_SQLSERVER
 
+struct Database::Statement
+{
+	// Query text using '?' parameter markers
+	std::string query;
+
+	// Parameter types in order, '#' for integers and '$' for strings
+	std::string types;
+
+#ifdef DATABASE_MYSQL
+	MYSQL_STMT *mysql_stmt;
+#endif // DATABASE_MYSQL
+#ifdef DATABASE_SQLITE
+	sqlite3_stmt *sqlite_stmt;
+#endif // DATABASE_SQLITE
+#ifdef DATABASE_SQLSERVER
+	HSTMT hstmt;
+#endif // DATABASE_SQLSERVER
+
+	Statement(const StatementQueryPair& parsed)
+		: query(parsed.first)
+		, types(parsed.second)
+#ifdef DATABASE_MYSQL
+		, mysql_stmt(nullptr)
+#endif // DATABASE_MYSQL
+#ifdef DATABASE_SQLITE
+		, sqlite_stmt(nullptr)
+#endif // DATABASE_SQLITE
+#ifdef DATABASE_SQLSERVER
+		, hstmt(SQL_NULL_HSTMT)
+#endif // DATABASE_SQLSERVER
+	{ }
+
+	Statement(const Statement&) = delete;
+
+	~Statement()
+	{
+#ifdef DATABASE_MYSQL
+		if (mysql_stmt)
+			mysql_stmt_close(mysql_stmt);
+#endif // DATABASE_MYSQL
+#ifdef DATABASE_SQLITE
+		if (sqlite_stmt)
+			sqlite3_finalize(sqlite_stmt);
+#endif // DATABASE_SQLITE
+#ifdef DATABASE_SQLSERVER
+		if (hstmt != SQL_NULL_HSTMT)
+			SQLFreeHandle(SQL_HANDLE_STMT, hstmt);
+#endif // DATABASE_SQLSERVER
+	}
+};
+
 #ifdef DATABASE_SQLSERVER
 void HandleSqlServerError(SQLSMALLINT handleType, SQLHANDLE handle, SQLRETURN code, void (*consoleFunc)(const char*, ...), std::list<int>* errorCodes = nullptr)
 {
@@ -117,6 +177,36 @@ void HandleSqlServerError(SQLSMALLINT handleType, SQLHANDLE handle, SQLRETURN co
 }
 #endif
 
+#ifdef DATABASE_MYSQL
+// Builds the literal text of a prepared statement, so it can be replayed if the connection drops mid-transaction
+static std::string mysql_statement_text(MYSQL *handle, const char *format, const std::vector<util::variant>& params)
+{
+	std::string query;
+	std::size_t param = 0;
+
+	for (const char *p = format; *p != '\0'; ++p)
+	{
+		if (*p == '#')
+		{
+			query += util::to_string(params[param++].GetInt());
+		}
+		else if (*p == '$')
+		{
+			std::string value = params[param++].GetString();
+			std::string escaped(value.length() * 2 + 1, '\0');
+			escaped.resize(mysql_real_escape_string(handle, &escaped[0], value.c_str(), value.length()));
+			query += escaped;
+		}
+		else
+		{
+			query += *p;
+		}
+	}
+
+	return query;
+}
+#endif // DATABASE_MYSQL
+
 #ifdef DATABASE_SQLITE
 static int sqlite_callback(void *data, int num, char *fields[], char *columns[])
 {
@@ -163,6 +253,54 @@ bool Database_Result::Error()
 	return this->error;
 }
 
+Database_Statement_Result::Database_Statement_Result(const Database_Result& result)
+	: affected_rows(const_cast<Database_Result&>(result).AffectedRows())
+{
+	if (result.empty())
+		return;
+
+	for (const auto& column : result.front())
+		this->columns.push_back(column.first);
+
+	std::sort(UTIL_RANGE(this->columns));
+
+	this->reserve(result.size());
+
+	for (const auto& row : result)
+	{
+		std::vector<util::variant> values;
+		values.reserve(this->columns.size());
+
+		for (const std::string& column : this->columns)
+		{
+			auto it = row.find(column);
+			values.push_back(it != row.end() ? it->second : util::variant(""));
+		}
+
+		this->push_back(std::move(values));
+	}
+}
+
+const std::vector<std::string>& Database_Statement_Result::Columns() const
+{
+	return this->columns;
+}
+
+std::size_t Database_Statement_Result::Column(const std::string& name) const
+{
+	auto it = std::find(UTIL_CRANGE(this->columns), name);
+
+	if (it == this->columns.end())
+		throw Database_QueryFailed("Unknown column in statement result");
+
+	return it - this->columns.begin();
+}
+
+int Database_Statement_Result::AffectedRows() const
+{
+	return this->affected_rows;
+}
+
 std::shared_ptr<Database> DatabaseFactory::CreateDatabase(Config& config, bool logConnection)
 {
 	auto dbType = util::lowercase(std::string(config["DBType"]));
@@ -273,6 +411,164 @@ std::shared_ptr<Database> DatabaseFactory::CreateDatabase(Config& config, bool l
 	return std::shared_ptr<Database>(new Database(engine, dbHost, dbPort, dbAuthType, dbUser, dbPass, dbName));
 }
 
+bool DatabaseFactory::SharesConnection(Config& config)
+{
+	return !util::lowercase(std::string(config["DBType"])).compare("sqlite");
+}
+
+std::shared_ptr<Database> DatabaseFactory::GetDatabase(Config& config)
+{
+	if (DatabaseFactory::SharesConnection(config))
+		return this->CreateDatabase(config);
+
+	const std::size_t pool_size = std::max(int(config["DBPoolSize"]), 1);
+	const std::chrono::duration<double> idle_timeout(static_cast<double>(config["DBPoolIdleTimeout"]));
+	const std::chrono::duration<double> check_interval(static_cast<double>(config["DBPoolCheckInterval"]));
+	const std::chrono::duration<double> wait_timeout(static_cast<double>(config["DBPoolWaitTimeout"]));
+
+	const std::shared_ptr<Pool> pool = this->_pool;
+	const auto thread_id = std::this_thread::get_id();
+	const auto now = std::chrono::steady_clock::now();
+	const auto deadline = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(wait_timeout);
+
+	std::shared_ptr<Database> database;
+	bool check = false;
+	unsigned long serial;
+
+	{
+		std::unique_lock<std::mutex> lock(pool->mutex);
+
+		while (true)
+		{
+			auto it = pool->connections.find(thread_id);
+
+			if (it != pool->connections.end())
+			{
+				if (it->second.users == 0 && now - it->second.last_used > idle_timeout)
+				{
+					it->second.database.reset();
+				}
+				else
+				{
+					database = it->second.database;
+					check = (it->second.users == 0 && now - it->second.last_used > check_interval);
+				}
+
+				++it->second.users;
+				serial = it->second.serial;
+				break;
+			}
+
+			if (pool->connections.size() < pool_size)
+			{
+				serial = pool->next_serial++;
+				pool->connections[thread_id] = Pooled_Database{nullptr, now, 1, serial};
+				break;
+			}
+
+			// Make room by closing the connection that has gone unused the longest
+			auto oldest = pool->connections.end();
+
+			for (auto it = pool->connections.begin(); it != pool->connections.end(); ++it)
+			{
+				if (it->second.users == 0 && (oldest == pool->connections.end() || it->second.last_used < oldest->second.last_used))
+					oldest = it;
+			}
+
+			if (oldest != pool->connections.end())
+			{
+				pool->connections.erase(oldest);
+				continue;
+			}
+
+			if (pool->released.wait_until(lock, deadline) == std::cv_status::timeout)
+				throw Database_OpenFailed("Timed out waiting for a free database connection");
+		}
+	}
+
+	// The slot is held from here on, so it has to be given back if opening the connection fails
+	auto release = [pool, thread_id, serial]()
+	{
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		auto it = pool->connections.find(thread_id);
+
+		if (it != pool->connections.end() && it->second.serial == serial)
+		{
+			if (--it->second.users == 0 && !it->second.database)
+				pool->connections.erase(it);
+			else
+				it->second.last_used = std::chrono::steady_clock::now();
+		}
+
+		pool->released.notify_all();
+	};
+
+	try
+	{
+		if (database && check)
+		{
+			try
+			{
+				database->RawQuery("SELECT 1");
+			}
+			catch (Database_Exception& e)
+			{
+				Console::Wrn("Pooled database connection failed health check: %s", e.error());
+				database.reset();
+			}
+		}
+
+		if (!database)
+		{
+			// Connecting can be slow, so the pool is not locked while it happens
+			database = this->CreateDatabase(config);
+
+			std::lock_guard<std::mutex> lock(pool->mutex);
+			auto it = pool->connections.find(thread_id);
+
+			if (it != pool->connections.end() && it->second.serial == serial)
+				it->second.database = database;
+		}
+	}
+	catch (...)
+	{
+		release();
+		throw;
+	}
+
+	// The handle counts as a user of the slot until every copy of it is released
+	std::shared_ptr<void> lease(nullptr, [release, database](void *) { release(); });
+	return std::shared_ptr<Database>(lease, database.get());
+}
+
+void DatabaseFactory::ExpireIdle(Config& config)
+{
+	if (!util::lowercase(std::string(config["DBType"])).compare("sqlite"))
+		return;
+
+	const std::chrono::duration<double> idle_timeout(static_cast<double>(config["DBPoolIdleTimeout"]));
+	const auto now = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(this->_pool->mutex);
+
+	for (auto it = this->_pool->connections.begin(); it != this->_pool->connections.end(); )
+	{
+		if (it->second.users == 0 && now - it->second.last_used > idle_timeout)
+			it = this->_pool->connections.erase(it);
+		else
+			++it;
+	}
+
+	this->_pool->released.notify_all();
+}
+
+void DatabaseFactory::ClearPool()
+{
+	std::lock_guard<std::mutex> lock(this->_pool->mutex);
+	this->_pool->connections.clear();
+	this->_pool->released.notify_all();
+}
+
 Database::Bulk_Query_Context::Bulk_Query_Context(Database& db)
 	: db(db)
 	, pending(false)
@@ -620,6 +916,12 @@ void Database::Close()
 
 	this->connected = false;
 
+	{
+		// Statements belong to the connection, so they have to be released before it closes
+		std::lock_guard<std::mutex> lock(this->statement_mutex);
+		this->statements.clear();
+	}
+
 	switch (this->engine)
 	{
 		case MySQL:
@@ -1110,6 +1412,470 @@ Database_Result Database::Query(const char *format, ...)
 		prepared);
 }
 
+Database::StatementQueryPair Database::ParseStatementQuery(const char *format) const
+{
+	std::string query;
+	std::string types;
+
+	bool removeQuote = false;
+	for (const char *p = format; *p != '\0'; ++p)
+	{
+		if (*p == '#' || *p == '$')
+		{
+			// Bound string parameters are not quoted
+			if (*p == '$' && !query.empty() && query.back() == '\'')
+			{
+				query.pop_back();
+				removeQuote = true;
+			}
+
+			query += '?';
+			types += *p;
+		}
+		else if (*p == '@')
+		{
+			throw Database_QueryFailed("'@' substitutions can not be used in a prepared statement");
+		}
+		else if (*p == '\'' && removeQuote)
+		{
+			removeQuote = false;
+		}
+		else if (*p != '`' || this->engine != SqlServer)
+		{
+			query += *p;
+		}
+	}
+
+	return StatementQueryPair(query, types);
+}
+
+Database_Statement_Result Database::Execute(const char *format, ...)
+{
+	std::vector<util::variant> params;
+
+	std::va_list ap;
+	va_start(ap, format);
+
+	for (const char *p = format; *p != '\0'; ++p)
+	{
+		if (*p == '#')
+			params.emplace_back(va_arg(ap, int));
+		else if (*p == '$')
+			params.emplace_back(std::string(va_arg(ap, const char *)));
+		else if (*p == '@')
+			(void)va_arg(ap, const char *);
+	}
+
+	va_end(ap);
+
+	return this->ExecuteStatement(format, params);
+}
+
+Database_Statement_Result Database::ExecuteStatement(const char *format, const std::vector<util::variant>& params)
+{
+	if (!this->connected)
+	{
+		throw Database_QueryFailed("Not connected to database.");
+	}
+
+	this->CheckThreadAffinity();
+
+	for (int attempt = 1; ; ++attempt)
+	{
+		try
+		{
+			std::lock_guard<std::mutex> lock(this->statement_mutex);
+
+			auto it = this->statements.find(format);
+
+			if (it == this->statements.end())
+			{
+				std::unique_ptr<Statement> statement(new Statement(this->ParseStatementQuery(format)));
+				it = this->statements.emplace(format, std::move(statement)).first;
+			}
+
+			return this->ExecutePrepared(*it->second, format, params);
+		}
+		catch (database_statement_connection_lost&)
+		{
+			if (attempt > 1)
+				throw Database_QueryFailed("Lost connection to database while executing a prepared statement");
+
+			// RawQuery reconnects, and replays any open transaction, when it finds the connection has gone away
+			// Reconnecting closes the old connection, which also discards every cached statement
+			this->RawQuery("SELECT 1", true);
+		}
+	}
+}
+
+Database_Statement_Result Database::ExecutePrepared(Statement& statement, const char *format, const std::vector<util::variant>& params)
+{
+	Database_Statement_Result result;
+
+#ifndef DATABASE_MYSQL
+	(void)format;
+#endif
+
+	if (params.size() != statement.types.size())
+	{
+		throw Database_QueryFailed("Prepared statement parameter count mismatch");
+	}
+
+#ifdef DATABASE_DEBUG
+	Console::Dbg("%s", statement.query.c_str());
+#endif // DATABASE_DEBUG
+
+	switch (this->engine)
+	{
+#ifdef DATABASE_MYSQL
+		case MySQL:
+		{
+			auto check_lost = [this](unsigned int myerr)
+			{
+				if (myerr == CR_SERVER_GONE_ERROR || myerr == CR_SERVER_LOST)
+				{
+					this->statements.clear();
+					throw database_statement_connection_lost();
+				}
+			};
+
+			if (!statement.mysql_stmt)
+			{
+				if ((statement.mysql_stmt = mysql_stmt_init(this->impl->mysql_handle)) == nullptr)
+				{
+					throw Database_QueryFailed(mysql_error(this->impl->mysql_handle));
+				}
+
+				if (mysql_stmt_prepare(statement.mysql_stmt, statement.query.c_str(), statement.query.length()) != 0)
+				{
+					check_lost(mysql_stmt_errno(statement.mysql_stmt));
+					std::string err = mysql_stmt_error(statement.mysql_stmt);
+					mysql_stmt_close(statement.mysql_stmt);
+					statement.mysql_stmt = nullptr;
+					throw Database_QueryFailed(err.c_str());
+				}
+
+				// Fills in max_length for result fields, so string buffers can be sized before fetching
+				bool update_max_length = true;
+				mysql_stmt_attr_set(statement.mysql_stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &update_max_length);
+			}
+
+			MYSQL_STMT *stmt = statement.mysql_stmt;
+
+			std::vector<MYSQL_BIND> binds(params.size());
+			std::vector<int> ints(params.size());
+			std::vector<std::string> strings(params.size());
+			std::vector<unsigned long> lengths(params.size());
+
+			for (std::size_t i = 0; i < params.size(); ++i)
+			{
+				std::memset(&binds[i], 0, sizeof(MYSQL_BIND));
+
+				if (statement.types[i] == '#')
+				{
+					ints[i] = params[i].GetInt();
+					binds[i].buffer_type = MYSQL_TYPE_LONG;
+					binds[i].buffer = &ints[i];
+				}
+				else
+				{
+					strings[i] = params[i].GetString();
+					lengths[i] = strings[i].length();
+					binds[i].buffer_type = MYSQL_TYPE_STRING;
+					binds[i].buffer = const_cast<char *>(strings[i].data());
+					binds[i].buffer_length = lengths[i];
+					binds[i].length = &lengths[i];
+				}
+			}
+
+			if ((!binds.empty() && mysql_stmt_bind_param(stmt, binds.data()) != 0) || mysql_stmt_execute(stmt) != 0)
+			{
+				check_lost(mysql_stmt_errno(stmt));
+				throw Database_QueryFailed(mysql_stmt_error(stmt));
+			}
+
+			if (this->in_transaction && std::strncmp(format, "SELECT", 6) != 0)
+			{
+				this->transaction_log.emplace_back(mysql_statement_text(this->impl->mysql_handle, format, params));
+			}
+
+			MYSQL_RES *meta = mysql_stmt_result_metadata(stmt);
+
+			if (!meta)
+			{
+				result.affected_rows = static_cast<int>(mysql_stmt_affected_rows(stmt));
+				break;
+			}
+
+			if (mysql_stmt_store_result(stmt) != 0)
+			{
+				mysql_free_result(meta);
+				throw Database_QueryFailed(mysql_stmt_error(stmt));
+			}
+
+			unsigned int num_fields = mysql_num_fields(meta);
+			MYSQL_FIELD *fields = mysql_fetch_fields(meta);
+
+			typedef typename std::remove_pointer<decltype(MYSQL_BIND::is_null)>::type null_flag;
+			std::vector<MYSQL_BIND> result_binds(num_fields);
+			std::vector<std::vector<char>> buffers(num_fields);
+			std::vector<unsigned long> result_lengths(num_fields);
+			std::unique_ptr<null_flag[]> nulls(new null_flag[num_fields]());
+
+			for (unsigned int i = 0; i < num_fields; ++i)
+			{
+				result.columns.push_back(fields[i].name);
+				buffers[i].resize(fields[i].max_length + 1);
+
+				std::memset(&result_binds[i], 0, sizeof(MYSQL_BIND));
+				result_binds[i].buffer_type = MYSQL_TYPE_STRING;
+				result_binds[i].buffer = buffers[i].data();
+				result_binds[i].buffer_length = buffers[i].size();
+				result_binds[i].length = &result_lengths[i];
+				result_binds[i].is_null = &nulls[i];
+			}
+
+			if (num_fields > 0 && mysql_stmt_bind_result(stmt, result_binds.data()) != 0)
+			{
+				mysql_stmt_free_result(stmt);
+				mysql_free_result(meta);
+				throw Database_QueryFailed(mysql_stmt_error(stmt));
+			}
+
+			result.reserve(static_cast<std::size_t>(mysql_stmt_num_rows(stmt)));
+
+			while (mysql_stmt_fetch(stmt) == 0)
+			{
+				std::vector<util::variant> row;
+				row.reserve(num_fields);
+
+				for (unsigned int i = 0; i < num_fields; ++i)
+				{
+					if (IS_NUM(fields[i].type))
+					{
+						row.emplace_back(nulls[i] ? 0 : util::to_int(std::string(buffers[i].data(), result_lengths[i])));
+					}
+					else
+					{
+						row.emplace_back(nulls[i] ? std::string() : std::string(buffers[i].data(), result_lengths[i]));
+					}
+				}
+
+				result.push_back(std::move(row));
+			}
+
+			mysql_stmt_free_result(stmt);
+			mysql_free_result(meta);
+		}
+		break;
+#endif // DATABASE_MYSQL
+
+#ifdef DATABASE_SQLITE
+		case SQLite:
+		{
+			if (!statement.sqlite_stmt && sqlite3_prepare_v2(this->impl->sqlite_handle, statement.query.c_str(), -1, &statement.sqlite_stmt, nullptr) != SQLITE_OK)
+			{
+				throw Database_QueryFailed(sqlite3_errmsg(this->impl->sqlite_handle));
+			}
+
+			sqlite3_stmt *stmt = statement.sqlite_stmt;
+
+			for (std::size_t i = 0; i < params.size(); ++i)
+			{
+				int param = static_cast<int>(i) + 1;
+
+				if (statement.types[i] == '#')
+					sqlite3_bind_int(stmt, param, params[i].GetInt());
+				else
+					sqlite3_bind_text(stmt, param, params[i].GetString().c_str(), -1, SQLITE_TRANSIENT);
+			}
+
+			int num_cols = sqlite3_column_count(stmt);
+
+			for (int i = 0; i < num_cols; ++i)
+			{
+				const char *name = sqlite3_column_name(stmt, i);
+				result.columns.push_back(name ? name : "");
+			}
+
+			int ret;
+			while ((ret = sqlite3_step(stmt)) == SQLITE_ROW)
+			{
+				std::vector<util::variant> row;
+				row.reserve(num_cols);
+
+				for (int i = 0; i < num_cols; ++i)
+				{
+					switch (sqlite3_column_type(stmt, i))
+					{
+						case SQLITE_INTEGER:
+							row.emplace_back(sqlite3_column_int(stmt, i));
+							break;
+
+						case SQLITE_FLOAT:
+							row.emplace_back(sqlite3_column_double(stmt, i));
+							break;
+
+						case SQLITE_NULL:
+							row.emplace_back(std::string());
+							break;
+
+						default:
+							row.emplace_back(std::string(reinterpret_cast<const char *>(sqlite3_column_text(stmt, i)), sqlite3_column_bytes(stmt, i)));
+					}
+				}
+
+				result.push_back(std::move(row));
+			}
+
+			sqlite3_reset(stmt);
+			sqlite3_clear_bindings(stmt);
+
+			if (ret != SQLITE_DONE)
+			{
+				throw Database_QueryFailed(sqlite3_errmsg(this->impl->sqlite_handle));
+			}
+
+			result.affected_rows = num_cols == 0 ? sqlite3_changes(this->impl->sqlite_handle) : 0;
+		}
+		break;
+#endif // DATABASE_SQLITE
+
+#ifdef DATABASE_SQLSERVER
+		case SqlServer:
+		{
+			SQLRETURN ret;
+
+			if (statement.hstmt == SQL_NULL_HSTMT)
+			{
+				ret = SQLAllocHandle(SQL_HANDLE_STMT, this->impl->hConn, &statement.hstmt);
+				if (!SQLSERVER_SUCCEEDED(ret))
+				{
+					HandleSqlServerError(SQL_HANDLE_DBC, this->impl->hConn, ret, Console::Err);
+					statement.hstmt = SQL_NULL_HSTMT;
+					throw Database_QueryFailed("Unable to allocate ODBC statement handle");
+				}
+
+				ret = SQLPrepare(statement.hstmt, (SQLCHAR*)(statement.query.c_str()), SQL_NTS);
+				if (!SQLSERVER_SUCCEEDED(ret))
+				{
+					HandleSqlServerError(SQL_HANDLE_STMT, statement.hstmt, ret, Console::Err);
+					SQLFreeHandle(SQL_HANDLE_STMT, statement.hstmt);
+					statement.hstmt = SQL_NULL_HSTMT;
+					throw Database_QueryFailed("Unable to prepare statement for execution!");
+				}
+			}
+
+			HSTMT hstmt = statement.hstmt;
+
+			std::vector<SQLINTEGER> ints(params.size());
+			std::vector<std::string> strings(params.size());
+			SQLLEN nts = SQL_NTS;
+
+			for (std::size_t i = 0; i < params.size(); ++i)
+			{
+				SQLUSMALLINT paramNdx = static_cast<SQLUSMALLINT>(i + 1); // parameter indices start at 1
+
+				if (statement.types[i] == '#')
+				{
+					ints[i] = params[i].GetInt();
+					ret = SQLBindParameter(hstmt, paramNdx, SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 0, 0, &ints[i], 0, nullptr);
+				}
+				else
+				{
+					strings[i] = params[i].GetString();
+					ret = SQLBindParameter(hstmt, paramNdx, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_VARCHAR,
+						strings[i].empty() ? 1 : strings[i].length(), // parameter length must be non-zero, even for empty strings
+						0, (SQLPOINTER)strings[i].c_str(), 0, &nts);
+				}
+
+				if (!SQLSERVER_SUCCEEDED(ret))
+				{
+					// Warn when a parameter binding fails, but still try the query (it will probably fail)
+					HandleSqlServerError(SQL_HANDLE_STMT, hstmt, ret, Console::Wrn);
+				}
+			}
+
+			ret = SQLExecute(hstmt);
+
+			SQLSMALLINT numCols = 0;
+			if (SQLSERVER_SUCCEEDED(ret))
+				ret = SQLNumResultCols(hstmt, &numCols);
+
+			if (SQLSERVER_SUCCEEDED(ret) && numCols > 0)
+			{
+				std::vector<SQLLEN> colTypes(numCols);
+
+				for (SQLUSMALLINT colNdx = 1; colNdx <= numCols; ++colNdx)
+				{
+					char titleBuf[50] = { 0 };
+					SQLColAttribute(hstmt, colNdx, SQL_DESC_NAME, titleBuf, sizeof(titleBuf), NULL, NULL);
+					SQLColAttribute(hstmt, colNdx, SQL_DESC_CONCISE_TYPE, NULL, 0, NULL, &colTypes[colNdx - 1]);
+					result.columns.push_back(std::string(titleBuf));
+				}
+
+				while (SQLSERVER_SUCCEEDED(ret) && SQLFetch(hstmt) == SQL_SUCCESS)
+				{
+					std::vector<util::variant> row;
+					row.reserve(numCols);
+
+					for (SQLUSMALLINT colNdx = 1; colNdx <= numCols && SQLSERVER_SUCCEEDED(ret); ++colNdx)
+					{
+						SQLLEN colType = colTypes[colNdx - 1];
+						SQLLEN nullIndicator = 0;
+
+						if (colType == SQL_CHAR || colType == SQL_VARCHAR || colType == SQL_LONGVARCHAR)
+						{
+							SQLCHAR resultStr[2048] = { 0 };
+							ret = SQLGetData(hstmt, colNdx, SQL_C_CHAR, resultStr, 2048, &nullIndicator);
+							row.emplace_back(nullIndicator != SQL_NULL_DATA ? std::string((const char*)resultStr) : std::string());
+						}
+						else
+						{
+							SQLINTEGER resultInt = 0;
+							ret = SQLGetData(hstmt, colNdx, SQL_C_SLONG, &resultInt, 0, &nullIndicator);
+							row.emplace_back(nullIndicator != SQL_NULL_DATA ? int(resultInt) : 0);
+						}
+					}
+
+					if (SQLSERVER_SUCCEEDED(ret))
+						result.push_back(std::move(row));
+				}
+			}
+			else if (SQLSERVER_SUCCEEDED(ret))
+			{
+				SQLLEN rowCount = 0;
+				ret = SQLRowCount(hstmt, &rowCount);
+				if (SQLSERVER_SUCCEEDED(ret) && rowCount >= 0)
+				{
+					result.affected_rows = static_cast<int>(rowCount);
+				}
+			}
+
+			if (ret == SQL_ERROR || ret == SQL_SUCCESS_WITH_INFO)
+			{
+				HandleSqlServerError(SQL_HANDLE_STMT, hstmt, ret, ret == SQL_ERROR ? Console::Err : Console::Dbg);
+			}
+
+			// Keep the prepared statement, but release its cursor and parameter bindings
+			SQLFreeStmt(hstmt, SQL_CLOSE);
+			SQLFreeStmt(hstmt, SQL_RESET_PARAMS);
+
+			if (ret == SQL_ERROR)
+			{
+				throw Database_QueryFailed("Error executing prepared statement");
+			}
+		}
+		break;
+#endif // DATABASE_SQLSERVER
+
+		default:
+			throw Database_QueryFailed("Unknown database engine");
+	}
+
+	return result;
+}
+
 std::string Database::Escape(const std::string& raw)
 {
 #if defined(DATABASE_MYSQL) || defined(DATABASE_SQLITE)
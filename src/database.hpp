@@ -12,10 +12,13 @@
 #include "util/variant.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <exception>
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -93,13 +96,96 @@ class Database_Result : public std::vector<std::unordered_map<std::string, util:
 	friend class Database;
 };
 
+/**
+ * Result from a prepared Database statement, with each row's values stored in column order
+ */
+class Database_Statement_Result : public std::vector<std::vector<util::variant>>
+{
+	protected:
+		std::vector<std::string> columns;
+		int affected_rows;
+
+	public:
+		Database_Statement_Result()
+			: affected_rows(0)
+		{ }
+
+		/**
+		 * Converts a result with named columns. Columns are taken from the first row, ordered by name.
+		 */
+		explicit Database_Statement_Result(const Database_Result&);
+
+		/**
+		 * Returns the column names, in the order values appear in each row
+		 */
+		const std::vector<std::string>& Columns() const;
+
+		/**
+		 * Returns the index of a column in each row
+		 * @throw Database_QueryFailed if the result has no such column
+		 */
+		std::size_t Column(const std::string& name) const;
+
+		/**
+		 * Returns the number of affected rows from an UPDATE or INSERT statement
+		 */
+		int AffectedRows() const;
+
+	friend class Database;
+};
+
 class DatabaseFactory
 {
 public:
 	virtual std::shared_ptr<Database> CreateDatabase(Config& config, bool logConnection = false);
 
+	/**
+	 * Returns a pooled connection owned by the calling thread, creating one if required.
+	 * Connections idle for longer than DBPoolCheckInterval are checked before being reused, and ones idle for
+	 *  longer than DBPoolIdleTimeout are closed. At most DBPoolSize connections are open at once, when they are
+	 *  all in use this waits up to DBPoolWaitTimeout for one to be released.
+	 * SQLite always uses the shared connection from CreateDatabase.
+	 * @throw Database_OpenFailed if no connection was released in time
+	 */
+	std::shared_ptr<Database> GetDatabase(Config& config);
+
+	/**
+	 * Returns true if every thread is handed the same connection (SQLite), in which case database work gains
+	 *  nothing from being moved to another thread and callers should run it on their own connection instead.
+	 */
+	static bool SharesConnection(Config& config);
+
+	/**
+	 * Closes pooled connections that have gone unused for longer than DBPoolIdleTimeout.
+	 */
+	void ExpireIdle(Config& config);
+
+	/**
+	 * Releases all pooled connections. Connections still referenced elsewhere stay open until released.
+	 */
+	void ClearPool();
+
 private:
+	struct Pooled_Database
+	{
+		std::shared_ptr<Database> database; // Null while the connection is being opened
+		std::chrono::steady_clock::time_point last_used;
+		int users;
+		unsigned long serial; // Tells a slot apart from one opened by the same thread after it was closed
+	};
+
+	// Shared with the connections handed out, which can outlive the factory
+	struct Pool
+	{
+		std::mutex mutex;
+		std::condition_variable released;
+		std::unordered_map<std::thread::id, Pooled_Database> connections;
+		unsigned long next_serial = 0;
+	};
+
 	std::shared_ptr<Database> _sqliteConnection;
+
+	std::shared_ptr<Pool> _pool = std::make_shared<Pool>();
 };
 
 /**
@@ -137,6 +223,31 @@ class Database
 		typedef std::pair<std::string, std::list<std::string>> QueryParameterPair;
 		QueryParameterPair ParseQueryArgs(const char * format, va_list ap) const;
 
+		struct Statement;
+
+		/**
+		 * Prepared statements keyed by their query format. Formats are string literals, so this stays small.
+		 */
+		std::unordered_map<std::string, std::unique_ptr<Statement>> statements;
+		std::mutex statement_mutex;
+
+		typedef std::pair<std::string, std::string> StatementQueryPair;
+
+		/**
+		 * Converts a query format to the engine's parameter marker syntax.
+		 * Returns the query and the type of each parameter in order ('#' or '$').
+		 * @throw Database_QueryFailed if the format contains a '@' substitution
+		 */
+		StatementQueryPair ParseStatementQuery(const char *format) const;
+
+		/**
+		 * Executes a cached prepared statement, preparing it on first use
+		 * @throw Database_QueryFailed
+		 */
+		virtual Database_Statement_Result ExecuteStatement(const char *format, const std::vector<util::variant>& params);
+
+		Database_Statement_Result ExecutePrepared(Statement& statement, const char *format, const std::vector<util::variant>& params);
+
 	public:
 		struct Bulk_Query_Context
 		{
@@ -189,6 +300,15 @@ class Database
 		 */
 		virtual Database_Result Query(const char *format, ...);
 
+		/**
+		 * Executes a query as a prepared statement and returns it's result.
+		 * Takes the same format as Query(), but '#' and '$' arguments are bound as parameters instead of being
+		 *  escaped in to the query text, so the statement is only parsed by the server once per connection.
+		 * '@' substitutions are not supported, as they change the statement text.
+		 * @throw Database_QueryFailed
+		 */
+		Database_Statement_Result Execute(const char *format, ...);
+
 		/**
 		 * Escapes a piece of text (including Query replacement tokens)
 		 */
@@ -44,7 +44,7 @@ ActionQueue::~ActionQueue()
 
 void EOClient::Initialize()
 {
-	this->upload_fh = 0;
+	this->upload_pos = 0;
 	this->seq_start = 0;
 	this->upcoming_seq_start = -1;
 	this->seq = 0;
@@ -62,148 +62,96 @@ void EOClient::Initialize()
 
 void EOClient::LogPacket(PacketFamily family, PacketAction action, size_t sz, const char * const actionStr)
 {
-	std::string ignoreFamilies = static_cast<std::string>(this->server()->world->config["IgnorePacketFamilies"]);
+	const char *timestamp = this->server()->PacketLogTimestamp(family);
 
-	if (ignoreFamilies != "*")
-	{
-		time_t rawtime;
-		time(&rawtime);
-		const tm * timeinfo = localtime(&rawtime);
+	if (!timestamp)
+		return;
 
-		std::string fam = PacketProcessor::GetFamilyName(family);
-		std::string act = PacketProcessor::GetActionName(action);
-		if (ignoreFamilies.find(fam) == std::string::npos)
-		{
-			Console::Out("%02d/%02d/%04d - %02d:%02d:%02d | %-12s | %4s Family: %-15s | Action: %-15s | SIZE=%d",
-				timeinfo->tm_mon + 1,
-				timeinfo->tm_mday,
-				timeinfo->tm_year + 1900,
-				timeinfo->tm_hour,
-				timeinfo->tm_min,
-				timeinfo->tm_sec,
-				player ? player->character ? player->character->real_name.c_str() : "no char" : "no char",
-				actionStr,
-				fam.c_str(),
-				act.c_str(),
-				sz);
-		}
-	}
+	std::string fam = PacketProcessor::GetFamilyName(family);
+	std::string act = PacketProcessor::GetActionName(action);
+
+	Console::Out("%s | %-12s | %4s Family: %-15s | Action: %-15s | SIZE=%d",
+		timestamp,
+		player ? player->character ? player->character->real_name.c_str() : "no char" : "no char",
+		actionStr,
+		fam.c_str(),
+		act.c_str(),
+		sz);
 }
 
 bool EOClient::NeedTick()
 {
-	return this->upload_fh;
+	return bool(this->upload_file);
 }
 
 void EOClient::Tick()
 {
-	std::string data;
-	int done = false;
-	int oldlength;
-
-	if (this->upload_fh)
+	if (this->upload_file)
 	{
 		// Send more of the file instead of doing other tasks
-		std::size_t upload_available = std::min(this->upload_size - this->upload_pos, Client::SendBufferRemaining());
+		const std::size_t upload_available = std::min(this->upload_file->length() - this->upload_pos, Client::SendBufferRemaining());
 
 		if (upload_available != 0)
 		{
-			upload_available = std::fread(&this->send_buffer[this->send_buffer_ppos + 1], 1, upload_available, this->upload_fh);
-
-			// Dynamically rewrite the bytes of the map to enable PK
-			if (this->upload_type == FILE_MAP && this->server()->world->config["GlobalPK"] && !this->server()->world->PKExcept(player->character->mapid))
-			{
-				if (this->upload_pos <= 0x03 && this->upload_pos + upload_available > 0x03)
-					this->send_buffer[this->send_buffer_ppos + 1 + 0x03 - this->upload_pos] = (char)0xFF;
-
-				if (this->upload_pos <= 0x03 && this->upload_pos + upload_available > 0x04)
-					this->send_buffer[this->send_buffer_ppos + 1 + 0x04 - this->upload_pos] = static_cast<char>(0x01);
-
-				if (this->upload_pos <= 0x1F && this->upload_pos + upload_available > 0x1F)
-					this->send_buffer[this->send_buffer_ppos + 1 + 0x1F - this->upload_pos] = static_cast<char>(0x04);
-			}
-
+			this->send_buffer.Write(this->upload_file->data() + this->upload_pos, upload_available);
 			this->upload_pos += upload_available;
-			this->send_buffer_ppos += upload_available;
-			this->send_buffer_used += upload_available;
 		}
-		else if (this->upload_pos == this->upload_size && this->SendBufferRemaining() == this->send_buffer.length())
+		else if (this->upload_pos == this->upload_file->length() && this->send_buffer.Empty())
 		{
 			using std::swap;
 
-			std::fclose(this->upload_fh);
-			this->upload_fh = 0;
+			this->upload_file.reset();
 			this->upload_pos = 0;
-			this->upload_size = 0;
 
 			// Place our temporary buffer back as the real one
 			swap(this->send_buffer, this->send_buffer2);
-			swap(this->send_buffer_gpos, this->send_buffer2_gpos);
-			swap(this->send_buffer_ppos, this->send_buffer2_ppos);
-			swap(this->send_buffer_used, this->send_buffer2_used);
 
 			// We're not using this anymore...
-			std::string empty;
-			swap(this->send_buffer2, empty);
+			this->send_buffer2 = util::RingBuffer();
 		}
 	}
 	else
 	{
-		data = this->Recv((this->packet_state == EOClient::ReadData) ? this->length : 1);
-
-		while (data.length() > 0 && !done)
+		// Packets are parsed straight out of recv_buffer, at most one is executed per tick
+		while (!this->recv_buffer.Empty())
 		{
-			switch (this->packet_state)
+			if (this->packet_state == EOClient::ReadLen1)
 			{
-				case EOClient::ReadLen1:
-					this->raw_length[0] = data[0];
-					data[0] = '\0';
-					data.erase(0, 1);
-					this->packet_state = EOClient::ReadLen2;
-
-					if (data.length() == 0)
-					{
-						break;
-					}
-					// fall through
-				case EOClient::ReadLen2:
-					this->raw_length[1] = data[0];
-					data[0] = '\0';
-					data.erase(0, 1);
-					this->length = PacketProcessor::Number(this->raw_length[0], this->raw_length[1]);
-					this->packet_state = EOClient::ReadData;
-
-					if (data.length() == 0)
-					{
-						break;
-					}
-					// fall through
-				case EOClient::ReadData:
-					oldlength = this->data.length();
-					this->data += data.substr(0, this->length);
-					std::fill(data.begin(), data.begin() + std::min<std::size_t>(data.length(), this->length), '\0');
-					data.erase(0, this->length);
-					this->length -= this->data.length() - oldlength;
-
-					if (this->length == 0)
-					{
-						this->Execute(this->data);
-
-						std::fill(UTIL_RANGE(this->data), '\0');
-						this->data.erase();
-						this->packet_state = EOClient::ReadLen1;
-
-						done = true;
-					}
-					break;
+				this->recv_buffer.Read(reinterpret_cast<char *>(&this->raw_length[0]), 1);
+				this->packet_state = EOClient::ReadLen2;
+			}
+			else if (this->packet_state == EOClient::ReadLen2)
+			{
+				this->recv_buffer.Read(reinterpret_cast<char *>(&this->raw_length[1]), 1);
+				this->length = PacketProcessor::Number(this->raw_length[0], this->raw_length[1]);
+				this->packet_state = EOClient::ReadData;
+			}
+			else if (this->packet_state == EOClient::ReadData)
+			{
+				const std::size_t oldlength = this->data.length();
+				const std::size_t available = std::min<std::size_t>(this->recv_buffer.Size(), this->length);
+
+				this->data.resize(oldlength + available);
+				this->recv_buffer.Read(&this->data[oldlength], available);
+				this->length -= available;
+
+				if (this->length == 0)
+				{
+					this->Execute(this->data);
 
-				default:
-					// If the code ever gets here, something is broken, so we just reset the client's state.
-					std::fill(UTIL_RANGE(data), '\0');
 					std::fill(UTIL_RANGE(this->data), '\0');
-					data.erase();
 					this->data.erase();
 					this->packet_state = EOClient::ReadLen1;
+
+					break;
+				}
+			}
+			else
+			{
+				// If the code ever gets here, something is broken, so we just reset the client's state.
+				std::fill(UTIL_RANGE(this->data), '\0');
+				this->data.erase();
+				this->packet_state = EOClient::ReadLen1;
 			}
 		}
 	}
@@ -314,7 +262,7 @@ void EOClient::Execute(const std::string &data)
 		else
 			client_seq = reader.GetChar();
 
-		if (this->server()->world->config["EnforceSequence"])
+		if (this->server()->world->settings.enforce_sequence)
 		{
 			if (client_seq != server_seq)
 			{
@@ -353,41 +301,25 @@ bool EOClient::Upload(FileType type, const std::string &filename, InitReply init
 {
 	using std::swap;
 
-	if (this->upload_fh)
+	if (this->upload_file)
 		throw std::runtime_error("Already uploading file");
 
-	this->upload_fh = std::fopen(filename.c_str(), "rb");
+	World *world = this->server()->world;
 
-	if (!this->upload_fh)
-		return false;
+	// Maps are sent with PK enabled when GlobalPK is on
+	const bool pk = (type == FILE_MAP && world->settings.global_pk && !world->PKExcept(this->player->character->mapid));
 
-	if (std::fseek(this->upload_fh, 0, SEEK_END) != 0)
-	{
-		std::fclose(this->upload_fh);
+	this->upload_file = world->file_cache.Get(filename, pk);
+
+	if (!this->upload_file)
 		return false;
-	}
 
-	this->upload_type = type;
 	this->upload_pos = 0;
-	this->upload_size = std::ftell(this->upload_fh);
-
-	std::fseek(this->upload_fh, 0, SEEK_SET);
 
-	std::size_t temp_buffer_size = this->send_buffer.size();
-
-	// Allocate a power-of-two buffer size large enough to hold the file
-	while (temp_buffer_size < this->upload_size + 6)
-		temp_buffer_size *= 2;
-
-	this->send_buffer2.resize(temp_buffer_size);
-	this->send_buffer2_gpos = 0;
-	this->send_buffer2_ppos = 0;
-	this->send_buffer2_used = 0;
+	// The file is copied from the cache as the temporary buffer drains, so it doesn't need to hold all of it
+	this->send_buffer2.Reset(this->send_buffer.Capacity());
 
 	swap(this->send_buffer, this->send_buffer2);
-	swap(this->send_buffer_gpos, this->send_buffer2_gpos);
-	swap(this->send_buffer_ppos, this->send_buffer2_ppos);
-	swap(this->send_buffer_used, this->send_buffer2_used);
 
 	// Build the file upload header packet
 	PacketBuilder builder(PACKET_F_INIT, PACKET_A_INIT, 2);
@@ -396,7 +328,7 @@ bool EOClient::Upload(FileType type, const std::string &filename, InitReply init
 	if (type != FILE_MAP)
 		builder.AddChar(1);
 
-	builder.AddSize(this->upload_size);
+	builder.AddSize(this->upload_file->length());
 
 	LogPacket(PACKET_F_INIT, PACKET_A_INIT, builder.Length(), "UPLD");
 
@@ -407,48 +339,46 @@ bool EOClient::Upload(FileType type, const std::string &filename, InitReply init
 
 void EOClient::Send(const PacketBuilder &builder)
 {
-	std::lock_guard<std::mutex> lock(send_mutex);
+	this->SendRaw(builder.GetID(), builder.Length(), builder.Get());
+}
 
-	auto fam = PacketFamily(PacketProcessor::EPID(builder.GetID())[1]);
-	auto act = PacketAction(PacketProcessor::EPID(builder.GetID())[0]);
-	this->LogPacket(fam, act, builder.Length(), "SEND");
+void EOClient::Send(const PacketBroadcast &packet)
+{
+	this->SendRaw(packet.GetID(), packet.Length(), packet.Raw());
+}
+
+void EOClient::SendRaw(unsigned short id, std::size_t length, const std::string &raw)
+{
+	auto fam = PacketFamily(PacketProcessor::EPID(id)[1]);
+	auto act = PacketAction(PacketProcessor::EPID(id)[0]);
+	this->LogPacket(fam, act, length, "SEND");
 
-	std::string data = this->processor.Encode(builder);
+	// Stick any outgoing data in to our temporary buffer while uploading
+	util::RingBuffer &buffer = this->upload_file ? this->send_buffer2 : this->send_buffer;
 
-	if (this->upload_fh)
+	if (raw.length() > buffer.Free())
 	{
-		// Stick any incoming data in to our temporary buffer
-		if (data.length() > this->send_buffer2.length() - this->send_buffer2_used)
-		{
-			this->Close(true);
-			return;
-		}
+		this->Close(true);
+		return;
+	}
 
-		const std::size_t mask = this->send_buffer2.length() - 1;
+	util::RingBuffer::Segments segments = buffer.WriteSegments(raw.length());
 
-		for (std::size_t i = 0; i < data.length(); ++i)
-		{
-			this->send_buffer2_ppos = (this->send_buffer2_ppos + 1) & mask;
-			this->send_buffer2[this->send_buffer2_ppos] = data[i];
-		}
+	this->processor.Encode(raw, segments[0].data, segments[0].length, segments[1].data);
 
-		this->send_buffer2_used += data.length();
-	}
-	else
-	{
-		Client::Send(data);
-	}
+	buffer.Commit(raw.length());
+
+	if (!this->upload_file)
+		this->QueueSend();
 }
 
 EOClient::~EOClient()
 {
-	if (this->upload_fh)
-	{
-		std::fclose(this->upload_fh);
-	}
-
 	if (this->player)
 	{
 		delete this->player;
 	}
+
+	this->server()->world->CancelLogins(this);
+	this->server()->world->ReleaseClientID(this->id);
 }
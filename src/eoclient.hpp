@@ -13,6 +13,7 @@
 #include "fwd/eodata.hpp"
 #include "fwd/player.hpp"
 #include "eoserver.hpp"
+#include "filecache.hpp"
 #include "packet.hpp"
 
 #include "socket.hpp"
@@ -23,7 +24,6 @@
 #include <queue>
 #include <string>
 #include <utility>
-#include <mutex>
 
 /**
  * An action the server will execute for the client
@@ -84,22 +84,20 @@ class EOClient : public Client
 
 		void LogPacket(PacketFamily family, PacketAction action, size_t sz, const char * const actionStr);
 
-		FileType upload_type;
-		std::FILE *upload_fh;
+		/**
+		 * Encodes a raw packet straight in to the active send buffer
+		 */
+		void SendRaw(unsigned short id, std::size_t length, const std::string &raw);
+
+		FileCache::File upload_file;
 		std::size_t upload_pos;
-		std::size_t upload_size;
 
-		std::string send_buffer2;
-		std::size_t send_buffer2_gpos;
-		std::size_t send_buffer2_ppos;
-		std::size_t send_buffer2_used;
+		util::RingBuffer send_buffer2;
 
 		int seq_start;
 		int upcoming_seq_start;
 		int seq;
 
-		std::mutex send_mutex;
-
 	public:
 		EOServer *server() { return static_cast<EOServer *>(Client::server); };
 		int version;
@@ -151,6 +149,7 @@ class EOClient : public Client
 		bool Upload(FileType type, int id, InitReply init_reply);
 		bool Upload(FileType type, const std::string &filename, InitReply init_reply);
 		virtual void Send(const PacketBuilder &packet);
+		virtual void Send(const PacketBroadcast &packet);
 
 		virtual ~EOClient();
 };
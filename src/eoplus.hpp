@@ -17,6 +17,7 @@
 #include <map>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace EOPlus
 {
@@ -85,6 +86,14 @@ namespace EOPlus
 		std::deque<Scope> scopes;
 		std::string function;
 		std::deque<util::variant> args;
+
+		// Filled in by whoever runs the quest once it is loaded (see Quest::Load), so it can be dispatched without comparing names
+		int opcode;
+		std::vector<int> int_args;
+
+		Expression()
+			: opcode(0)
+		{ }
 	};
 
 	struct Action
@@ -107,6 +116,13 @@ namespace EOPlus
 	{
 		Expression expr;
 		Action action;
+
+		// Events that can change the outcome of expr, as a bitmask defined by whoever runs the quest
+		unsigned events;
+
+		Rule()
+			: events(~0u)
+		{ }
 	};
 
 	struct Info
@@ -139,9 +155,13 @@ namespace EOPlus
 		std::deque<Action> actions;
 		std::size_t goal_rule;
 
+		// Every event any of the rules are interested in
+		unsigned rule_events;
+
 		State()
 			: has_desc(false)
 			, goal_rule(0)
+			, rule_events(~0u)
 		{ }
 	};
 
@@ -11,10 +11,10 @@
 #include "../util.hpp"
 #include "../util/variant.hpp"
 
-#include <deque>
 #include <functional>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace EOPlus
 {
@@ -54,7 +54,10 @@ namespace EOPlus
 		if (it == this->quest->states.end())
 		{
 			if (state_id == "end" || state_id == "done")
+			{
+				this->EndState();
 				return;
+			}
 			else
 				throw Runtime_Error("Unknown quest state: " + state_id);
 		}
@@ -97,7 +100,7 @@ namespace EOPlus
 
 			bool last_cond = false;
 
-			UTIL_FOREACH(this->state->actions, action)
+			UTIL_FOREACH_CREF(this->state->actions, action)
 			{
 				if (action.cond == EOPlus::Action::ElseIf || action.cond == EOPlus::Action::Else)
 				{
@@ -141,38 +144,38 @@ namespace EOPlus
 		return this->finished;
 	}
 
-	bool Context::QueryRule(std::string rule) const
+	bool Context::QueryRule(int opcode) const
 	{
-		return this->QueryRule(rule, [](const std::deque<util::variant>&) { return true; });
+		return this->QueryRule(opcode, [](const std::vector<int>&) { return true; });
 	}
 
-	bool Context::QueryRule(std::string rule, std::function<bool(const std::deque<util::variant>&)> arg_check) const
+	bool Context::QueryRule(int opcode, std::function<bool(const std::vector<int>&)> arg_check) const
 	{
 		if (!this->state)
 			return false;
 
-		UTIL_FOREACH(this->state->rules, check_rule)
+		UTIL_FOREACH_CREF(this->state->rules, check_rule)
 		{
-			if (check_rule.expr.function == rule && arg_check(check_rule.expr.args))
+			if (check_rule.expr.opcode == opcode && arg_check(check_rule.expr.int_args))
 				return true;
 		}
 
 		return false;
 	}
 
-	bool Context::TriggerRule(std::string rule)
+	bool Context::TriggerRule(int opcode)
 	{
-		return this->TriggerRule(rule, [](const std::deque<util::variant>&) { return true; });
+		return this->TriggerRule(opcode, [](const std::vector<int>&) { return true; });
 	}
 
-	bool Context::TriggerRule(std::string rule, std::function<bool(const std::deque<util::variant>&)> arg_check)
+	bool Context::TriggerRule(int opcode, std::function<bool(const std::vector<int>&)> arg_check)
 	{
 		if (!this->state)
 			return false;
 
-		UTIL_FOREACH(this->state->rules, check_rule)
+		UTIL_FOREACH_CREF(this->state->rules, check_rule)
 		{
-			if (check_rule.expr.function == rule && arg_check(check_rule.expr.args))
+			if (check_rule.expr.opcode == opcode && arg_check(check_rule.expr.int_args))
 			{
 				this->DoAction(check_rule.action);
 				// *this may not be valid here
@@ -183,7 +186,7 @@ namespace EOPlus
 		return false;
 	}
 
-	bool Context::CheckRules()
+	bool Context::CheckRules(unsigned events)
 	{
 		if (!this->state)
 		{
@@ -193,6 +196,9 @@ namespace EOPlus
 				throw std::runtime_error("No state selected");
 		}
 
+		if (!(this->state->rule_events & events))
+			return false;
+
 		if (++recursive_depth > max_recursion)
 		{
 			--recursive_depth;
@@ -201,8 +207,11 @@ namespace EOPlus
 
 		try
 		{
-			UTIL_FOREACH(this->state->rules, rule)
+			UTIL_FOREACH_CREF(this->state->rules, rule)
 			{
+				if (!(rule.events & events))
+					continue;
+
 				if (this->CheckRule(rule.expr))
 				{
 					if (this->DoAction(rule.action))
@@ -13,9 +13,9 @@
 
 #include "../util/variant.hpp"
 
-#include <deque>
 #include <functional>
 #include <string>
+#include <vector>
 
 namespace EOPlus
 {
@@ -32,6 +32,11 @@ namespace EOPlus
 			virtual bool DoAction(const Action& action) = 0;
 			virtual bool CheckRule(const Expression& expr) = 0;
 
+			/**
+			 * Called instead of BeginState when the context moves to an end or done state the quest does not define
+			 */
+			virtual void EndState() { }
+
 		public:
 			Context(const Quest* quest);
 
@@ -46,13 +51,16 @@ namespace EOPlus
 
 			bool Finished() const;
 
-			bool QueryRule(std::string rule) const;
-			bool QueryRule(std::string rule, std::function<bool(const std::deque<util::variant>&)> arg_check) const;
+			bool QueryRule(int opcode) const;
+			bool QueryRule(int opcode, std::function<bool(const std::vector<int>&)> arg_check) const;
 
-			bool TriggerRule(std::string rule);
-			bool TriggerRule(std::string rule, std::function<bool(const std::deque<util::variant>&)> arg_check);
+			bool TriggerRule(int opcode);
+			bool TriggerRule(int opcode, std::function<bool(const std::vector<int>&)> arg_check);
 
-			bool CheckRules();
+			/**
+			 * Checks the rules of the current state that are interested in any of the given events
+			 */
+			bool CheckRules(unsigned events = ~0u);
 
 			virtual ~Context();
 	};
@@ -30,6 +30,7 @@ void eoserv_config_validate_config(Config& config)
 	eoserv_config_default(config, "LogOut"             , "-");
 	eoserv_config_default(config, "LogErr"             , "error.log");
 	eoserv_config_default(config, "StyleConsole"       , true);
+	eoserv_config_default(config, "LogLevel"           , 0);
 	eoserv_config_default(config, "LogCommands"        , true);
 	eoserv_config_default(config, "LogConnection"      , 0);
 	eoserv_config_default(config, "Host"               , "0.0.0.0");
@@ -43,11 +44,17 @@ void eoserv_config_validate_config(Config& config)
 	eoserv_config_default(config, "HangupDelay"        , 10.0);
 	eoserv_config_default(config, "QuietConnectionErrors", false);
 	eoserv_config_default(config, "MaxLoginAttempts"   , 3);
-	eoserv_config_default(config, "LoginQueueSize"     , 10);
+	eoserv_config_default(config, "LoginQueueSize"     , 50);
+	eoserv_config_default(config, "LoginConcurrency"   , 0);
+	eoserv_config_default(config, "LoginRateIP"        , 30);
+	eoserv_config_default(config, "LoginRateAccount"   , 10);
+	eoserv_config_default(config, "LoginRateWindow"    , "1m");
+	eoserv_config_default(config, "LoginCacheTime"     , "2m");
 	eoserv_config_default(config, "CheckVersion"       , true);
 	eoserv_config_default(config, "MinVersion"         , 0);
 	eoserv_config_default(config, "MaxVersion"         , 0);
 	eoserv_config_default(config, "TimedSave"          , "5m");
+	eoserv_config_default(config, "BanRefreshRate"     , "1m");
 	eoserv_config_default(config, "IgnoreHDID"         , false);
 	eoserv_config_default(config, "ServerLanguage"     , "./lang/en.ini");
 	eoserv_config_default(config, "PacketQueueMax"     , 40);
@@ -121,6 +128,7 @@ void eoserv_config_validate_config(Config& config)
 	eoserv_config_default(config, "NPCChaseMode"       , 0);
 	eoserv_config_default(config, "NPCChaseDistance"   , 18);
 	eoserv_config_default(config, "NPCBoredTimer"      , 30);
+	eoserv_config_default(config, "NPCIdleTime"        , 60);
 	eoserv_config_default(config, "NPCAdjustMaxDam"    , 3);
 	eoserv_config_default(config, "BoardMaxPosts"      , 20);
 	eoserv_config_default(config, "BoardMaxUserPosts"  , 6);
@@ -287,9 +295,14 @@ void eoserv_config_validate_config(Config& config)
 	eoserv_config_default(config, "MaxMap"             , 400);
 	eoserv_config_default(config, "MaxTrade"           , 2000000000);
 	eoserv_config_default(config, "IgnorePacketFamilies", "*");
+	eoserv_config_default(config, "PacketLogRate"      , 200);
 	eoserv_config_default(config, "InitLoginBan"       , true);
 	eoserv_config_default(config, "ThreadPoolThreads"  , 0);
 	eoserv_config_default(config, "AutoCreateDatabase" , false);
+	eoserv_config_default(config, "DBPoolSize"         , 8);
+	eoserv_config_default(config, "DBPoolIdleTimeout"  , 300);
+	eoserv_config_default(config, "DBPoolCheckInterval", 60);
+	eoserv_config_default(config, "DBPoolWaitTimeout"  , 5);
 	eoserv_config_default(config, "WorldDumpFile"      , "./world.bak.json");
 }
 
@@ -304,6 +317,8 @@ void eoserv_config_validate_admin(Config& config)
 	eoserv_config_default(config, "book"          , 1);
 	eoserv_config_default(config, "inventory"     , 1);
 	eoserv_config_default(config, "uptime"        , 1);
+	eoserv_config_default(config, "threadpool"    , 4);
+	eoserv_config_default(config, "logins"        , 4);
 	eoserv_config_default(config, "kick"          , 1);
 	eoserv_config_default(config, "skick"         , 3);
 	eoserv_config_default(config, "jail"          , 1);
@@ -17,10 +17,13 @@
 #include "console.hpp"
 #include "socket.hpp"
 #include "util.hpp"
+#include "util/async.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cerrno>
 #include <cstddef>
+#include <ctime>
 #include <exception>
 #include <memory>
 #include <stdexcept>
@@ -75,6 +78,12 @@ void server_check_hangup(void *server_void)
 	}
 }
 
+void server_flush_packet_log(void *server_void)
+{
+	EOServer *server = static_cast<EOServer *>(server_void);
+	server->FlushPacketLog();
+}
+
 void server_pump_queue(void *server_void)
 {
 	EOServer *server = static_cast<EOServer *>(server_void);
@@ -89,7 +98,7 @@ void server_pump_queue(void *server_void)
 
 		std::size_t size = client->queue.queue.size();
 
-		if (size > std::size_t(int(server->world->config["PacketQueueMax"])))
+		if (size > server->world->settings.packet_queue_max)
 		{
 			Console::Wrn("Client was disconnected for filling up the action queue: %s", static_cast<std::string>(client->GetRemoteAddr()).c_str());
 			client->AsyncOpPending(false);
@@ -167,6 +176,51 @@ void EOServer::UpdateConfig()
 	this->HangupDelay = double(this->world->config["HangupDelay"]);
 
 	this->maxconn = unsigned(int(this->world->config["MaxConnections"]));
+
+	Console::SetLevel(Console::Level(util::clamp<int>(this->world->config["LogLevel"], Console::LEVEL_DEBUG, Console::LEVEL_ERROR)));
+
+	std::string ignore_families = static_cast<std::string>(this->world->config["IgnorePacketFamilies"]);
+	this->packet_log_enabled = (ignore_families != "*");
+	this->packet_log_rate = std::max(int(this->world->config["PacketLogRate"]), 0);
+
+	for (std::size_t family = 0; family < this->packet_log_ignored.size(); ++family)
+	{
+		std::string name = PacketProcessor::GetFamilyName(PacketFamily(family));
+		this->packet_log_ignored[family] = (ignore_families.find(name) != std::string::npos);
+	}
+}
+
+const char *EOServer::PacketLogTimestamp(PacketFamily family)
+{
+	if (!this->packet_log_enabled || this->packet_log_ignored[family])
+		return nullptr;
+
+	this->FlushPacketLog();
+
+	if (this->packet_log_rate > 0 && this->packet_log_count >= this->packet_log_rate)
+	{
+		++this->packet_log_skipped;
+		return nullptr;
+	}
+
+	++this->packet_log_count;
+	return this->packet_log_timestamp;
+}
+
+void EOServer::FlushPacketLog()
+{
+	std::time_t now = std::time(nullptr);
+
+	if (now == this->packet_log_second)
+		return;
+
+	if (this->packet_log_skipped > 0)
+		Console::Out("%s | Skipped logging %d packets (PacketLogRate)", this->packet_log_timestamp, this->packet_log_skipped);
+
+	std::strftime(this->packet_log_timestamp, sizeof(this->packet_log_timestamp), "%m/%d/%Y - %H:%M:%S", std::localtime(&now));
+	this->packet_log_second = now;
+	this->packet_log_count = 0;
+	this->packet_log_skipped = 0;
 }
 
 void EOServer::Initialize(std::shared_ptr<DatabaseFactory> databaseFactory, const Config &eoserv_config, const Config &admin_config)
@@ -179,6 +233,10 @@ void EOServer::Initialize(std::shared_ptr<DatabaseFactory> databaseFactory, cons
 	event = new TimeEvent(server_pump_queue, this, 0.001, Timer::FOREVER);
 	this->world->timer.Register(event);
 
+	// A quiet second after a burst would otherwise hold back the skipped packet summary until the next packet is logged
+	event = new TimeEvent(server_flush_packet_log, this, 1.0, Timer::FOREVER);
+	this->world->timer.Register(event);
+
 	this->world->server = this;
 
 	if (this->world->config["SLN"])
@@ -293,6 +351,8 @@ void EOServer::Tick()
 		active_clients->clear();
 	}
 
+	AsyncCompletionQueue::Drain();
+
 	this->BuryTheDead();
 
 	this->world->timer.Tick();
@@ -314,6 +374,9 @@ void EOServer::RecordClientRejection(const IPAddress& ip, const char* reason)
 
 EOServer::~EOServer()
 {
+	// Finish off any async operations that already completed while their clients still exist
+	AsyncCompletionQueue::Drain();
+
 	// All clients must be fully closed before the world ends
 	UTIL_FOREACH(this->clients, client)
 	{
@@ -12,6 +12,7 @@
 #include "fwd/config.hpp"
 #include "fwd/database.hpp"
 #include "fwd/eoclient.hpp"
+#include "fwd/packet.hpp"
 #include "fwd/sln.hpp"
 #include "fwd/timer.hpp"
 #include "fwd/world.hpp"
@@ -19,11 +20,14 @@
 #include "socket.hpp"
 
 #include <array>
+#include <bitset>
+#include <ctime>
 #include <string>
 #include <unordered_map>
 
 void server_ping_all(void *server_void);
 void server_pump_queue(void *server_void);
+void server_flush_packet_log(void *server_void);
 
 struct ConnectionLogEntry
 {
@@ -43,6 +47,17 @@ class EOServer : public Server
 
 		TimeEvent* ping_timer = nullptr;
 
+		// Converted from IgnorePacketFamilies and PacketLogRate by UpdateConfig
+		bool packet_log_enabled = false;
+		std::bitset<256> packet_log_ignored;
+		int packet_log_rate = 0;
+
+		// Packets logged and skipped so far in the current second, whose timestamp is formatted once
+		std::time_t packet_log_second = 0;
+		int packet_log_count = 0;
+		int packet_log_skipped = 0;
+		char packet_log_timestamp[32] = {};
+
 	protected:
 		virtual Client *ClientFactory(const Socket &);
 
@@ -56,6 +71,17 @@ class EOServer : public Server
 
 		void UpdateConfig();
 
+		/**
+		 * Decides whether a packet of this family is logged, under IgnorePacketFamilies and PacketLogRate
+		 * @return The timestamp to log the packet with, or nullptr to skip it
+		 */
+		const char *PacketLogTimestamp(PacketFamily family);
+
+		/**
+		 * Starts a new second of packet logging once the clock has moved on, reporting how many packets PacketLogRate skipped
+		 */
+		void FlushPacketLog();
+
 		EOServer(IPAddress addr, unsigned short port, std::shared_ptr<DatabaseFactory> databaseFactory, const Config &eoserv_config, const Config &admin_config) : Server(addr, port)
 		{
 			this->Initialize(databaseFactory, eoserv_config, admin_config);
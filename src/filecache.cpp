@@ -0,0 +1,92 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "filecache.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+static FileCache::File filecache_read(const std::string &filename)
+{
+	std::FILE *fh = std::fopen(filename.c_str(), "rb");
+
+	if (!fh)
+		return FileCache::File();
+
+	std::string data;
+	char buf[8192];
+	std::size_t read;
+
+	while ((read = std::fread(buf, 1, sizeof(buf), fh)) > 0)
+		data.append(buf, read);
+
+	const bool failed = std::ferror(fh);
+
+	std::fclose(fh);
+
+	if (failed)
+		return FileCache::File();
+
+	return std::make_shared<const std::string>(std::move(data));
+}
+
+static FileCache::File filecache_patch_pk(const std::string &data)
+{
+	std::string pk_data = data;
+
+	// Rewrite the bytes of the map to enable PK
+	if (pk_data.length() > 0x03)
+		pk_data[0x03] = char(0xFF);
+
+	if (pk_data.length() > 0x04)
+		pk_data[0x04] = char(0x01);
+
+	if (pk_data.length() > 0x1F)
+		pk_data[0x1F] = char(0x04);
+
+	return std::make_shared<const std::string>(std::move(pk_data));
+}
+
+FileCache::File FileCache::Get(const std::string &filename, bool pk)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	Entry &entry = this->entries[filename];
+
+	if (!entry.data)
+	{
+		entry.data = filecache_read(filename);
+
+		if (!entry.data)
+		{
+			this->entries.erase(filename);
+			return File();
+		}
+	}
+
+	if (!pk)
+		return entry.data;
+
+	if (!entry.pk_data)
+		entry.pk_data = filecache_patch_pk(*entry.data);
+
+	return entry.pk_data;
+}
+
+void FileCache::Invalidate(const std::string &filename)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->entries.erase(filename);
+}
+
+void FileCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->entries.clear();
+}
@@ -0,0 +1,55 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef FILECACHE_HPP_INCLUDED
+#define FILECACHE_HPP_INCLUDED
+
+#include "fwd/filecache.hpp"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Keeps map and pub files in memory so they can be uploaded to many clients without re-reading them.
+ * Cached contents are immutable: invalidating a file drops it from the cache, but uploads already in progress keep the old contents alive.
+ */
+class FileCache
+{
+	public:
+		typedef std::shared_ptr<const std::string> File;
+
+	private:
+		struct Entry
+		{
+			File data;
+			File pk_data;
+		};
+
+		std::unordered_map<std::string, Entry> entries;
+		std::mutex mutex;
+
+	public:
+		/**
+		 * Returns the contents of a file, reading it from disk if it is not cached.
+		 * @param pk Return a copy of a map file with its PK flag set, for GlobalPK.
+		 * @return The file contents, or a null pointer if the file could not be read.
+		 */
+		File Get(const std::string &filename, bool pk = false);
+
+		/**
+		 * Drops a file from the cache so it is re-read on next use.
+		 */
+		void Invalidate(const std::string &filename);
+
+		/**
+		 * Drops every file from the cache.
+		 */
+		void Clear();
+};
+
+#endif // FILECACHE_HPP_INCLUDED
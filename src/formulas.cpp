@@ -0,0 +1,102 @@
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "formulas.hpp"
+
+#include "character.hpp"
+#include "config.hpp"
+#include "console.hpp"
+#include "npc.hpp"
+
+#include "util.hpp"
+#include "util/rpn.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static std::vector<std::size_t> formulas_add_symbols(util::rpn_symbols &symbols, const std::vector<std::string> &names, const std::string &prefix)
+{
+	std::vector<std::size_t> slots;
+	slots.reserve(names.size());
+
+	UTIL_FOREACH_CREF(names, name)
+	{
+		slots.push_back(symbols.add(prefix + name));
+	}
+
+	return slots;
+}
+
+static util::rpn_formula formulas_compile(Config &config, const std::string &key, const util::rpn_symbols &symbols)
+{
+	try
+	{
+		return util::rpn_formula(config[key], symbols);
+	}
+	catch (std::runtime_error &e)
+	{
+		Console::Wrn("Formula '%s' is invalid: %s", key.c_str(), e.what());
+		return util::rpn_formula();
+	}
+}
+
+Formulas::Formulas()
+{
+	this->character_slots = formulas_add_symbols(this->symbols, Character::FormulaVarNames(), "");
+	this->target_character_slots = formulas_add_symbols(this->symbols, Character::FormulaVarNames(), "target_");
+	this->npc_slots = formulas_add_symbols(this->symbols, NPC::FormulaVarNames(), "");
+	this->target_npc_slots = formulas_add_symbols(this->symbols, NPC::FormulaVarNames(), "target_");
+
+	this->modifier_slot = this->symbols.add("modifier");
+	this->damage_slot = this->symbols.add("damage");
+	this->critical_slot = this->symbols.add("critical");
+}
+
+void Formulas::Compile(Config &config)
+{
+	this->hp = formulas_compile(config, "hp", this->symbols);
+	this->tp = formulas_compile(config, "tp", this->symbols);
+	this->sp = formulas_compile(config, "sp", this->symbols);
+	this->weight = formulas_compile(config, "weight", this->symbols);
+	this->hit_rate = formulas_compile(config, "hit_rate", this->symbols);
+	this->damage = formulas_compile(config, "damage", this->symbols);
+
+	std::vector<int> class_types;
+
+	UTIL_FOREACH_CREF(config, entry)
+	{
+		if (entry.first.compare(0, 6, "class.") == 0)
+			class_types.push_back(std::atoi(entry.first.c_str() + 6));
+	}
+
+	this->classes.clear();
+
+	UTIL_FOREACH(class_types, type)
+	{
+		if (this->classes.find(type) != this->classes.end())
+			continue;
+
+		std::string prefix = "class." + util::to_string(type) + ".";
+		Class_Formulas &formulas = this->classes[type];
+
+		formulas.damage = formulas_compile(config, prefix + "damage", this->symbols);
+		formulas.accuracy = formulas_compile(config, prefix + "accuracy", this->symbols);
+		formulas.evade = formulas_compile(config, prefix + "evade", this->symbols);
+		formulas.defence = formulas_compile(config, prefix + "defence", this->symbols);
+	}
+}
+
+const Formulas::Class_Formulas *Formulas::Class(int type) const
+{
+	auto it = this->classes.find(type);
+
+	if (it == this->classes.end())
+		return 0;
+
+	return &it->second;
+}
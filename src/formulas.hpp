@@ -0,0 +1,79 @@
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef FORMULAS_HPP_INCLUDED
+#define FORMULAS_HPP_INCLUDED
+
+#include "fwd/formulas.hpp"
+
+#include "fwd/config.hpp"
+#include "util/rpn.hpp"
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Formulas from formulas.ini compiled once at startup and on rehash.
+ * Variables are bound to fixed slots, see Character::FormulaVars and NPC::FormulaVars.
+ */
+class Formulas
+{
+	public:
+		struct Class_Formulas
+		{
+			util::rpn_formula damage;
+			util::rpn_formula accuracy;
+			util::rpn_formula evade;
+			util::rpn_formula defence;
+		};
+
+		util::rpn_symbols symbols;
+
+		/**
+		 * Slots for the variables set by Character::FormulaVars and NPC::FormulaVars, with and without the "target_" prefix
+		 */
+		std::vector<std::size_t> character_slots;
+		std::vector<std::size_t> target_character_slots;
+		std::vector<std::size_t> npc_slots;
+		std::vector<std::size_t> target_npc_slots;
+
+		std::size_t modifier_slot;
+		std::size_t damage_slot;
+		std::size_t critical_slot;
+
+		util::rpn_formula hp;
+		util::rpn_formula tp;
+		util::rpn_formula sp;
+		util::rpn_formula weight;
+		util::rpn_formula hit_rate;
+		util::rpn_formula damage;
+
+		std::unordered_map<int, Class_Formulas> classes;
+
+		Formulas();
+
+		/**
+		 * Replaces all formulas with ones compiled from a formulas config.
+		 * Formulas which fail to compile are logged and evaluate to 0.
+		 */
+		void Compile(Config &config);
+
+		/**
+		 * Returns the formulas for a class type, or 0 if there are none
+		 */
+		const Class_Formulas *Class(int type) const;
+
+		/**
+		 * Resets a caller's variable list to the defaults for every slot, to be filled in before evaluating formulas
+		 */
+		void ResetVars(std::vector<double> &vars) const
+		{
+			const std::vector<double> &defaults = this->symbols.vars();
+			vars.assign(defaults.begin(), defaults.end());
+		}
+};
+
+#endif // FORMULAS_HPP_INCLUDED
@@ -12,6 +12,7 @@ class Character;
 struct Character_Item;
 struct Character_Spell;
 struct Character_QuestState;
+struct Character_Save_Data;
 
 enum AdminLevel : unsigned char
 {
@@ -0,0 +1,11 @@
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef FWD_FORMULAS_HPP_INCLUDED
+#define FWD_FORMULAS_HPP_INCLUDED
+
+class Formulas;
+
+#endif // FWD_FORMULAS_HPP_INCLUDED
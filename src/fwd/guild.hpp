@@ -12,6 +12,8 @@ class Guild_Create;
 class GuildManager;
 class Guild;
 
+struct Guild_Save_Data;
+
 enum GuildReply : short
 {
 	GUILD_BUSY = 1,
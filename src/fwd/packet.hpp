@@ -10,6 +10,7 @@
 class PacketProcessor;
 class PacketReader;
 class PacketBuilder;
+class PacketBroadcast;
 
 enum PacketFamily : unsigned char
 {
@@ -10,4 +10,16 @@
 class Quest;
 class Quest_Context;
 
+/**
+ * Kinds of change to a character that can make a quest rule pass, see Character::CheckQuestRules
+ */
+enum QuestEvent : unsigned
+{
+	QUEST_EVENT_MOVE      = 1, // EnterMap, EnterCoord, LeaveMap, LeaveCoord
+	QUEST_EVENT_ITEMS     = 2, // GotItems, LostItems
+	QUEST_EVENT_SPELLS    = 4, // GotSpell, LostSpell
+	QUEST_EVENT_CHARACTER = 8, // IsGender, IsClass, IsRace, IsWearing, CitizenOf
+	QUEST_EVENT_ALL       = 0xFFFFFFFF
+};
+
 #endif // FWD_QUEST_HPP_INCLUDED
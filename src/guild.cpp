@@ -22,6 +22,7 @@
 #include <ctime>
 #include <limits>
 #include <memory>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -100,6 +101,37 @@ Guild_Create::~Guild_Create()
 	this->manager->CancelCreate(this->tag);
 }
 
+// Expects an uppercase tag
+static bool guild_valid_tag(const std::string& tag)
+{
+	if (tag.length() < 2 || tag.length() > 3)
+	{
+		return false;
+	}
+
+	for (std::size_t i = 0; i < tag.length(); ++i)
+	{
+		if (tag[i] < 'A' || tag[i] > 'Z')
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static std::shared_ptr<Guild> guild_from_row(GuildManager *manager, std::unordered_map<std::string, util::variant> &row)
+{
+	std::shared_ptr<Guild> guild(new Guild(manager));
+	guild->tag = static_cast<std::string>(row["tag"]);
+	guild->name = static_cast<std::string>(row["name"]);
+	guild->description = util::text_word_wrap(static_cast<std::string>(row["description"]), manager->world->config["GuildMaxWidth"]);
+	guild->created = static_cast<int>(row["created"]);
+	guild->ranks = RankUnserialize(static_cast<std::string>(row["ranks"]));
+	guild->bank = static_cast<int>(row["bank"]);
+	return guild;
+}
+
 std::shared_ptr<Guild> GuildManager::GetGuild(std::string tag, Database * database)
 {
 	tag = util::uppercase(tag);
@@ -121,14 +153,7 @@ std::shared_ptr<Guild> GuildManager::GetGuild(std::string tag, Database * databa
 			return std::shared_ptr<Guild>();
 		}
 
-		std::unordered_map<std::string, util::variant> row = res.front();
-		std::shared_ptr<Guild> guild(new Guild(this));
-		guild->tag = static_cast<std::string>(row["tag"]);
-		guild->name = static_cast<std::string>(row["name"]);
-		guild->description = util::text_word_wrap(static_cast<std::string>(row["description"]), this->world->config["GuildMaxWidth"]);
-		guild->created = static_cast<int>(row["created"]);
-		guild->ranks = RankUnserialize(static_cast<std::string>(row["ranks"]));
-		guild->bank = static_cast<int>(row["bank"]);
+		std::shared_ptr<Guild> guild = guild_from_row(this, res.front());
 
 		res = db_ptr->Query("SELECT `name`, `guild_rank`, `guild_rank_string` FROM `characters` WHERE `guild` = '$' ORDER BY `guild_rank` ASC, `name` ASC", tag.c_str());
 
@@ -144,6 +169,102 @@ std::shared_ptr<Guild> GuildManager::GetGuild(std::string tag, Database * databa
 	}
 }
 
+std::vector<std::shared_ptr<Guild>> GuildManager::LoadGuilds(const std::vector<std::string>& tags, Database * database)
+{
+	std::vector<std::string> uncached;
+
+	UTIL_FOREACH(tags, raw_tag)
+	{
+		std::string tag = util::uppercase(util::trim(raw_tag));
+
+		if (this->cache.find(tag) == this->cache.end())
+			uncached.push_back(tag);
+	}
+
+	if (uncached.empty())
+		return std::vector<std::shared_ptr<Guild>>();
+
+	auto db_ptr = database ? database : this->world->db.get();
+
+	Guild_Load_Data data = GuildManager::QueryGuilds(uncached, *db_ptr);
+	return this->AddGuilds(data);
+}
+
+Guild_Load_Data GuildManager::QueryGuilds(const std::vector<std::string>& tags, Database& database)
+{
+	Guild_Load_Data data;
+	std::set<std::string> unique_tags;
+
+	UTIL_FOREACH(tags, raw_tag)
+	{
+		std::string tag = util::uppercase(util::trim(raw_tag));
+
+		// Only valid tags are loaded, as they are written in to the query unescaped
+		if (guild_valid_tag(tag))
+			unique_tags.insert(tag);
+	}
+
+	std::string tag_list;
+
+	UTIL_FOREACH(unique_tags, tag)
+	{
+		if (!tag_list.empty())
+			tag_list += ", ";
+
+		tag_list += "'" + tag + "'";
+	}
+
+	if (tag_list.empty())
+		return data;
+
+	data.guilds = database.Query("SELECT `tag`, `name`, `description`, `created`, `ranks`, `bank` FROM `guilds` WHERE `tag` IN (@)", tag_list.c_str());
+
+	if (!data.guilds.empty())
+		data.members = database.Query("SELECT `name`, `guild`, `guild_rank`, `guild_rank_string` FROM `characters` WHERE `guild` IN (@) ORDER BY `guild_rank` ASC, `name` ASC", tag_list.c_str());
+
+	return data;
+}
+
+std::vector<std::shared_ptr<Guild>> GuildManager::AddGuilds(Guild_Load_Data& data)
+{
+	std::vector<std::shared_ptr<Guild>> loaded;
+	std::unordered_map<std::string, std::shared_ptr<Guild>> added;
+
+	UTIL_FOREACH_REF(data.guilds, row)
+	{
+		std::string tag = util::uppercase(static_cast<std::string>(row["tag"]));
+		auto cached = this->cache.find(tag);
+		std::shared_ptr<Guild> guild;
+
+		if (cached != this->cache.end())
+			guild = cached->second.lock();
+
+		if (!guild)
+		{
+			guild = guild_from_row(this, row);
+			added[tag] = guild;
+		}
+
+		loaded.push_back(guild);
+	}
+
+	UTIL_FOREACH_REF(data.members, row)
+	{
+		auto it = added.find(util::uppercase(util::trim(static_cast<std::string>(row["guild"]))));
+
+		if (it != added.end())
+			it->second->members.push_back(std::make_shared<Guild_Member>(row["name"], row["guild_rank"], row["guild_rank_string"]));
+	}
+
+	UTIL_FOREACH_CREF(added, entry)
+	{
+		this->cache[entry.second->tag] = entry.second;
+		this->cache[entry.second->name] = entry.second;
+	}
+
+	return loaded;
+}
+
 std::shared_ptr<Guild> GuildManager::GetGuildName(std::string name)
 {
 	name = util::lowercase(name);
@@ -258,38 +379,48 @@ void GuildManager::SaveAll()
 	}
 }
 
-bool GuildManager::ValidName(std::string name)
+std::vector<Guild_Save_Data> GuildManager::TakeSaveData(bool all)
 {
-	name = util::lowercase(name);
+	std::vector<Guild_Save_Data> data;
 
-	if (name.length() < 4 || name.length() > std::size_t(int(this->world->config["GuildMaxNameLength"])))
+	// Guilds are cached under both their tag and name
+	if (all)
 	{
-		return false;
+		UTIL_FOREACH(this->cache, entry)
+		{
+			std::shared_ptr<Guild> guild(entry.second);
+
+			if (guild)
+				guild->needs_save = true;
+		}
 	}
 
-	for (std::size_t i = 0; i < name.length(); ++i)
+	UTIL_FOREACH(this->cache, entry)
 	{
-		if ((name[i] < 'a' || name[i] > 'z') && name[i] != ' ')
+		std::shared_ptr<Guild> guild(entry.second);
+
+		if (guild && guild->needs_save)
 		{
-			return false;
+			data.push_back(guild->SaveData());
+			guild->needs_save = false;
 		}
 	}
 
-	return true;
+	return data;
 }
 
-bool GuildManager::ValidTag(std::string tag)
+bool GuildManager::ValidName(std::string name)
 {
-	tag = util::uppercase(tag);
+	name = util::lowercase(name);
 
-	if (tag.length() < 2 || tag.length() > 3)
+	if (name.length() < 4 || name.length() > std::size_t(int(this->world->config["GuildMaxNameLength"])))
 	{
 		return false;
 	}
 
-	for (std::size_t i = 0; i < tag.length(); ++i)
+	for (std::size_t i = 0; i < name.length(); ++i)
 	{
-		if (tag[i] < 'A' || tag[i] > 'Z')
+		if ((name[i] < 'a' || name[i] > 'z') && name[i] != ' ')
 		{
 			return false;
 		}
@@ -298,6 +429,11 @@ bool GuildManager::ValidTag(std::string tag)
 	return true;
 }
 
+bool GuildManager::ValidTag(std::string tag)
+{
+	return guild_valid_tag(util::uppercase(tag));
+}
+
 bool GuildManager::ValidRank(std::string rank)
 {
 	rank = util::lowercase(rank);
@@ -346,6 +482,7 @@ void Guild::AddMember(Character *joined, Character *recruiter, bool alert, int r
 	joined->guild = shared_from_this();
 	joined->guild_rank = rank;
 	joined->guild_rank_string = this->GetRank(rank);
+	joined->InvalidateAvatar();
 
 	this->members.push_back(std::make_shared<Guild_Member>(joined->real_name, rank, joined->guild_rank_string));
 
@@ -414,6 +551,7 @@ void Guild::DelMember(std::string kicked, Character *kicker, bool alert)
 					character->guild.reset();
 					character->guild_rank = 0;
 					character->guild_rank_string.clear();
+					character->InvalidateAvatar();
 					// *this may not be valid after this point
 
 					if (character->online)
@@ -564,11 +702,31 @@ void Guild::Save()
 {
 	if (this->needs_save)
 	{
-		this->manager->world->db->Query("UPDATE `guilds` SET `description` = '$', `ranks` = '$', `bank` = # WHERE tag = '$'", this->description.c_str(), RankSerialize(this->ranks).c_str(), this->bank, this->tag.c_str());
+		std::shared_ptr<World_Save_Batch> batch = std::make_shared<World_Save_Batch>();
+		batch->guilds.push_back(this->SaveData());
+
+		if (!this->manager->world->QueueSave(batch))
+			batch->guilds.back().Save(*this->manager->world->db);
+
 		this->needs_save = false;
 	}
 }
 
+Guild_Save_Data Guild::SaveData() const
+{
+	Guild_Save_Data data;
+	data.tag = this->tag;
+	data.description = this->description;
+	data.ranks = RankSerialize(this->ranks);
+	data.bank = this->bank;
+	return data;
+}
+
+void Guild_Save_Data::Save(Database& db) const
+{
+	db.Query("UPDATE `guilds` SET `description` = '$', `ranks` = '$', `bank` = # WHERE tag = '$'", this->description.c_str(), this->ranks.c_str(), this->bank, this->tag.c_str());
+}
+
 Guild::~Guild()
 {
 	if (!this->manager->cache_clearing)
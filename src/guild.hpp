@@ -13,6 +13,8 @@
 #include "fwd/database.hpp"
 #include "fwd/world.hpp"
 
+#include "database.hpp"
+
 #include <algorithm>
 #include <array>
 #include <ctime>
@@ -69,6 +71,28 @@ class Guild_Create : public std::enable_shared_from_this<Guild_Create>
 		~Guild_Create();
 };
 
+/**
+ * Copy of the values Guild::Save writes to the guilds table
+ */
+struct Guild_Save_Data
+{
+	std::string tag;
+	std::string description;
+	std::string ranks;
+	int bank;
+
+	void Save(Database& db) const;
+};
+
+/**
+ * Guild and member rows read by GuildManager::QueryGuilds, which can run on any thread
+ */
+struct Guild_Load_Data
+{
+	Database_Result guilds;
+	Database_Result members;
+};
+
 /**
  * Manages when to load and save guild data
  */
@@ -83,6 +107,24 @@ class GuildManager
 		GuildManager(World *world_) : cache_clearing(false), world(world_) { }
 
 		std::shared_ptr<Guild> GetGuild(std::string tag, Database * database = nullptr);
+
+		/**
+		 * Loads every listed guild that isn't cached yet, with one query for the guilds and one for their members
+		 * The returned references are what keep the newly loaded guilds in the cache
+		 */
+		std::vector<std::shared_ptr<Guild>> LoadGuilds(const std::vector<std::string>& tags, Database * database = nullptr);
+
+		/**
+		 * Reads the rows for every valid tag listed without touching the cache, so it is safe to call from any thread
+		 */
+		static Guild_Load_Data QueryGuilds(const std::vector<std::string>& tags, Database& database);
+
+		/**
+		 * Caches the guilds read by QueryGuilds, keeping any that were loaded in the meantime
+		 * The returned references are what keep the newly loaded guilds in the cache
+		 */
+		std::vector<std::shared_ptr<Guild>> AddGuilds(Guild_Load_Data& data);
+
 		std::shared_ptr<Guild> GetGuildName(std::string name);
 		std::shared_ptr<Guild_Create> GetCreate(std::string tag);
 		std::shared_ptr<Guild_Create> BeginCreate(std::string tag, std::string name, Character *leader);
@@ -91,6 +133,12 @@ class GuildManager
 
 		void SaveAll();
 
+		/**
+		 * Returns a copy of every guild that needs saving and clears their needs_save flags
+		 * @param all Include guilds which have not changed
+		 */
+		std::vector<Guild_Save_Data> TakeSaveData(bool all = false);
+
 		bool ValidName(std::string name);
 		bool ValidTag(std::string tag);
 		bool ValidRank(std::string rank);
@@ -136,6 +184,7 @@ class Guild : public std::enable_shared_from_this<Guild>
 		void Msg(Character *from, std::string message, bool echo = true);
 
 		void Save();
+		Guild_Save_Data SaveData() const;
 
 		~Guild();
 };
@@ -23,7 +23,7 @@ void Attack_Use(Character *character, PacketReader &reader)
 
 	int ts_diff = timestamp - character->timestamp;
 
-	if (character->world->config["EnforceTimestamps"])
+	if (character->world->settings.enforce_timestamps)
 	{
 		if (ts_diff < 48)
 		{
@@ -36,15 +36,15 @@ void Attack_Use(Character *character, PacketReader &reader)
 	if (character->sitting != SIT_STAND)
 		return;
 
-	if (int(character->world->config["EnforceWeight"]) >= 1 && character->weight > character->maxweight)
+	if (character->world->settings.enforce_weight >= 1 && character->weight > character->maxweight)
 		return;
 
-	int limit_attack = character->world->config["LimitAttack"];
+	int limit_attack = character->world->settings.limit_attack;
 
 	if (limit_attack != 0 && character->attacks >= limit_attack)
 		return;
 
-	if (!character->world->config["EnforceTimestamps"] || ts_diff >= 60)
+	if (!character->world->settings.enforce_timestamps || ts_diff >= 60)
 	{
 		direction = character->direction;
 	}
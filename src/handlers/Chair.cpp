@@ -143,6 +143,7 @@ void Chair_Request(Character *character, PacketReader &reader)
 
 		character->x = x;
 		character->y = y;
+		character->map->character_grid.Update(character, x, y);
 
 		PacketBuilder reply(PACKET_CHAIR, PACKET_PLAYER, 6);
 		reply.AddShort(character->PlayerID());
@@ -85,6 +85,7 @@ void Init_Init(EOClient *client, PacketReader &reader)
 		}
 	}
 
+	// Passes everyone until the bans have loaded, Login_Request answers busy in the meantime
 	int ban_expires;
 	IPAddress remote_addr = client->GetRemoteAddr();
 	if ((ban_expires = client->server()->world->CheckBan(0, &remote_addr, ignore_hdid ? 0 : &client->hdid)) != -1)
@@ -46,13 +46,10 @@ void Item_Use(Character *character, PacketReader &reader)
 
 	auto QuestUsedItems = [](Character* character, int id)
 	{
-		UTIL_FOREACH(character->quests, q)
+		character->world->quest_triggers.Dispatch(character, QuestTriggerIndex::UsedItem, id, [id](Quest_Context& quest)
 		{
-			if (!q.second || q.second->GetQuest()->Disabled())
-				continue;
-
-			q.second->UsedItem(id);
-		}
+			quest.UsedItem(id);
+		});
 	};
 
 	switch (item.type)
@@ -100,7 +97,7 @@ void Item_Use(Character *character, PacketReader &reader)
 			int hpgain = item.hp;
 			int tpgain = item.tp;
 
-			if (character->world->config["LimitDamage"])
+			if (character->world->settings.limit_damage)
 			{
 				hpgain = std::min(hpgain, character->maxhp - character->hp);
 				tpgain = std::min(tpgain, character->maxtp - character->tp);
@@ -115,7 +112,7 @@ void Item_Use(Character *character, PacketReader &reader)
 			character->hp += hpgain;
 			character->tp += tpgain;
 
-			if (!character->world->config["LimitDamage"])
+			if (!character->world->settings.limit_damage)
 			{
 				character->hp = std::min(character->hp, character->maxhp);
 				character->tp = std::min(character->tp, character->maxtp);
@@ -234,6 +231,7 @@ void Item_Use(Character *character, PacketReader &reader)
 				if (character->world->eif->Get(character->paperdoll[i]).special == EIF::Cursed)
 				{
 					character->paperdoll[i] = 0;
+					character->InvalidateAvatar();
 					found = true;
 				}
 			}
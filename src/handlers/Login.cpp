@@ -20,6 +20,7 @@
 #include "../util/secure_string.hpp"
 
 #include <cstddef>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -43,6 +44,16 @@ void Login_Request(EOClient *client, PacketReader &reader)
 	if (client->server()->world->config["SeoseCompat"])
 		password = std::move(seose_str_hash(password.str(), client->server()->world->config["SeoseCompatKey"]));
 
+	// An empty ban list could just as well mean the database was unreachable
+	if (!client->server()->world->BansLoaded())
+	{
+		PacketBuilder reply(PACKET_LOGIN, PACKET_REPLY, 2);
+		reply.AddShort(LOGIN_BUSY);
+		client->Send(reply);
+		client->Close();
+		return;
+	}
+
 	if (client->server()->world->CheckBan(&username, 0, 0) != -1)
 	{
 		PacketBuilder reply(PACKET_F_INIT, PACKET_A_INIT, 2);
@@ -88,15 +99,20 @@ void Login_Request(EOClient *client, PacketReader &reader)
 		return;
 	}
 
-	auto successCallback = [username](EOClient* c)
+	std::shared_ptr<AccountCredentials> credentials(new AccountCredentials { username, std::move(password), HashFunc::NONE });
+
+	// The account was loaded by the login worker, so this only has to attach it to the client
+	auto successCallback = [username, credentials](EOClient* c)
 	{
-		c->player = c->server()->world->PlayerFactory(username);
 		c->server()->world->SetPendingLogin(username, false);
 
 		// The client may disconnect if the password generation takes too long
 		if (!c->Connected())
 			return;
 
+		if (credentials->player)
+			c->player = new Player(c->server()->world, std::move(*credentials->player));
+
 		if (!c->player)
 		{
 			// Someone deleted the account between checking it and logging in
@@ -161,12 +177,20 @@ void Login_Request(EOClient *client, PacketReader &reader)
 		return;
 	}
 
-	client->server()->world->SetPendingLogin(username, true);
+	World *world = client->server()->world;
+	world->SetPendingLogin(username, true);
+
+	// A login still waiting in the queue is dropped if its client disconnects
+	auto cancelCallback = [world, username]()
+	{
+		world->SetPendingLogin(username, false);
+	};
 
-	client->server()->world->CheckCredential(client)
+	world->CheckCredential(client, username)
 		->OnSuccess(successCallback)
 		->OnFailure(failureCallback)
-		->Execute(std::shared_ptr<AccountCredentials>(new AccountCredentials { username, std::move(password), HashFunc::NONE }));
+		->OnCancel(cancelCallback)
+		->Execute(credentials);
 }
 
 PACKET_HANDLER_REGISTER(PACKET_LOGIN)
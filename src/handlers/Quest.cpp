@@ -17,6 +17,7 @@
 
 #include "../util.hpp"
 
+#include <algorithm>
 #include <cstddef>
 #include <deque>
 #include <memory>
@@ -30,27 +31,31 @@ static void open_quest_dialog(Character* character, NPC* npc, int quest_id, int
 	struct dialog_t
 	{
 		int quest_id;
-		const std::shared_ptr<Quest_Context> quest;
+		std::shared_ptr<Quest_Context> quest;
 		const Dialog* dialog;
 	};
 
 	std::deque<dialog_t> dialogs;
 	std::size_t this_dialog = 0;
 
-	UTIL_FOREACH(character->quests, quest)
+	character->world->quest_triggers.Dispatch(character, QuestTriggerIndex::Dialog, vendor_id, [&](Quest_Context& quest)
 	{
-		if (!quest.second || quest.second->GetQuest()->Disabled())
-			continue;
-
-		const Dialog* dialog = quest.second->GetDialog(vendor_id);
+		const Dialog* dialog = quest.GetDialog(vendor_id);
 
 		if (dialog)
 		{
-			dialogs.push_back(dialog_t{quest.first, quest.second, dialog});
-
-			if (quest.first == quest_id)
-				this_dialog = dialogs.size() - 1;
+			short id = quest.GetQuest()->ID();
+			dialogs.push_back(dialog_t{id, character->GetQuest(id), dialog});
 		}
+	});
+
+	// Keep the quests listed in ID order
+	std::sort(UTIL_RANGE(dialogs), [](const dialog_t& a, const dialog_t& b) { return a.quest_id < b.quest_id; });
+
+	for (std::size_t i = 0; i < dialogs.size(); ++i)
+	{
+		if (dialogs[i].quest_id == quest_id)
+			this_dialog = i;
 	}
 
 	if (!dialogs.empty())
@@ -70,7 +70,7 @@ void Spell_Target_Self(Character *character, PacketReader &reader)
 	character->spell_target = Character::TargetSelf;
 	character->spell_target_id = 0;
 
-	if (character->world->config["EnforceTimestamps"])
+	if (character->world->settings.enforce_timestamps)
 	{
 		const ESF_Data& spell = character->world->esf->Get(character->spell_id);
 
@@ -118,7 +118,7 @@ void Spell_Target_Other(Character *character, PacketReader &reader)
 			return;
 	}
 
-	if (character->world->config["EnforceTimestamps"])
+	if (character->world->settings.enforce_timestamps)
 	{
 		const ESF_Data& spell = character->world->esf->Get(character->spell_id);
 
@@ -148,7 +148,7 @@ void Spell_Target_Group(Character *character, PacketReader &reader)
 	character->spell_target = Character::TargetGroup;
 	character->spell_target_id = 0;
 
-	if (character->world->config["EnforceTimestamps"])
+	if (character->world->settings.enforce_timestamps)
 	{
 		const ESF_Data& spell = character->world->esf->Get(character->spell_id);
 
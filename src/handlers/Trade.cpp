@@ -176,8 +176,8 @@ void Trade_Agree(Character *character, PacketReader &reader)
 			character->trade_inventory.clear();
 			character->trade_agree = false;
 
-			character->CheckQuestRules();
-			character->trade_partner->CheckQuestRules();
+			character->CheckQuestRules(QUEST_EVENT_ITEMS);
+			character->trade_partner->CheckQuestRules(QUEST_EVENT_ITEMS);
 
 			character->trade_partner->trading = false;
 			character->trade_partner->trade_inventory.clear();
@@ -291,8 +291,8 @@ void Trade_Close(Character *character, PacketReader &reader)
 	character->trade_partner->trade_inventory.clear();
 	character->trade_agree = false;
 
-	character->CheckQuestRules();
-	character->trade_partner->CheckQuestRules();
+	character->CheckQuestRules(QUEST_EVENT_ITEMS);
+	character->trade_partner->CheckQuestRules(QUEST_EVENT_ITEMS);
 
 	character->trade_partner->trade_partner = 0;
 	character->trade_partner = 0;
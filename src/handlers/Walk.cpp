@@ -24,7 +24,7 @@ static void walk_common(Character *character, PacketReader &reader, Map::WalkRes
 	unsigned char y = reader.GetChar();
 	Map::WalkResult walk_result = Map::WalkFail;
 
-	if (character->world->config["EnforceTimestamps"])
+	if (character->world->settings.enforce_timestamps)
 	{
 		if (timestamp - character->timestamp < 36)
 		{
@@ -60,8 +60,8 @@ static void walk_common(Character *character, PacketReader &reader, Map::WalkRes
 			character->trade_partner->trade_inventory.clear();
 			character->trade_agree = false;
 
-			character->CheckQuestRules();
-			character->trade_partner->CheckQuestRules();
+			character->CheckQuestRules(QUEST_EVENT_ITEMS);
+			character->trade_partner->CheckQuestRules(QUEST_EVENT_ITEMS);
 
 			character->trade_partner->trade_partner = 0;
 			character->trade_partner = 0;
@@ -79,7 +79,7 @@ static void walk_common(Character *character, PacketReader &reader, Map::WalkRes
 // Player walking (admin)
 void Walk_Admin(Character *character, PacketReader &reader)
 {
-	if (character->SourceDutyAccess() < int(character->world->admin_config["nowall"]))
+	if (character->SourceDutyAccess() < character->world->settings.admin_nowall)
 		return;
 
 	walk_common(character, reader, &Character::AdminWalk);
@@ -326,28 +326,7 @@ void Welcome_Msg(Player *player, PacketReader &reader)
 	reply.AddByte(255);
 	UTIL_FOREACH(updatecharacters, character)
 	{
-		reply.AddBreakString(character->SourceName());
-		reply.AddShort(character->PlayerID());
-		reply.AddShort(character->mapid);
-		reply.AddShort(character->x);
-		reply.AddShort(character->y);
-		reply.AddChar(character->direction);
-		reply.AddChar(6); // ?
-		reply.AddString(character->PaddedGuildTag());
-		reply.AddChar(character->level);
-		reply.AddChar(character->gender);
-		reply.AddChar(character->hairstyle);
-		reply.AddChar(character->haircolor);
-		reply.AddChar(character->race);
-		reply.AddShort(character->maxhp);
-		reply.AddShort(character->hp);
-		reply.AddShort(character->maxtp);
-		reply.AddShort(character->tp);
-		// equipment
-		character->AddPaperdollData(reply, "B000A0HSW");
-
-		reply.AddChar(character->sitting);
-		reply.AddChar(character->IsHideInvisible());
+		character->AddAvatarData(reply);
 		reply.AddByte(255);
 	}
 	UTIL_FOREACH(updatenpcs, npc)
@@ -4,30 +4,243 @@
  * See LICENSE.txt for more info.
  */
 
+#include <algorithm>
 #include <ctime>
+#include <memory>
+#include <random>
+#include <string>
 
 #include "util/threadpool.hpp"
 
 #include "loginmanager.hpp"
 #include "player.hpp"
+#include "timer.hpp"
+#include "util.hpp"
 #include "world.hpp"
 
+// Counts an attempt against a fixed rate window, returning false once the limit for the window has been used up
+template <typename Key>
+static bool login_rate_allows(LoginRateTable<Key>& rates, const Key& key, int limit, double window, double now)
+{
+    if (limit <= 0)
+        return true;
+
+    while (!rates.windows.empty() && rates.windows.front().first + window < now)
+    {
+        auto it = rates.entries.find(rates.windows.front().second);
+
+        // A refunded entry can have started a newer window since this one was queued
+        if (it != rates.entries.end() && it->second.window_start == rates.windows.front().first)
+            rates.entries.erase(it);
+
+        rates.windows.pop_front();
+    }
+
+    LoginRateEntry& entry = rates.entries[key];
+
+    if (entry.attempts == 0)
+    {
+        entry.window_start = now;
+        rates.windows.emplace_back(now, key);
+    }
+
+    return ++entry.attempts <= limit;
+}
+
+// Gives back an attempt counted by login_rate_allows
+template <typename Key>
+static void login_rate_refund(LoginRateTable<Key>& rates, const Key& key)
+{
+    auto it = rates.entries.find(key);
+
+    if (it != rates.entries.end() && it->second.attempts > 0)
+        --it->second.attempts;
+}
+
 LoginManager::LoginManager(std::shared_ptr<DatabaseFactory> databaseFactory, Config& config, const std::unordered_map<HashFunc, std::shared_ptr<Hasher>>& passwordHashers)
     : _databaseFactory(databaseFactory)
     , _config(config)
     , _passwordHashers(passwordHashers)
     , _processCount(0)
+    , _runningCount(0)
+    , _admitted(0)
+    , _busy(0)
+    , _rateLimited(0)
+    , _cacheHits(0)
+    , _hashes(0)
+    , _hashTotalUs(0)
+    , _hashMaxUs(0)
+{
+    // Keys the cached credential fingerprints so they are useless outside of this process
+    std::random_device random;
+
+    for (int i = 0; i < 4; ++i)
+        this->_verifiedKey += util::to_string(int(random() & 0x7FFFFFFF));
+
+    this->UpdateConfig();
+}
+
+LoginManager::~LoginManager()
+{
+    // The World is being torn down, so there is nothing left for the cancel callbacks to undo
+    for (auto& waiting : this->_waiting)
+        waiting.cancel(false);
+}
+
+void LoginManager::UpdateConfig()
+{
+    // The main thread keeps reading and rehashing _config while logins run, and even a lookup can write to a Config (operator[]
+    //   checks the environment the first time a key is read, variants cache their conversions). Doing all of that to the copy
+    //   here leaves the workers sharing it with nothing to write.
+    auto snapshot = std::make_shared<Config>(this->_config);
+
+    for (auto& entry : *snapshot)
+    {
+        const util::variant& value = (*snapshot)[entry.first];
+        value.GetInt();
+        value.GetFloat();
+        value.GetString();
+        value.GetBool();
+    }
+
+    this->_dbConfig = std::move(snapshot);
+}
+
+bool LoginManager::AdmitLogin(const IPAddress& remote, const std::string& username)
+{
+    const double now = Timer::GetTime();
+    const double window = util::tdparse(this->_config["LoginRateWindow"]);
+
+    bool ip_allowed = login_rate_allows(this->_ipRates, remote, int(this->_config["LoginRateIP"]), window, now);
+    bool account_allowed = login_rate_allows(this->_accountRates, username, int(this->_config["LoginRateAccount"]), window, now);
+
+    if (!ip_allowed || !account_allowed)
+    {
+        ++this->_rateLimited;
+        return false;
+    }
+
+    if (this->_processCount >= int(this->_config["LoginQueueSize"]))
+    {
+        ++this->_busy;
+        return false;
+    }
+
+    ++this->_admitted;
+    return true;
+}
+
+void LoginManager::CancelLogins(const EOClient* client)
+{
+    for (auto it = this->_waiting.begin(); it != this->_waiting.end(); )
+    {
+        if (it->client == client)
+        {
+            // The password was never checked, so the attempt doesn't count against the rate limits
+            login_rate_refund(this->_ipRates, it->remote);
+            login_rate_refund(this->_accountRates, it->username);
+
+            it->cancel(true);
+            --this->_processCount;
+            it = this->_waiting.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+LoginManager::Stats LoginManager::GetStats() const
+{
+    Stats stats;
+    stats.admitted = this->_admitted;
+    stats.busy = this->_busy;
+    stats.rate_limited = this->_rateLimited;
+    stats.cache_hits = this->_cacheHits;
+    stats.hashes = this->_hashes;
+    stats.hash_total_us = this->_hashTotalUs;
+    stats.hash_max_us = this->_hashMaxUs;
+    stats.waiting = this->_waiting.size();
+    stats.running = this->_runningCount;
+    return stats;
+}
+
+void LoginManager::DispatchLogins()
+{
+    // Hashing is CPU bound, so running more checks at once than there are threads only makes every login slower
+    int concurrency = int(this->_config["LoginConcurrency"]);
+
+    if (concurrency <= 0)
+        concurrency = int(util::ThreadPool::GetStats().threads);
+
+    while (this->_runningCount < concurrency && !this->_waiting.empty())
+    {
+        auto start = std::move(this->_waiting.front().start);
+        this->_waiting.pop_front();
+
+        ++this->_runningCount;
+        start();
+    }
+}
+
+std::string LoginManager::Fingerprint(util::secure_string& saltedPassword) const
+{
+    util::secure_string keyed(this->_verifiedKey + saltedPassword.str());
+    return Sha256Hasher().hash(keyed.str());
+}
+
+bool LoginManager::CheckVerified(const std::string& username, const std::string& passwordHash, util::secure_string& saltedPassword)
+{
+    std::lock_guard<std::mutex> guard(this->_verifiedLock);
+
+    auto it = this->_verified.find(username);
+
+    if (it == this->_verified.end())
+        return false;
+
+    if (it->second.expires < std::chrono::steady_clock::now())
+    {
+        this->_verified.erase(it);
+        return false;
+    }
+
+    // A changed password hash in the database means the password was changed since it was verified
+    return it->second.password_hash == passwordHash && it->second.fingerprint == this->Fingerprint(saltedPassword);
+}
+
+void LoginManager::AddVerified(const std::string& username, const std::string& passwordHash, util::secure_string& saltedPassword, std::chrono::steady_clock::duration lifetime)
 {
+    auto now = std::chrono::steady_clock::now();
+    std::string fingerprint = this->Fingerprint(saltedPassword);
+
+    std::lock_guard<std::mutex> guard(this->_verifiedLock);
+
+    for (auto it = this->_verified.begin(); it != this->_verified.end(); )
+    {
+        if (it->second.expires < now)
+            it = this->_verified.erase(it);
+        else
+            ++it;
+    }
+
+    this->_verified[username] = VerifiedLogin{passwordHash, std::move(fingerprint), now + lifetime};
+}
+
+void LoginManager::ForgetVerified(const std::string& username)
+{
+    std::lock_guard<std::mutex> guard(this->_verifiedLock);
+    this->_verified.erase(username);
 }
 
 bool LoginManager::CheckLogin(const std::string& username, util::secure_string&& password)
 {
-    auto res = this->_databaseFactory->CreateDatabase(this->_config)->Query("SELECT `password`, `password_version` FROM `accounts` WHERE `username` = '$'", username.c_str());
+    auto res = this->_databaseFactory->GetDatabase(this->_config)->Execute("SELECT `password`, `password_version` FROM `accounts` WHERE `username` = '$'", username.c_str());
 
     if (!res.empty())
     {
-        HashFunc dbPasswordVersion = static_cast<HashFunc>(res[0]["password_version"].GetInt());
-        std::string dbPasswordHash = std::string(res[0]["password"]);
+        HashFunc dbPasswordVersion = static_cast<HashFunc>(res[0][res.Column("password_version")].GetInt());
+        std::string dbPasswordHash = res[0][res.Column("password")].GetString();
 
         password = std::move(Hasher::SaltPassword(std::string(this->_config["PasswordSalt"]), username, std::move(password)));
 
@@ -43,10 +256,12 @@ void LoginManager::SetPassword(const std::string& username, util::secure_string&
     password = std::move(Hasher::SaltPassword(std::string(this->_config["PasswordSalt"]), username, std::move(password)));
     password = std::move(this->_passwordHashers[passwordVersion]->hash(password.str()));
 
-    this->_databaseFactory->CreateDatabase(this->_config)->Query("UPDATE `accounts` SET `password` = '$', `password_version` = # WHERE username = '$'",
+    this->_databaseFactory->GetDatabase(this->_config)->Query("UPDATE `accounts` SET `password` = '$', `password_version` = # WHERE username = '$'",
         password.str().c_str(),
         int(passwordVersion),
         username.c_str());
+
+    this->ForgetVerified(username);
 }
 
 AsyncOperation<AccountCreateInfo, bool>* LoginManager::CreateAccountAsync(EOClient* client)
@@ -59,7 +274,7 @@ AsyncOperation<AccountCreateInfo, bool>* LoginManager::CreateAccountAsync(EOClie
         password = std::move(Hasher::SaltPassword(std::string(this->_config["PasswordSalt"]), accountCreateInfo->username, std::move(password)));
         password = std::move(this->_passwordHashers[passwordVersion]->hash(password.str()));
 
-        auto db_res = this->_databaseFactory->CreateDatabase(this->_config)->Query(
+        auto db_res = this->_databaseFactory->GetDatabase(this->_config)->Query(
             "INSERT INTO `accounts` (`username`, `password`, `fullname`, `location`, `email`, `computer`, `hdid`, `regip`, `created`, `password_version`)"
             " VALUES ('$','$','$','$','$','$',#,'$',#,#)",
             accountCreateInfo->username.c_str(),
@@ -99,9 +314,9 @@ AsyncOperation<PasswordChangeInfo, bool>* LoginManager::SetPasswordAsync(EOClien
 }
 
 // This doesn't return AsyncOperation because it doesn't operate within the context of sending a client response
-void LoginManager::UpdatePasswordVersionInBackground(AccountCredentials&& accountCredentials)
+void LoginManager::UpdatePasswordVersionInBackground(AccountCredentials&& accountCredentials, const std::string& passwordSalt, std::shared_ptr<Config> dbConfig)
 {
-    auto updateThreadProc = [this](const void * state)
+    auto updateThreadProc = [this, passwordSalt, dbConfig](const void * state)
     {
         auto updateState = static_cast<const AccountCredentials*>(state);
         auto username = updateState->username;
@@ -111,10 +326,10 @@ void LoginManager::UpdatePasswordVersionInBackground(AccountCredentials&& accoun
 
         if (hashFunc != NONE)
         {
-            password = std::move(Hasher::SaltPassword(std::string(this->_config["PasswordSalt"]), username, std::move(password)));
+            password = std::move(Hasher::SaltPassword(passwordSalt, username, std::move(password)));
             password = std::move(this->_passwordHashers[hashFunc]->hash(std::move(password.str())));
 
-            this->_databaseFactory->CreateDatabase(this->_config)->Query("UPDATE `accounts` SET `password` = '$', `password_version` = # WHERE `username` = '$'",
+            this->_databaseFactory->GetDatabase(*dbConfig)->Query("UPDATE `accounts` SET `password` = '$', `password_version` = # WHERE `username` = '$'",
                 password.str().c_str(),
                 hashFunc,
                 username.c_str());
@@ -122,31 +337,59 @@ void LoginManager::UpdatePasswordVersionInBackground(AccountCredentials&& accoun
     };
 
     auto state = static_cast<void*>(new AccountCredentials(std::move(accountCredentials)));
-    util::ThreadPool::Queue(updateThreadProc, state);
+    util::ThreadPool::Queue(updateThreadProc, state, util::ThreadPool::Background);
 }
 
-AsyncOperation<AccountCredentials, LoginReply>* LoginManager::CheckLoginAsync(EOClient* client)
+AsyncOperation<AccountCredentials, LoginReply>* LoginManager::CheckLoginAsync(EOClient* client, const std::string& username)
 {
-    auto loginThreadProc = [this, client](std::shared_ptr<AccountCredentials> updateState)
+    // The worker only sees values taken here and the shared snapshot, never _config itself
+    auto verifiedLifetime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(util::tdparse(this->_config["LoginCacheTime"])));
+    auto currentPasswordVersion = static_cast<HashFunc>(this->_config["PasswordCurrentVersion"].GetInt());
+    std::string passwordSalt = this->_config["PasswordSalt"];
+    auto dbConfig = this->_dbConfig;
+
+    auto loginThreadProc = [this, client, verifiedLifetime, currentPasswordVersion, passwordSalt, dbConfig](std::shared_ptr<AccountCredentials> updateState)
     {
         auto username = updateState->username;
         auto password = std::move(updateState->password);
 
-        auto database = this->_databaseFactory->CreateDatabase(this->_config);
-        Database_Result res = database->Query("SELECT `password`, `password_version` FROM `accounts` WHERE `username` = '$'", username.c_str());
+        auto database = this->_databaseFactory->GetDatabase(*dbConfig);
+        Database_Statement_Result res = database->Execute("SELECT `password`, `password_version` FROM `accounts` WHERE `username` = '$'", username.c_str());
 
         if (!res.empty())
         {
-            HashFunc dbPasswordVersion = static_cast<HashFunc>(res[0]["password_version"].GetInt());
-            HashFunc currentPasswordVersion = static_cast<HashFunc>(this->_config["PasswordCurrentVersion"].GetInt());
-            std::string dbPasswordHash = std::string(res[0]["password"]);
+            HashFunc dbPasswordVersion = static_cast<HashFunc>(res[0][res.Column("password_version")].GetInt());
+            std::string dbPasswordHash = res[0][res.Column("password")].GetString();
 
             // make a copy of the password for input to the salting function
             // original password needs to be preserved for update of password version (if necessary)
             util::secure_string passwordCopy(std::string(password.str()));
-            util::secure_string saltedPassword = Hasher::SaltPassword(std::string(this->_config["PasswordSalt"]), username, std::move(passwordCopy));
-            if (this->_passwordHashers[dbPasswordVersion]->check(saltedPassword.str(), dbPasswordHash))
+            util::secure_string saltedPassword = Hasher::SaltPassword(passwordSalt, username, std::move(passwordCopy));
+
+            if (this->CheckVerified(username, dbPasswordHash, saltedPassword))
             {
+                ++this->_cacheHits;
+                updateState->player = Player::Query(username, *database);
+                return LOGIN_OK;
+            }
+
+            auto hashStart = std::chrono::steady_clock::now();
+            bool passwordOk = this->_passwordHashers[dbPasswordVersion]->check(saltedPassword.str(), dbPasswordHash);
+            std::uint64_t hashUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - hashStart).count();
+
+            ++this->_hashes;
+            this->_hashTotalUs += hashUs;
+
+            std::uint64_t hashMaxUs = this->_hashMaxUs;
+            while (hashUs > hashMaxUs && !this->_hashMaxUs.compare_exchange_weak(hashMaxUs, hashUs))
+                ;
+
+            if (passwordOk)
+            {
+                if (verifiedLifetime.count() > 0)
+                    this->AddVerified(username, dbPasswordHash, saltedPassword, verifiedLifetime);
+
                 if (dbPasswordVersion < currentPasswordVersion)
                 {
                     // There is a potential race here:
@@ -154,9 +397,11 @@ AsyncOperation<AccountCredentials, LoginReply>* LoginManager::CheckLoginAsync(EO
                     // 2. Password version starts update in background thread
                     // 3. User changes password while updating version in background
                     // 4. Password version completes update; overwrites changed password
-                    this->UpdatePasswordVersionInBackground(std::move(AccountCredentials { username, std::move(password), currentPasswordVersion }));
+                    this->UpdatePasswordVersionInBackground(std::move(AccountCredentials { username, std::move(password), currentPasswordVersion }), passwordSalt, dbConfig);
                 }
 
+                // Loading the account is as slow as checking it, so it is done here rather than by the callback on the main thread
+                updateState->player = Player::Query(username, *database);
                 return LOGIN_OK;
             }
             else
@@ -170,8 +415,21 @@ AsyncOperation<AccountCredentials, LoginReply>* LoginManager::CheckLoginAsync(EO
         }
     };
 
-    this->_processCount++;
+    ++this->_processCount;
 
     auto asyncOp = new AsyncOperation<AccountCredentials, LoginReply>(client, loginThreadProc, LOGIN_OK);
-    return asyncOp->OnComplete([this]() { this->_processCount--; });
+
+    // Admitted logins wait here in arrival order until a hashing slot is free, instead of all piling onto the threadpool at once
+    asyncOp->DispatchWith([this, client, remote = client->GetRemoteAddr(), username, asyncOp](std::function<void()> start)
+    {
+        this->_waiting.push_back(WaitingLogin{client, remote, username, std::move(start), [asyncOp](bool notify) { asyncOp->Cancel(notify); }});
+        this->DispatchLogins();
+    });
+
+    return asyncOp->OnComplete([this]()
+    {
+        --this->_processCount;
+        --this->_runningCount;
+        this->DispatchLogins();
+    });
 }
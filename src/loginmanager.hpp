@@ -7,43 +7,139 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <queue>
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 
 #include "hash.hpp"
+#include "socket.hpp"
 #include "fwd/config.hpp"
 #include "fwd/database.hpp"
+#include "fwd/eoclient.hpp"
 #include "fwd/player.hpp"
 #include "fwd/world.hpp"
 #include "util/secure_string.hpp"
 #include "util/semaphore.hpp"
 #include "util/async.hpp"
 
+struct LoginRateEntry
+{
+    double window_start = 0.0;
+    int attempts = 0;
+};
+
+// Login attempts per key. Windows are all the same length and queued in the order they start, so the ones that have
+//   expired are always at the front of the queue.
+template <typename Key>
+struct LoginRateTable
+{
+    std::unordered_map<Key, LoginRateEntry> entries;
+    std::deque<std::pair<double, Key>> windows;
+};
+
 class LoginManager
 {
 public:
+    struct Stats
+    {
+        std::uint64_t admitted;
+        std::uint64_t busy;
+        std::uint64_t rate_limited;
+        std::uint64_t cache_hits;
+
+        // Password checks that ran the hasher, and how long they took in microseconds
+        std::uint64_t hashes;
+        std::uint64_t hash_total_us;
+        std::uint64_t hash_max_us;
+
+        std::size_t waiting;
+        std::size_t running;
+    };
+
     LoginManager(std::shared_ptr<DatabaseFactory> databaseFactory, Config& config, const std::unordered_map<HashFunc, std::shared_ptr<Hasher>>& passwordHashers);
+    ~LoginManager();
 
     bool CheckLogin(const std::string& username, util::secure_string&& password);
     void SetPassword(const std::string& username, util::secure_string&& password);
 
     AsyncOperation<AccountCreateInfo, bool>* CreateAccountAsync(EOClient* client);
     AsyncOperation<PasswordChangeInfo, bool>* SetPasswordAsync(EOClient* client);
-    AsyncOperation<AccountCredentials, LoginReply>* CheckLoginAsync(EOClient* client);
+    AsyncOperation<AccountCredentials, LoginReply>* CheckLoginAsync(EOClient* client, const std::string& username);
+
+    // Called from a login worker thread, so it is handed the salt and a config to connect with instead of reading _config
+    void UpdatePasswordVersionInBackground(AccountCredentials&& accountCredentials, const std::string& passwordSalt, std::shared_ptr<Config> dbConfig);
+
+    // Rebuilds the config snapshot handed to login workers. Must be called from the main thread whenever the config changes.
+    void UpdateConfig();
 
-    void UpdatePasswordVersionInBackground(AccountCredentials&& accountCredentials);
+    // Decides whether a login attempt may join the login queue. Rejects it when the queue is full or the address or account
+    //   has made too many attempts recently. Must only be called from the main thread.
+    bool AdmitLogin(const IPAddress& remote, const std::string& username);
 
-    bool LoginBusy() const { return this->_processCount >= static_cast<int>(this->_config["LoginQueueSize"]); };
+    // Drops any logins the client still has waiting in the queue, for clients that are destroyed before their turn comes.
+    //   Their cancel callbacks are run, so anything the caller set up for the login can be undone.
+    void CancelLogins(const EOClient* client);
+
+    Stats GetStats() const;
 
 private:
+    struct WaitingLogin
+    {
+        const EOClient* client;
+        IPAddress remote;
+        std::string username;
+        std::function<void()> start;
+        std::function<void(bool)> cancel;
+    };
+
+    struct VerifiedLogin
+    {
+        std::string password_hash;
+        std::string fingerprint;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    void DispatchLogins();
+
+    std::string Fingerprint(util::secure_string& saltedPassword) const;
+    bool CheckVerified(const std::string& username, const std::string& passwordHash, util::secure_string& saltedPassword);
+    void AddVerified(const std::string& username, const std::string& passwordHash, util::secure_string& saltedPassword, std::chrono::steady_clock::duration lifetime);
+    void ForgetVerified(const std::string& username);
+
     std::shared_ptr<DatabaseFactory> _databaseFactory;
 
     Config& _config;
+
+    // Copy of _config shared by every login worker to connect with, see UpdateConfig
+    std::shared_ptr<Config> _dbConfig;
     std::unordered_map<HashFunc, std::shared_ptr<Hasher>> _passwordHashers;
 
-    // Count of the number of concurrent login requests
-    volatile std::atomic_int _processCount;
+    // Logins that have been admitted and are either waiting in _waiting or running. Main thread only.
+    int _processCount;
+    int _runningCount;
+    std::deque<WaitingLogin> _waiting;
+
+    LoginRateTable<IPAddress> _ipRates;
+    LoginRateTable<std::string> _accountRates;
+
+    // Recently verified credentials, so a quick reconnect doesn't pay for a full password hash again
+    std::mutex _verifiedLock;
+    std::unordered_map<std::string, VerifiedLogin> _verified;
+    std::string _verifiedKey;
+
+    std::uint64_t _admitted;
+    std::uint64_t _busy;
+    std::uint64_t _rateLimited;
+    std::atomic<std::uint64_t> _cacheHits;
+    std::atomic<std::uint64_t> _hashes;
+    std::atomic<std::uint64_t> _hashTotalUs;
+    std::atomic<std::uint64_t> _hashMaxUs;
 };
\ No newline at end of file
@@ -12,6 +12,7 @@
 
 #include "console.hpp"
 #include "socket.hpp"
+#include "util.hpp"
 
 #include <array>
 #include <csignal>
@@ -44,6 +45,11 @@ volatile bool eoserv_running = true;
 std::unique_ptr<EOServer> server;
 void Cleanup(std::unique_ptr<EOServer>& server);
 
+static Console::Level eoserv_log_level(Config& config)
+{
+	return Console::Level(util::clamp<int>(config["LogLevel"], Console::LEVEL_DEBUG, Console::LEVEL_ERROR));
+}
+
 #ifdef SIGHUP
 static void eoserv_rehash(int signal)
 {
@@ -325,6 +331,7 @@ Julian Smythe  ╚══════╝   ╚═╝   ╚═╝  ╚═╝╚═
 				}
 			}
 
+			// Console output is flushed after every line or batch, so stdout can be fully buffered
 			std::string logout = config["LogOut"];
 			if (!logout.empty() && logout.compare("-") != 0)
 			{
@@ -339,13 +346,16 @@ Julian Smythe  ╚══════╝   ╚═╝   ╚═╝  ╚═╝╚═
 					std::printf("\n\n--- %s ---\n\n", timestr);
 				}
 
-				if (std::setvbuf(stdout, 0, _IONBF, 0) != 0)
+				if (std::setvbuf(stdout, 0, _IOFBF, 64 * 1024) != 0)
 				{
 					Console::Wrn("Failed to change stdout buffer settings");
 				}
 			}
 		}
 
+		Console::SetLevel(eoserv_log_level(config));
+		Console::StartAsync();
+
 		const auto threadPoolThreads = static_cast<int>(config["ThreadPoolThreads"]);
 		if (threadPoolThreads <= 0)
 		{
@@ -368,7 +378,7 @@ Julian Smythe  ╚══════╝   ╚═╝   ╚═╝  ╚═╝╚═
 		Console::Out("Setting number of threadpool threads to %d", threadPoolSize);
 		util::ThreadPool::SetNumThreads(threadPoolSize);
 
-		const auto databaseFactory = std::make_shared<DatabaseFactory>(DatabaseFactory());
+		const auto databaseFactory = std::make_shared<DatabaseFactory>();
 
 		server = std::make_unique<EOServer>(static_cast<std::string>(config["Host"]), static_cast<int>(config["Port"]), databaseFactory, config, aconfig);
 		server->Listen(int(config["MaxConnections"]), int(config["ListenBacklog"]));
@@ -459,6 +469,8 @@ Julian Smythe  ╚══════╝   ╚═╝   ╚═╝  ╚═╝╚═
 				eoserv_sig_rehash = false;
 				server->world->Rehash(nullptr);
 
+				Console::StopAsync();
+
 				// Does not support changing from file logging back to '-'
 				{
 					std::time_t rawtime;
@@ -504,13 +516,14 @@ Julian Smythe  ╚══════╝   ╚═╝   ╚═╝  ╚═╝╚═
 							std::printf("\n\n--- %s ---\n\n", timestr);
 						}
 
-						if (std::setvbuf(stdout, 0, _IONBF, 0) != 0)
+						if (std::setvbuf(stdout, 0, _IOFBF, 64 * 1024) != 0)
 						{
 							Console::Wrn("Failed to change stdout buffer settings");
 						}
 					}
 				}
 
+				Console::StartAsync();
 				Console::Out("Config reloaded");
 			}
 
@@ -570,15 +583,14 @@ Julian Smythe  ╚══════╝   ╚═╝   ╚═╝  ╚═╝╚═
 
 void Cleanup(std::unique_ptr<EOServer>& server)
 {
-	if (!server || !server->world)
+	if (server && server->world)
 	{
-		Database::GlobalFree();
-		return;
+		server->world->SaveCommandAudit();
+		server->world->DumpToFile(server->world->config["WorldDumpFile"]);
+		server.reset();
 	}
 
-	server->world->SaveCommandAudit();
-	server->world->DumpToFile(server->world->config["WorldDumpFile"]);
-	server.reset();
-
 	Database::GlobalFree();
+
+	Console::StopAsync();
 }
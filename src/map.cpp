@@ -23,7 +23,6 @@
 
 #include "console.hpp"
 #include "util.hpp"
-#include "util/rpn.hpp"
 
 #include <algorithm>
 #include <cstdio>
@@ -32,7 +31,6 @@
 #include <list>
 #include <memory>
 #include <set>
-#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -40,6 +38,22 @@
 
 static const char *map_safe_fail_filename;
 
+// Compares the distance of (x, y) from the old and new position of something which moved one tile.
+// Returns 1 if the tile has come in to view, -1 if it has gone out of view, and 0 otherwise.
+static int map_view_change(int x, int y, int old_x, int old_y, int new_x, int new_y, int seedistance)
+{
+	const int old_distance = util::path_length(x, y, old_x, old_y);
+	const int new_distance = util::path_length(x, y, new_x, new_y);
+
+	if (new_distance == seedistance && old_distance == seedistance + 1)
+		return 1;
+
+	if (new_distance == seedistance + 1 && old_distance == seedistance)
+		return -1;
+
+	return 0;
+}
+
 static void map_safe_fail(int line)
 {
 	Console::Err("Invalid file / failed read/seek: %s -- %i", map_safe_fail_filename, line);
@@ -352,6 +366,7 @@ Map::Map(int id, World *world)
 	this->wedding = nullptr;
 	this->evacuate_lock = false;
 	this->has_timed_spikes = false;
+	this->idle_since = Timer::GetTime();
 
 	this->Load();
 
@@ -506,7 +521,17 @@ bool Map::Load()
 	this->width = PacketProcessor::Number(buf[0]) + 1;
 	this->height = PacketProcessor::Number(buf[1]) + 1;
 
-	this->tiles.resize(this->height * this->width);
+	this->tilespecs.assign(this->height * this->width, static_cast<signed char>(Map_Tile::None));
+	this->warps.clear();
+
+	this->character_grid.Reset(this->width, this->height);
+	this->npc_grid.Reset(this->width, this->height);
+	this->item_grid.Reset(this->width, this->height);
+
+	UTIL_FOREACH(this->items, item)
+	{
+		this->item_grid.Update(item.get(), item->x, item->y);
+	}
 
 	SAFE_SEEK(fh, 0x2A, SEEK_SET);
 	SAFE_READ(buf, sizeof(char), 3, fh);
@@ -555,7 +580,7 @@ bool Map::Load()
 				continue;
 			}
 
-			this->GetTile(xloc, yloc).tilespec = static_cast<Map_Tile::TileSpec>(spec);
+			this->tilespecs[yloc * this->width + xloc] = static_cast<signed char>(spec);
 
 			if (spec == Map_Tile::Chest)
 			{
@@ -600,16 +625,24 @@ bool Map::Load()
 				continue;
 			}
 
-			try
-			{
-				this->GetTile(xloc, yloc).warp = newwarp;
-			}
-			catch (...)
-			{
-				std::fclose(fh);
-				map_safe_fail(__LINE__);
-				return false;
-			}
+			if (newwarp)
+				this->warps[yloc * this->width + xloc] = newwarp;
+		}
+	}
+
+	this->walk_grid.Reset(this->width, this->height);
+	this->nav_grid.Reset(this->width, this->height);
+
+	for (int y = 0; y < this->height; ++y)
+	{
+		for (int x = 0; x < this->width; ++x)
+		{
+			const int i = y * this->width + x;
+			Map_Tile::TileSpec spec = static_cast<Map_Tile::TileSpec>(this->tilespecs[i]);
+			bool warp = this->warps.find(i) != this->warps.end();
+
+			this->walk_grid.SetWalkable(x, y, Map_Tile::Walkable(spec));
+			this->nav_grid.SetWalkable(x, y, !warp && Map_Tile::Walkable(spec, true));
 		}
 	}
 
@@ -642,6 +675,7 @@ bool Map::Load()
 
 			NPC *newnpc = new NPC(this, npc_id, x, y, spawntype, spawntime, index++);
 			this->npcs.push_back(newnpc);
+			this->npc_indexes.Take(newnpc->index);
 
 			newnpc->Spawn();
 		}
@@ -736,6 +770,9 @@ void Map::Unload()
 	}
 
 	this->npcs.clear();
+	this->npc_grid.Clear();
+	this->npc_indexes.Clear();
+	this->act_queue.clear();
 
 	if (this->arena)
 	{
@@ -753,42 +790,35 @@ void Map::Unload()
 	}
 
 	this->chests.clear();
-	this->tiles.clear();
+	this->tilespecs.clear();
+	this->tilespecs.shrink_to_fit();
+	this->warps.clear();
+	this->walk_grid.Reset(0, 0);
+	this->nav_grid.Reset(0, 0);
 }
 
-int Map::GenerateItemID() const
+int Map::GenerateItemID()
 {
-	int lowest_free_id = 1;
-	restart_loop:
-	UTIL_FOREACH(this->items, item)
-	{
-		if (item->uid == lowest_free_id)
-		{
-			lowest_free_id = item->uid + 1;
-			goto restart_loop;
-		}
-	}
-	return lowest_free_id;
+	return this->item_ids.Acquire();
 }
 
-unsigned char Map::GenerateNPCIndex() const
+unsigned char Map::GenerateNPCIndex()
 {
-	unsigned char lowest_free_id = 1;
-	restart_loop:
-	UTIL_FOREACH(this->npcs, npc)
-	{
-		if (npc->index == lowest_free_id)
-		{
-			lowest_free_id = npc->index + 1;
-			goto restart_loop;
-		}
-	}
-	return lowest_free_id;
+	return this->npc_indexes.Acquire();
 }
 
 void Map::Enter(Character *character, WarpAnimation animation)
 {
+	double current_time = Timer::GetTime();
+
+	if (this->Activity(current_time) == ActivityDormant)
+	{
+		this->Wake(current_time);
+	}
+
 	this->characters.push_back(character);
+	this->character_grid.Update(character, character->x, character->y);
+	this->character_index.Add(character);
 	character->map = this;
 	character->last_walk = Timer::GetTime();
 	character->attacks = 0;
@@ -797,32 +827,13 @@ void Map::Enter(Character *character, WarpAnimation animation)
 	PacketBuilder builder(PACKET_PLAYERS, PACKET_AGREE, 63);
 
 	builder.AddByte(255);
-	builder.AddBreakString(character->SourceName());
-	builder.AddShort(character->PlayerID());
-	builder.AddShort(character->mapid);
-	builder.AddShort(character->x);
-	builder.AddShort(character->y);
-	builder.AddChar(character->direction);
-	builder.AddChar(6); // ?
-	builder.AddString(character->PaddedGuildTag());
-	builder.AddChar(character->level);
-	builder.AddChar(character->gender);
-	builder.AddChar(character->hairstyle);
-	builder.AddChar(character->haircolor);
-	builder.AddChar(character->race);
-	builder.AddShort(character->maxhp);
-	builder.AddShort(character->hp);
-	builder.AddShort(character->maxtp);
-	builder.AddShort(character->tp);
-	// equipment
-	character->AddPaperdollData(builder, "B000A0HSW");
-
-	builder.AddChar(character->sitting);
-	builder.AddChar(character->IsHideInvisible());
+	character->AddAvatarData(builder);
 	builder.AddChar(animation);
 	builder.AddByte(255);
 	builder.AddChar(1); // 0 = NPC, 1 = player
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, checkcharacter)
 	{
 		if (checkcharacter == character || !character->InRange(checkcharacter))
@@ -830,10 +841,10 @@ void Map::Enter(Character *character, WarpAnimation animation)
 			continue;
 		}
 
-		checkcharacter->Send(builder);
+		checkcharacter->Send(packet);
 	}
 
-	character->CheckQuestRules();
+	character->CheckQuestRules(QUEST_EVENT_MOVE);
 }
 
 void Map::Leave(Character *character, WarpAnimation animation, bool silent)
@@ -848,6 +859,8 @@ void Map::Leave(Character *character, WarpAnimation animation, bool silent)
 			builder.AddChar(animation);
 		}
 
+		PacketBroadcast packet(builder);
+
 		UTIL_FOREACH(this->characters, checkcharacter)
 		{
 			if (checkcharacter == character || !character->InRange(checkcharacter))
@@ -855,7 +868,7 @@ void Map::Leave(Character *character, WarpAnimation animation, bool silent)
 				continue;
 			}
 
-			checkcharacter->Send(builder);
+			checkcharacter->Send(packet);
 		}
 	}
 
@@ -869,7 +882,125 @@ void Map::Leave(Character *character, WarpAnimation animation, bool silent)
 		this->characters.end()
 	);
 
+	this->character_grid.Remove(character);
+	this->character_index.Remove(character);
+
 	character->map = 0;
+
+	if (this->characters.empty())
+	{
+		this->idle_since = Timer::GetTime();
+	}
+}
+
+bool Map_ActOrder::operator()(const NPC *a, const NPC *b) const
+{
+	if (a->act_deadline != b->act_deadline)
+		return a->act_deadline < b->act_deadline;
+
+	if (a->index != b->index)
+		return a->index < b->index;
+
+	return a < b;
+}
+
+Map::ActivityState Map::Activity(double current_time) const
+{
+	if (!this->characters.empty())
+	{
+		return ActivityHot;
+	}
+
+	if (this->idle_since + this->world->settings.npc_idle_time > current_time)
+	{
+		return ActivityWarm;
+	}
+
+	return ActivityDormant;
+}
+
+void Map::Wake(double current_time)
+{
+	// Shift every NPC's timers forward by however long the map slept for, so they pick up where they left off
+	double slept = current_time - (this->idle_since + this->world->settings.npc_idle_time);
+
+	this->act_queue.clear();
+
+	UTIL_FOREACH(this->npcs, npc)
+	{
+		npc->last_act += slept;
+		npc->last_talk += slept;
+
+		if (npc->alive)
+		{
+			this->ScheduleAct(npc);
+		}
+	}
+
+	// Respawns that came due while dormant happen all at once, in the same order world_spawn_npcs would have done them
+	this->SpawnNPCs(current_time);
+}
+
+void Map::ScheduleAct(NPC *npc)
+{
+	this->act_queue.erase(npc);
+	npc->act_deadline = npc->last_act + npc->act_speed;
+	this->act_queue.insert(npc);
+}
+
+void Map::UnscheduleAct(NPC *npc)
+{
+	this->act_queue.erase(npc);
+}
+
+void Map::SpawnNPCs(double current_time)
+{
+	double spawnrate = this->world->config["SpawnRate"];
+	bool respawn_children = this->world->config["RespawnBossChildren"];
+
+	UTIL_FOREACH(this->npcs, npc)
+	{
+		if ((!npc->alive && npc->dead_since + (double(npc->spawn_time) * spawnrate) < current_time)
+		 && (!npc->ENF().child || (npc->parent && npc->parent->alive && respawn_children)))
+		{
+#ifdef DEBUG
+			Console::Dbg("Spawning NPC %i on map %i", npc->id, this->id);
+#endif // DEBUG
+			npc->Spawn();
+		}
+	}
+}
+
+void Map::ActNPCs(double current_time)
+{
+	std::vector<NPC *> due;
+
+	// Each NPC acts at most once per call, even if it has fallen more than one act behind
+	for (auto it = this->act_queue.begin(); it != this->act_queue.end() && (*it)->act_deadline < current_time; )
+	{
+		due.push_back(*it);
+		it = this->act_queue.erase(it);
+	}
+
+	UTIL_FOREACH(due, npc)
+	{
+		if (npc->alive)
+		{
+			npc->Act();
+			this->ScheduleAct(npc);
+		}
+	}
+}
+
+void Map::TalkNPCs(double current_time)
+{
+	UTIL_FOREACH(this->npcs, npc)
+	{
+		if (npc->alive && npc->last_talk + npc->Data().talk_speed < current_time)
+		{
+			npc->Talk();
+		}
+	}
 }
 
 void Map::Msg(Character *from, std::string message, bool echo)
@@ -880,6 +1011,8 @@ void Map::Msg(Character *from, std::string message, bool echo)
 	builder.AddShort(from->PlayerID());
 	builder.AddString(message);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		if (!from->InRange(character))
@@ -890,7 +1023,7 @@ void Map::Msg(Character *from, std::string message, bool echo)
 		if (!echo && character == from)
 			continue;
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 }
 
@@ -905,18 +1038,20 @@ void Map::Msg(NPC *from, std::string message)
 	builder.AddChar(static_cast<unsigned char>(message.length()));
 	builder.AddString(message);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		if (!character->InRange(from))
 			continue;
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 }
 
 Map::WalkResult Map::Walk(Character *from, Direction direction, bool admin)
 {
-	int seedistance = this->world->config["SeeDistance"];
+	int seedistance = this->world->settings.see_distance;
 
 	unsigned char target_x = from->x;
 	unsigned char target_y = from->y;
@@ -972,17 +1107,17 @@ Map::WalkResult Map::Walk(Character *from, Direction direction, bool admin)
 		if (!this->Walkable(target_x, target_y))
 			return WalkFail;
 
-		if (this->Occupied(target_x, target_y, PlayerOnly) && (from->last_walk + double(this->world->config["GhostTimer"]) > Timer::GetTime()))
+		if (this->Occupied(target_x, target_y, PlayerOnly) && (from->last_walk + this->world->settings.ghost_timer > Timer::GetTime()))
 			return WalkFail;
 	}
 
-	const Map_Warp& warp = this->GetWarp(target_x, target_y);
+	const Map_Warp *warp = this->GetWarp(target_x, target_y);
 
 	if (warp)
 	{
-		if (from->level >= warp.levelreq && (warp.spec == Map_Warp::NoDoor || warp.open))
+		if (from->level >= warp->levelreq && (warp->spec == Map_Warp::NoDoor || warp->open))
 		{
-			Map* map = this->world->GetMap(warp.map);
+			Map* map = this->world->GetMap(warp->map);
 			if (from->SourceAccess() < ADMIN_GUIDE && map->evacuate_lock && map->id != from->map->id)
 			{
 				from->StatusMsg(this->world->i18n.Format("map_evacuate_block"));
@@ -990,7 +1125,7 @@ Map::WalkResult Map::Walk(Character *from, Direction direction, bool admin)
 			}
 			else
 			{
-				from->Warp(warp.map, warp.x, warp.y);
+				from->Warp(warp->map, warp->x, warp->y);
 			}
 
 			return WalkWarped;
@@ -1004,131 +1139,57 @@ Map::WalkResult Map::Walk(Character *from, Direction direction, bool admin)
     from->attacks = 0;
     from->CancelSpell();
 
+	const int old_x = from->x;
+	const int old_y = from->y;
+
 	from->direction = direction;
 
 	from->x = target_x;
 	from->y = target_y;
 
-	int newx;
-	int newy;
-	int oldx;
-	int oldy;
-
-	std::vector<std::pair<int, int>> newcoords;
-	std::vector<std::pair<int, int>> oldcoords;
+	this->character_grid.Update(from, from->x, from->y);
 
 	std::vector<Character *> newchars;
 	std::vector<Character *> oldchars;
 	std::vector<NPC *> newnpcs;
 	std::vector<NPC *> oldnpcs;
-	std::vector<std::shared_ptr<Map_Item>> newitems;
+	std::vector<Map_Item *> newitems;
 
-	switch (direction)
-	{
-		case DIRECTION_UP:
-			for (int i = -seedistance; i <= seedistance; ++i)
-			{
-				newy = from->y - seedistance + std::abs(i);
-				newx = from->x + i;
-				oldy = from->y + seedistance + 1 - std::abs(i);
-				oldx = from->x + i;
-
-				newcoords.push_back(std::make_pair(newx, newy));
-				oldcoords.push_back(std::make_pair(oldx, oldy));
-			}
-			break;
-
-		case DIRECTION_RIGHT:
-			for (int i = -seedistance; i <= seedistance; ++i)
-			{
-				newx = from->x + seedistance - std::abs(i);
-				newy = from->y + i;
-				oldx = from->x - seedistance - 1 + std::abs(i);
-				oldy = from->y + i;
-
-				newcoords.push_back(std::make_pair(newx, newy));
-				oldcoords.push_back(std::make_pair(oldx, oldy));
-			}
-			break;
-
-		case DIRECTION_DOWN:
-			for (int i = -seedistance; i <= seedistance; ++i)
-			{
-				newy = from->y + seedistance - std::abs(i);
-				newx = from->x + i;
-				oldy = from->y - seedistance - 1 + std::abs(i);
-				oldx = from->x + i;
-
-				newcoords.push_back(std::make_pair(newx, newy));
-				oldcoords.push_back(std::make_pair(oldx, oldy));
-			}
-			break;
-
-		case DIRECTION_LEFT:
-			for (int i = -seedistance; i <= seedistance; ++i)
-			{
-				newx = from->x - seedistance + std::abs(i);
-				newy = from->y + i;
-				oldx = from->x + seedistance + 1 - std::abs(i);
-				oldy = from->y + i;
-
-				newcoords.push_back(std::make_pair(newx, newy));
-				oldcoords.push_back(std::make_pair(oldx, oldy));
-			}
-			break;
-
-	}
-
-	UTIL_FOREACH(this->characters, checkchar)
+	this->character_grid.ForEach(from->x, from->y, seedistance + 1, [&](Character *checkchar)
 	{
 		if (checkchar == from)
 		{
-			continue;
+			return;
 		}
 
-		for (std::size_t i = 0; i < oldcoords.size(); ++i)
+		switch (map_view_change(checkchar->x, checkchar->y, old_x, old_y, from->x, from->y, seedistance))
 		{
-			if (checkchar->x == oldcoords[i].first && checkchar->y == oldcoords[i].second)
-			{
-				oldchars.push_back(checkchar);
-			}
-			else if (checkchar->x == newcoords[i].first && checkchar->y == newcoords[i].second)
-			{
-				newchars.push_back(checkchar);
-			}
+			case 1: newchars.push_back(checkchar); break;
+			case -1: oldchars.push_back(checkchar); break;
 		}
-	}
+	});
 
-	UTIL_FOREACH(this->npcs, checknpc)
+	this->npc_grid.ForEach(from->x, from->y, seedistance + 1, [&](NPC *checknpc)
 	{
 		if (!checknpc->alive)
 		{
-			continue;
+			return;
 		}
 
-		for (std::size_t i = 0; i < oldcoords.size(); ++i)
+		switch (map_view_change(checknpc->x, checknpc->y, old_x, old_y, from->x, from->y, seedistance))
 		{
-			if (checknpc->x == oldcoords[i].first && checknpc->y == oldcoords[i].second)
-			{
-				oldnpcs.push_back(checknpc);
-			}
-			else if (checknpc->x == newcoords[i].first && checknpc->y == newcoords[i].second)
-			{
-				newnpcs.push_back(checknpc);
-			}
+			case 1: newnpcs.push_back(checknpc); break;
+			case -1: oldnpcs.push_back(checknpc); break;
 		}
-	}
+	});
 
-	UTIL_FOREACH(this->items, checkitem)
+	this->item_grid.ForEach(from->x, from->y, seedistance, [&](Map_Item *checkitem)
 	{
-		for (std::size_t i = 0; i < oldcoords.size(); ++i)
+		if (map_view_change(checkitem->x, checkitem->y, old_x, old_y, from->x, from->y, seedistance) == 1)
 		{
-			if (checkitem->x == newcoords[i].first && checkitem->y == newcoords[i].second)
-			{
-				newitems.push_back(checkitem);
-			}
+			newitems.push_back(checkitem);
 		}
-	}
+	});
 
 	PacketBuilder builder(PACKET_AVATAR, PACKET_REMOVE, 2);
 	builder.AddShort(from->PlayerID());
@@ -1146,27 +1207,7 @@ Map::WalkResult Map::Walk(Character *from, Direction direction, bool admin)
 	builder.SetID(PACKET_PLAYERS, PACKET_AGREE);
 
 	builder.AddByte(255);
-	builder.AddBreakString(from->SourceName());
-	builder.AddShort(from->PlayerID());
-	builder.AddShort(from->mapid);
-	builder.AddShort(from->x);
-	builder.AddShort(from->y);
-	builder.AddChar(from->direction);
-	builder.AddChar(6); // ?
-	builder.AddString(from->PaddedGuildTag());
-	builder.AddChar(from->level);
-	builder.AddChar(from->gender);
-	builder.AddChar(from->hairstyle);
-	builder.AddChar(from->haircolor);
-	builder.AddChar(from->race);
-	builder.AddShort(from->maxhp);
-	builder.AddShort(from->hp);
-	builder.AddShort(from->maxtp);
-	builder.AddShort(from->tp);
-	// equipment
-	from->AddPaperdollData(builder, "B000A0HSW");
-	builder.AddChar(from->sitting);
-	builder.AddChar(from->IsHideInvisible());
+	from->AddAvatarData(builder);
 	builder.AddByte(255);
 	builder.AddChar(1); // 0 = NPC, 1 = player
 
@@ -1174,28 +1215,7 @@ Map::WalkResult Map::Walk(Character *from, Direction direction, bool admin)
 	{
 		PacketBuilder rbuilder(PACKET_PLAYERS, PACKET_AGREE, 62);
 		rbuilder.AddByte(255);
-		rbuilder.AddBreakString(character->SourceName());
-		rbuilder.AddShort(character->PlayerID());
-		rbuilder.AddShort(character->mapid);
-		rbuilder.AddShort(character->x);
-		rbuilder.AddShort(character->y);
-		rbuilder.AddChar(character->direction);
-		rbuilder.AddChar(6); // ?
-		rbuilder.AddString(character->PaddedGuildTag());
-		rbuilder.AddChar(character->level);
-		rbuilder.AddChar(character->gender);
-		rbuilder.AddChar(character->hairstyle);
-		rbuilder.AddChar(character->haircolor);
-		rbuilder.AddChar(character->race);
-		rbuilder.AddShort(character->maxhp);
-		rbuilder.AddShort(character->hp);
-		rbuilder.AddShort(character->maxtp);
-		rbuilder.AddShort(character->tp);
-		// equipment
-		character->AddPaperdollData(rbuilder, "B000A0HSW");
-
-		rbuilder.AddChar(character->sitting);
-		rbuilder.AddChar(character->IsHideInvisible());
+		character->AddAvatarData(rbuilder);
 		rbuilder.AddByte(255);
 		rbuilder.AddChar(1); // 0 = NPC, 1 = player
 
@@ -1211,14 +1231,16 @@ Map::WalkResult Map::Walk(Character *from, Direction direction, bool admin)
 	builder.AddChar(from->x);
 	builder.AddChar(from->y);
 
-	UTIL_FOREACH(this->characters, character)
+	PacketBroadcast packet(builder);
+
+	UTIL_FOREACH(this->CharactersInRange(from->x, from->y, seedistance), character)
 	{
 		if (character == from || !from->InRange(character))
 		{
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 
 	builder.Reset(2 + newitems.size() * 9);
@@ -1256,11 +1278,11 @@ Map::WalkResult Map::Walk(Character *from, Direction direction, bool admin)
 		npc->RemoveFromView(from);
 	}
 
-	from->CheckQuestRules();
+	from->CheckQuestRules(QUEST_EVENT_MOVE);
 
 	Map_Tile::TileSpec spec = this->GetSpec(from->x, from->y);
 
-	double spike_damage = this->world->config["SpikeDamage"];
+	double spike_damage = this->world->settings.spike_damage;
 
 	if (spike_damage > 0.0 && (spec == Map_Tile::Spikes2 || spec == Map_Tile::Spikes3) && !from->IsHideInvisible())
 	{
@@ -1280,7 +1302,7 @@ Map::WalkResult Map::Walk(Character *from, Direction direction, bool admin)
 
 Map::WalkResult Map::Walk(NPC *from, Direction direction)
 {
-	int seedistance = this->world->config["SeeDistance"];
+	int seedistance = this->world->settings.see_distance;
 
 	unsigned char target_x = from->x;
 	unsigned char target_y = from->y;
@@ -1335,92 +1357,27 @@ Map::WalkResult Map::Walk(NPC *from, Direction direction)
 		return WalkFail;
 	}
 
+	const int old_x = from->x;
+	const int old_y = from->y;
+
 	from->x = target_x;
 	from->y = target_y;
 
-	int newx;
-	int newy;
-	int oldx;
-	int oldy;
-
-	std::vector<std::pair<int, int>> newcoords;
-	std::vector<std::pair<int, int>> oldcoords;
+	this->npc_grid.Update(from, from->x, from->y);
 
 	std::vector<Character *> newchars;
 	std::vector<Character *> oldchars;
 
-	switch (direction)
-	{
-		case DIRECTION_UP:
-			for (int i = -seedistance; i <= seedistance; ++i)
-			{
-				newy = from->y - seedistance + std::abs(i);
-				newx = from->x + i;
-				oldy = from->y + seedistance + 1 - std::abs(i);
-				oldx = from->x + i;
-
-				newcoords.push_back(std::make_pair(newx, newy));
-				oldcoords.push_back(std::make_pair(oldx, oldy));
-			}
-			break;
-
-		case DIRECTION_RIGHT:
-			for (int i = -seedistance; i <= seedistance; ++i)
-			{
-				newx = from->x + seedistance - std::abs(i);
-				newy = from->y + i;
-				oldx = from->x - seedistance - 1 + std::abs(i);
-				oldy = from->y + i;
-
-				newcoords.push_back(std::make_pair(newx, newy));
-				oldcoords.push_back(std::make_pair(oldx, oldy));
-			}
-			break;
-
-		case DIRECTION_DOWN:
-			for (int i = -seedistance; i <= seedistance; ++i)
-			{
-				newy = from->y + seedistance - std::abs(i);
-				newx = from->x + i;
-				oldy = from->y - seedistance - 1 + std::abs(i);
-				oldx = from->x + i;
-
-				newcoords.push_back(std::make_pair(newx, newy));
-				oldcoords.push_back(std::make_pair(oldx, oldy));
-			}
-			break;
-
-		case DIRECTION_LEFT:
-			for (int i = -seedistance; i <= seedistance; ++i)
-			{
-				newx = from->x - seedistance + std::abs(i);
-				newy = from->y + i;
-				oldx = from->x + seedistance + 1 - std::abs(i);
-				oldy = from->y + i;
-
-				newcoords.push_back(std::make_pair(newx, newy));
-				oldcoords.push_back(std::make_pair(oldx, oldy));
-			}
-			break;
-
-	}
-
 	from->direction = direction;
 
-	UTIL_FOREACH(this->characters, checkchar)
+	this->character_grid.ForEach(from->x, from->y, seedistance + 1, [&](Character *checkchar)
 	{
-		for (std::size_t i = 0; i < oldcoords.size(); ++i)
+		switch (map_view_change(checkchar->x, checkchar->y, old_x, old_y, from->x, from->y, seedistance))
 		{
-			if (checkchar->x == oldcoords[i].first && checkchar->y == oldcoords[i].second)
-			{
-				oldchars.push_back(checkchar);
-			}
-			else if (checkchar->x == newcoords[i].first && checkchar->y == newcoords[i].second)
-			{
-				newchars.push_back(checkchar);
-			}
+			case 1: newchars.push_back(checkchar); break;
+			case -1: oldchars.push_back(checkchar); break;
 		}
-	}
+	});
 
 	PacketBuilder builder(PACKET_RANGE, PACKET_REPLY, 8);
 	builder.AddChar(0);
@@ -1447,14 +1404,16 @@ Map::WalkResult Map::Walk(NPC *from, Direction direction)
 	builder.AddByte(255);
 	builder.AddByte(255);
 
-	UTIL_FOREACH(this->characters, character)
+	PacketBroadcast packet(builder);
+
+	UTIL_FOREACH(this->CharactersInRange(from->x, from->y, seedistance), character)
 	{
 		if (!character->InRange(from))
 		{
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 
 	UTIL_FOREACH(oldchars, character)
@@ -1493,7 +1452,7 @@ void Map::Attack(Character *from, Direction direction)
 	int wep_graphic = wepdata.dollgraphic;
 	bool is_instrument = (wep_graphic != 0 && this->world->IsInstrument(wep_graphic));
 
-	if (!is_instrument && (this->pk || (this->world->config["GlobalPK"] && !this->world->PKExcept(this->id))))
+	if (!is_instrument && (this->pk || (this->world->settings.global_pk && !this->world->PKExcept(this->id))))
 	{
 		if (this->AttackPK(from, direction))
 		{
@@ -1505,6 +1464,8 @@ void Map::Attack(Character *from, Direction direction)
 	builder.AddShort(from->PlayerID());
 	builder.AddChar(direction);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		if (character == from || !from->InRange(character))
@@ -1512,7 +1473,7 @@ void Map::Attack(Character *from, Direction direction)
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 
 	if (is_instrument)
@@ -1528,7 +1489,7 @@ void Map::Attack(Character *from, Direction direction)
 
 	if (wepdata.subtype == EIF::Ranged)
 	{
-		range = static_cast<int>(this->world->config["RangedDistance"]);
+		range = this->world->settings.ranged_distance;
 	}
 
 	for (int i = 0; i < range; ++i)
@@ -1554,27 +1515,29 @@ void Map::Attack(Character *from, Direction direction)
 
 		UTIL_FOREACH(this->npcs, npc)
 		{
-			if ((npc->ENF().type == ENF::Passive || npc->ENF().type == ENF::Aggressive || from->SourceDutyAccess() >= static_cast<int>(this->world->admin_config["killnpc"]))
+			if ((npc->ENF().type == ENF::Passive || npc->ENF().type == ENF::Aggressive || from->SourceDutyAccess() >= this->world->settings.admin_killnpc)
 			 && npc->alive && npc->x == target_x && npc->y == target_y)
 			{
 				int amount = util::rand(from->mindam, from->maxdam);
 				double rand = util::rand(0.0, 1.0);
 				// Checks if target is facing you
-				bool critical = std::abs(int(npc->direction) - from->direction) != 2 || rand < static_cast<double>(this->world->config["CriticalRate"]);
+				bool critical = std::abs(int(npc->direction) - from->direction) != 2 || rand < this->world->settings.critical_rate;
 
-				if (this->world->config["CriticalFirstHit"] && npc->hp == npc->ENF().hp)
+				if (this->world->settings.critical_first_hit && npc->hp == npc->ENF().hp)
 					critical = true;
 
-				std::unordered_map<std::string, double> formula_vars;
+				const Formulas &formulas = this->world->formulas;
+				std::vector<double> &formula_vars = this->formula_vars;
+				formulas.ResetVars(formula_vars);
 
-				from->FormulaVars(formula_vars);
-				npc->FormulaVars(formula_vars, "target_");
-				formula_vars["modifier"] = this->world->config["MobRate"];
-				formula_vars["damage"] = amount;
-				formula_vars["critical"] = critical;
+				from->FormulaVars(formula_vars, formulas.character_slots);
+				npc->FormulaVars(formula_vars, formulas.target_npc_slots);
+				formula_vars[formulas.modifier_slot] = this->world->settings.mob_rate;
+				formula_vars[formulas.damage_slot] = amount;
+				formula_vars[formulas.critical_slot] = critical;
 
-				amount = static_cast<int>(rpn_eval(rpn_parse(this->world->formulas_config["damage"]), formula_vars));
-				double hit_rate = rpn_eval(rpn_parse(this->world->formulas_config["hit_rate"]), formula_vars);
+				amount = static_cast<int>(formulas.damage.eval(formula_vars));
+				double hit_rate = formulas.hit_rate.eval(formula_vars);
 
 				if (rand > hit_rate)
 				{
@@ -1585,7 +1548,7 @@ void Map::Attack(Character *from, Direction direction)
 
 				int limitamount = std::min(amount, int(npc->hp));
 
-				if (this->world->config["LimitDamage"])
+				if (this->world->settings.limit_damage)
 				{
 					amount = limitamount;
 				}
@@ -1618,7 +1581,7 @@ bool Map::AttackPK(Character *from, Direction direction)
 
 	if (this->world->eif->Get(from->paperdoll[Character::Weapon]).subtype == EIF::Ranged)
 	{
-		range = static_cast<int>(this->world->config["RangedDistance"]);
+		range = this->world->settings.ranged_distance;
 	}
 
 	for (int i = 0; i < range; ++i)
@@ -1649,18 +1612,20 @@ bool Map::AttackPK(Character *from, Direction direction)
 				int amount = util::rand(from->mindam, from->maxdam);
 				double rand = util::rand(0.0, 1.0);
 				// Checks if target is facing you
-				bool critical = std::abs(int(character->direction) - from->direction) != 2 || rand < static_cast<double>(this->world->config["CriticalRate"]);
+				bool critical = std::abs(int(character->direction) - from->direction) != 2 || rand < this->world->settings.critical_rate;
 
-				std::unordered_map<std::string, double> formula_vars;
+				const Formulas &formulas = this->world->formulas;
+				std::vector<double> &formula_vars = this->formula_vars;
+				formulas.ResetVars(formula_vars);
 
-				from->FormulaVars(formula_vars);
-				character->FormulaVars(formula_vars, "target_");
-				formula_vars["modifier"] = this->world->config["PKRate"];
-				formula_vars["damage"] = amount;
-				formula_vars["critical"] = critical;
+				from->FormulaVars(formula_vars, formulas.character_slots);
+				character->FormulaVars(formula_vars, formulas.target_character_slots);
+				formula_vars[formulas.modifier_slot] = this->world->settings.pk_rate;
+				formula_vars[formulas.damage_slot] = amount;
+				formula_vars[formulas.critical_slot] = critical;
 
-				amount = static_cast<int>(rpn_eval(rpn_parse(this->world->formulas_config["damage"]), formula_vars));
-				double hit_rate = rpn_eval(rpn_parse(this->world->formulas_config["hit_rate"]), formula_vars);
+				amount = static_cast<int>(formulas.damage.eval(formula_vars));
+				double hit_rate = formulas.hit_rate.eval(formula_vars);
 
 				if (rand > hit_rate)
 				{
@@ -1671,7 +1636,7 @@ bool Map::AttackPK(Character *from, Direction direction)
 
 				int limitamount = std::min(amount, int(character->hp));
 
-				if (this->world->config["LimitDamage"])
+				if (this->world->settings.limit_damage)
 				{
 					amount = limitamount;
 				}
@@ -1708,13 +1673,10 @@ bool Map::AttackPK(Character *from, Direction direction)
 				{
 					character->DeathRespawn();
 
-					UTIL_FOREACH(from->quests, q)
+					this->world->quest_triggers.Dispatch(from, QuestTriggerIndex::KilledPlayer, 0, [](Quest_Context& quest)
 					{
-						if (!q.second || q.second->GetQuest()->Disabled())
-							continue;
-
-						q.second->KilledPlayer();
-					}
+						quest.KilledPlayer();
+					});
 				}
 
 				builder.Reset(4);
@@ -1747,6 +1709,8 @@ void Map::Face(Character *from, Direction direction)
 	builder.AddShort(from->PlayerID());
 	builder.AddChar(direction);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		if (character == from || !from->InRange(character))
@@ -1754,7 +1718,7 @@ void Map::Face(Character *from, Direction direction)
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 }
 
@@ -1771,6 +1735,8 @@ void Map::Sit(Character *from, SitState sit_type)
 	builder.AddChar(from->direction);
 	builder.AddChar(0); // ?
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		if (character == from || !from->InRange(character))
@@ -1778,7 +1744,7 @@ void Map::Sit(Character *from, SitState sit_type)
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 }
 
@@ -1793,6 +1759,8 @@ void Map::Stand(Character *from)
 	builder.AddChar(from->x);
 	builder.AddChar(from->y);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		if (character == from || !from->InRange(character))
@@ -1800,7 +1768,7 @@ void Map::Stand(Character *from)
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 }
 
@@ -1810,6 +1778,8 @@ void Map::Emote(Character *from, enum Emote emote, bool echo)
 	builder.AddShort(from->PlayerID());
 	builder.AddChar(emote);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		if (!echo && (character == from || !from->InRange(character)))
@@ -1817,7 +1787,7 @@ void Map::Emote(Character *from, enum Emote emote, bool echo)
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 }
 
@@ -1828,31 +1798,33 @@ bool Map::Occupied(unsigned char x, unsigned char y, Map::OccupiedTarget target,
 		return false;
 	}
 
+	bool occupied = false;
+
 	if (target != Map::NPCOnly)
 	{
-		UTIL_FOREACH(this->characters, character)
+		this->character_grid.ForEach(x, y, 0, [&](Character *character)
 		{
 			bool ghost = adminghost && (!character->CanInteractCombat() || character->IsHideNpc());
 
 			if (character->x == x && character->y == y && !ghost)
 			{
-				return true;
+				occupied = true;
 			}
-		}
+		});
 	}
 
-	if (target != Map::PlayerOnly)
+	if (target != Map::PlayerOnly && !occupied)
 	{
-		UTIL_FOREACH(this->npcs, npc)
+		this->npc_grid.ForEach(x, y, 0, [&](NPC *npc)
 		{
 			if (npc->alive && npc->x == x && npc->y == y)
 			{
-				return true;
+				occupied = true;
 			}
-		}
+		});
 	}
 
-	return false;
+	return occupied;
 }
 
 Map::~Map()
@@ -1867,16 +1839,16 @@ bool Map::OpenDoor(Character *from, unsigned char x, unsigned char y)
 		return false;
 	}
 
-	if (Map_Warp& warp = this->GetWarp(x, y))
+	if (Map_Warp *warp = this->GetWarp(x, y))
 	{
-		if (warp.spec == Map_Warp::NoDoor || warp.open)
+		if (warp->spec == Map_Warp::NoDoor || warp->open)
 		{
 			return false;
 		}
 
-		if (from && warp.spec > Map_Warp::Door)
+		if (from && warp->spec > Map_Warp::Door)
 		{
-			int keynum = warp.spec - static_cast<int>(Map_Warp::Door) + 1;
+			int keynum = warp->spec - static_cast<int>(Map_Warp::Door) + 1;
 			if (!from->CanInteractDoors() || !from->HasItem(this->world->eif->GetKey(keynum)))
 			{
 				PacketBuilder builder(PACKET_DOOR, PACKET_CLOSE, 1);
@@ -1899,7 +1871,7 @@ bool Map::OpenDoor(Character *from, unsigned char x, unsigned char y)
 			}
 		}
 
-		warp.open = true;
+		warp->open = true;
 
 		map_close_door_struct *close = new map_close_door_struct;
 		close->map = this;
@@ -1920,14 +1892,14 @@ void Map::CloseDoor(unsigned char x, unsigned char y)
 	if (!this->InBounds(x, y))
 		return;
 
-	if (Map_Warp& warp = this->GetWarp(x, y))
+	if (Map_Warp *warp = this->GetWarp(x, y))
 	{
-		if (warp.spec == Map_Warp::NoDoor || !warp.open)
+		if (warp->spec == Map_Warp::NoDoor || !warp->open)
 		{
 			return;
 		}
 
-		warp.open = false;
+		warp->open = false;
 	}
 }
 
@@ -1942,7 +1914,7 @@ void Map::SpellSelf(Character *from, unsigned short spell_id)
 
 	int hpgain = spell.hp;
 
-	if (this->world->config["LimitDamage"])
+	if (this->world->settings.limit_damage)
 		hpgain = std::min(hpgain, from->maxhp - from->hp);
 
 	hpgain = std::max(hpgain, 0);
@@ -1987,18 +1959,20 @@ void Map::SpellAttack(Character *from, NPC *npc, unsigned short spell_id)
 		int amount = util::rand(from->mindam + spell.mindam, from->maxdam + spell.maxdam);
 		double rand = util::rand(0.0, 1.0);
 
-		bool critical = rand < static_cast<double>(this->world->config["CriticalRate"]);
+		bool critical = rand < this->world->settings.critical_rate;
 
-		std::unordered_map<std::string, double> formula_vars;
+		const Formulas &formulas = this->world->formulas;
+		std::vector<double> &formula_vars = this->formula_vars;
+		formulas.ResetVars(formula_vars);
 
-		from->FormulaVars(formula_vars);
-		npc->FormulaVars(formula_vars, "target_");
-		formula_vars["modifier"] = this->world->config["MobRate"];
-		formula_vars["damage"] = amount;
-		formula_vars["critical"] = critical;
+		from->FormulaVars(formula_vars, formulas.character_slots);
+		npc->FormulaVars(formula_vars, formulas.target_npc_slots);
+		formula_vars[formulas.modifier_slot] = this->world->settings.mob_rate;
+		formula_vars[formulas.damage_slot] = amount;
+		formula_vars[formulas.critical_slot] = critical;
 
-		amount = static_cast<int>(rpn_eval(rpn_parse(this->world->formulas_config["damage"]), formula_vars));
-		double hit_rate = rpn_eval(rpn_parse(this->world->formulas_config["hit_rate"]), formula_vars);
+		amount = static_cast<int>(formulas.damage.eval(formula_vars));
+		double hit_rate = formulas.hit_rate.eval(formula_vars);
 
 		if (rand > hit_rate)
 		{
@@ -2009,7 +1983,7 @@ void Map::SpellAttack(Character *from, NPC *npc, unsigned short spell_id)
 
 		int limitamount = std::min(amount, int(npc->hp));
 
-		if (this->world->config["LimitDamage"])
+		if (this->world->settings.limit_damage)
 		{
 			amount = limitamount;
 		}
@@ -2026,7 +2000,7 @@ void Map::SpellAttackPK(Character *from, Character *victim, unsigned short spell
 	if (!spell || (spell.type != ESF::Heal && spell.type != ESF::Damage) || from->tp < spell.tp)
 		return;
 
-	if (spell.type == ESF::Damage && (from->map->pk || (this->world->config["GlobalPK"] && !this->world->PKExcept(this->id))))
+	if (spell.type == ESF::Damage && (from->map->pk || (this->world->settings.global_pk && !this->world->PKExcept(this->id))))
 	{
 		if (!from->CanInteractPKCombat())
 			return;
@@ -2036,18 +2010,20 @@ void Map::SpellAttackPK(Character *from, Character *victim, unsigned short spell
 		int amount = util::rand(from->mindam + spell.mindam, from->maxdam + spell.maxdam);
 		double rand = util::rand(0.0, 1.0);
 
-		bool critical = rand < static_cast<double>(this->world->config["CriticalRate"]);
+		bool critical = rand < this->world->settings.critical_rate;
 
-		std::unordered_map<std::string, double> formula_vars;
+		const Formulas &formulas = this->world->formulas;
+		std::vector<double> &formula_vars = this->formula_vars;
+		formulas.ResetVars(formula_vars);
 
-		from->FormulaVars(formula_vars);
-		victim->FormulaVars(formula_vars, "target_");
-		formula_vars["modifier"] = this->world->config["PKRate"];
-		formula_vars["damage"] = amount;
-		formula_vars["critical"] = critical;
+		from->FormulaVars(formula_vars, formulas.character_slots);
+		victim->FormulaVars(formula_vars, formulas.target_character_slots);
+		formula_vars[formulas.modifier_slot] = this->world->settings.pk_rate;
+		formula_vars[formulas.damage_slot] = amount;
+		formula_vars[formulas.critical_slot] = critical;
 
-		amount = static_cast<int>(rpn_eval(rpn_parse(this->world->formulas_config["damage"]), formula_vars));
-		double hit_rate = rpn_eval(rpn_parse(this->world->formulas_config["hit_rate"]), formula_vars);
+		amount = static_cast<int>(formulas.damage.eval(formula_vars));
+		double hit_rate = formulas.hit_rate.eval(formula_vars);
 
 		if (rand > hit_rate)
 		{
@@ -2058,7 +2034,7 @@ void Map::SpellAttackPK(Character *from, Character *victim, unsigned short spell
 
 		int limitamount = std::min(amount, int(victim->hp));
 
-		if (this->world->config["LimitDamage"])
+		if (this->world->settings.limit_damage)
 		{
 			amount = limitamount;
 		}
@@ -2084,13 +2060,10 @@ void Map::SpellAttackPK(Character *from, Character *victim, unsigned short spell
 		{
 			victim->DeathRespawn();
 
-			UTIL_FOREACH(from->quests, q)
+			this->world->quest_triggers.Dispatch(from, QuestTriggerIndex::KilledPlayer, 0, [](Quest_Context& quest)
 			{
-				if (!q.second || q.second->GetQuest()->Disabled())
-					continue;
-
-				q.second->KilledPlayer();
-			}
+				quest.KilledPlayer();
+			});
 		}
 
 		builder.Reset(4);
@@ -2112,19 +2085,19 @@ void Map::SpellAttackPK(Character *from, Character *victim, unsigned short spell
 		int displayhp = spell.hp;
 		int hpgain = spell.hp;
 
-		if (this->world->config["LimitDamage"])
+		if (this->world->settings.limit_damage)
 			hpgain = std::min(hpgain, victim->maxhp - victim->hp);
 
 		hpgain = std::max(hpgain, 0);
 
-		if (!from->CanInteractCombat() && from != victim && !(from->CanInteractPKCombat() && (from->map->pk || (this->world->config["GlobalPK"] && !this->world->PKExcept(this->id)))))
+		if (!from->CanInteractCombat() && from != victim && !(from->CanInteractPKCombat() && (from->map->pk || (this->world->settings.global_pk && !this->world->PKExcept(this->id)))))
 		{
 			displayhp = hpgain = std::min(hpgain, 1);
 		}
 
 		victim->hp += hpgain;
 
-		if (!this->world->config["LimitDamage"])
+		if (!this->world->settings.limit_damage)
 			victim->hp = std::min(victim->hp, victim->maxhp);
 
 		PacketBuilder builder(PACKET_SPELL, PACKET_TARGET_OTHER, 18);
@@ -2168,7 +2141,7 @@ void Map::SpellGroup(Character *from, unsigned short spell_id)
 
 	int displayhp = spell.hp;
 
-	if (!from->CanInteractCombat() && !(from->CanInteractPKCombat() && (from->map->pk || (this->world->config["GlobalPK"] && !this->world->PKExcept(this->id)))))
+	if (!from->CanInteractCombat() && !(from->CanInteractPKCombat() && (from->map->pk || (this->world->settings.global_pk && !this->world->PKExcept(this->id)))))
 	{
 		displayhp = std::min(displayhp, 1);
 	}
@@ -2188,17 +2161,17 @@ void Map::SpellGroup(Character *from, unsigned short spell_id)
 
 		int hpgain = spell.hp;
 
-		if (this->world->config["LimitDamage"])
+		if (this->world->settings.limit_damage)
 			hpgain = std::min(hpgain, member->maxhp - member->hp);
 
 		hpgain = std::max(hpgain, 0);
 
-		if (!from->CanInteractCombat() && !(from->CanInteractPKCombat() && (from->map->pk || (this->world->config["GlobalPK"] && !this->world->PKExcept(this->id)))))
+		if (!from->CanInteractCombat() && !(from->CanInteractPKCombat() && (from->map->pk || (this->world->settings.global_pk && !this->world->PKExcept(this->id)))))
 			hpgain = std::min(hpgain, 1);
 
 		member->hp += hpgain;
 
-		if (!this->world->config["LimitDamage"])
+		if (!this->world->settings.limit_damage)
 			member->hp = std::min(member->hp, member->maxhp);
 
 		// wat?
@@ -2232,16 +2205,15 @@ std::shared_ptr<Map_Item> Map::AddItem(short id, int amount, unsigned char x, un
 	if (from || (from && from->SourceAccess() <= ADMIN_GM))
 	{
 		int ontile = 0;
-		int onmap = 0;
+		int onmap = this->items.size();
 
-		UTIL_FOREACH(this->items, item)
+		this->item_grid.ForEach(x, y, 0, [&](Map_Item *item)
 		{
-			++onmap;
 			if (item->x == x && item->y == y)
 			{
 				++ontile;
 			}
-		}
+		});
 
 		if (ontile >= static_cast<int>(this->world->config["MaxTile"]) || onmap >= static_cast<int>(this->world->config["MaxMap"]))
 		{
@@ -2258,6 +2230,8 @@ std::shared_ptr<Map_Item> Map::AddItem(short id, int amount, unsigned char x, un
 	builder.AddChar(x);
 	builder.AddChar(y);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		if ((from && character == from) || !character->InRange(*newitem))
@@ -2265,10 +2239,11 @@ std::shared_ptr<Map_Item> Map::AddItem(short id, int amount, unsigned char x, un
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 
 	this->items.push_back(newitem);
+	this->item_grid.Update(newitem.get(), x, y);
 	return newitem;
 }
 
@@ -2315,6 +2290,8 @@ std::list<std::shared_ptr<Map_Item>>::iterator Map::DelItem(std::list<std::share
 	PacketBuilder builder(PACKET_ITEM, PACKET_REMOVE, 2);
 	builder.AddShort((*it)->uid);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		if ((from && character == from) || !character->InRange(**it))
@@ -2322,9 +2299,11 @@ std::list<std::shared_ptr<Map_Item>>::iterator Map::DelItem(std::list<std::share
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 
+	this->item_grid.Remove(it->get());
+	this->item_ids.Release((*it)->uid);
 	return this->items.erase(it);
 }
 
@@ -2387,58 +2366,52 @@ bool Map::InBounds(unsigned char x, unsigned char y) const
 
 bool Map::Walkable(unsigned char x, unsigned char y, bool npc) const
 {
-	if (!InBounds(x, y) || !this->GetTile(x, y).Walkable(npc))
+	if (!(npc ? this->nav_grid : this->walk_grid).Walkable(x, y))
 		return false;
 
-	if (this->world->config["GhostArena"] && this->GetTile(x, y).tilespec == Map_Tile::Arena && this->Occupied(x, y, PlayerAndNPC))
+	if (this->world->settings.ghost_arena && this->tilespecs[y * this->width + x] == Map_Tile::Arena && this->Occupied(x, y, PlayerAndNPC))
 		return false;
 
 	return true;
 }
 
-Map_Tile& Map::GetTile(unsigned char x, unsigned char y)
+Map_Tile::TileSpec Map::GetSpec(unsigned char x, unsigned char y) const
 {
 	if (!InBounds(x, y))
-		throw std::out_of_range("Map tile out of range");
+		return Map_Tile::None;
 
-	return this->tiles[y * this->width + x];
+	return static_cast<Map_Tile::TileSpec>(this->tilespecs[y * this->width + x]);
 }
 
-const Map_Tile& Map::GetTile(unsigned char x, unsigned char y) const
+Map_Warp *Map::GetWarp(unsigned char x, unsigned char y)
 {
 	if (!InBounds(x, y))
-		throw std::out_of_range("Map tile out of range");
+		return nullptr;
+
+	auto it = this->warps.find(y * this->width + x);
 
-	return this->tiles[y * this->width + x];
+	return (it != this->warps.end()) ? &it->second : nullptr;
 }
 
-Map_Tile::TileSpec Map::GetSpec(unsigned char x, unsigned char y) const
+const Map_Warp *Map::GetWarp(unsigned char x, unsigned char y) const
 {
 	if (!InBounds(x, y))
-		return Map_Tile::None;
-
-	return this->GetTile(x, y).tilespec;
-}
+		return nullptr;
 
-Map_Warp& Map::GetWarp(unsigned char x, unsigned char y)
-{
-	return this->GetTile(x, y).warp;
-}
+	auto it = this->warps.find(y * this->width + x);
 
-const Map_Warp& Map::GetWarp(unsigned char x, unsigned char y) const
-{
-	return this->GetTile(x, y).warp;
+	return (it != this->warps.end()) ? &it->second : nullptr;
 }
 
 std::vector<Character *> Map::CharactersInRange(unsigned char x, unsigned char y, unsigned char range)
 {
 	std::vector<Character *> characters;
 
-	UTIL_FOREACH(this->characters, character)
+	this->character_grid.ForEach(x, y, range, [&](Character *character)
 	{
 		if (util::path_length(character->x, character->y, x, y) <= range)
 			characters.push_back(character);
-	}
+	});
 
 	return characters;
 }
@@ -2447,11 +2420,11 @@ std::vector<NPC *> Map::NPCsInRange(unsigned char x, unsigned char y, unsigned c
 {
 	std::vector<NPC *> npcs;
 
-	UTIL_FOREACH(this->npcs, npc)
+	this->npc_grid.ForEach(x, y, range, [&](NPC *npc)
 	{
 		if (util::path_length(npc->x, npc->y, x, y) <= range)
 			npcs.push_back(npc);
-	}
+	});
 
 	return npcs;
 }
@@ -2462,9 +2435,11 @@ void Map::Effect(MapEffect effect, unsigned char param)
 	builder.AddChar(effect);
 	builder.AddChar(param);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
-		character->Send(builder);
+		character->Send(packet);
 	}
 }
 
@@ -2475,10 +2450,12 @@ void Map::TileEffect(unsigned char x, unsigned char y, unsigned short effect)
 	builder.AddChar(y);
 	builder.AddShort(effect);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		if (character->InRange(x, y))
-			character->Send(builder);
+			character->Send(packet);
 	}
 }
 
@@ -2514,6 +2491,8 @@ bool Map::Reload()
 	filename.append(namebuf);
 	filename.append(".emf");
 
+	this->world->file_cache.Invalidate(filename);
+
 	std::FILE *fh = std::fopen(filename.c_str(), "rb");
 
 	if (!fh)
@@ -2547,6 +2526,11 @@ bool Map::Reload()
 
 	this->characters = temp;
 
+	UTIL_FOREACH(temp, character)
+	{
+		this->character_grid.Update(character, character->x, character->y);
+	}
+
 	UTIL_FOREACH(temp, character)
 	{
 		character->player->client->Upload(FILE_MAP, character->mapid, INIT_MAP_MUTATION);
@@ -2566,7 +2550,7 @@ void Map::TimedSpikes()
 	PacketBuilder builder(PACKET_EFFECT, PACKET_REPORT, 1);
 	builder.AddByte(83); // S
 
-	double spike_damage = this->world->config["SpikeDamage"];
+	double spike_damage = this->world->settings.spike_damage;
 
 	std::vector<Character*> killed;
 
@@ -2725,43 +2709,17 @@ void Map::TimedQuakes(bool initialize)
 
 Character *Map::GetCharacter(std::string name)
 {
-	name = util::lowercase(name);
-
-	UTIL_FOREACH(this->characters, character)
-	{
-		if (character->SourceName().compare(name) == 0)
-		{
-			return character;
-		}
-	}
-
-	return 0;
+	return this->character_index.GetName(util::lowercase(name));
 }
 
 Character *Map::GetCharacterPID(unsigned int id)
 {
-	UTIL_FOREACH(this->characters, character)
-	{
-		if (character->PlayerID() == id)
-		{
-			return character;
-		}
-	}
-
-	return 0;
+	return this->character_index.GetPID(id);
 }
 
 Character *Map::GetCharacterCID(unsigned int id)
 {
-	UTIL_FOREACH(this->characters, character)
-	{
-		if (character->id == id)
-		{
-			return character;
-		}
-	}
-
-	return 0;
+	return this->character_index.GetCID(id);
 }
 
 NPC *Map::GetNPCIndex(unsigned char index)
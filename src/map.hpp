@@ -14,10 +14,17 @@
 #include "fwd/npc.hpp"
 #include "fwd/wedding.hpp"
 #include "fwd/world.hpp"
+#include "character_index.hpp"
+
+#include "util/id_pool.hpp"
+#include "util/nav_grid.hpp"
+#include "util/spatial_grid.hpp"
 
 #include <list>
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -68,7 +75,7 @@ struct Map_Warp
 };
 
 /**
- * Object representing one tile on a map
+ * Tile specs a map tile can have, and which of them can be walked on
  */
 struct Map_Tile
 {
@@ -114,20 +121,9 @@ struct Map_Tile
 		Spikes3
 	};
 
-	TileSpec tilespec;
-
-	Map_Warp warp;
-
-	Map_Tile() : tilespec(Map_Tile::None) { }
-
-	bool Walkable(bool npc = false) const
+	static bool Walkable(TileSpec tilespec, bool npc = false)
 	{
-		if (this->warp && npc)
-		{
-			return false;
-		}
-
-		switch (this->tilespec)
+		switch (tilespec)
 		{
 			case Wall:
 			case ChairDown:
@@ -205,6 +201,14 @@ struct Map_Chest
 	void Update(Map *map, Character *exclude = 0) const;
 };
 
+/**
+ * Orders NPCs by the time they are next due to act, then by index
+ */
+struct Map_ActOrder
+{
+	bool operator()(const NPC *a, const NPC *b) const;
+};
+
 /**
  * Contains all information about a map, holds reference to contained Characters and manages NPCs on it
  */
@@ -214,6 +218,14 @@ class Map
 		bool Load();
 		void Unload();
 
+		// NPCs waiting to act, ordered by NPC::act_deadline
+		std::set<NPC *, Map_ActOrder> act_queue;
+
+		// When the last character left the map
+		double idle_since;
+
+		void Wake(double current_time);
+
 	public:
 		enum WalkResult
 		{
@@ -233,6 +245,13 @@ class Map
 			EffectQuake4 = 6
 		};
 
+		enum ActivityState
+		{
+			ActivityHot,
+			ActivityWarm,
+			ActivityDormant
+		};
+
 		World *world;
 		short id;
 		char rid[4];
@@ -248,7 +267,32 @@ class Map
 		std::vector<NPC *> npcs;
 		std::vector<std::shared_ptr<Map_Chest>> chests;
 		std::list<std::shared_ptr<Map_Item>> items;
-		std::vector<Map_Tile> tiles;
+
+		// Spatial indexes of the above, must be kept in sync with the positions of everything on the map
+		util::SpatialGrid<Character *> character_grid;
+		util::SpatialGrid<NPC *> npc_grid;
+		util::SpatialGrid<Map_Item *> item_grid;
+
+		// Tile data decoded by Load, indexed by y * width + x
+		// Specs are packed one byte per tile, warps are sparse since most tiles have none
+		std::vector<signed char> tilespecs;
+		std::unordered_map<int, Map_Warp> warps;
+
+		// Which tiles players and NPCs can walk on, ignoring anything standing on them. Built once by Load.
+		// Warp tiles are never walkable for NPCs.
+		util::NavGrid walk_grid;
+		util::NavGrid nav_grid;
+
+		// Index of characters on the map, kept in sync by Enter and Leave
+		CharacterIndex character_index;
+
+		// IDs in use by the above, must be released when an item or NPC is removed
+		util::IDPool item_ids;
+		util::IDPool npc_indexes;
+
+		// Variable list for combat formulas on this map, kept between attacks so evaluating them doesn't allocate
+		std::vector<double> formula_vars;
+
 		bool exists;
 		double jukebox_protect;
 		std::string jukebox_player;
@@ -264,12 +308,35 @@ class Map
 		void LoadArena();
 		void LoadWedding();
 
-		int GenerateItemID() const;
-		unsigned char GenerateNPCIndex() const;
+		/**
+		 * Reserves the lowest unused item UID. It must be released through item_ids when the item is removed.
+		 */
+		int GenerateItemID();
+
+		/**
+		 * Reserves the lowest unused NPC index. It must be released through npc_indexes when the NPC is removed.
+		 */
+		unsigned char GenerateNPCIndex();
 
 		void Enter(Character *, WarpAnimation animation = WARP_ANIMATION_NONE);
 		void Leave(Character *, WarpAnimation animation = WARP_ANIMATION_NONE, bool silent = false);
 
+		/**
+		 * Hot maps have characters on them, warm maps were left less than NPCIdleTime ago, and anything else is dormant.
+		 * NPCs on dormant maps are not processed at all until a character enters.
+		 */
+		ActivityState Activity(double current_time) const;
+
+		/**
+		 * (Re)queues an NPC to act at last_act + act_speed. Must be called whenever either changes.
+		 */
+		void ScheduleAct(NPC *);
+		void UnscheduleAct(NPC *);
+
+		void SpawnNPCs(double current_time);
+		void ActNPCs(double current_time);
+		void TalkNPCs(double current_time);
+
 		void Msg(Character *from, std::string message, bool echo = true);
 		void Msg(NPC *from, std::string message);
 		WalkResult Walk(Character *from, Direction direction, bool admin = false);
@@ -300,11 +367,9 @@ class Map
 
 		bool InBounds(unsigned char x, unsigned char y) const;
 		bool Walkable(unsigned char x, unsigned char y, bool npc = false) const;
-		Map_Tile& GetTile(unsigned char x, unsigned char y);
-		const Map_Tile& GetTile(unsigned char x, unsigned char y) const;
 		Map_Tile::TileSpec GetSpec(unsigned char x, unsigned char y) const;
-		Map_Warp& GetWarp(unsigned char x, unsigned char y);
-		const Map_Warp& GetWarp(unsigned char x, unsigned char y) const;
+		Map_Warp *GetWarp(unsigned char x, unsigned char y);
+		const Map_Warp *GetWarp(unsigned char x, unsigned char y) const;
 
 		std::vector<Character *> CharactersInRange(unsigned char x, unsigned char y, unsigned char range);
 		std::vector<NPC *> NPCsInRange(unsigned char x, unsigned char y, unsigned char range);
@@ -19,7 +19,6 @@
 
 #include "console.hpp"
 #include "util.hpp"
-#include "util/rpn.hpp"
 
 #include <algorithm>
 #include <array>
@@ -55,6 +54,9 @@ NPC::NPC(Map *map, short id, unsigned char x, unsigned char y, unsigned char spa
 	this->alive = false;
 	this->attack = false;
 	this->totaldamage = 0;
+	this->act_deadline = 0.0;
+	this->path_backoff = 0;
+	this->path_wait = 0;
 
 	if (spawn_type > 7)
 	{
@@ -157,11 +159,17 @@ void NPC::Spawn(NPC *parent)
 		}
 	}
 
+	this->map->npc_grid.Update(this, this->x, this->y);
+	this->path.clear();
+	this->path_backoff = 0;
+	this->path_wait = 0;
+
 	this->alive = true;
 	this->hp = this->ENF().hp;
 	this->last_act = Timer::GetTime();
 	this->last_talk = Timer::GetTime();
 	this->act_speed = speed_table[this->spawn_type];
+	this->map->ScheduleAct(this);
 
 	PacketBuilder builder(PACKET_RANGE, PACKET_REPLY, 8);
 	builder.AddChar(0);
@@ -204,14 +212,14 @@ void NPC::Act()
 	}
 
 	Character *attacker = 0;
-	unsigned char attacker_distance = static_cast<int>(this->map->world->config["NPCChaseDistance"]);
+	unsigned char attacker_distance = this->map->world->settings.npc_chase_distance;
 	unsigned short attacker_damage = 0;
 
 	if (this->ENF().type == ENF::Passive || this->ENF().type == ENF::Aggressive)
 	{
 		UTIL_FOREACH_CREF(this->damagelist, opponent)
 		{
-			if (opponent->attacker->map != this->map || opponent->attacker->nowhere || opponent->last_hit < Timer::GetTime() - static_cast<double>(this->map->world->config["NPCBoredTimer"]))
+			if (opponent->attacker->map != this->map || opponent->attacker->nowhere || opponent->last_hit < Timer::GetTime() - this->map->world->settings.npc_bored_timer)
 			{
 				continue;
 			}
@@ -233,7 +241,7 @@ void NPC::Act()
 		{
 			UTIL_FOREACH_CREF(this->parent->damagelist, opponent)
 			{
-				if (opponent->attacker->map != this->map || opponent->attacker->nowhere || opponent->last_hit < Timer::GetTime() - static_cast<double>(this->map->world->config["NPCBoredTimer"]))
+				if (opponent->attacker->map != this->map || opponent->attacker->nowhere || opponent->last_hit < Timer::GetTime() - this->map->world->settings.npc_bored_timer)
 				{
 					continue;
 				}
@@ -256,7 +264,7 @@ void NPC::Act()
 	if (this->ENF().type == ENF::Aggressive || (this->parent && attacker))
 	{
 		Character *closest = 0;
-		unsigned char closest_distance = static_cast<int>(this->map->world->config["NPCChaseDistance"]);
+		unsigned char closest_distance = this->map->world->settings.npc_chase_distance;
 
 		if (attacker)
 		{
@@ -264,10 +272,10 @@ void NPC::Act()
 			closest_distance = std::min(closest_distance, attacker_distance);
 		}
 
-		UTIL_FOREACH(this->map->characters, character)
+		this->map->character_grid.ForEach(this->x, this->y, closest_distance, [&](Character *character)
 		{
 			if (character->IsHideNpc() || !character->CanInteractCombat())
-				continue;
+				return;
 
 			int distance = util::path_length(character->x, character->y, this->x, this->y);
 
@@ -279,7 +287,7 @@ void NPC::Act()
 				closest = character;
 				closest_distance = distance;
 			}
-		}
+		});
 
 		if (closest)
 		{
@@ -299,7 +307,13 @@ void NPC::Act()
 			this->Attack(attacker);
 			return;
 		}
-		else if (absxdiff > absydiff)
+
+		if (this->map->world->settings.npc_chase_mode == 1 && this->Chase(attacker))
+		{
+			return;
+		}
+
+		if (absxdiff > absydiff)
 		{
 			if (xdiff < 0)
 			{
@@ -344,6 +358,8 @@ void NPC::Act()
 	}
 	else
 	{
+		this->path.clear();
+
 		// Random walking
 
 		int act;
@@ -415,7 +431,7 @@ void NPC::Talk()
 
 bool NPC::InCharacterRange()
 {
-	UTIL_FOREACH(this->map->characters, character)
+	UTIL_FOREACH(this->map->CharactersInRange(this->x, this->y, this->map->world->settings.see_distance), character)
 	{
 		if (character->InRange(this))
 		{
@@ -430,11 +446,116 @@ bool NPC::Walk(Direction direction)
 	return this->map->Walk(this, direction);
 }
 
+bool NPC::Chase(Character *target)
+{
+	const util::NavGrid::Point goal = {target->x, target->y};
+	const std::size_t max_path = std::size_t(this->map->world->settings.npc_chase_distance) * 2;
+
+	if (!this->path.empty() && goal != this->path_goal)
+	{
+		// Following a target that moved one tile only needs one more step on the end of the path
+		if (util::path_length(goal.x, goal.y, this->path_goal.x, this->path_goal.y) == 1 && this->path.size() < max_path)
+		{
+			this->path.insert(this->path.begin(), goal);
+		}
+		else
+		{
+			this->path.clear();
+		}
+	}
+
+	this->path_goal = goal;
+
+	auto find_path = [&]()
+	{
+		const int chase_distance = this->map->world->settings.npc_chase_distance;
+		const std::size_t max_nodes = std::size_t(chase_distance * 2 + 1) * std::size_t(chase_distance * 2 + 1);
+		bool adminghost = (this->ENF().type == ENF::Aggressive || this->parent);
+
+		// Only things right next to the NPC are treated as obstacles, anything further away will likely have moved by the time it gets there
+		bool found = this->map->nav_grid.FindPath({this->x, this->y}, goal, max_nodes, this->path, [&](int x, int y)
+		{
+			return util::path_length(x, y, this->x, this->y) <= 2 && this->map->Occupied(x, y, Map::PlayerAndNPC, adminghost);
+		});
+
+		std::reverse(this->path.begin(), this->path.end());
+
+		return found;
+	};
+
+	auto step = [&]()
+	{
+		const util::NavGrid::Point next = this->path.back();
+
+		if (util::path_length(next.x, next.y, this->x, this->y) != 1)
+		{
+			return false;
+		}
+
+		if (next.x > this->x)
+			this->direction = DIRECTION_RIGHT;
+		else if (next.x < this->x)
+			this->direction = DIRECTION_LEFT;
+		else if (next.y > this->y)
+			this->direction = DIRECTION_DOWN;
+		else
+			this->direction = DIRECTION_UP;
+
+		if (this->Walk(this->direction) == Map::WalkFail)
+		{
+			return false;
+		}
+
+		this->path.pop_back();
+		return true;
+	};
+
+	if (!this->path.empty() && step())
+	{
+		return true;
+	}
+
+	// Searching again for a target that still can't be reached would cost a full search every act, so let the caller step towards it instead
+	if (this->path_backoff > 0 && goal == this->path_failed_goal)
+	{
+		if (this->path_wait > 0)
+		{
+			--this->path_wait;
+			this->path.clear();
+			return false;
+		}
+	}
+	else
+	{
+		this->path_backoff = 0;
+	}
+
+	// Either there was no path yet or something is in the way, so search again
+	if (!find_path() || this->path.empty())
+	{
+		this->path.clear();
+		this->path_failed_goal = goal;
+		this->path_backoff = std::min(std::max(this->path_backoff * 2, 1), 16);
+		this->path_wait = this->path_backoff;
+		return false;
+	}
+
+	this->path_backoff = 0;
+
+	if (!step())
+	{
+		this->path.clear();
+		return false;
+	}
+
+	return true;
+}
+
 void NPC::Damage(Character *from, int amount, int spell_id)
 {
 	int limitamount = std::min(this->hp, amount);
 
-	if (this->map->world->config["LimitDamage"])
+	if (this->map->world->settings.limit_damage)
 	{
 		amount = limitamount;
 	}
@@ -635,6 +756,7 @@ void NPC::Killed(Character *from, int amount, int spell_id)
 
 		std::shared_ptr<Map_Item> newitem(std::make_shared<Map_Item>(dropuid, dropid, dropamount, this->x, this->y, from->PlayerID(), Timer::GetTime() + static_cast<int>(this->map->world->config["ProtectNPCDrop"])));
 		this->map->items.push_back(newitem);
+		this->map->item_grid.Update(newitem.get(), newitem->x, newitem->y);
 
 		// Selects a random number between 0 and maxhp, and decides the winner based on that
 		switch (sharemode)
@@ -936,15 +1058,17 @@ void NPC::Killed(Character *from, int amount, int spell_id)
 			std::remove(this->map->npcs.begin(), this->map->npcs.end(), this),
 			this->map->npcs.end()
 		);
+
+		this->map->npc_grid.Remove(this);
+		this->map->npc_indexes.Release(this->index);
 	}
 
-	UTIL_FOREACH(from->quests, q)
-	{
-		if (!q.second || q.second->GetQuest()->Disabled())
-			continue;
+	short npc_id = this->ENF().id;
 
-		q.second->KilledNPC(this->ENF().id);
-	}
+	from->world->quest_triggers.Dispatch(from, QuestTriggerIndex::KilledNPC, npc_id, [npc_id](Quest_Context& quest)
+	{
+		quest.KilledNPC(npc_id);
+	});
 
 	if (this->temporary)
 	{
@@ -1002,27 +1126,32 @@ void NPC::Die(bool show)
 			this->map->npcs.end()
 		);
 
+		this->map->npc_grid.Remove(this);
+		this->map->npc_indexes.Release(this->index);
+
 		delete this;
 	}
 }
 
 void NPC::Attack(Character *target)
 {
-	int amount = util::rand(this->ENF().mindam, this->ENF().maxdam + static_cast<int>(this->map->world->config["NPCAdjustMaxDam"]));
+	int amount = util::rand(this->ENF().mindam, this->ENF().maxdam + this->map->world->settings.npc_adjust_max_dam);
 	double rand = util::rand(0.0, 1.0);
 	// Checks if target is facing you
-	bool critical = std::abs(int(target->direction) - this->direction) != 2 || rand < static_cast<double>(this->map->world->config["CriticalRate"]);
+	bool critical = std::abs(int(target->direction) - this->direction) != 2 || rand < this->map->world->settings.critical_rate;
 
-	std::unordered_map<std::string, double> formula_vars;
+	const Formulas &formulas = this->map->world->formulas;
+	std::vector<double> &formula_vars = this->map->formula_vars;
+	formulas.ResetVars(formula_vars);
 
-	this->FormulaVars(formula_vars);
-	target->FormulaVars(formula_vars, "target_");
-	formula_vars["modifier"] = 1.0 / static_cast<double>(this->map->world->config["MobRate"]);
-	formula_vars["damage"] = amount;
-	formula_vars["critical"] = critical;
+	this->FormulaVars(formula_vars, formulas.npc_slots);
+	target->FormulaVars(formula_vars, formulas.target_character_slots);
+	formula_vars[formulas.modifier_slot] = 1.0 / this->map->world->settings.mob_rate;
+	formula_vars[formulas.damage_slot] = amount;
+	formula_vars[formulas.critical_slot] = critical;
 
-	amount = static_cast<int>(rpn_eval(rpn_parse(this->map->world->formulas_config["damage"]), formula_vars));
-	double hit_rate = rpn_eval(rpn_parse(this->map->world->formulas_config["hit_rate"]), formula_vars);
+	amount = static_cast<int>(formulas.damage.eval(formula_vars));
+	double hit_rate = formulas.hit_rate.eval(formula_vars);
 
 	if (rand > hit_rate)
 	{
@@ -1033,7 +1162,7 @@ void NPC::Attack(Character *target)
 
 	int limitamount = std::min(amount, int(target->hp));
 
-	if (this->map->world->config["LimitDamage"])
+	if (this->map->world->settings.limit_damage)
 	{
 		amount = limitamount;
 	}
@@ -1107,6 +1236,12 @@ void NPC::Say(const std::string& message)
 	this->map->Msg(this, message);
 }
 
+#define NPC_FORMULA_VARS \
+	vv(1, "npc") v(hp) vv(data.hp, "maxhp") \
+	vd(mindam) vd(maxdam) \
+	vd(accuracy) vd(evade) vd(armor) \
+	v(x) v(y) v(direction) vv(map->id, "mapid")
+
 #define v(x) vars[prefix + #x] = x;
 #define vv(x, n) vars[prefix + n] = x;
 #define vd(x) vars[prefix + #x] = data.x;
@@ -1114,18 +1249,48 @@ void NPC::Say(const std::string& message)
 void NPC::FormulaVars(std::unordered_map<std::string, double> &vars, std::string prefix)
 {
 	const ENF_Data& data = this->ENF();
-	vv(1, "npc") v(hp) vv(data.hp, "maxhp")
-	vd(mindam) vd(maxdam)
-	vd(accuracy) vd(evade) vd(armor)
-	v(x) v(y) v(direction) vv(map->id, "mapid")
+	NPC_FORMULA_VARS
+}
+
+#undef vd
+#undef vv
+#undef v
+
+#define v(x) vars[*slot++] = x;
+#define vv(x, n) vars[*slot++] = x;
+#define vd(x) vars[*slot++] = data.x;
+
+void NPC::FormulaVars(std::vector<double> &vars, const std::vector<std::size_t> &slots)
+{
+	const ENF_Data& data = this->ENF();
+	auto slot = slots.begin();
+	NPC_FORMULA_VARS
 }
 
 #undef vd
 #undef vv
 #undef v
 
+#define v(x) names.push_back(#x);
+#define vv(x, n) names.push_back(n);
+#define vd(x) names.push_back(#x);
+
+std::vector<std::string> NPC::FormulaVarNames()
+{
+	std::vector<std::string> names;
+	NPC_FORMULA_VARS
+	return names;
+}
+
+#undef vd
+#undef vv
+#undef v
+#undef NPC_FORMULA_VARS
+
 NPC::~NPC()
 {
+	this->map->UnscheduleAct(this);
+
 	UTIL_FOREACH(this->map->characters, character)
 	{
 		if (character->npc == this)
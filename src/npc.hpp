@@ -14,6 +14,8 @@
 #include "fwd/map.hpp"
 #include "fwd/npc_data.hpp"
 
+#include "util/nav_grid.hpp"
+
 #include <array>
 #include <list>
 #include <memory>
@@ -46,12 +48,22 @@ class NPC
 		double last_act;
 		double last_talk;
 		double act_speed;
+		double act_deadline; // Key in Map::act_queue
 		int walk_idle_for;
 		bool attack;
 		int hp;
 		int totaldamage;
 		std::list<std::unique_ptr<NPC_Opponent>> damagelist;
 
+		// Cached route to the character being chased, next step at the back
+		std::vector<util::NavGrid::Point> path;
+		util::NavGrid::Point path_goal;
+
+		// Target position no path could be found to, searched for again after path_wait more tries, doubling each time it fails
+		util::NavGrid::Point path_failed_goal;
+		int path_backoff;
+		int path_wait;
+
 		Map *map;
 		unsigned char index;
 		unsigned char spawn_type;
@@ -74,6 +86,12 @@ class NPC
 		bool InCharacterRange();
 
 		bool Walk(Direction);
+
+		/**
+		 * Takes one step along a path towards a character, searching for a new path if the target moved or the way is blocked.
+		 * Returns false if no path could be found within the chase distance, or one was recently not found to the same position.
+		 */
+		bool Chase(Character *target);
 		void Damage(Character *from, int amount, int spell_id = -1);
 		void RemoveFromView(Character *target);
 		void Killed(Character *from, int amount, int spell_id = -1);
@@ -85,6 +103,13 @@ class NPC
 
 		void FormulaVars(std::unordered_map<std::string, double> &vars, std::string prefix = "");
 
+		/**
+		 * Fills in formula variables by slot, in the order of FormulaVarNames
+		 */
+		void FormulaVars(std::vector<double> &vars, const std::vector<std::size_t> &slots);
+
+		static std::vector<std::string> FormulaVarNames();
+
 		~NPC();
 };
 
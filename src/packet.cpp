@@ -176,52 +176,76 @@ std::string PacketProcessor::Decode(const std::string &str)
 
 std::string PacketProcessor::Encode(const std::string &rawstr)
 {
-	if (emulti_e == 0 || ((unsigned char)rawstr[2] == PACKET_A_INIT && (unsigned char)rawstr[3] == PACKET_F_INIT))
-		return rawstr;
-
-	std::string str = this->DickWinderE(rawstr);
 	std::string newstr;
-	int length = str.length();
-	int i = 2;
-	int ii = 2;
+	newstr.resize(rawstr.length());
 
-	newstr.resize(length);
+	this->Encode(rawstr, &newstr[0], newstr.length(), nullptr);
 
-	newstr[0] = str[0];
-	newstr[1] = str[1];
-
-	while (i < length)
-	{
-		newstr[i] = (unsigned char)str[ii++] ^ 0x80;
-		i += 2;
-	}
+	return newstr;
+}
 
-	i = length - 1;
+void PacketProcessor::Encode(const std::string &raw, char *out, std::size_t split, char *wrapped) const
+{
+	const std::size_t length = raw.length();
 
-	if (length % 2)
+	if (emulti_e == 0 || ((unsigned char)raw[2] == PACKET_A_INIT && (unsigned char)raw[3] == PACKET_F_INIT))
 	{
-		--i;
-	}
+		for (std::size_t i = 0; i < length; ++i)
+			(i < split ? out[i] : wrapped[i - split]) = raw[i];
 
-	while (i >= 2)
-	{
-		newstr[i] = (unsigned char)str[ii++] ^ 0x80;
-		i -= 2;
+		return;
 	}
 
-	for (int i = 2; i < length; ++i)
+	// After the length bytes, the first half of the wound packet fills the even
+	// positions forwards and the rest fills the odd positions backwards
+	const std::size_t evens = (length - 1) / 2;
+	const std::size_t last = (length % 2) ? length - 2 : length - 1;
+
+	auto put = [&](std::size_t i, unsigned char c)
 	{
-		if (static_cast<unsigned char>(newstr[i]) == 128)
+		std::size_t pos = i;
+
+		if (i >= 2)
 		{
-			newstr[i] = 0;
+			const std::size_t k = i - 2;
+			pos = (k < evens) ? 2 + 2 * k : last - 2 * (k - evens);
+
+			c ^= 0x80;
+
+			if (c == 128)
+				c = 0;
+			else if (c == 0)
+				c = 128;
 		}
-		else if (newstr[i] == 0)
+
+		(pos < split ? out[pos] : wrapped[pos - split]) = c;
+	};
+
+	// Streams DickWinder: runs of bytes divisible by emulti are written reversed
+	std::size_t run = 0;
+	std::size_t run_length = 0;
+
+	for (std::size_t i = 0; i < length; ++i)
+	{
+		unsigned char c = raw[i];
+
+		if (c % emulti_e == 0)
 		{
-			newstr[i] = (char)128;
+			if (run_length++ == 0)
+				run = i;
+
+			continue;
 		}
+
+		for (std::size_t ii = 0; ii < run_length; ++ii)
+			put(run + ii, raw[run + run_length - 1 - ii]);
+
+		run_length = 0;
+		put(i, c);
 	}
 
-	return newstr;
+	for (std::size_t ii = 0; ii < run_length; ++ii)
+		put(run + ii, raw[run + run_length - 1 - ii]);
 }
 
 std::string PacketProcessor::DickWinder(const std::string &str, unsigned char emulti)
@@ -713,3 +737,9 @@ PacketBuilder::~PacketBuilder()
 {
 	std::fill(UTIL_RANGE(this->data), '\0');
 }
+
+PacketBroadcast::PacketBroadcast(const PacketBuilder &builder)
+	: id(builder.GetID())
+	, length(builder.Length())
+	, raw(builder.Get())
+{ }
@@ -60,6 +60,12 @@ class PacketProcessor
 
 		std::string Decode(const std::string &);
 		std::string Encode(const std::string &);
+
+		/**
+		 * Encodes a raw packet straight in to a two segment (ring) buffer without allocating.
+		 * Byte i of the result is written to out[i] while i < split, and to wrapped[i - split] after that.
+		 */
+		void Encode(const std::string &raw, char *out, std::size_t split, char *wrapped) const;
 		static std::string DickWinder(const std::string &, unsigned char emulti);
 		std::string DickWinderE(const std::string &);
 		std::string DickWinderD(const std::string &);
@@ -147,4 +153,31 @@ class PacketBuilder
 		~PacketBuilder();
 };
 
+/**
+ * A packet serialized once to be sent to many clients.
+ * Each recipient only applies its own connection encoding when it is sent.
+ */
+class PacketBroadcast
+{
+	protected:
+		unsigned short id;
+		std::size_t length;
+		std::string raw;
+
+	public:
+		explicit PacketBroadcast(const PacketBuilder &builder);
+
+		unsigned short GetID() const { return this->id; }
+
+		/**
+		 * Length of the packet's payload, excluding the length and ID header.
+		 */
+		std::size_t Length() const { return this->length; }
+
+		/**
+		 * The unencoded packet including its header, as returned by PacketBuilder::Get().
+		 */
+		const std::string &Raw() const { return this->raw; }
+};
+
 #endif // PACKET_HPP_INCLUDED
@@ -19,10 +19,12 @@
 
 #include <algorithm>
 #include <ctime>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 Player::Player(const std::string& username)
 	: username(username)
@@ -34,31 +36,38 @@ Player::Player(const std::string& username)
 	this->char_op_id = 0;
 }
 
-Player::Player(const std::string& username, World * world, Database * database)
+static Player_Load_Data player_query(const std::string& username, Database& database)
 {
-	this->world = world;
+	std::shared_ptr<Player_Load_Data> data = Player::Query(username, database);
 
-	auto db_ptr = database ? database : this->world->db.get();
-
-	Database_Result res = db_ptr->Query("SELECT `username`, `password` FROM `accounts` WHERE `username` = '$'", username.c_str());
-	if (res.empty())
+	if (!data)
 	{
 		throw std::runtime_error("Player not found (" + username + ")");
 	}
-	std::unordered_map<std::string, util::variant> row = res.front();
+
+	return std::move(*data);
+}
+
+Player::Player(const std::string& username, World * world, Database * database)
+	: Player(world, player_query(username, database ? *database : *world->db))
+{ }
+
+Player::Player(World * world, Player_Load_Data&& data)
+{
+	this->world = world;
 
 	this->login_time = static_cast<int>(std::time(0));
 
 	this->online = true;
 	this->character = nullptr;
 
-	this->username = static_cast<std::string>(row["username"]);
+	this->username = data.username;
 
-	res = db_ptr->Query("SELECT `name` FROM `characters` WHERE `account` = '$' ORDER BY `exp` DESC", username.c_str());
+	// Holds the guilds in the cache until the characters take their own references
+	std::vector<std::shared_ptr<Guild>> guilds = world->guildmanager->AddGuilds(data.guilds);
 
-	UTIL_FOREACH_REF(res, row)
+	UTIL_FOREACH(Character::LoadAccount(data.characters, world), newchar)
 	{
-		Character *newchar = new Character(row["name"], world, db_ptr);
 		newchar->player = this;
 		this->characters.push_back(newchar);
 	}
@@ -67,6 +76,31 @@ Player::Player(const std::string& username, World * world, Database * database)
 	this->char_op_id = 0;
 }
 
+std::shared_ptr<Player_Load_Data> Player::Query(const std::string& username, Database& database)
+{
+	Database_Result res = database.Query("SELECT `username`, `password` FROM `accounts` WHERE `username` = '$'", username.c_str());
+
+	if (res.empty())
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<Player_Load_Data> data = std::make_shared<Player_Load_Data>();
+	data->username = static_cast<std::string>(res.front()["username"]);
+	data->characters = Character::QueryAccount(data->username, database);
+
+	std::vector<std::string> guild_tags;
+
+	UTIL_FOREACH_REF(data->characters, row)
+	{
+		guild_tags.push_back(row["guild"]);
+	}
+
+	data->guilds = GuildManager::QueryGuilds(guild_tags, database);
+
+	return data;
+}
+
 bool Player::ValidName(std::string username)
 {
 	for (std::size_t i = 0; i < username.length(); ++i)
@@ -130,6 +164,11 @@ void Player::Send(const PacketBuilder &builder)
 	this->client->Send(builder);
 }
 
+void Player::Send(const PacketBroadcast &packet)
+{
+	this->client->Send(packet);
+}
+
 void Player::Logout()
 {
 	UTIL_FOREACH(this->characters, character)
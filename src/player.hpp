@@ -17,12 +17,25 @@
 
 #include "util/secure_string.hpp"
 
+#include "database.hpp"
+#include "guild.hpp"
 #include "hash.hpp"
 #include "socket.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>
 
+/**
+ * Everything a Player is built from, read by Player::Query so the database work can be done away from the main thread
+ */
+struct Player_Load_Data
+{
+	std::string username;
+	Database_Result characters;
+	Guild_Load_Data guilds;
+};
+
 struct AccountCreateInfo
 {
 	std::string username;
@@ -54,6 +67,9 @@ struct AccountCredentials
 	util::secure_string password;
 	HashFunc hashFunc;
 
+	// Filled in by LoginManager::CheckLoginAsync once the password has been accepted, null if the account has gone since
+	std::shared_ptr<Player_Load_Data> player;
+
 	AccountCredentials()
 		: username(""), password(""), hashFunc(NONE) { }
 
@@ -78,6 +94,17 @@ class Player
 		Player(const std::string& username);
 		Player(const std::string& username, World *, Database * = nullptr);
 
+		/**
+		 * Builds a player from rows read by Query without touching the database
+		 */
+		Player(World *, Player_Load_Data&& data);
+
+		/**
+		 * Reads an account, its characters and their guilds. Only touches the database, so it is safe to call from any thread.
+		 * Returns null if the account does not exist.
+		 */
+		static std::shared_ptr<Player_Load_Data> Query(const std::string& username, Database& database);
+
 		std::vector<Character *> characters;
 		Character *character;
 
@@ -89,6 +116,7 @@ class Player
 		AdminLevel Admin() const;
 
 		void Send(const PacketBuilder &);
+		void Send(const PacketBroadcast &);
 
 		void Logout();
 
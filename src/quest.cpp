@@ -32,6 +32,7 @@
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 static int quest_day()
 {
@@ -60,158 +61,249 @@ struct Validation_Error : public EOPlus::Runtime_Error
 		}
 };
 
-static void validate_state(const EOPlus::Quest& quest, const std::string& name, const EOPlus::State& state)
+enum QuestAction
 {
-	struct info_t
-	{
-		int min_args;
-		int max_args;
+	QUEST_ACTION_UNKNOWN,
+	QUEST_ACTION_SETSTATE,
+	QUEST_ACTION_RESET,
+	QUEST_ACTION_RESETDAILY,
+	QUEST_ACTION_END,
+	QUEST_ACTION_STARTQUEST,
+	QUEST_ACTION_RESETQUEST,
+	QUEST_ACTION_SETQUESTSTATE,
+	QUEST_ACTION_ADDNPCTEXT,
+	QUEST_ACTION_ADDNPCINPUT,
+	QUEST_ACTION_ADDNPCCHAT,
+	QUEST_ACTION_SHOWHINT,
+	QUEST_ACTION_QUAKE,
+	QUEST_ACTION_QUAKEWORLD,
+	QUEST_ACTION_SETCOORD,
+	QUEST_ACTION_PLAYSOUND,
+	QUEST_ACTION_GIVEEXP,
+	QUEST_ACTION_GIVEITEM,
+	QUEST_ACTION_REMOVEITEM,
+	QUEST_ACTION_SETCLASS,
+	QUEST_ACTION_SETRACE,
+	QUEST_ACTION_REMOVEKARMA,
+	QUEST_ACTION_GIVEKARMA,
+	QUEST_ACTION_SETTITLE,
+	QUEST_ACTION_SETFIANCE,
+	QUEST_ACTION_SETPARTNER,
+	QUEST_ACTION_SETHOME,
+	QUEST_ACTION_SETSTAT,
+	QUEST_ACTION_GIVESTAT,
+	QUEST_ACTION_REMOVESTAT,
+	QUEST_ACTION_ROLL
+};
 
-		info_t(int min_args, int max_args = 0)
-			: min_args(min_args)
-			, max_args(max_args < 0 ? max_args : std::max(min_args, max_args))
-		{ }
-	};
+enum QuestRule
+{
+	QUEST_RULE_UNKNOWN,
+	QUEST_RULE_INPUTNPC,
+	QUEST_RULE_TALKEDTONPC,
+	QUEST_RULE_ALWAYS,
+	QUEST_RULE_DONEDAILY,
+	QUEST_RULE_ENTERMAP,
+	QUEST_RULE_ENTERCOORD,
+	QUEST_RULE_LEAVEMAP,
+	QUEST_RULE_LEAVECOORD,
+	QUEST_RULE_KILLEDNPCS,
+	QUEST_RULE_KILLEDPLAYERS,
+	QUEST_RULE_GOTITEMS,
+	QUEST_RULE_LOSTITEMS,
+	QUEST_RULE_USEDITEM,
+	QUEST_RULE_ISGENDER,
+	QUEST_RULE_ISCLASS,
+	QUEST_RULE_ISRACE,
+	QUEST_RULE_ISWEARING,
+	QUEST_RULE_GOTSPELL,
+	QUEST_RULE_LOSTSPELL,
+	QUEST_RULE_USEDSPELL,
+	QUEST_RULE_CITIZENOF,
+	QUEST_RULE_ROLLED,
+	QUEST_RULE_STATIS,
+	QUEST_RULE_STATNOT,
+	QUEST_RULE_STATGREATER,
+	QUEST_RULE_STATLESS,
+	QUEST_RULE_STATBETWEEN,
+	QUEST_RULE_STATRPN
+};
 
-	static std::map<std::string, info_t> action_argument_info{
-		{"setstate", 1},
-		{"reset", 0},
-		{"resetdaily", 0},
-		{"end", 0},
-
-		{"startquest", {1, 2}},
-		{"resetquest", 1},
-		{"setqueststate", 2},
-
-		{"addnpctext", 2},
-		{"addnpcinput", 3},
-
-		{"addnpcchat", 2}, // TODO: AddNpcChat
-		{"showhint", 1},
-		{"quake", {0, 1}},
-		{"quakeworld", {0, 1}},
-
-		{"setmap", 3}, // Alias for SetCoord
-		{"setcoord", 3},
-		{"playsound", 1},
-		{"giveexp", 1},
-		{"giveitem", {1, 2}},
-		{"removeitem", {1, 2}},
-		{"setclass", 1},
-		{"setrace", 1},
-		{"removekarma", 1},
-		{"givekarma", 1},
-
-		{"settitle", 1},
-		{"setfiance", 1},
-		{"setpartner", 1},
-		{"sethome", 1},
-
-		{"setstat", 2},
-		{"givestat", 2},
-		{"removestat", 2},
-
-		{"roll", 1},
-	};
+struct quest_function_info
+{
+	int opcode;
+	int min_args;
+	int max_args;
+
+	// Events that can change the outcome of a rule, rules only triggered by Quest_Context's event functions have none
+	unsigned events;
+
+	quest_function_info(int opcode, int min_args, int max_args = 0, unsigned events = 0)
+		: opcode(opcode)
+		, min_args(min_args)
+		, max_args(max_args < 0 ? max_args : std::max(min_args, max_args))
+		, events(events)
+	{ }
+};
 
-	static std::map<std::string, info_t> rule_argument_info{
-		{"inputnpc", 1},
-		{"talkedtonpc", 1},
+static const std::map<std::string, quest_function_info> quest_action_info{
+	{"setstate",      {QUEST_ACTION_SETSTATE, 1}},
+	{"reset",         {QUEST_ACTION_RESET, 0}},
+	{"resetdaily",    {QUEST_ACTION_RESETDAILY, 0}},
+	{"end",           {QUEST_ACTION_END, 0}},
+
+	{"startquest",    {QUEST_ACTION_STARTQUEST, 1, 2}},
+	{"resetquest",    {QUEST_ACTION_RESETQUEST, 1}},
+	{"setqueststate", {QUEST_ACTION_SETQUESTSTATE, 2}},
+
+	{"addnpctext",    {QUEST_ACTION_ADDNPCTEXT, 2}},
+	{"addnpcinput",   {QUEST_ACTION_ADDNPCINPUT, 3}},
+
+	{"addnpcchat",    {QUEST_ACTION_ADDNPCCHAT, 2}}, // TODO: AddNpcChat
+	{"showhint",      {QUEST_ACTION_SHOWHINT, 1}},
+	{"quake",         {QUEST_ACTION_QUAKE, 0, 1}},
+	{"quakeworld",    {QUEST_ACTION_QUAKEWORLD, 0, 1}},
+
+	{"setmap",        {QUEST_ACTION_SETCOORD, 3}}, // Alias for SetCoord
+	{"setcoord",      {QUEST_ACTION_SETCOORD, 3}},
+	{"playsound",     {QUEST_ACTION_PLAYSOUND, 1}},
+	{"giveexp",       {QUEST_ACTION_GIVEEXP, 1}},
+	{"giveitem",      {QUEST_ACTION_GIVEITEM, 1, 2}},
+	{"removeitem",    {QUEST_ACTION_REMOVEITEM, 1, 2}},
+	{"setclass",      {QUEST_ACTION_SETCLASS, 1}},
+	{"setrace",       {QUEST_ACTION_SETRACE, 1}},
+	{"removekarma",   {QUEST_ACTION_REMOVEKARMA, 1}},
+	{"givekarma",     {QUEST_ACTION_GIVEKARMA, 1}},
+
+	{"settitle",      {QUEST_ACTION_SETTITLE, 1}},
+	{"setfiance",     {QUEST_ACTION_SETFIANCE, 1}},
+	{"setpartner",    {QUEST_ACTION_SETPARTNER, 1}},
+	{"sethome",       {QUEST_ACTION_SETHOME, 1}},
+
+	{"setstat",       {QUEST_ACTION_SETSTAT, 2}},
+	{"givestat",      {QUEST_ACTION_GIVESTAT, 2}},
+	{"removestat",    {QUEST_ACTION_REMOVESTAT, 2}},
+
+	{"roll",          {QUEST_ACTION_ROLL, 1}},
+};
 
-		{"always", 0},
+static const std::map<std::string, quest_function_info> quest_rule_info{
+	{"inputnpc",      {QUEST_RULE_INPUTNPC, 1}},
+	{"talkedtonpc",   {QUEST_RULE_TALKEDTONPC, 1}},
 
-		{"donedaily", 1},
+	{"always",        {QUEST_RULE_ALWAYS, 0, 0, QUEST_EVENT_ALL}},
 
-		{"entermap", 1},
-		{"entercoord", 3},
-		{"leavemap", 1},
-		{"leavecoord", 3},
+	{"donedaily",     {QUEST_RULE_DONEDAILY, 1, 0, QUEST_EVENT_ALL}},
 
-		{"killednpcs", {1, 2}},
-		{"killedplayers", 1},
+	{"entermap",      {QUEST_RULE_ENTERMAP, 1, 0, QUEST_EVENT_MOVE}},
+	{"entercoord",    {QUEST_RULE_ENTERCOORD, 3, 0, QUEST_EVENT_MOVE}},
+	{"leavemap",      {QUEST_RULE_LEAVEMAP, 1, 0, QUEST_EVENT_MOVE}},
+	{"leavecoord",    {QUEST_RULE_LEAVECOORD, 3, 0, QUEST_EVENT_MOVE}},
 
-		{"gotitems", {1, 2}},
-		{"lostitems", {1, 2}},
-		{"useditem", {1, 2}},
+	{"killednpcs",    {QUEST_RULE_KILLEDNPCS, 1, 2}},
+	{"killedplayers", {QUEST_RULE_KILLEDPLAYERS, 1}},
 
-		{"isgender", 1},
-		{"isclass", 1},
-		{"israce", 1},
-		{"iswearing", 1},
+	{"gotitems",      {QUEST_RULE_GOTITEMS, 1, 2, QUEST_EVENT_ITEMS}},
+	{"lostitems",     {QUEST_RULE_LOSTITEMS, 1, 2, QUEST_EVENT_ITEMS}},
+	{"useditem",      {QUEST_RULE_USEDITEM, 1, 2}},
 
-		{"gotspell", {1, 2}},
-		{"lostspell", 1},
-		{"usedspell", {1, 2}},
+	{"isgender",      {QUEST_RULE_ISGENDER, 1, 0, QUEST_EVENT_CHARACTER}},
+	{"isclass",       {QUEST_RULE_ISCLASS, 1, 0, QUEST_EVENT_CHARACTER}},
+	{"israce",        {QUEST_RULE_ISRACE, 1, 0, QUEST_EVENT_CHARACTER}},
+	{"iswearing",     {QUEST_RULE_ISWEARING, 1, 0, QUEST_EVENT_CHARACTER}},
 
-		{"citizenof", 1},
+	{"gotspell",      {QUEST_RULE_GOTSPELL, 1, 2, QUEST_EVENT_SPELLS}},
+	{"lostspell",     {QUEST_RULE_LOSTSPELL, 1, 0, QUEST_EVENT_SPELLS}},
+	{"usedspell",     {QUEST_RULE_USEDSPELL, 1, 2}},
 
-		{"rolled", {1, 2}},
+	{"citizenof",     {QUEST_RULE_CITIZENOF, 1, 0, QUEST_EVENT_CHARACTER}},
 
-		// Only needed until expression support is added
-		{"statis", 2},
-		{"statnot", 2},
-		{"statgreater", 2},
-		{"statless", 2},
-		{"statbetween", 3},
-		{"statrpn", 1}
-	};
+	{"rolled",        {QUEST_RULE_ROLLED, 1, 2, QUEST_EVENT_ALL}},
 
-	auto check = [&](std::string type, std::string function, const std::deque<util::variant>& args, info_t& info)
+	// Only needed until expression support is added
+	{"statis",        {QUEST_RULE_STATIS, 2, 0, QUEST_EVENT_ALL}},
+	{"statnot",       {QUEST_RULE_STATNOT, 2, 0, QUEST_EVENT_ALL}},
+	{"statgreater",   {QUEST_RULE_STATGREATER, 2, 0, QUEST_EVENT_ALL}},
+	{"statless",      {QUEST_RULE_STATLESS, 2, 0, QUEST_EVENT_ALL}},
+	{"statbetween",   {QUEST_RULE_STATBETWEEN, 3, 0, QUEST_EVENT_ALL}},
+	{"statrpn",       {QUEST_RULE_STATRPN, 1, 0, QUEST_EVENT_ALL}}
+};
+
+/**
+ * Resolves an expression to its opcode and converts its arguments to integers up front
+ */
+static const quest_function_info* resolve_expression(const std::map<std::string, quest_function_info>& table, EOPlus::Expression& expr)
+{
+	const auto it = table.find(expr.function);
+
+	if (it == table.end())
+		return nullptr;
+
+	expr.opcode = it->second.opcode;
+	expr.int_args.clear();
+
+	UTIL_FOREACH_CREF(expr.args, arg)
 	{
-		if (args.size() < std::size_t(info.min_args))
-			throw Validation_Error(type + " " + function + " requires at least " + util::to_string(info.min_args) + " argument(s)", name);
+		expr.int_args.push_back(int(arg));
+	}
 
-		if (info.max_args != -1 && args.size() > std::size_t(info.max_args))
-			throw Validation_Error(type + " " + function + " requires at most " + util::to_string(info.max_args) + " argument(s)", name);
+	return &it->second;
+}
 
-		if (function == "setstate")
+static void compile_state(const EOPlus::Quest& quest, const std::string& name, EOPlus::State& state)
+{
+	auto compile = [&](std::string type, const std::map<std::string, quest_function_info>& table, EOPlus::Expression& expr) -> const quest_function_info&
+	{
+		const quest_function_info* info = resolve_expression(table, expr);
+
+		if (!info)
+			throw Validation_Error("Unknown " + util::lowercase(type) + ": " + expr.function, name);
+
+		if (expr.args.size() < std::size_t(info->min_args))
+			throw Validation_Error(type + " " + expr.function + " requires at least " + util::to_string(info->min_args) + " argument(s)", name);
+
+		if (info->max_args != -1 && expr.args.size() > std::size_t(info->max_args))
+			throw Validation_Error(type + " " + expr.function + " requires at most " + util::to_string(info->max_args) + " argument(s)", name);
+
+		if (expr.function == "setstate")
 		{
-			std::string state = util::lowercase(args[0]);
+			std::string state = util::lowercase(expr.args[0]);
 			auto it = quest.states.find(state);
 
 			if (it == quest.states.end())
 				throw Validation_Error("Unknown quest state: " + state, name);
 		}
+
+		return *info;
 	};
 
-	UTIL_FOREACH(state.actions, action)
+	UTIL_FOREACH_REF(state.actions, action)
 	{
-		const auto it = action_argument_info.find(action.expr.function);
-
-		if (it == action_argument_info.end())
-			throw Validation_Error("Unknown action: " + action.expr.function, name);
+		compile("Action", quest_action_info, action.expr);
 
-		check("Action", action.expr.function, action.expr.args, it->second);
+		// Conditions have never been validated, an unknown one is simply never true
+		resolve_expression(quest_rule_info, action.cond_expr);
 	}
 
-	UTIL_FOREACH(state.rules, rule)
+	UTIL_FOREACH_REF(state.rules, rule)
 	{
-		const EOPlus::Action& action = rule.action;
-
-		const auto it = action_argument_info.find(action.expr.function);
-
-		if (it == action_argument_info.end())
-			throw Validation_Error("Unknown action: " + action.expr.function, name);
-
-		check("Action", action.expr.function, action.expr.args, it->second);
+		compile("Action", quest_action_info, rule.action.expr);
 	}
 
-	UTIL_FOREACH(state.rules, rule)
-	{
-		const auto it = rule_argument_info.find(rule.expr.function);
-
-		if (it == rule_argument_info.end())
-			throw Validation_Error("Unknown rule: " + rule.expr.function, name);
+	state.rule_events = 0;
 
-		check("Rule", rule.expr.function, rule.expr.args, it->second);
+	UTIL_FOREACH_REF(state.rules, rule)
+	{
+		rule.events = compile("Rule", quest_rule_info, rule.expr).events;
+		state.rule_events |= rule.events;
 	}
 }
 
-static void validate_quest(const EOPlus::Quest& quest)
+static void compile_quest(EOPlus::Quest& quest)
 {
-	UTIL_CIFOREACH(quest.states, it)
+	UTIL_IFOREACH(quest.states, it)
 	{
-		validate_state(quest, it->first, it->second);
+		compile_state(quest, it->first, it->second);
 	}
 }
 
@@ -314,7 +406,7 @@ static bool modify_stat(std::string name, std::function<int(int)> f, Character*
 
 	if (!stats && !skillpoints && !appearance)
 	{
-		victim->CheckQuestRules();
+		victim->CheckQuestRules(QUEST_EVENT_CHARACTER);
 	}
 
 	return true;
@@ -344,8 +436,9 @@ void Quest::Load()
 
 	try
 	{
-		this->quest = new EOPlus::Quest(f);
-		validate_quest(*this->quest);
+		EOPlus::Quest* quest = new EOPlus::Quest(f);
+		this->quest = quest;
+		compile_quest(*quest);
 	}
 	catch (EOPlus::Syntax_Error& e)
 	{
@@ -408,355 +501,486 @@ void Quest_Context::BeginState(const std::string& name, const EOPlus::State& sta
 	}
 
 	this->dialogs.clear();
+	this->ClearTriggers();
 
 	if (this->quest->Disabled())
 		return;
 
-	UTIL_FOREACH(state.actions, action)
+	UTIL_FOREACH_CREF(state.actions, action)
 	{
-		std::string function_name = action.expr.function;
+		int opcode = action.expr.opcode;
 
-		if (function_name == "addnpctext" || function_name == "addnpcinput")
+		if (opcode == QUEST_ACTION_ADDNPCTEXT || opcode == QUEST_ACTION_ADDNPCINPUT)
 		{
-			short vendor_id = int(action.expr.args[0]);
+			short vendor_id = action.expr.int_args[0];
 			auto it = this->dialogs.find(vendor_id);
 
 			if (it == this->dialogs.end())
+			{
 				it = this->dialogs.insert(std::make_pair(vendor_id, std::shared_ptr<Dialog>(new Dialog()))).first;
+				this->AddTrigger(QuestTriggerIndex::Dialog, vendor_id);
+			}
 
-			if (function_name == "addnpctext")
+			if (opcode == QUEST_ACTION_ADDNPCTEXT)
 				it->second->AddPage(std::string(action.expr.args[1]));
-			else if (function_name == "addnpcinput")
-				it->second->AddLink(int(action.expr.args[1]), std::string(action.expr.args[2]));
+			else
+				it->second->AddLink(action.expr.int_args[1], std::string(action.expr.args[2]));
+		}
+	}
+
+	UTIL_FOREACH_CREF(state.rules, rule)
+	{
+		const EOPlus::Expression& expr = rule.expr;
+
+		switch (expr.opcode)
+		{
+			case QUEST_RULE_KILLEDNPCS:
+				this->AddTrigger(QuestTriggerIndex::KilledNPC, expr.int_args[0]);
+				break;
+
+			case QUEST_RULE_KILLEDPLAYERS:
+				this->AddTrigger(QuestTriggerIndex::KilledPlayer, 0);
+				break;
+
+			case QUEST_RULE_USEDITEM:
+				this->AddTrigger(QuestTriggerIndex::UsedItem, expr.int_args[0]);
+				break;
+
+			case QUEST_RULE_USEDSPELL:
+				this->AddTrigger(QuestTriggerIndex::UsedSpell, expr.int_args[0]);
+				break;
+
+			case QUEST_RULE_GOTITEMS:
+			case QUEST_RULE_LOSTITEMS:
+				this->AddTrigger(QuestTriggerIndex::Item, expr.int_args[0]);
+				break;
+
+			case QUEST_RULE_ISWEARING:
+				this->AddTrigger(QuestTriggerIndex::Inventory, 0);
+				break;
+
+			// Equipping re-checks every rule through CalculateStats, so the inventory on its own only changes weight
+			case QUEST_RULE_STATIS:
+			case QUEST_RULE_STATNOT:
+			case QUEST_RULE_STATGREATER:
+			case QUEST_RULE_STATLESS:
+			case QUEST_RULE_STATBETWEEN:
+			case QUEST_RULE_STATRPN:
+				if (std::string(expr.args[0]).find("weight") != std::string::npos)
+					this->AddTrigger(QuestTriggerIndex::Inventory, 0);
+
+				break;
 		}
 	}
 }
 
-bool Quest_Context::DoAction(const EOPlus::Action& action)
+void Quest_Context::EndState()
 {
-	if (this->quest->Disabled())
-		return false;
+	// The previous state's dialogs are left open until the next state replaces them
+	this->ClearTriggers(true);
+}
 
-	std::string function_name = action.expr.function;
+void Quest_Context::AddTrigger(QuestTriggerIndex::Trigger trigger, int id)
+{
+	QuestTriggerIndex::Key key{this->character, trigger, id};
 
-	if (function_name == "setstate")
-	{
-		std::string state = util::lowercase(action.expr.args[0]);
-		this->SetState(state);
-		return true;
-	}
-	else if (function_name == "reset")
-	{
-		if (this->progress.find("c") == this->progress.end())
-		{
-			this->character->ResetQuest(this->quest->ID());
-		}
-		else
-		{
-			this->SetState("done");
-		}
+	if (std::find(this->triggers.begin(), this->triggers.end(), key) != this->triggers.end())
+		return;
 
-		return true;
-		// *this may not be valid after this point
-	}
-	else if (function_name == "resetdaily")
-	{
-		this->progress["d"] = quest_day();
-		++this->progress["c"];
-		this->SetState("done");
-		return true;
-	}
-	else if (function_name == "end")
+	this->character->world->quest_triggers.Add(key, this->quest->ID(), this);
+	this->triggers.push_back(key);
+}
+
+void Quest_Context::ClearTriggers(bool keep_dialogs)
+{
+	auto kept = this->triggers.begin();
+
+	UTIL_FOREACH_CREF(this->triggers, key)
 	{
-		this->SetState("end");
-		return true;
+		if (keep_dialogs && key.trigger == QuestTriggerIndex::Dialog)
+			*kept++ = key;
+		else
+			this->character->world->quest_triggers.Remove(key, this);
 	}
-	else if (function_name == "startquest")
-	{
-		short id = int(action.expr.args[0]);
 
-		auto context = character->GetQuest(id);
+	this->triggers.erase(kept, this->triggers.end());
+}
 
-		if (!context)
-		{
-			auto it = this->character->world->quests.find(id);
+bool Quest_Context::DoAction(const EOPlus::Action& action)
+{
+	if (this->quest->Disabled())
+		return false;
 
-			if (it != this->character->world->quests.end())
-			{
-				// WARNING: holds a non-tracked reference to shared_ptr
-				Quest* quest = it->second.get();
-				auto context = std::make_shared<Quest_Context>(this->character, quest);
-				this->character->quests[it->first] = context;
-				context->SetState(action.expr.args.size() >= 2 ? std::string(action.expr.args[1]) : "begin");
-			}
-		}
-		else if (context->StateName() == "done")
+	switch (action.expr.opcode)
+	{
+		case QUEST_ACTION_SETSTATE:
 		{
-			context->SetState(action.expr.args.size() >= 2 ? std::string(action.expr.args[1]) : "begin");
+			std::string state = util::lowercase(action.expr.args[0]);
+			this->SetState(state);
+			return true;
 		}
-	}
-	else if (function_name == "resetquest")
-	{
-		short this_id = this->quest->ID();
-		short id = int(action.expr.args[0]);
-
-		auto context = this->character->GetQuest(id);
 
-		if (context)
+		case QUEST_ACTION_RESET:
 		{
 			if (this->progress.find("c") == this->progress.end())
-				context->SetState("done");
+			{
+				this->character->ResetQuest(this->quest->ID());
+			}
 			else
-				this->character->ResetQuest(id);
+			{
+				this->SetState("done");
+			}
+
+			return true;
+			// *this may not be valid after this point
 		}
 
-		if (id == this_id)
+		case QUEST_ACTION_RESETDAILY:
 		{
+			this->progress["d"] = quest_day();
+			++this->progress["c"];
+			this->SetState("done");
 			return true;
-			// *this is not valid after this point
 		}
-	}
-	else if (function_name == "setqueststate")
-	{
-		short this_id = this->quest->ID();
-		short id = int(action.expr.args[0]);
-		std::string state = std::string(action.expr.args[1]);
 
-		// WARNING: holds a non-tracked reference to shared_ptr
-		Quest_Context* quest = this->character->GetQuest(id).get();
+		case QUEST_ACTION_END:
+		{
+			this->SetState("end");
+			return true;
+		}
 
-		if (quest)
+		case QUEST_ACTION_STARTQUEST:
 		{
-			quest->SetState(state);
+			short id = action.expr.int_args[0];
+
+			auto context = character->GetQuest(id);
+
+			if (!context)
+			{
+				auto it = this->character->world->quests.find(id);
+
+				if (it != this->character->world->quests.end())
+				{
+					// WARNING: holds a non-tracked reference to shared_ptr
+					Quest* quest = it->second.get();
+					auto context = std::make_shared<Quest_Context>(this->character, quest);
+					this->character->quests[it->first] = context;
+					context->SetState(action.expr.args.size() >= 2 ? std::string(action.expr.args[1]) : "begin");
+				}
+			}
+			else if (context->StateName() == "done")
+			{
+				context->SetState(action.expr.args.size() >= 2 ? std::string(action.expr.args[1]) : "begin");
+			}
+		}
+		break;
+
+		case QUEST_ACTION_RESETQUEST:
+		{
+			short this_id = this->quest->ID();
+			short id = action.expr.int_args[0];
+
+			auto context = this->character->GetQuest(id);
+
+			if (context)
+			{
+				if (this->progress.find("c") == this->progress.end())
+					context->SetState("done");
+				else
+					this->character->ResetQuest(id);
+			}
 
 			if (id == this_id)
+			{
 				return true;
+				// *this is not valid after this point
+			}
 		}
-	}
-	else if (function_name == "showhint")
-	{
-		this->character->StatusMsg(action.expr.args[0]);
-	}
-	else if (function_name == "quake")
-	{
-		int strength = 5;
+		break;
 
-		if (action.expr.args.size() >= 1)
-			strength = std::max(1, std::min(8, int(action.expr.args[0])));
+		case QUEST_ACTION_SETQUESTSTATE:
+		{
+			short this_id = this->quest->ID();
+			short id = action.expr.int_args[0];
+			std::string state = std::string(action.expr.args[1]);
 
-		this->character->map->Effect(MAP_EFFECT_QUAKE, strength);
-	}
-	else if (function_name == "quakeworld")
-	{
-		int strength = 5;
+			// WARNING: holds a non-tracked reference to shared_ptr
+			Quest_Context* quest = this->character->GetQuest(id).get();
 
-		if (action.expr.args.size() >= 1)
-			strength = std::max(1, std::min(8, int(action.expr.args[0])));
+			if (quest)
+			{
+				quest->SetState(state);
 
-		UTIL_FOREACH(this->character->world->maps, map)
+				if (id == this_id)
+					return true;
+			}
+		}
+		break;
+
+		case QUEST_ACTION_SHOWHINT:
 		{
-			if (map->exists)
-				map->Effect(MAP_EFFECT_QUAKE, strength);
+			this->character->StatusMsg(action.expr.args[0]);
 		}
-	}
-	else if (function_name == "setmap" || function_name == "setcoord")
-	{
-		this->character->Warp(int(action.expr.args[0]), int(action.expr.args[1]), int(action.expr.args[2]));
-	}
-	else if (function_name == "playsound")
-	{
-		this->character->PlaySound(int(action.expr.args[0]));
-	}
-	else if (function_name == "giveexp")
-	{
-		bool level_up = false;
+		break;
 
-		this->character->exp += int(action.expr.args[0]);
+		case QUEST_ACTION_QUAKE:
+		{
+			int strength = 5;
 
-		this->character->exp = std::min(this->character->exp, int(this->character->map->world->config["MaxExp"]));
+			if (action.expr.args.size() >= 1)
+				strength = std::max(1, std::min(8, action.expr.int_args[0]));
 
-		while (this->character->level < int(this->character->map->world->config["MaxLevel"])
-		 && this->character->exp >= this->character->map->world->exp_table[this->character->level+1])
-		{
-			level_up = true;
-			++this->character->level;
-			this->character->statpoints += int(this->character->map->world->config["StatPerLevel"]);
-			this->character->skillpoints += int(this->character->map->world->config["SkillPerLevel"]);
-			this->character->CalculateStats();
+			this->character->map->Effect(MAP_EFFECT_QUAKE, strength);
 		}
+		break;
+
+		case QUEST_ACTION_QUAKEWORLD:
+		{
+			int strength = 5;
 
-		PacketBuilder builder(PACKET_RECOVER, PACKET_REPLY, 11);
-		builder.AddInt(this->character->exp);
-		builder.AddShort(this->character->karma);
-		builder.AddChar(level_up ? this->character->level : 0);
+			if (action.expr.args.size() >= 1)
+				strength = std::max(1, std::min(8, action.expr.int_args[0]));
+
+			UTIL_FOREACH(this->character->world->maps, map)
+			{
+				if (map->exists)
+					map->Effect(MAP_EFFECT_QUAKE, strength);
+			}
+		}
+		break;
 
-		if (level_up)
+		case QUEST_ACTION_SETCOORD:
 		{
-			builder.AddShort(this->character->statpoints);
-			builder.AddShort(this->character->skillpoints);
+			this->character->Warp(action.expr.int_args[0], action.expr.int_args[1], action.expr.int_args[2]);
 		}
+		break;
 
-		this->character->Send(builder);
+		case QUEST_ACTION_PLAYSOUND:
+		{
+			this->character->PlaySound(action.expr.int_args[0]);
+		}
+		break;
 
-		if (level_up)
+		case QUEST_ACTION_GIVEEXP:
 		{
-			UTIL_FOREACH(this->character->map->characters, character)
+			bool level_up = false;
+
+			this->character->exp += action.expr.int_args[0];
+
+			this->character->exp = std::min(this->character->exp, int(this->character->map->world->config["MaxExp"]));
+
+			while (this->character->level < int(this->character->map->world->config["MaxLevel"])
+			 && this->character->exp >= this->character->map->world->exp_table[this->character->level+1])
+			{
+				level_up = true;
+				++this->character->level;
+				this->character->statpoints += int(this->character->map->world->config["StatPerLevel"]);
+				this->character->skillpoints += int(this->character->map->world->config["SkillPerLevel"]);
+				this->character->CalculateStats();
+			}
+
+			PacketBuilder builder(PACKET_RECOVER, PACKET_REPLY, 11);
+			builder.AddInt(this->character->exp);
+			builder.AddShort(this->character->karma);
+			builder.AddChar(level_up ? this->character->level : 0);
+
+			if (level_up)
+			{
+				builder.AddShort(this->character->statpoints);
+				builder.AddShort(this->character->skillpoints);
+			}
+
+			this->character->Send(builder);
+
+			if (level_up)
 			{
-				if (character != this->character && this->character->InRange(character))
+				UTIL_FOREACH(this->character->map->characters, character)
 				{
-					PacketBuilder builder(PACKET_ITEM, PACKET_ACCEPT, 2);
-					builder.AddShort(character->PlayerID());
-					character->Send(builder);
+					if (character != this->character && this->character->InRange(character))
+					{
+						PacketBuilder builder(PACKET_ITEM, PACKET_ACCEPT, 2);
+						builder.AddShort(character->PlayerID());
+						character->Send(builder);
+					}
 				}
 			}
 		}
-	}
-	else if (function_name == "giveitem")
-	{
-		int id = int(action.expr.args[0]);
-		int amount = (action.expr.args.size() >= 2) ? int(action.expr.args[1]) : 1;
+		break;
 
-		if (this->character->AddItem(id, amount))
+		case QUEST_ACTION_GIVEITEM:
 		{
-			if (id == 1)
+			int id = action.expr.int_args[0];
+			int amount = (action.expr.args.size() >= 2) ? action.expr.int_args[1] : 1;
+
+			if (this->character->AddItem(id, amount))
 			{
-				PacketBuilder builder(PACKET_ITEM, PACKET_GET, 9);
-				builder.AddShort(0); // UID
-				builder.AddShort(id);
-				builder.AddThree(amount);
-				builder.AddChar(static_cast<unsigned char>(this->character->weight));
-				builder.AddChar(static_cast<unsigned char>(this->character->maxweight));
-				this->character->Send(builder);
+				if (id == 1)
+				{
+					PacketBuilder builder(PACKET_ITEM, PACKET_GET, 9);
+					builder.AddShort(0); // UID
+					builder.AddShort(id);
+					builder.AddThree(amount);
+					builder.AddChar(static_cast<unsigned char>(this->character->weight));
+					builder.AddChar(static_cast<unsigned char>(this->character->maxweight));
+					this->character->Send(builder);
+				}
+				else
+				{
+					PacketBuilder builder(PACKET_ITEM, PACKET_OBTAIN, 6);
+					builder.AddShort(id);
+					builder.AddThree(amount);
+					builder.AddChar(static_cast<unsigned char>(this->character->weight));
+					this->character->Send(builder);
+				}
 			}
-			else
+		}
+		break;
+
+		case QUEST_ACTION_REMOVEITEM:
+		{
+			int id = action.expr.int_args[0];
+			int amount = (action.expr.args.size() >= 2) ? action.expr.int_args[1] : 1;
+
+			if (this->character->DelItem(id, amount))
 			{
-				PacketBuilder builder(PACKET_ITEM, PACKET_OBTAIN, 6);
+				PacketBuilder builder(PACKET_ITEM, PACKET_KICK, 7);
 				builder.AddShort(id);
-				builder.AddThree(amount);
+				builder.AddInt(this->character->HasItem(id));
 				builder.AddChar(static_cast<unsigned char>(this->character->weight));
 				this->character->Send(builder);
 			}
 		}
-	}
-	else if (function_name == "removeitem")
-	{
-		int id = int(action.expr.args[0]);
-		int amount = (action.expr.args.size() >= 2) ? int(action.expr.args[1]) : 1;
+		break;
 
-		if (this->character->DelItem(id, amount))
+		case QUEST_ACTION_SETCLASS:
 		{
-			PacketBuilder builder(PACKET_ITEM, PACKET_KICK, 7);
-			builder.AddShort(id);
-			builder.AddInt(this->character->HasItem(id));
-			builder.AddChar(static_cast<unsigned char>(this->character->weight));
+			this->character->clas = action.expr.int_args[0];
+
+			this->character->CalculateStats();
+
+			PacketBuilder builder(PACKET_RECOVER, PACKET_LIST, 32);
+
+			builder.AddShort(this->character->clas);
+			builder.AddShort(this->character->display_str);
+			builder.AddShort(this->character->display_intl);
+			builder.AddShort(this->character->display_wis);
+			builder.AddShort(this->character->display_agi);
+			builder.AddShort(this->character->display_con);
+			builder.AddShort(this->character->display_cha);
+			builder.AddShort(this->character->maxhp);
+			builder.AddShort(this->character->maxtp);
+			builder.AddShort(this->character->maxsp);
+			builder.AddShort(this->character->maxweight);
+			builder.AddShort(this->character->mindam);
+			builder.AddShort(this->character->maxdam);
+			builder.AddShort(this->character->accuracy);
+			builder.AddShort(this->character->evade);
+			builder.AddShort(this->character->armor);
+
 			this->character->Send(builder);
 		}
-	}
-	else if (function_name == "setclass")
-	{
-		this->character->clas = int(action.expr.args[0]);
+		break;
 
-		this->character->CalculateStats();
+		case QUEST_ACTION_SETRACE:
+		{
+			this->character->race = Skin(action.expr.int_args[0]);
+			this->character->Warp(this->character->map->id, this->character->x, this->character->y);
+		}
+		break;
 
-		PacketBuilder builder(PACKET_RECOVER, PACKET_LIST, 32);
+		case QUEST_ACTION_REMOVEKARMA:
+		{
+			this->character->karma -= action.expr.int_args[0];
 
-		builder.AddShort(this->character->clas);
-		builder.AddShort(this->character->display_str);
-		builder.AddShort(this->character->display_intl);
-		builder.AddShort(this->character->display_wis);
-		builder.AddShort(this->character->display_agi);
-		builder.AddShort(this->character->display_con);
-		builder.AddShort(this->character->display_cha);
-		builder.AddShort(this->character->maxhp);
-		builder.AddShort(this->character->maxtp);
-		builder.AddShort(this->character->maxsp);
-		builder.AddShort(this->character->maxweight);
-		builder.AddShort(this->character->mindam);
-		builder.AddShort(this->character->maxdam);
-		builder.AddShort(this->character->accuracy);
-		builder.AddShort(this->character->evade);
-		builder.AddShort(this->character->armor);
-
-		this->character->Send(builder);
-	}
-	else if (function_name == "setrace")
-	{
-		this->character->race = Skin(int(action.expr.args[0]));
-		this->character->Warp(this->character->map->id, this->character->x, this->character->y);
-	}
-	else if (function_name == "removekarma")
-	{
-		this->character->karma -= int(action.expr.args[0]);
+			if (this->character->karma < 0)
+				this->character->karma = 0;
 
-		if (this->character->karma < 0)
-			this->character->karma = 0;
+			PacketBuilder builder(PACKET_RECOVER, PACKET_REPLY, 7);
+			builder.AddInt(this->character->exp);
+			builder.AddShort(this->character->karma);
+			builder.AddChar(0);
+			this->character->Send(builder);
+		}
+		break;
 
-		PacketBuilder builder(PACKET_RECOVER, PACKET_REPLY, 7);
-		builder.AddInt(this->character->exp);
-		builder.AddShort(this->character->karma);
-		builder.AddChar(0);
-		this->character->Send(builder);
-	}
-	else if (function_name == "givekarma")
-	{
-		this->character->karma += int(action.expr.args[0]);
+		case QUEST_ACTION_GIVEKARMA:
+		{
+			this->character->karma += action.expr.int_args[0];
 
-		if (this->character->karma > 2000)
-			this->character->karma = 2000;
+			if (this->character->karma > 2000)
+				this->character->karma = 2000;
 
-		PacketBuilder builder(PACKET_RECOVER, PACKET_REPLY, 7);
-		builder.AddInt(this->character->exp);
-		builder.AddShort(this->character->karma);
-		builder.AddChar(0);
-		this->character->Send(builder);
-	}
-	else if (function_name == "settitle")
-	{
-		this->character->title = std::string(action.expr.args[0]);
-		this->character->title = this->character->title.substr(0, 32);
-	}
-	else if (function_name == "setfiance")
-	{
-		this->character->fiance = std::string(action.expr.args[0]);
-		this->character->fiance = this->character->fiance.substr(0, 16);
-	}
-	else if (function_name == "setpartner")
-	{
-		this->character->partner = std::string(action.expr.args[0]);
-		this->character->partner = this->character->partner.substr(0, 16);
-	}
-	else if (function_name == "sethome")
-	{
-		this->character->home = std::string(action.expr.args[0]);
-		this->character->home = this->character->home.substr(0, 32);
-	}
-	else if (function_name == "setstat")
-	{
-		std::string stat = action.expr.args[0];
-		int value = action.expr.args[1];
+			PacketBuilder builder(PACKET_RECOVER, PACKET_REPLY, 7);
+			builder.AddInt(this->character->exp);
+			builder.AddShort(this->character->karma);
+			builder.AddChar(0);
+			this->character->Send(builder);
+		}
+		break;
 
-		if (!modify_stat(stat, [value](int) { return value; }, this->character))
-			throw EOPlus::Runtime_Error("Unknown stat: " + stat);
-	}
-	else if (function_name == "givestat")
-	{
-		std::string stat = action.expr.args[0];
-		int value = action.expr.args[1];
+		case QUEST_ACTION_SETTITLE:
+		{
+			this->character->title = std::string(action.expr.args[0]);
+			this->character->title = this->character->title.substr(0, 32);
+		}
+		break;
 
-		if (!modify_stat(stat, [value](int x) { return x + value; }, this->character))
-			throw EOPlus::Runtime_Error("Unknown stat: " + stat);
-	}
-	else if (function_name == "removestat")
-	{
-		std::string stat = action.expr.args[0];
-		int value = action.expr.args[1];
+		case QUEST_ACTION_SETFIANCE:
+		{
+			this->character->fiance = std::string(action.expr.args[0]);
+			this->character->fiance = this->character->fiance.substr(0, 16);
+		}
+		break;
 
-		if (!modify_stat(stat, [value](int x) { return x - value; }, this->character))
-			throw EOPlus::Runtime_Error("Unknown stat: " + stat);
-	}
-	else if (function_name == "roll")
-	{
-		this->progress["r"] = util::rand(1, int(action.expr.args[0]));
+		case QUEST_ACTION_SETPARTNER:
+		{
+			this->character->partner = std::string(action.expr.args[0]);
+			this->character->partner = this->character->partner.substr(0, 16);
+		}
+		break;
+
+		case QUEST_ACTION_SETHOME:
+		{
+			this->character->home = std::string(action.expr.args[0]);
+			this->character->home = this->character->home.substr(0, 32);
+		}
+		break;
+
+		case QUEST_ACTION_SETSTAT:
+		{
+			std::string stat = action.expr.args[0];
+			int value = action.expr.int_args[1];
+
+			if (!modify_stat(stat, [value](int) { return value; }, this->character))
+				throw EOPlus::Runtime_Error("Unknown stat: " + stat);
+		}
+		break;
+
+		case QUEST_ACTION_GIVESTAT:
+		{
+			std::string stat = action.expr.args[0];
+			int value = action.expr.int_args[1];
+
+			if (!modify_stat(stat, [value](int x) { return x + value; }, this->character))
+				throw EOPlus::Runtime_Error("Unknown stat: " + stat);
+		}
+		break;
+
+		case QUEST_ACTION_REMOVESTAT:
+		{
+			std::string stat = action.expr.args[0];
+			int value = action.expr.int_args[1];
+
+			if (!modify_stat(stat, [value](int x) { return x - value; }, this->character))
+				throw EOPlus::Runtime_Error("Unknown stat: " + stat);
+		}
+		break;
+
+		case QUEST_ACTION_ROLL:
+		{
+			this->progress["r"] = util::rand(1, action.expr.int_args[0]);
+		}
+		break;
 	}
 
 	return false;
@@ -781,119 +1005,101 @@ bool Quest_Context::CheckRule(const EOPlus::Expression& expr)
 	if (this->quest->Disabled())
 		return false;
 
-	std::string function_name = expr.function;
-
-	if (function_name == "always")
-	{
-		return true;
-	}
-	else if (function_name == "donedaily")
-	{
-		if (this->progress["d"] == quest_day())
-		{
-			return this->progress["c"] >= int(expr.args[0]);
-		}
-		else
-		{
-			this->progress["d"] = quest_day();
-			this->progress["c"] = 0;
-			return false;
-		}
-	}
-	else if (function_name == "entermap")
+	switch (expr.opcode)
 	{
-		return this->character->map->id == int(expr.args[0]);
-	}
-	else if (function_name == "entercoord")
-	{
-		return this->character->map->id == int(expr.args[0])
-		    && this->character->x == int(expr.args[1])
-		    && this->character->y == int(expr.args[2]);
-	}
-	else if (function_name == "leavemap")
-	{
-		return this->character->map->id != int(expr.args[0]);
-	}
-	else if (function_name == "leavecoord")
-	{
-		return this->character->map->id != int(expr.args[0])
-		    || this->character->x != int(expr.args[1])
-		    || this->character->y != int(expr.args[2]);
-	}
-	else if (function_name == "gotitems")
-	{
-		return this->character->HasItem(int(expr.args[0])) >= (expr.args.size() >= 2 ? int(expr.args[1]) : 1);
-	}
-	else if (function_name == "lostitems")
-	{
-		return this->character->HasItem(int(expr.args[0])) < (expr.args.size() >= 2 ? int(expr.args[1]) : 1);
-	}
-	else if (function_name == "gotspell")
-	{
-		return this->character->HasSpell(int(expr.args[0]))
-		    && (expr.args.size() < 2 || this->character->SpellLevel(int(expr.args[0])) >= int(expr.args[1]));
-	}
-	else if (function_name == "lostspell")
-	{
-		return !this->character->HasSpell(int(expr.args[0]));
-	}
-	else if (function_name == "isgender")
-	{
-		return this->character->gender == Gender(int(expr.args[0]));
-	}
-	else if (function_name == "isclass")
-	{
-		return this->character->clas == int(expr.args[0]);
-	}
-	else if (function_name == "israce")
-	{
-		return this->character->race == int(expr.args[0]);
-	}
-	else if (function_name == "iswearing")
-	{
-		return std::find(UTIL_CRANGE(this->character->paperdoll), int(expr.args[0])) != this->character->paperdoll.end();
-	}
-	else if (function_name == "citizenof")
-	{
-		return this->character->home == std::string(expr.args[0]);
-	}
-	else if (function_name == "rolled")
-	{
-		int roll = this->progress["r"];
+		case QUEST_RULE_ALWAYS:
+			return true;
 
-		if (expr.args.size() < 2)
+		case QUEST_RULE_DONEDAILY:
 		{
-			return roll == int(expr.args[0]);
+			if (this->progress["d"] == quest_day())
+			{
+				return this->progress["c"] >= expr.int_args[0];
+			}
+			else
+			{
+				this->progress["d"] = quest_day();
+				this->progress["c"] = 0;
+				return false;
+			}
 		}
-		else
+
+		case QUEST_RULE_ENTERMAP:
+			return this->character->map->id == expr.int_args[0];
+
+		case QUEST_RULE_ENTERCOORD:
+			return this->character->map->id == expr.int_args[0]
+			    && this->character->x == expr.int_args[1]
+			    && this->character->y == expr.int_args[2];
+
+		case QUEST_RULE_LEAVEMAP:
+			return this->character->map->id != expr.int_args[0];
+
+		case QUEST_RULE_LEAVECOORD:
+			return this->character->map->id != expr.int_args[0]
+			    || this->character->x != expr.int_args[1]
+			    || this->character->y != expr.int_args[2];
+
+		case QUEST_RULE_GOTITEMS:
+			return this->character->HasItem(expr.int_args[0]) >= (expr.args.size() >= 2 ? expr.int_args[1] : 1);
+
+		case QUEST_RULE_LOSTITEMS:
+			return this->character->HasItem(expr.int_args[0]) < (expr.args.size() >= 2 ? expr.int_args[1] : 1);
+
+		case QUEST_RULE_GOTSPELL:
+			return this->character->HasSpell(expr.int_args[0])
+			    && (expr.args.size() < 2 || this->character->SpellLevel(expr.int_args[0]) >= expr.int_args[1]);
+
+		case QUEST_RULE_LOSTSPELL:
+			return !this->character->HasSpell(expr.int_args[0]);
+
+		case QUEST_RULE_ISGENDER:
+			return this->character->gender == Gender(expr.int_args[0]);
+
+		case QUEST_RULE_ISCLASS:
+			return this->character->clas == expr.int_args[0];
+
+		case QUEST_RULE_ISRACE:
+			return this->character->race == expr.int_args[0];
+
+		case QUEST_RULE_ISWEARING:
+			return std::find(UTIL_CRANGE(this->character->paperdoll), expr.int_args[0]) != this->character->paperdoll.end();
+
+		case QUEST_RULE_CITIZENOF:
+			return this->character->home == std::string(expr.args[0]);
+
+		case QUEST_RULE_ROLLED:
 		{
-			return roll >= int(expr.args[0])
-			    && roll <= int(expr.args[1]);
+			int roll = this->progress["r"];
+
+			if (expr.args.size() < 2)
+			{
+				return roll == expr.int_args[0];
+			}
+			else
+			{
+				return roll >= expr.int_args[0]
+				    && roll <= expr.int_args[1];
+			}
 		}
-	}
-	else if (function_name == "statis")
-	{
-		return rpn_char_eval({expr.args[1], expr.args[0], "="}, character);
-	}
-	else if (function_name == "statnot")
-	{
-		return rpn_char_eval({expr.args[1], expr.args[0], "="}, character);
-	}
-	else if (function_name == "statgreater")
-	{
-		return rpn_char_eval({expr.args[1], expr.args[0], ">"}, character);
-	}
-	else if (function_name == "statless")
-	{
-		return rpn_char_eval({expr.args[1], expr.args[0], "<"}, character);
-	}
-	else if (function_name == "statbetween")
-	{
-		return rpn_char_eval({expr.args[1], expr.args[0], "gte", expr.args[2], expr.args[0], "lte", "&"}, character);
-	}
-	else if (function_name == "statrpn")
-	{
-		return rpn_char_eval(rpn_parse(expr.args[0]), character);
+
+		case QUEST_RULE_STATIS:
+			return rpn_char_eval({expr.args[1], expr.args[0], "="}, character);
+
+		case QUEST_RULE_STATNOT:
+			return rpn_char_eval({expr.args[1], expr.args[0], "="}, character);
+
+		case QUEST_RULE_STATGREATER:
+			return rpn_char_eval({expr.args[1], expr.args[0], ">"}, character);
+
+		case QUEST_RULE_STATLESS:
+			return rpn_char_eval({expr.args[1], expr.args[0], "<"}, character);
+
+		case QUEST_RULE_STATBETWEEN:
+			return rpn_char_eval({expr.args[1], expr.args[0], "gte", expr.args[2], expr.args[0], "lte", "&"}, character);
+
+		case QUEST_RULE_STATRPN:
+			return rpn_char_eval(rpn_parse(expr.args[0]), character);
 	}
 
 	return false;
@@ -934,33 +1140,42 @@ Quest_Context::ProgressInfo Quest_Context::Progress() const
 
 	if (goal)
 	{
-		if (goal->expr.function == "gotitems" || goal->expr.function == "gotspell")
-		{
-			icon = BOOK_ICON_ITEM;
-			goal_progress = std::min<int>(goal->expr.args[1], this->character->HasItem(int(goal->expr.args[0])));
-			goal_goal = goal->expr.args.size() >= 2 ? int(goal->expr.args[1]) : 1;
-		}
-		else if (goal->expr.function == "useditem" || goal->expr.function == "usedspell")
-		{
-			icon = BOOK_ICON_ITEM;
-			goal_progress_key = goal->expr.function + "/" + std::string(goal->expr.args[0]);
-			goal_goal = goal->expr.args.size() >= 2 ? int(goal->expr.args[1]) : 1;
-		}
-		else if (goal->expr.function == "killednpcs")
-		{
-			icon = BOOK_ICON_KILL;
-			goal_progress_key = goal->expr.function + "/" + std::string(goal->expr.args[0]);
-			goal_goal = goal->expr.args.size() >= 2 ? int(goal->expr.args[1]) : 1;
-		}
-		else if (goal->expr.function == "killedplayers")
-		{
-			icon = BOOK_ICON_KILL;
-			goal_progress_key = goal->expr.function;
-			goal_goal = int(goal->expr.args[0]);
-		}
-		else if (goal->expr.function == "entercoord" || goal->expr.function == "leavecoord" || goal->expr.function == "entermap" || goal->expr.function == "leavemap")
+		const EOPlus::Expression& expr = goal->expr;
+
+		switch (expr.opcode)
 		{
-			icon = BOOK_ICON_STEP;
+			case QUEST_RULE_GOTITEMS:
+			case QUEST_RULE_GOTSPELL:
+				icon = BOOK_ICON_ITEM;
+				goal_goal = expr.int_args.size() >= 2 ? expr.int_args[1] : 1;
+				goal_progress = std::min<int>(goal_goal, this->character->HasItem(expr.int_args[0]));
+				break;
+
+			case QUEST_RULE_USEDITEM:
+			case QUEST_RULE_USEDSPELL:
+				icon = BOOK_ICON_ITEM;
+				goal_progress_key = expr.function + "/" + std::string(expr.args[0]);
+				goal_goal = expr.int_args.size() >= 2 ? expr.int_args[1] : 1;
+				break;
+
+			case QUEST_RULE_KILLEDNPCS:
+				icon = BOOK_ICON_KILL;
+				goal_progress_key = expr.function + "/" + std::string(expr.args[0]);
+				goal_goal = expr.int_args.size() >= 2 ? expr.int_args[1] : 1;
+				break;
+
+			case QUEST_RULE_KILLEDPLAYERS:
+				icon = BOOK_ICON_KILL;
+				goal_progress_key = expr.function;
+				goal_goal = expr.int_args[0];
+				break;
+
+			case QUEST_RULE_ENTERCOORD:
+			case QUEST_RULE_LEAVECOORD:
+			case QUEST_RULE_ENTERMAP:
+			case QUEST_RULE_LEAVEMAP:
+				icon = BOOK_ICON_STEP;
+				break;
 		}
 	}
 
@@ -1051,7 +1266,7 @@ bool Quest_Context::DialogInput(char link_id)
 	if (this->quest->Disabled())
 		return false;
 
-	return this->TriggerRule("inputnpc", [link_id](const std::deque<util::variant>& args) { return int(args[0]) == link_id; });
+	return this->TriggerRule(QUEST_RULE_INPUTNPC, [link_id](const std::vector<int>& args) { return args[0] == link_id; });
 }
 
 bool Quest_Context::TalkedNPC(short vendor_id)
@@ -1059,7 +1274,7 @@ bool Quest_Context::TalkedNPC(short vendor_id)
 	if (this->quest->Disabled())
 		return false;
 
-	return this->TriggerRule("talkedtonpc", [vendor_id](const std::deque<util::variant>& args) { return int(args[0]) == vendor_id; });
+	return this->TriggerRule(QUEST_RULE_TALKEDTONPC, [vendor_id](const std::vector<int>& args) { return args[0] == vendor_id; });
 }
 
 void Quest_Context::UsedItem(short id)
@@ -1067,13 +1282,13 @@ void Quest_Context::UsedItem(short id)
 	if (this->quest->Disabled())
 		return;
 
-	bool check = this->QueryRule("useditem", [id](const std::deque<util::variant>& args) { return int(args[0]) == id; });
+	bool check = this->QueryRule(QUEST_RULE_USEDITEM, [id](const std::vector<int>& args) { return args[0] == id; });
 	short amount = 0;
 
 	if (check)
 		amount = ++this->progress["useditem/" + util::to_string(id)];
 
-	if (this->TriggerRule("useditem", [id, amount](const std::deque<util::variant>& args) { return int(args[0]) == id && amount >= int(args[1]); }))
+	if (this->TriggerRule(QUEST_RULE_USEDITEM, [id, amount](const std::vector<int>& args) { return args[0] == id && amount >= (args.size() >= 2 ? args[1] : 1); }))
 		this->progress.erase("useditem/" + util::to_string(id));
 }
 
@@ -1082,13 +1297,13 @@ void Quest_Context::UsedSpell(short id)
 	if (this->quest->Disabled())
 		return;
 
-	bool check = this->QueryRule("usedspell", [id](const std::deque<util::variant>& args) { return int(args[0]) == id; });
+	bool check = this->QueryRule(QUEST_RULE_USEDSPELL, [id](const std::vector<int>& args) { return args[0] == id; });
 	short amount = 0;
 
 	if (check)
 		amount = ++this->progress["usedspell/" + util::to_string(id)];
 
-	if (this->TriggerRule("usedspell", [id, amount](const std::deque<util::variant>& args) { return int(args[0]) == id && amount >= int(args[1]); }))
+	if (this->TriggerRule(QUEST_RULE_USEDSPELL, [id, amount](const std::vector<int>& args) { return args[0] == id && amount >= (args.size() >= 2 ? args[1] : 1); }))
 		this->progress.erase("usedspell/" + util::to_string(id));
 }
 
@@ -1097,13 +1312,13 @@ void Quest_Context::KilledNPC(short id)
 	if (this->quest->Disabled())
 		return;
 
-	bool check = this->QueryRule("killednpcs", [id](const std::deque<util::variant>& args) { return int(args[0]) == id; });
+	bool check = this->QueryRule(QUEST_RULE_KILLEDNPCS, [id](const std::vector<int>& args) { return args[0] == id; });
 	short amount = 0;
 
 	if (check)
 		amount = ++this->progress["killednpcs/" + util::to_string(id)];
 
-	if (this->TriggerRule("killednpcs", [id, amount](const std::deque<util::variant>& args) { return int(args[0]) == id && amount >= int(args[1]); }))
+	if (this->TriggerRule(QUEST_RULE_KILLEDNPCS, [id, amount](const std::vector<int>& args) { return args[0] == id && amount >= (args.size() >= 2 ? args[1] : 1); }))
 		this->progress.erase("killednpcs/" + util::to_string(id));
 }
 
@@ -1112,13 +1327,13 @@ void Quest_Context::KilledPlayer()
 	if (this->quest->Disabled())
 		return;
 
-	bool check = this->QueryRule("killedplayers");
+	bool check = this->QueryRule(QUEST_RULE_KILLEDPLAYERS);
 	short amount = 0;
 
 	if (check)
 		amount = ++this->progress["killedplayers"];
 
-	if (this->TriggerRule("killedplayers", [amount](const std::deque<util::variant>& args) { return amount >= int(args[0]); }))
+	if (this->TriggerRule(QUEST_RULE_KILLEDPLAYERS, [amount](const std::vector<int>& args) { return amount >= args[0]; }))
 		this->progress.erase("killedplayers");
 }
 
@@ -1131,5 +1346,5 @@ bool Quest_Context::IsHidden() const
 
 Quest_Context::~Quest_Context()
 {
-
+	this->ClearTriggers();
 }
@@ -13,10 +13,12 @@
 #include "fwd/dialog.hpp"
 #include "fwd/world.hpp"
 #include "eoplus/context.hpp"
+#include "quest_index.hpp"
 
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 class Quest
 {
@@ -58,8 +60,15 @@ class Quest_Context : public EOPlus::Context
 
 		std::map<std::string, short> progress;
 
+		// Entries this context has added to World::quest_triggers
+		std::vector<QuestTriggerIndex::Key> triggers;
+
+		void AddTrigger(QuestTriggerIndex::Trigger trigger, int id);
+		void ClearTriggers(bool keep_dialogs = false);
+
 	protected:
 		void BeginState(const std::string& name, const EOPlus::State& state);
+		void EndState();
 		bool DoAction(const EOPlus::Action& action);
 		bool CheckRule(const EOPlus::Expression& expr);
 
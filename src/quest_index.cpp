@@ -0,0 +1,73 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "quest_index.hpp"
+
+#include "character.hpp"
+#include "quest.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+std::size_t QuestTriggerIndex::KeyHash::operator()(const Key &key) const
+{
+	std::size_t hash = std::hash<Character *>()(key.character);
+	hash ^= (std::size_t(key.trigger) << 24 ^ std::size_t(key.id)) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	return hash;
+}
+
+void QuestTriggerIndex::Add(const Key &key, short quest_id, Quest_Context *context)
+{
+	this->index[key].push_back(std::make_pair(quest_id, context));
+}
+
+void QuestTriggerIndex::Remove(const Key &key, Quest_Context *context)
+{
+	auto it = this->index.find(key);
+
+	if (it == this->index.end())
+		return;
+
+	Entries &entries = it->second;
+
+	entries.erase(std::remove_if(entries.begin(), entries.end(), [context](const std::pair<short, Quest_Context *> &entry)
+	{
+		return entry.second == context;
+	}), entries.end());
+
+	if (entries.empty())
+		this->index.erase(it);
+}
+
+void QuestTriggerIndex::Dispatch(Character *character, Trigger trigger, int id, const std::function<void(Quest_Context &)> &f) const
+{
+	auto it = this->index.find(Key{character, trigger, id});
+
+	if (it == this->index.end())
+		return;
+
+	// f can add and remove entries, including these ones
+	Entries entries = it->second;
+
+	for (const auto &entry : entries)
+	{
+		std::shared_ptr<Quest_Context> context = character->GetQuest(entry.first);
+
+		if (context.get() != entry.second || context->GetQuest()->Disabled())
+			continue;
+
+		f(*context);
+	}
+}
+
+std::size_t QuestTriggerIndex::Size() const
+{
+	return this->index.size();
+}
@@ -0,0 +1,73 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#ifndef QUEST_INDEX_HPP_INCLUDED
+#define QUEST_INDEX_HPP_INCLUDED
+
+#include "fwd/character.hpp"
+#include "fwd/quest.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Index from a character's quest event about a specific NPC, item or spell to the quests whose current state reacts to it.
+ * Quest_Context adds and removes its own entries as it enters and leaves states.
+ */
+class QuestTriggerIndex
+{
+	public:
+		enum Trigger : unsigned char
+		{
+			Dialog,       // AddNpcText, AddNpcInput (vendor ID)
+			KilledNPC,    // KilledNpcs (NPC ID)
+			KilledPlayer, // KilledPlayers (always ID 0)
+			UsedItem,     // UsedItem (item ID)
+			UsedSpell,    // UsedSpell (spell ID)
+			Item,         // GotItems, LostItems (item ID)
+			Inventory     // IsWearing, and Stat* rules on weight, checked on any inventory change (always ID 0)
+		};
+
+		struct Key
+		{
+			Character *character;
+			Trigger trigger;
+			int id;
+
+			bool operator==(const Key &other) const
+			{
+				return this->character == other.character && this->trigger == other.trigger && this->id == other.id;
+			}
+		};
+
+	private:
+		struct KeyHash
+		{
+			std::size_t operator()(const Key &key) const;
+		};
+
+		// The context pointer is only compared, never followed, it tells a removed context apart from a newer one with the same quest ID
+		typedef std::vector<std::pair<short, Quest_Context *>> Entries;
+
+		std::unordered_map<Key, Entries, KeyHash> index;
+
+	public:
+		void Add(const Key &key, short quest_id, Quest_Context *context);
+		void Remove(const Key &key, Quest_Context *context);
+
+		/**
+		 * Calls f for every enabled quest of character whose state reacts to the trigger for this ID.
+		 * Quests may change state or be removed by f.
+		 */
+		void Dispatch(Character *character, Trigger trigger, int id, const std::function<void(Quest_Context &)> &f) const;
+
+		std::size_t Size() const;
+};
+
+#endif // QUEST_INDEX_HPP_INCLUDED
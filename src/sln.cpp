@@ -13,6 +13,7 @@
 
 #include "console.hpp"
 #include "nanohttp.hpp"
+#include "util/async.hpp"
 
 #include <cmath>
 #include <stdexcept>
@@ -173,8 +174,8 @@ void* SLN::RequestThread(void* void_request)
 	}
 
 end:
-	TimeEvent* event = new TimeEvent(SLN::TimedCleanup, request, 0.0, 1);
-	request->sln->server->world->timer.Register(event);
+	// The cleanup touches the timer and server, so it has to run on the main thread
+	AsyncCompletionQueue::Post([request]() { SLN::TimedCleanup(request); });
 
 	return 0;
 }
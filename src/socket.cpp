@@ -13,10 +13,13 @@
 #include "util.hpp"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
 #include <ctime>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -225,9 +228,21 @@ struct Client::impl_
 	SOCKET sock;
 	sockaddr_in sin;
 
+	// Edge-triggered readiness state, only used by the epoll backend
+	bool registered;
+	bool readable;
+	bool writable;
+	bool ready;
+	std::atomic<bool> send_queued;
+
 	impl_(const SOCKET &sock = SOCKET(), const sockaddr_in &sin = sockaddr_in())
 		: sock(sock)
 		, sin(sin)
+		, registered(false)
+		, readable(false)
+		, writable(false)
+		, ready(false)
+		, send_queued(false)
 	{ }
 };
 
@@ -237,12 +252,6 @@ Client::Client()
 	, server(0)
 	, connected(false)
 	, connect_time(0)
-	, recv_buffer_gpos(0)
-	, recv_buffer_ppos(0)
-	, recv_buffer_used(0)
-	, send_buffer_gpos(0)
-	, send_buffer_ppos(0)
-	, send_buffer_used(0)
 { }
 
 Client::Client(const IPAddress &addr, uint16_t port)
@@ -251,12 +260,6 @@ Client::Client(const IPAddress &addr, uint16_t port)
 	, server(0)
 	, connected(false)
 	, connect_time(0)
-	, recv_buffer_gpos(0)
-	, recv_buffer_ppos(0)
-	, recv_buffer_used(0)
-	, send_buffer_gpos(0)
-	, send_buffer_ppos(0)
-	, send_buffer_used(0)
 {
 	this->Connect(addr, port);
 }
@@ -267,12 +270,6 @@ Client::Client(Server *server)
 	, server(server)
 	, connected(false)
 	, connect_time(0)
-	, recv_buffer_gpos(0)
-	, recv_buffer_ppos(0)
-	, recv_buffer_used(0)
-	, send_buffer_gpos(0)
-	, send_buffer_ppos(0)
-	, send_buffer_used(0)
 { }
 
 Client::Client(const Socket &sock, Server *server)
@@ -281,35 +278,16 @@ Client::Client(const Socket &sock, Server *server)
 	, server(server)
 	, connected(true)
 	, connect_time(std::time(0))
-	, recv_buffer_gpos(0)
-	, recv_buffer_ppos(0)
-	, recv_buffer_used(0)
-	, send_buffer_gpos(0)
-	, send_buffer_ppos(0)
-	, send_buffer_used(0)
 { }
 
-inline void assert_power_of_two(std::size_t size)
-{
-	while ((size & 1) == 0)
-	{
-		size >>= 1;
-	}
-
-	if (size > 1)
-		throw std::runtime_error("Buffer size must be a power of two");
-}
-
 void Client::SetRecvBuffer(std::size_t size)
 {
-	assert_power_of_two(size);
-	this->recv_buffer.resize(size);
+	this->recv_buffer.Reset(size);
 }
 
 void Client::SetSendBuffer(std::size_t size)
 {
-	assert_power_of_two(size);
-	this->send_buffer.resize(size);
+	this->send_buffer.Reset(size);
 }
 
 bool Client::Connect(const IPAddress &addr, uint16_t port)
@@ -356,94 +334,95 @@ void Client::Bind(const IPAddress &addr, uint16_t port)
 
 std::string Client::Recv(std::size_t length)
 {
-	length = std::min(length, this->recv_buffer_used);
-
-	std::string ret(length, char());
+	std::string ret(std::min(length, this->recv_buffer.Size()), char());
 
-	const std::size_t mask = this->recv_buffer.length() - 1;
-
-	for (std::size_t i = 0; i < length; ++i)
-	{
-		this->recv_buffer_gpos = (this->recv_buffer_gpos + 1) & mask;
-		ret[i] = this->recv_buffer[this->recv_buffer_gpos];
-	}
-
-	this->recv_buffer_used -= length;
+	this->recv_buffer.Read(&ret[0], ret.length());
 
 	return ret;
 }
 
 void Client::Send(const std::string &data)
 {
-	if (data.length() > this->send_buffer.length() - this->send_buffer_used)
+	if (!this->send_buffer.Write(data.data(), data.length()))
 	{
 		this->Close(true);
 		return;
 	}
 
-	const std::size_t mask = this->send_buffer.length() - 1;
-
-	for (std::size_t i = 0; i < data.length(); ++i)
-	{
-		this->send_buffer_ppos = (this->send_buffer_ppos + 1) & mask;
-		this->send_buffer[this->send_buffer_ppos] = data[i];
-	}
+	this->QueueSend();
+}
 
-	this->send_buffer_used += data.length();
+void Client::QueueSend()
+{
+	if (this->server)
+		this->server->QueueSend(this);
 }
 
 bool Client::DoRecv()
 {
-	char buf[8192];
+	util::RingBuffer::Segments segments = this->recv_buffer.WriteSegments();
 
-	const int to_recv = std::min(this->recv_buffer.length() - this->recv_buffer_used, sizeof(buf));
-
-	if (to_recv == 0)
+	if (segments[0].length == 0)
 		return false;
 
-	const int recieved = recv(this->impl->sock, buf, to_recv, 0);
+#ifdef WIN32
+	WSABUF buffers[2] = {
+		{ static_cast<ULONG>(segments[0].length), segments[0].data },
+		{ static_cast<ULONG>(segments[1].length), segments[1].data }
+	};
+
+	DWORD recieved = 0;
+	DWORD flags = 0;
 
-	if (recieved > 0)
-	{
-		const std::size_t mask = this->recv_buffer.length() - 1;
+	if (WSARecv(this->impl->sock, buffers, segments[1].length > 0 ? 2 : 1, &recieved, &flags, 0, 0) == SOCKET_ERROR || recieved == 0)
+		return false;
+#else // WIN32
+	iovec buffers[2] = {
+		{ segments[0].data, segments[0].length },
+		{ segments[1].data, segments[1].length }
+	};
 
-		for (int i = 0; i < recieved; ++i)
-		{
-			this->recv_buffer_ppos = (this->recv_buffer_ppos + 1) & mask;
-			this->recv_buffer[this->recv_buffer_ppos] = buf[i];
-		}
+	const ssize_t recieved = readv(this->impl->sock, buffers, segments[1].length > 0 ? 2 : 1);
 
-		this->recv_buffer_used += recieved;
-	}
-	else
-	{
+	if (recieved <= 0)
 		return false;
-	}
+#endif // WIN32
+
+	this->recv_buffer.Commit(recieved);
 
 	return true;
 }
 
 bool Client::DoSend()
 {
-	char buf[8192];
+	util::RingBuffer::Segments segments = this->send_buffer.ReadSegments();
 
-	const std::size_t mask = this->send_buffer.length() - 1;
-	const std::size_t gpos = this->send_buffer_gpos;
+	if (segments[0].length == 0)
+		return true;
 
-	std::size_t to_send;
-	for (to_send = 0; to_send < std::min(this->send_buffer_used, sizeof(buf)); ++to_send)
-	{
-		this->send_buffer_gpos = (this->send_buffer_gpos + 1) & mask;
-		buf[to_send] = this->send_buffer[this->send_buffer_gpos];
-	}
+#ifdef WIN32
+	WSABUF buffers[2] = {
+		{ static_cast<ULONG>(segments[0].length), segments[0].data },
+		{ static_cast<ULONG>(segments[1].length), segments[1].data }
+	};
 
-	const int written = send(this->impl->sock, buf, to_send, 0);
+	DWORD written = 0;
 
-	if (written < 0 || written == SOCKET_ERROR)
+	if (WSASend(this->impl->sock, buffers, segments[1].length > 0 ? 2 : 1, &written, 0, 0, 0) == SOCKET_ERROR)
 		return false;
+#else // WIN32
+	iovec buffers[2] = {
+		{ segments[0].data, segments[0].length },
+		{ segments[1].data, segments[1].length }
+	};
 
-	this->send_buffer_gpos = (gpos + written) & mask;
-	this->send_buffer_used -= written;
+	const ssize_t written = writev(this->impl->sock, buffers, segments[1].length > 0 ? 2 : 1);
+
+	if (written < 0)
+		return false;
+#endif // WIN32
+
+	this->send_buffer.Consume(written);
 
 	return true;
 }
@@ -456,7 +435,7 @@ bool Client::Select(double timeout)
 	fd.fd = this->impl->sock;
 	fd.events = POLLIN;
 
-	if (this->send_buffer.length() > 0)
+	if (this->send_buffer.Capacity() > 0)
 	{
 		fd.events |= POLLOUT;
 	}
@@ -510,12 +489,12 @@ bool Client::Select(double timeout)
 	FD_ZERO(&write_fds);
 	FD_ZERO(&except_fds);
 
-	if (this->recv_buffer_used != this->recv_buffer.length())
+	if (!this->recv_buffer.Full())
 	{
 		FD_SET(this->impl->sock, &read_fds);
 	}
 
-	if (this->send_buffer_used > 0)
+	if (!this->send_buffer.Empty())
 	{
 		FD_SET(this->impl->sock, &write_fds);
 	}
@@ -605,6 +584,77 @@ Client::~Client()
 	this->Close(true);
 }
 
+#ifdef SOCKET_EPOLL
+struct Server::impl_
+{
+	SOCKET sock;
+	int epfd;
+
+	std::array<epoll_event, 1024> events;
+
+	// Clients with outstanding work, kept across calls to Select
+	std::vector<Client *> ready;
+	std::vector<Client *> selected;
+
+	// Clients with newly queued send data, possibly from another thread
+	std::mutex queued_mutex;
+	std::vector<Client *> queued;
+
+	impl_(const SOCKET &sock = INVALID_SOCKET)
+		: sock(sock)
+		, epfd(epoll_create1(EPOLL_CLOEXEC))
+	{
+		if (this->epfd == -1)
+			throw Socket_InitFailed(OSErrorString());
+	}
+
+	void Register(Client *client)
+	{
+		epoll_event ev;
+		ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+		ev.data.ptr = client;
+
+		fcntl(client->impl->sock, F_SETFL, fcntl(client->impl->sock, F_GETFL) | O_NONBLOCK);
+
+		if (epoll_ctl(this->epfd, EPOLL_CTL_ADD, client->impl->sock, &ev) == -1)
+			throw Socket_Exception(OSErrorString());
+
+		client->impl->registered = true;
+	}
+
+	void Unregister(Client *client)
+	{
+		if (!client->impl->registered)
+			return;
+
+		epoll_ctl(this->epfd, EPOLL_CTL_DEL, client->impl->sock, 0);
+		client->impl->registered = false;
+
+		if (client->impl->ready)
+			this->ready.erase(std::remove(UTIL_RANGE(this->ready), client), this->ready.end());
+
+		if (client->impl->send_queued)
+		{
+			std::lock_guard<std::mutex> lock(this->queued_mutex);
+			this->queued.erase(std::remove(UTIL_RANGE(this->queued), client), this->queued.end());
+		}
+	}
+
+	void MarkReady(Client *client)
+	{
+		if (!client->impl->ready)
+		{
+			client->impl->ready = true;
+			this->ready.push_back(client);
+		}
+	}
+
+	~impl_()
+	{
+		close(this->epfd);
+	}
+};
+#else // SOCKET_EPOLL
 struct Server::impl_
 {
 	fd_set read_fds;
@@ -615,7 +665,11 @@ struct Server::impl_
 	impl_(const SOCKET &sock = INVALID_SOCKET)
 		: sock(sock)
 	{ }
+
+	void Register(Client *) { }
+	void Unregister(Client *) { }
 };
+#endif // SOCKET_EPOLL
 
 Server::Server()
 	: impl(new impl_(socket(AF_INET, SOCK_STREAM, 0)))
@@ -736,6 +790,7 @@ Client *Server::Poll()
 			if (!client->accepted)
 			{
 				client->Close(true);
+				this->impl->Unregister(client);
 #ifdef WIN32
 				closesocket(client->impl->sock);
 #else // WIN32
@@ -764,12 +819,136 @@ Client *Server::Poll()
 	newclient->SetRecvBuffer(this->recv_buffer_max);
 	newclient->SetSendBuffer(this->send_buffer_max);
 
+	this->impl->Register(newclient);
 	this->clients.push_back(newclient);
 
 	return newclient;
 }
 
-#if defined(SOCKET_POLL) && !defined(WIN32)
+#if defined(SOCKET_EPOLL)
+void Server::QueueSend(Client *client)
+{
+	if (client->impl->registered && !client->impl->send_queued.exchange(true))
+	{
+		std::lock_guard<std::mutex> lock(this->impl->queued_mutex);
+		this->impl->queued.push_back(client);
+	}
+}
+
+static inline bool socket_would_block()
+{
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+std::vector<Client *> *Server::Select(double timeout)
+{
+	std::vector<Client *> &ready = this->impl->ready;
+	std::vector<Client *> &selected = this->impl->selected;
+
+	// Don't block waiting for new events if there is already work to do
+	const int timeout_ms = ready.empty() ? int(timeout * 1000) : 0;
+
+	int result = epoll_wait(this->impl->epfd, this->impl->events.data(), this->impl->events.size(), timeout_ms);
+
+	if (result == -1)
+	{
+		throw Socket_SelectFailed(OSErrorString());
+	}
+
+	for (int i = 0; i < result; ++i)
+	{
+		const epoll_event &ev = this->impl->events[i];
+		Client *client = static_cast<Client *>(ev.data.ptr);
+
+		if (ev.events & EPOLLERR || ev.events & EPOLLHUP)
+		{
+			client->Close(true);
+			continue;
+		}
+
+		if (ev.events & EPOLLIN)
+			client->impl->readable = true;
+
+		if (ev.events & EPOLLOUT)
+			client->impl->writable = true;
+
+		this->impl->MarkReady(client);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->impl->queued_mutex);
+
+		UTIL_FOREACH(this->impl->queued, client)
+		{
+			client->impl->send_queued = false;
+			this->impl->MarkReady(client);
+		}
+
+		this->impl->queued.clear();
+	}
+
+	std::size_t keep = 0;
+
+	for (std::size_t i = 0; i < ready.size(); ++i)
+	{
+		Client *client = ready[i];
+
+		// Edge-triggered: keep reading/writing until the socket would block
+		while (client->impl->readable && !client->recv_buffer.Full())
+		{
+			errno = 0;
+
+			if (!client->DoRecv())
+			{
+				if (socket_would_block())
+					client->impl->readable = false;
+				else
+					client->Close(true);
+
+				break;
+			}
+		}
+
+		while (client->impl->writable && !client->send_buffer.Empty())
+		{
+			errno = 0;
+
+			if (!client->DoSend())
+			{
+				if (socket_would_block())
+					client->impl->writable = false;
+				else
+					client->Close(true);
+
+				break;
+			}
+		}
+
+		const bool need_tick = !client->recv_buffer.Empty() || client->NeedTick();
+
+		if (need_tick)
+			selected.push_back(client);
+
+		if (need_tick
+		 || (client->impl->readable && client->recv_buffer.Full())
+		 || (client->impl->writable && !client->send_buffer.Empty()))
+		{
+			ready[keep++] = client;
+		}
+		else
+		{
+			client->impl->ready = false;
+		}
+	}
+
+	ready.resize(keep);
+
+	return &selected;
+}
+#elif defined(SOCKET_POLL) && !defined(WIN32)
+void Server::QueueSend(Client *)
+{ }
+
 std::vector<Client *> *Server::Select(double timeout)
 {
 	static std::vector<Client *> selected;
@@ -789,12 +968,12 @@ std::vector<Client *> *Server::Select(double timeout)
 
 		fd.events = 0;
 
-		if (client->recv_buffer_used != client->recv_buffer.length())
+		if (!client->recv_buffer.Full())
 		{
 			fd.events |= POLLIN;
 		}
 
-		if (client->send_buffer_used > 0)
+		if (!client->send_buffer.Empty())
 		{
 			fd.events |= POLLOUT;
 		}
@@ -848,7 +1027,7 @@ std::vector<Client *> *Server::Select(double timeout)
 
 	UTIL_FOREACH(this->clients, client)
 	{
-		if (client->recv_buffer_used > 0 || client->NeedTick())
+		if (!client->recv_buffer.Empty() || client->NeedTick())
 		{
 			selected.push_back(client);
 		}
@@ -857,6 +1036,9 @@ std::vector<Client *> *Server::Select(double timeout)
 	return &selected;
 }
 #else // defined(SOCKET_POLL) && !defined(WIN32)
+void Server::QueueSend(Client *)
+{ }
+
 std::vector<Client *> *Server::Select(double timeout)
 {
 	long tsecs = long(timeout);
@@ -871,12 +1053,12 @@ std::vector<Client *> *Server::Select(double timeout)
 
 	UTIL_FOREACH(this->clients, client)
 	{
-		if (client->recv_buffer_used != client->recv_buffer.length())
+		if (!client->recv_buffer.Full())
 		{
 			FD_SET(client->impl->sock, &this->impl->read_fds);
 		}
 
-		if (client->send_buffer_used > 0)
+		if (!client->send_buffer.Empty())
 		{
 			FD_SET(client->impl->sock, &this->impl->write_fds);
 		}
@@ -935,7 +1117,7 @@ std::vector<Client *> *Server::Select(double timeout)
 
 	UTIL_FOREACH(this->clients, client)
 	{
-		if (client->recv_buffer_used > 0 || client->NeedTick())
+		if (!client->recv_buffer.Empty() || client->NeedTick())
 		{
 			selected.push_back(client);
 		}
@@ -943,7 +1125,7 @@ std::vector<Client *> *Server::Select(double timeout)
 
 	return &selected;
 }
-#endif // defined(SOCKET_POLL) && !defined(WIN32)
+#endif // defined(SOCKET_EPOLL)
 
 void Server::BuryTheDead()
 {
@@ -951,8 +1133,9 @@ void Server::BuryTheDead()
 	{
 		Client *client = *it;
 
-		if (!client->Connected() && !client->IsAsyncOpPending() && ((client->send_buffer.length() == 0 && client->recv_buffer.length() == 0) || client->closed_time + 2 < std::time(0)))
+		if (!client->Connected() && !client->IsAsyncOpPending() && ((client->send_buffer.Capacity() == 0 && client->recv_buffer.Capacity() == 0) || client->closed_time + 2 < std::time(0)))
 		{
+			this->impl->Unregister(client);
 #ifdef WIN32
 			closesocket(client->impl->sock);
 #else // WIN32
@@ -970,6 +1153,7 @@ Server::~Server()
 {
 	UTIL_FOREACH(this->clients, client)
 	{
+		this->impl->Unregister(client);
 #ifdef WIN32
 		closesocket(client->impl->sock);
 #else // WIN32
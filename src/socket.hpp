@@ -9,6 +9,8 @@
 
 #include "fwd/socket.hpp"
 
+#include "util/ring_buffer.hpp"
+
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
@@ -233,15 +235,13 @@ class Client
 		std::time_t closed_time;
 		std::time_t connect_time;
 
-		std::string recv_buffer;
-		std::size_t recv_buffer_gpos;
-		std::size_t recv_buffer_ppos;
-		std::size_t recv_buffer_used;
+		util::RingBuffer recv_buffer;
+		util::RingBuffer send_buffer;
 
-		std::string send_buffer;
-		std::size_t send_buffer_gpos;
-		std::size_t send_buffer_ppos;
-		std::size_t send_buffer_used;
+		/**
+		 * Notifies the server that data has been written in to send_buffer.
+		 */
+		void QueueSend();
 
 	public:
 		Client();
@@ -257,8 +257,8 @@ class Client
 		bool Connect(const IPAddress &addr, std::uint16_t port);
 		void Bind(const IPAddress &addr, std::uint16_t port);
 
-		std::size_t RecvBufferRemaining() { return this->recv_buffer.length() - this->recv_buffer_used; }
-		std::size_t SendBufferRemaining() { return this->send_buffer.length() - this->send_buffer_used; }
+		std::size_t RecvBufferRemaining() { return this->recv_buffer.Free(); }
+		std::size_t SendBufferRemaining() { return this->send_buffer.Free(); }
 
 		std::string Recv(std::size_t length);
 		void Send(const std::string &data);
@@ -321,6 +321,12 @@ class Server
 
 		impl_ *impl;
 
+		/**
+		 * Notifies the readiness backend that a client has new data in its send_buffer.
+		 * Safe to call from any thread.
+		 */
+		void QueueSend(Client *client);
+
 	protected:
 		virtual Client *ClientFactory(const Socket &sock) { return new Client(sock, this); }
 
@@ -409,6 +415,7 @@ class Server
 		/**
 		 * Check clients for incoming data and errors, and sends data in their send_buffer.
 		 * If data is recieved, it is added to their recv_buffer.
+		 * With the epoll backend only clients which have been reported ready are visited.
 		 * @param timeout Max number of seconds to block for
 		 * @throw Socket_SelectFailed
 		 * @throw Socket_Exception
@@ -438,6 +445,8 @@ class Server
 		}
 
 		virtual ~Server();
+
+	friend class Client;
 };
 
 
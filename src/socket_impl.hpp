@@ -35,14 +35,23 @@
 typedef int socklen_t;
 
 #else // WIN32
+// epoll is used on Linux unless a different backend is requested
+#if defined(__linux__) && !defined(SOCKET_POLL) && !defined(SOCKET_NO_EPOLL)
+#define SOCKET_EPOLL
+#endif // defined(__linux__) && !defined(SOCKET_POLL) && !defined(SOCKET_NO_EPOLL)
+
 // Stop doxygen generating a gigantic include graph
 #ifndef DOXYGEN
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #ifdef SOCKET_POLL
 #include <sys/poll.h>
 #endif // SOCKET_POLL
+#ifdef SOCKET_EPOLL
+#include <sys/epoll.h>
+#endif // SOCKET_EPOLL
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "ban_index.hpp"
+
+GTEST_TEST(BanIndexTests, CheckMatchesAnyGivenKey)
+{
+    BanIndex index;
+    index.Add(BanIndex::Ban{"banned", 0x0100007F, 1234, 0}, 100);
+
+    std::string username = "banned";
+    std::string other = "other";
+    int ip = 0x0100007F;
+    int hdid = 1234;
+    int other_hdid = 4321;
+
+    ASSERT_EQ(0, index.Check(&username, nullptr, nullptr, 100));
+    ASSERT_EQ(0, index.Check(nullptr, &ip, nullptr, 100));
+    ASSERT_EQ(0, index.Check(&other, nullptr, &hdid, 100));
+    ASSERT_EQ(-1, index.Check(&other, nullptr, &other_hdid, 100));
+    ASSERT_EQ(-1, index.Check(nullptr, nullptr, nullptr, 100));
+}
+
+GTEST_TEST(BanIndexTests, TemporaryBansExpire)
+{
+    BanIndex index;
+    index.Add(BanIndex::Ban{"short", 0, 0, 200}, 100);
+    index.Add(BanIndex::Ban{"short", 0, 0, 300}, 100);
+    index.Add(BanIndex::Ban{"expired", 0, 0, 50}, 100);
+
+    std::string username = "short";
+    std::string expired = "expired";
+
+    ASSERT_EQ(300, index.Check(&username, nullptr, nullptr, 100));
+    ASSERT_EQ(300, index.Check(&username, nullptr, nullptr, 250));
+    ASSERT_EQ(-1, index.Check(&username, nullptr, nullptr, 300));
+    ASSERT_EQ(-1, index.Check(&expired, nullptr, nullptr, 100));
+    ASSERT_EQ(0u, index.Size());
+}
+
+GTEST_TEST(BanIndexTests, PermanentBanOutlastsTemporaryBan)
+{
+    BanIndex index;
+    index.Add(BanIndex::Ban{"user", 0, 0, 0}, 100);
+    index.Add(BanIndex::Ban{"user", 0, 0, 200}, 100);
+
+    std::string username = "user";
+
+    ASSERT_EQ(0, index.Check(&username, nullptr, nullptr, 100));
+    ASSERT_EQ(0, index.Check(&username, nullptr, nullptr, 500));
+}
+
+GTEST_TEST(BanIndexTests, RefreshKeepsBansAddedWhileLoading)
+{
+    BanIndex index;
+    index.Add(BanIndex::Ban{"unbanned", 0, 0, 0}, 100);
+
+    index.BeginRefresh();
+    index.Add(BanIndex::Ban{"local", 0, 0, 0}, 100);
+
+    std::vector<BanIndex::Ban> loaded{BanIndex::Ban{"remote", 0, 0, 0}};
+    index.FinishRefresh(loaded, 100);
+
+    std::string unbanned = "unbanned";
+    std::string local = "local";
+    std::string remote = "remote";
+
+    ASSERT_FALSE(index.Refreshing());
+    ASSERT_EQ(-1, index.Check(&unbanned, nullptr, nullptr, 100));
+    ASSERT_EQ(0, index.Check(&local, nullptr, nullptr, 100));
+    ASSERT_EQ(0, index.Check(&remote, nullptr, nullptr, 100));
+}
+
+GTEST_TEST(BanIndexTests, LoadedOnlyOnceBansAreRead)
+{
+    BanIndex index;
+    index.Add(BanIndex::Ban{"local", 0, 0, 0}, 100);
+
+    ASSERT_FALSE(index.Loaded());
+
+    index.BeginRefresh();
+    index.AbortRefresh();
+
+    ASSERT_FALSE(index.Loaded());
+
+    index.BeginRefresh();
+    index.FinishRefresh(std::vector<BanIndex::Ban>(), 100);
+
+    ASSERT_TRUE(index.Loaded());
+}
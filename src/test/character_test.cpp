@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include "character.hpp"
+#include "packet.hpp"
+#include "player.hpp"
+#include "world.hpp"
+
+#include "testhelper/mocks.hpp"
+#include "testhelper/setup.hpp"
+
+#include "console.hpp"
+
+static std::unordered_map<std::string, util::variant> avatar_row()
+{
+    std::unordered_map<std::string, util::variant> row;
+    row["name"] = "avatar";
+    row["map"] = 1;
+    row["level"] = 5;
+    return row;
+}
+
+class CharacterAvatarTest : public WorldCharacterTest
+{
+public:
+    CharacterAvatarTest()
+        : WorldCharacterTest(avatar_row())
+    {
+        player->id = 7;
+    }
+
+protected:
+    // The avatar data as it was written field by field before it was cached
+    std::string Expected()
+    {
+        PacketBuilder builder;
+        builder.AddBreakString(character->SourceName());
+        builder.AddShort(character->PlayerID());
+        builder.AddShort(character->mapid);
+        builder.AddShort(character->x);
+        builder.AddShort(character->y);
+        builder.AddChar(character->direction);
+        builder.AddChar(6);
+        builder.AddString(character->PaddedGuildTag());
+        builder.AddChar(character->level);
+        builder.AddChar(character->gender);
+        builder.AddChar(character->hairstyle);
+        builder.AddChar(character->haircolor);
+        builder.AddChar(character->race);
+        builder.AddShort(character->maxhp);
+        builder.AddShort(character->hp);
+        builder.AddShort(character->maxtp);
+        builder.AddShort(character->tp);
+        character->AddPaperdollData(builder, "B000A0HSW");
+        builder.AddChar(character->sitting);
+        builder.AddChar(character->IsHideInvisible());
+        return builder.Get();
+    }
+
+    std::string Actual()
+    {
+        PacketBuilder builder;
+        character->AddAvatarData(builder);
+        return builder.Get();
+    }
+};
+
+TEST_F(CharacterAvatarTest, AddAvatarData_MatchesFieldByFieldSerialization)
+{
+    ASSERT_EQ(Expected(), Actual());
+    ASSERT_EQ(Expected(), Actual());
+}
+
+TEST_F(CharacterAvatarTest, AddAvatarData_RebuildsWhenCharacterChanges)
+{
+    Actual();
+
+    character->hp = 3;
+    character->x = 12;
+    character->paperdoll[Character::Hat] = 1;
+    character->faux_name = "disguise";
+    character->InvalidateAvatar();
+    ASSERT_EQ(Expected(), Actual());
+
+    character->hidden |= Character::HideInvisible;
+    character->sitting = SIT_FLOOR;
+    ASSERT_EQ(Expected(), Actual());
+}
+
+class CharacterSaveTest : public WorldCharacterTest
+{
+public:
+    CharacterSaveTest()
+        : WorldCharacterTest(avatar_row())
+    { }
+};
+
+TEST_F(CharacterSaveTest, TimedSave_SkipsIdleOnlineCharacter)
+{
+    world->characters.push_back(character.get());
+
+    character->last_save = std::make_shared<const Character_Save_Data>(character->SaveData());
+    auto last_save = character->last_save;
+
+    // Ten minutes online without doing anything
+    character->login_time -= 600;
+    ASSERT_NE(last_save->usage, character->SaveData().usage);
+
+    world->TimedSave();
+    world->WaitForSave();
+    ASSERT_EQ(last_save, character->last_save);
+
+    world->characters.clear();
+}
@@ -1,9 +1,12 @@
 #include <gtest/gtest.h>
 #include <thread>
 
+#include "config.hpp"
 #include "database.hpp"
 #include "console.hpp"
 
+#include "testhelper/mocks.hpp"
+
 static const char* TestDbPath = ":memory:";
 
 // Subclass that enables thread affinity checking for SQLite connections.
@@ -152,3 +155,195 @@ TEST_F(DatabaseThreadAffinityTest, SqliteConnect_SkipsThreadAffinity)
 
     EXPECT_TRUE(captured == nullptr) << "SQLite connections should be usable from any thread";
 }
+
+class DatabasePoolTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        Console::SuppressOutput(true);
+
+        config["DBType"] = "mysql";
+        config["DBPoolSize"] = 2;
+        config["DBPoolIdleTimeout"] = 300;
+        config["DBPoolCheckInterval"] = 60;
+        config["DBPoolWaitTimeout"] = 5;
+
+        EXPECT_CALL(factory, CreateDatabase(_, _))
+            .WillRepeatedly(Invoke([this](Unused, Unused)
+            {
+                ++created;
+                return std::make_shared<MockDatabase>(Database::MySQL);
+            }));
+    }
+
+    std::shared_ptr<Database> GetDatabaseOnNewThread()
+    {
+        std::shared_ptr<Database> database;
+        std::thread worker([this, &database]() { database = factory.GetDatabase(config); });
+        worker.join();
+        return database;
+    }
+
+    Config config;
+    MockDatabaseFactory factory;
+    int created = 0;
+};
+
+TEST_F(DatabasePoolTest, GetDatabase_SameThread_ReusesConnection)
+{
+    auto first = factory.GetDatabase(config);
+    auto second = factory.GetDatabase(config);
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(1, created);
+}
+
+TEST_F(DatabasePoolTest, GetDatabase_DifferentThreads_UseSeparateConnections)
+{
+    auto first = factory.GetDatabase(config);
+    auto second = GetDatabaseOnNewThread();
+
+    EXPECT_NE(first, second);
+    EXPECT_EQ(2, created);
+}
+
+TEST_F(DatabasePoolTest, GetDatabase_PoolFull_ReplacesUnusedConnection)
+{
+    config["DBPoolSize"] = 1;
+
+    factory.GetDatabase(config);
+    auto first = GetDatabaseOnNewThread();
+
+    EXPECT_NE(nullptr, first);
+    EXPECT_EQ(2, created);
+}
+
+TEST_F(DatabasePoolTest, GetDatabase_PoolFullAndInUse_FailsAfterWaiting)
+{
+    config["DBPoolSize"] = 1;
+    config["DBPoolWaitTimeout"] = 0.01;
+
+    auto first = factory.GetDatabase(config);
+
+    std::exception_ptr captured;
+    std::thread worker([this, &captured]()
+    {
+        try
+        {
+            factory.GetDatabase(config);
+        }
+        catch (...)
+        {
+            captured = std::current_exception();
+        }
+    });
+    worker.join();
+
+    EXPECT_THROW(std::rethrow_exception(captured), Database_OpenFailed);
+    EXPECT_EQ(1, created);
+}
+
+TEST_F(DatabasePoolTest, GetDatabase_PoolFullAndInUse_WaitsForRelease)
+{
+    config["DBPoolSize"] = 1;
+
+    auto first = factory.GetDatabase(config);
+
+    std::shared_ptr<Database> second;
+    std::thread worker([this, &second]() { second = factory.GetDatabase(config); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    first.reset();
+    worker.join();
+
+    EXPECT_NE(nullptr, second);
+    EXPECT_EQ(2, created);
+}
+
+TEST_F(DatabasePoolTest, GetDatabase_IdleConnection_IsReplaced)
+{
+    config["DBPoolIdleTimeout"] = 0;
+
+    factory.GetDatabase(config);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    factory.GetDatabase(config);
+
+    EXPECT_EQ(2, created);
+}
+
+TEST_F(DatabasePoolTest, ExpireIdle_ClosesOnlyUnusedConnections)
+{
+    config["DBPoolIdleTimeout"] = 0;
+
+    auto first = factory.GetDatabase(config);
+    std::weak_ptr<Database> second = GetDatabaseOnNewThread();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    factory.ExpireIdle(config);
+
+    EXPECT_TRUE(second.expired());
+
+    auto third = factory.GetDatabase(config);
+
+    EXPECT_EQ(first, third);
+    EXPECT_EQ(2, created);
+}
+
+TEST_F(DatabasePoolTest, GetDatabase_ClearPool_CreatesNewConnection)
+{
+    auto first = factory.GetDatabase(config);
+    factory.ClearPool();
+    auto second = factory.GetDatabase(config);
+
+    EXPECT_NE(first, second);
+    EXPECT_EQ(2, created);
+}
+
+class DatabaseStatementTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        Console::SuppressOutput(true);
+
+        db.Connect(Database::SQLite, TestDbPath, 0, "", "", "");
+        db.RawQuery("CREATE TABLE accounts (username TEXT, password TEXT, password_version INTEGER)");
+    }
+
+    Database db;
+};
+
+TEST_F(DatabaseStatementTest, Execute_BindsParametersWithoutEscaping)
+{
+    auto insert = db.Execute("INSERT INTO `accounts` (`username`, `password`, `password_version`) VALUES ('$', '$', #)", "o'brien", "$#@?", 2);
+    EXPECT_EQ(1, insert.AffectedRows());
+
+    auto res = db.Execute("SELECT `password`, `password_version` FROM `accounts` WHERE `username` = '$'", "o'brien");
+
+    ASSERT_EQ(1u, res.size());
+    EXPECT_EQ(std::vector<std::string>({ "password", "password_version" }), res.Columns());
+    EXPECT_EQ("$#@?", res[0][res.Column("password")].GetString());
+    EXPECT_EQ(2, res[0][res.Column("password_version")].GetInt());
+}
+
+TEST_F(DatabaseStatementTest, Execute_ReusesStatementWithNewParameters)
+{
+    const char *insert = "INSERT INTO `accounts` (`username`, `password`, `password_version`) VALUES ('$', '$', #)";
+    db.Execute(insert, "first", "a", 1);
+    db.Execute(insert, "second", "b", 2);
+
+    const char *select = "SELECT `username` FROM `accounts` WHERE `password_version` = #";
+    EXPECT_EQ("first", db.Execute(select, 1)[0][0].GetString());
+    EXPECT_EQ("second", db.Execute(select, 2)[0][0].GetString());
+    EXPECT_TRUE(db.Execute(select, 3).empty());
+}
+
+TEST_F(DatabaseStatementTest, Execute_RawSubstitution_Throws)
+{
+    EXPECT_THROW(db.Execute("SELECT * FROM @", "accounts"), Database_QueryFailed);
+}
+
+TEST_F(DatabaseStatementTest, Column_Unknown_Throws)
+{
+    auto res = db.Execute("SELECT `username` FROM `accounts`");
+    EXPECT_THROW(res.Column("password"), Database_QueryFailed);
+}
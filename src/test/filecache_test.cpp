@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "filecache.hpp"
+
+static const char *CacheTestFile = "filecache_test.emf";
+
+class FileCacheTest : public ::testing::Test
+{
+protected:
+    void WriteFile(const std::string& contents)
+    {
+        std::ofstream out(CacheTestFile, std::ios::binary | std::ios::trunc);
+        out << contents;
+    }
+
+    void TearDown() override
+    {
+        std::remove(CacheTestFile);
+    }
+};
+
+TEST_F(FileCacheTest, Get_SharesCachedContents)
+{
+    WriteFile("EMF contents");
+
+    FileCache cache;
+    auto file = cache.Get(CacheTestFile);
+
+    ASSERT_TRUE(file);
+    ASSERT_EQ("EMF contents", *file);
+
+    WriteFile("changed");
+    ASSERT_EQ(file, cache.Get(CacheTestFile));
+}
+
+TEST_F(FileCacheTest, Get_MissingFileReturnsNull)
+{
+    FileCache cache;
+
+    ASSERT_FALSE(cache.Get("filecache_test_missing.emf"));
+}
+
+TEST_F(FileCacheTest, Get_PKVariantRewritesMapFlags)
+{
+    WriteFile(std::string(0x20, 'x'));
+
+    FileCache cache;
+    auto plain = cache.Get(CacheTestFile);
+    auto pk = cache.Get(CacheTestFile, true);
+
+    ASSERT_EQ(std::string(0x20, 'x'), *plain);
+    ASSERT_EQ(char(0xFF), (*pk)[0x03]);
+    ASSERT_EQ(char(0x01), (*pk)[0x04]);
+    ASSERT_EQ(char(0x04), (*pk)[0x1F]);
+    ASSERT_EQ('x', (*pk)[0x05]);
+    ASSERT_EQ(pk, cache.Get(CacheTestFile, true));
+}
+
+TEST_F(FileCacheTest, Invalidate_RereadsFileAndKeepsOldContentsAlive)
+{
+    WriteFile("old");
+
+    FileCache cache;
+    auto old_file = cache.Get(CacheTestFile);
+
+    WriteFile("new");
+    cache.Invalidate(CacheTestFile);
+
+    ASSERT_EQ("new", *cache.Get(CacheTestFile));
+    ASSERT_EQ("old", *old_file);
+}
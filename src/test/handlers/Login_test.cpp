@@ -114,7 +114,10 @@ GTEST_TEST(LoginTests, LoginWhenBannedReturnsBan)
 
     Database_Result banCheckResult;
     std::unordered_map<std::string, util::variant> banCheckColumns;
-    banCheckColumns["expires"] = util::variant(5);
+    banCheckColumns["username"] = util::variant("test_user");
+    banCheckColumns["ip"] = util::variant(0);
+    banCheckColumns["hdid"] = util::variant(0);
+    banCheckColumns["expires"] = util::variant(0);
     banCheckResult.push_back(banCheckColumns);
 
     EXPECT_CALL(*dynamic_cast<MockDatabase*>(mockDatabase.get()),
@@ -157,6 +160,36 @@ GTEST_TEST(LoginTests, LoginWhenBannedReturnsBan)
     }
 }
 
+GTEST_TEST(LoginTests, LoginWhenBansCouldNotBeLoadedIsBusy)
+{
+    Console::SuppressOutput(true);
+
+    Config config, admin_config;
+    CreateConfigWithTestDefaults(config, admin_config);
+
+    auto mockDatabase = CreateMockDatabase();
+    auto mockDatabaseFactory = CreateMockDatabaseFactory(mockDatabase, true);
+
+    EXPECT_CALL(*dynamic_cast<MockDatabase*>(mockDatabase.get()),
+                RawQuery(HasSubstr("FROM bans"), _, _))
+        .WillRepeatedly(Throw(Database_QueryFailed("bans table unavailable")));
+
+    EOServer server(IPAddress("127.0.0.1"), TestServerPort, mockDatabaseFactory, config, admin_config);
+    server.world->config["InitLoginBan"] = false;
+
+    MockClient client(&server);
+
+    PacketBuilder expectedResponse(PACKET_LOGIN, PACKET_REPLY, 2);
+    expectedResponse.AddShort(LOGIN_BUSY);
+    EXPECT_CALL(client, Send(expectedResponse)).Times(1);
+    EXPECT_CALL(client, Close(false)).Times(1);
+
+    PacketBuilder b(PACKET_LOGIN, PACKET_REQUEST, 20);
+    PacketReader r(b.AddBreakString("test_user").AddBreakString("test_pass").Get());
+    r.GetShort();
+    Handlers::Login_Request(&client, r);
+}
+
 GTEST_TEST(LoginTests, LoginUnderStressReturnsServerBusy)
 {
     Console::SuppressOutput(true);
@@ -191,8 +224,8 @@ GTEST_TEST(LoginTests, LoginUnderStressReturnsServerBusy)
         Handlers::Login_Request(client.get(), r);
     }
 
-    // wait for the threads to finish
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    // wait for the threads to finish and run their callbacks
+    RunAsyncCompletionsFor(std::chrono::milliseconds(1000));
 }
 
 GTEST_TEST(LoginTests, TooManyRepeatedLoginAttemptsDisconnectsClient)
@@ -225,7 +258,7 @@ GTEST_TEST(LoginTests, TooManyRepeatedLoginAttemptsDisconnectsClient)
         PacketReader r(b.AddBreakString("test_user").AddBreakString("test_pass").Get());
         Handlers::Login_Request(&client, r);
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        RunAsyncCompletionsFor(std::chrono::milliseconds(500));
     }
 }
 
@@ -273,7 +306,7 @@ GTEST_TEST(LoginTests, LoginWithOldPasswordVersionDoesNotUpgradeOnWrongPassword)
     r.GetShort(); // skip first two bytes (Family/Action - packet id, normally consumed from the reader when selecting the handler)
     Handlers::Login_Request(&client, r);
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    RunAsyncCompletionsFor(std::chrono::milliseconds(500));
 }
 
 GTEST_TEST(LoginTests, LoginWithOldPasswordVersionUpgradesInBackground)
@@ -366,6 +399,197 @@ GTEST_TEST(LoginTests, LoginWithOldPasswordVersionUpgradesInBackground)
         r.GetShort(); // skip first two bytes (Family/Action - packet id, normally consumed from the reader when selecting the handler)
         Handlers::Login_Request(client.get(), r);
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+        RunAsyncCompletionsFor(std::chrono::milliseconds(1500));
+    }
+}
+
+GTEST_TEST(LoginTests, LoginOverAccountRateLimitReturnsServerBusy)
+{
+    Console::SuppressOutput(true);
+
+    const int LoginRateAccount = 2;
+
+    Config config, admin_config;
+    CreateConfigWithTestDefaults(config, admin_config);
+    config["LoginRateAccount"] = LoginRateAccount;
+    config["MaxLoginAttempts"] = 0;
+
+    auto mockDatabase = CreateMockDatabase();
+    auto mockDatabaseFactory = CreateMockDatabaseFactory(mockDatabase, false);
+
+    EOServer server(IPAddress("127.0.0.1"), TestServerPort, mockDatabaseFactory, config, admin_config);
+    MockClient client(&server);
+
+    PacketBuilder wrongUserResponse(PACKET_LOGIN, PACKET_REPLY, 2);
+    wrongUserResponse.AddShort(LOGIN_WRONG_USER);
+    EXPECT_CALL(client, Send(wrongUserResponse)).Times(LoginRateAccount);
+
+    // Attempts past the limit are turned away before the password is checked
+    PacketBuilder busyResponse(PACKET_LOGIN, PACKET_REPLY, 2);
+    busyResponse.AddShort(LOGIN_BUSY);
+    EXPECT_CALL(client, Send(busyResponse)).Times(1);
+
+    EXPECT_CALL(client, Close(_)).Times(0);
+
+    for (auto i = 0; i < LoginRateAccount + 1; i++)
+    {
+        PacketBuilder b(PACKET_LOGIN, PACKET_REQUEST, 20);
+        PacketReader r(b.AddBreakString("test_user").AddBreakString("test_pass").Get());
+        Handlers::Login_Request(&client, r);
+
+        RunAsyncCompletionsFor(std::chrono::milliseconds(200));
+    }
+
+    ASSERT_EQ(1u, server.world->LoginStats().rate_limited);
+}
+
+GTEST_TEST(LoginTests, LoginsBeyondConcurrencyWaitInsteadOfBusy)
+{
+    Console::SuppressOutput(true);
+
+    const int LoginCount = 6;
+
+    Config config, admin_config;
+    CreateConfigWithTestDefaults(config, admin_config);
+    config["LoginConcurrency"] = 1;
+
+    auto mockDatabase = CreateMockDatabase();
+    auto mockDatabaseFactory = CreateMockDatabaseFactory(mockDatabase, true);
+
+    EOServer server(IPAddress("127.0.0.1"), TestServerPort, mockDatabaseFactory, config, admin_config);
+
+    std::list<std::shared_ptr<MockClient>> clientRefs;
+    for (auto i = 0; i < LoginCount; i++)
+    {
+        std::shared_ptr<MockClient> client(new MockClient(&server));
+        clientRefs.push_back(client);
+
+        PacketBuilder expectedResponse(PACKET_LOGIN, PACKET_REPLY, 2);
+        expectedResponse.AddShort(LOGIN_WRONG_USER);
+        EXPECT_CALL(*client, Send(expectedResponse)).Times(1);
+
+        PacketBuilder b(PACKET_LOGIN, PACKET_REQUEST, 20);
+        PacketReader r(b.AddBreakString("test_user" + std::to_string(i)).AddBreakString("test_pass").Get());
+        Handlers::Login_Request(client.get(), r);
+    }
+
+    LoginManager::Stats stats = server.world->LoginStats();
+    ASSERT_EQ(1u, stats.running);
+    ASSERT_EQ(std::size_t(LoginCount - 1), stats.waiting);
+
+    // Each check takes ~100ms in the mock database, one at a time
+    RunAsyncCompletionsFor(std::chrono::milliseconds(1500));
+
+    stats = server.world->LoginStats();
+    ASSERT_EQ(0u, stats.running);
+    ASSERT_EQ(0u, stats.waiting);
+    ASSERT_EQ(std::uint64_t(LoginCount), stats.admitted);
+}
+
+GTEST_TEST(LoginTests, RepeatLoginSkipsPasswordHash)
+{
+    Console::SuppressOutput(true);
+
+    const std::string ExpectedUsername = "test_user";
+    const std::string UnhashedPassword = "test_pass";
+
+    Config config, admin_config;
+    CreateConfigWithTestDefaults(config, admin_config);
+    config["PasswordCurrentVersion"] = int(HashFunc::SHA256);
+    config["MaxLoginAttempts"] = 0;
+
+    std::string passwordCopy(UnhashedPassword);
+    auto saltedPassword = Hasher::SaltPassword(std::string(config["PasswordSalt"]), ExpectedUsername, std::move(passwordCopy)).str();
+
+    auto mockDatabase = CreateMockDatabase();
+    auto mockDatabaseFactory = CreateMockDatabaseFactory(mockDatabase, false);
+
+    Database_Result accountResult;
+    std::unordered_map<std::string, util::variant> accountColumns;
+    accountColumns["password_version"] = util::variant(HashFunc::SHA256);
+    accountColumns["password"] = Sha256Hasher().hash(saltedPassword);
+    accountResult.push_back(accountColumns);
+
+    EXPECT_CALL(*dynamic_cast<MockDatabase*>(mockDatabase.get()),
+                RawQuery(StartsWith("SELECT password, password_version FROM accounts"), _, _))
+        .WillRepeatedly(Return(accountResult));
+
+    EOServer server(IPAddress("127.0.0.1"), TestServerPort, mockDatabaseFactory, config, admin_config);
+
+    auto login = [&server, &ExpectedUsername](const std::string& password)
+    {
+        MockClient client(&server);
+        EXPECT_CALL(client, Send(_)).Times(AnyNumber());
+
+        PacketBuilder b(PACKET_LOGIN, PACKET_REQUEST, 20);
+        PacketReader r(b.AddBreakString(ExpectedUsername).AddBreakString(password).Get());
+        r.GetShort(); // skip first two bytes (Family/Action - packet id, normally consumed from the reader when selecting the handler)
+        Handlers::Login_Request(&client, r);
+
+        RunAsyncCompletionsFor(std::chrono::milliseconds(200));
+    };
+
+    login(UnhashedPassword);
+    login(UnhashedPassword);
+
+    LoginManager::Stats stats = server.world->LoginStats();
+    ASSERT_EQ(1u, stats.hashes);
+    ASSERT_EQ(1u, stats.cache_hits);
+
+    // A wrong password never matches the cached credentials
+    login("wrong_pass");
+
+    stats = server.world->LoginStats();
+    ASSERT_EQ(2u, stats.hashes);
+    ASSERT_EQ(1u, stats.cache_hits);
+}
+
+GTEST_TEST(LoginTests, CancelledQueuedLoginCanLogInAgain)
+{
+    Console::SuppressOutput(true);
+
+    Config config, admin_config;
+    CreateConfigWithTestDefaults(config, admin_config);
+    config["LoginConcurrency"] = 1;
+
+    auto mockDatabase = CreateMockDatabase();
+    auto mockDatabaseFactory = CreateMockDatabaseFactory(mockDatabase, true);
+
+    EOServer server(IPAddress("127.0.0.1"), TestServerPort, mockDatabaseFactory, config, admin_config);
+
+    auto login = [](MockClient& client, const std::string& username)
+    {
+        PacketBuilder b(PACKET_LOGIN, PACKET_REQUEST, 20);
+        PacketReader r(b.AddBreakString(username).AddBreakString("test_pass").Get());
+        r.GetShort();
+        Handlers::Login_Request(&client, r);
+    };
+
+    // Takes the only login slot
+    MockClient running(&server);
+    EXPECT_CALL(running, Send(_)).Times(AnyNumber());
+    login(running, "runninguser");
+
+    // Waits behind it and disconnects before its turn
+    {
+        MockClient queued(&server);
+        EXPECT_CALL(queued, Send(_)).Times(0);
+        login(queued, "queueduser");
+
+        ASSERT_EQ(1u, server.world->LoginStats().waiting);
+        ASSERT_TRUE(server.world->PlayerOnline("queueduser"));
     }
+
+    ASSERT_EQ(0u, server.world->LoginStats().waiting);
+    ASSERT_FALSE(server.world->PlayerOnline("queueduser"));
+
+    MockClient retry(&server);
+
+    PacketBuilder expectedResponse(PACKET_LOGIN, PACKET_REPLY, 2);
+    expectedResponse.AddShort(LOGIN_WRONG_USER);
+    EXPECT_CALL(retry, Send(expectedResponse)).Times(1);
+
+    login(retry, "queueduser");
+
+    RunAsyncCompletionsFor(std::chrono::milliseconds(1000));
 }
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <string>
+
+#include "packet.hpp"
+
+// The allocating encoder as it was written before encoding straight in to ring buffers
+static std::string ReferenceEncode(const std::string &rawstr, unsigned char emulti)
+{
+    if (emulti == 0 || ((unsigned char)rawstr[2] == PACKET_A_INIT && (unsigned char)rawstr[3] == PACKET_F_INIT))
+        return rawstr;
+
+    std::string str = PacketProcessor::DickWinder(rawstr, emulti);
+    std::string newstr;
+    int length = str.length();
+    int i = 2;
+    int ii = 2;
+
+    newstr.resize(length);
+
+    newstr[0] = str[0];
+    newstr[1] = str[1];
+
+    for (; i < length; i += 2)
+        newstr[i] = (unsigned char)str[ii++] ^ 0x80;
+
+    for (i = length - 1 - (length % 2); i >= 2; i -= 2)
+        newstr[i] = (unsigned char)str[ii++] ^ 0x80;
+
+    for (i = 2; i < length; ++i)
+    {
+        if (static_cast<unsigned char>(newstr[i]) == 128)
+            newstr[i] = 0;
+        else if (newstr[i] == 0)
+            newstr[i] = (char)128;
+    }
+
+    return newstr;
+}
+
+static PacketBuilder MakePacket(std::size_t length, unsigned char seed)
+{
+    PacketBuilder builder(PACKET_TALK, PACKET_PLAYER, length);
+
+    for (std::size_t i = 0; i < length; ++i)
+        builder.AddByte(static_cast<unsigned char>(seed + i * 7));
+
+    return builder;
+}
+
+GTEST_TEST(PacketTests, Encode_MatchesReferenceEncoder)
+{
+    for (unsigned char emulti = 0; emulti <= 12; ++emulti)
+    {
+        PacketProcessor processor;
+        processor.SetEMulti(emulti, emulti);
+
+        for (std::size_t length = 0; length < 40; ++length)
+        {
+            const std::string raw = MakePacket(length, static_cast<unsigned char>(emulti * 3 + length)).Get();
+
+            ASSERT_EQ(ReferenceEncode(raw, emulti), processor.Encode(raw)) << "emulti " << int(emulti) << " length " << length;
+        }
+    }
+}
+
+GTEST_TEST(PacketTests, Encode_InitPacketIsNotEncoded)
+{
+    PacketProcessor processor;
+    processor.SetEMulti(6, 6);
+
+    PacketBuilder builder(PACKET_F_INIT, PACKET_A_INIT, 3);
+    builder.AddByte(1);
+    builder.AddByte(2);
+    builder.AddByte(3);
+
+    ASSERT_EQ(builder.Get(), processor.Encode(builder.Get()));
+}
+
+GTEST_TEST(PacketTests, Encode_SplitsAcrossSegments)
+{
+    PacketProcessor processor;
+    processor.SetEMulti(5, 5);
+
+    const std::string raw = MakePacket(11, 40).Get();
+    const std::string expected = processor.Encode(raw);
+
+    for (std::size_t split = 0; split <= raw.length(); ++split)
+    {
+        std::string out(split, '\0');
+        std::string wrapped(raw.length() - split, '\0');
+
+        processor.Encode(raw, &out[0], split, &wrapped[0]);
+
+        ASSERT_EQ(expected, out + wrapped) << "split " << split;
+    }
+}
+
+GTEST_TEST(PacketTests, Broadcast_KeepsBuilderHeader)
+{
+    PacketBuilder builder = MakePacket(9, 1);
+    PacketBroadcast packet(builder);
+
+    ASSERT_EQ(builder.GetID(), packet.GetID());
+    ASSERT_EQ(builder.Length(), packet.Length());
+    ASSERT_EQ(builder.Get(), packet.Raw());
+}
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+
+#include "character.hpp"
+#include "guild.hpp"
+#include "player.hpp"
+#include "world.hpp"
+
+#include "testhelper/mocks.hpp"
+#include "testhelper/setup.hpp"
+
+#include "console.hpp"
+
+class PlayerLoadTest : public testing::Test
+{
+public:
+    PlayerLoadTest()
+    {
+        Console::SuppressOutput(true);
+
+        Config config, aConfig;
+        CreateConfigWithTestDefaults(config, aConfig);
+
+        database = CreateMockDatabase();
+        databaseFactory = CreateMockDatabaseFactory(database);
+        world = std::make_shared<World>(databaseFactory, config, aConfig);
+    }
+
+protected:
+    std::shared_ptr<Database> database;
+    std::shared_ptr<DatabaseFactory> databaseFactory;
+    std::shared_ptr<World> world;
+
+    MockDatabase& Mock()
+    {
+        return *dynamic_cast<MockDatabase*>(database.get());
+    }
+
+    static std::unordered_map<std::string, util::variant> CharacterRow(const std::string& name, const std::string& guild)
+    {
+        std::unordered_map<std::string, util::variant> row;
+        row["name"] = name;
+        row["guild"] = guild;
+        row["guild_rank"] = 1;
+        row["map"] = 1;
+        row["level"] = 1;
+        return row;
+    }
+
+    void GivenAccount(const std::string& username)
+    {
+        std::unordered_map<std::string, util::variant> row;
+        row["username"] = username;
+
+        Database_Result res;
+        res.push_back(row);
+
+        EXPECT_CALL(Mock(), RawQuery(StartsWith("SELECT username, password FROM accounts"), _, _))
+            .WillRepeatedly(Return(res));
+    }
+};
+
+TEST_F(PlayerLoadTest, Player_LoadsCharactersAndGuildsWithOneQueryEach)
+{
+    GivenAccount("account");
+
+    Database_Result characters;
+    characters.push_back(CharacterRow("first", "ABC"));
+    characters.push_back(CharacterRow("second", "ABC"));
+    characters.push_back(CharacterRow("third", ""));
+
+    EXPECT_CALL(Mock(), RawQuery(AllOf(HasSubstr("FROM characters WHERE account = "), HasSubstr("account")), _, _))
+        .Times(1)
+        .WillOnce(Return(characters));
+
+    std::unordered_map<std::string, util::variant> guild_row;
+    guild_row["tag"] = "ABC";
+    guild_row["name"] = "alphabet";
+
+    Database_Result guilds;
+    guilds.push_back(guild_row);
+
+    EXPECT_CALL(Mock(), RawQuery(AllOf(StartsWith("SELECT tag, name, description"), HasSubstr("WHERE tag IN ('ABC')")), _, _))
+        .Times(1)
+        .WillOnce(Return(guilds));
+
+    Database_Result members;
+    members.push_back(CharacterRow("first", "ABC"));
+    members.push_back(CharacterRow("second", "ABC"));
+
+    EXPECT_CALL(Mock(), RawQuery(AllOf(StartsWith("SELECT name, guild, guild_rank"), HasSubstr("WHERE guild IN ('ABC')")), _, _))
+        .Times(1)
+        .WillOnce(Return(members));
+
+    Player player("account", world.get());
+
+    ASSERT_EQ(3u, player.characters.size());
+    EXPECT_EQ("first", player.characters[0]->real_name);
+    EXPECT_EQ("third", player.characters[2]->real_name);
+
+    ASSERT_TRUE(player.characters[0]->guild != nullptr);
+    EXPECT_EQ(player.characters[0]->guild, player.characters[1]->guild);
+    EXPECT_EQ(2u, player.characters[0]->guild->members.size());
+    EXPECT_TRUE(player.characters[2]->guild == nullptr);
+}
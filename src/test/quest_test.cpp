@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "character.hpp"
+#include "eoplus.hpp"
+#include "player.hpp"
+#include "quest.hpp"
+#include "world.hpp"
+
+#include "testhelper/mocks.hpp"
+#include "testhelper/setup.hpp"
+
+#include "console.hpp"
+
+static std::unordered_map<std::string, util::variant> quester_row()
+{
+    std::unordered_map<std::string, util::variant> row;
+    row["name"] = "quester";
+    row["map"] = 1;
+    row["x"] = 0;
+    row["y"] = 0;
+    return row;
+}
+
+class QuestRuleTest : public WorldCharacterTest
+{
+public:
+    QuestRuleTest()
+        : WorldCharacterTest(quester_row())
+    {
+        world->config["QuestDir"] = "./";
+    }
+
+    ~QuestRuleTest()
+    {
+        character->quests.clear();
+        std::remove("09999.eqf");
+    }
+
+protected:
+    std::shared_ptr<Quest> LoadQuest(const std::string& source)
+    {
+        {
+            std::ofstream file("09999.eqf");
+            file << "main { questname \"Test\" version 1 }\n" << source;
+        }
+
+        return std::make_shared<Quest>(9999, world.get());
+    }
+
+    std::shared_ptr<Quest_Context> Start(const std::shared_ptr<Quest>& quest)
+    {
+        auto context = std::make_shared<Quest_Context>(character.get(), quest.get());
+        character->quests[quest->ID()] = context;
+        context->SetState("begin");
+        return context;
+    }
+};
+
+TEST_F(QuestRuleTest, Load_IndexesRulesByEvent)
+{
+    auto quest = LoadQuest(
+        "state begin { rule EnterCoord(1, 5, 5) goto walked rule GotItems(1, 3) goto walked rule TalkedToNpc(2) goto walked }\n"
+        "state walked { }\n");
+
+    const EOPlus::State& state = quest->GetQuest()->states.at("begin");
+
+    ASSERT_EQ(QUEST_EVENT_MOVE, state.rules[0].events);
+    ASSERT_EQ(QUEST_EVENT_ITEMS, state.rules[1].events);
+    ASSERT_EQ(0u, state.rules[2].events);
+    ASSERT_EQ(unsigned(QUEST_EVENT_MOVE | QUEST_EVENT_ITEMS), state.rule_events);
+
+    std::vector<int> expected{1, 5, 5};
+    ASSERT_EQ(expected, state.rules[0].expr.int_args);
+}
+
+TEST_F(QuestRuleTest, Load_RejectsUnknownRule)
+{
+    ASSERT_THROW(LoadQuest("state begin { rule Bogus(1) goto begin }\n"), std::runtime_error);
+}
+
+TEST_F(QuestRuleTest, CheckQuestRules_OnlyChecksRulesForTheEvent)
+{
+    auto quest = LoadQuest(
+        "state begin { rule EnterCoord(1, 5, 5) goto walked }\n"
+        "state walked { }\n");
+
+    auto context = Start(quest);
+    ASSERT_EQ("begin", context->StateName());
+
+    character->x = 5;
+    character->y = 5;
+
+    character->CheckQuestRules(QUEST_EVENT_ITEMS | QUEST_EVENT_SPELLS);
+    ASSERT_EQ("begin", context->StateName());
+
+    character->CheckQuestRules(QUEST_EVENT_MOVE);
+    ASSERT_EQ("walked", context->StateName());
+}
+
+TEST_F(QuestRuleTest, CheckQuestRules_StatRuleOnCoordinateFiresOnWalk)
+{
+    auto quest = LoadQuest(
+        "state begin { rule StatIs(\"x\", 3) goto walked }\n"
+        "state walked { }\n");
+
+    auto context = Start(quest);
+    ASSERT_EQ("begin", context->StateName());
+
+    // Map::Walk moves the character then only dispatches the move event
+    character->x = 3;
+    character->CheckQuestRules(QUEST_EVENT_MOVE);
+    ASSERT_EQ("walked", context->StateName());
+}
+
+TEST_F(QuestRuleTest, TalkedNPC_TriggersMatchingRule)
+{
+    auto quest = LoadQuest(
+        "state begin { rule TalkedToNpc(3) goto talked }\n"
+        "state talked { }\n");
+
+    auto context = Start(quest);
+
+    ASSERT_FALSE(context->TalkedNPC(2));
+    ASSERT_EQ("begin", context->StateName());
+
+    ASSERT_TRUE(context->TalkedNPC(3));
+    ASSERT_EQ("talked", context->StateName());
+}
+
+TEST_F(QuestRuleTest, KilledNPC_OnlyDispatchedToQuestsWaitingOnTheNPC)
+{
+    auto quest = LoadQuest(
+        "state begin { rule KilledNpcs(5, 2) goto killed }\n"
+        "state killed { }\n");
+
+    auto context = Start(quest);
+    int calls = 0;
+
+    auto killed = [&calls](Quest_Context& quest)
+    {
+        ++calls;
+        quest.KilledNPC(5);
+    };
+
+    world->quest_triggers.Dispatch(character.get(), QuestTriggerIndex::KilledNPC, 4, killed);
+    ASSERT_EQ(0, calls);
+
+    world->quest_triggers.Dispatch(character.get(), QuestTriggerIndex::KilledNPC, 5, killed);
+    world->quest_triggers.Dispatch(character.get(), QuestTriggerIndex::KilledNPC, 5, killed);
+    ASSERT_EQ(2, calls);
+    ASSERT_EQ("killed", context->StateName());
+
+    world->quest_triggers.Dispatch(character.get(), QuestTriggerIndex::KilledNPC, 5, killed);
+    ASSERT_EQ(2, calls);
+    ASSERT_EQ(0u, world->quest_triggers.Size());
+}
+
+TEST_F(QuestRuleTest, QuestTriggers_RemovedWhenQuestIsDropped)
+{
+    auto quest = LoadQuest(
+        "state begin { action AddNpcText(3, \"Hello\") rule UsedSpell(2) goto used }\n"
+        "state used { }\n");
+
+    Start(quest);
+    ASSERT_EQ(2u, world->quest_triggers.Size());
+
+    character->quests.clear();
+    ASSERT_EQ(0u, world->quest_triggers.Size());
+}
+
+TEST_F(QuestRuleTest, CheckQuestItemRules_ChecksQuestsWaitingOnTheItem)
+{
+    auto quest = LoadQuest(
+        "state begin { rule GotItems(1, 3) goto got }\n"
+        "state got { }\n");
+
+    auto context = Start(quest);
+
+    Character_Item item;
+    item.id = 1;
+    item.amount = 3;
+    character->inventory.push_back(item);
+
+    character->CheckQuestItemRules(2);
+    ASSERT_EQ("begin", context->StateName());
+
+    character->CheckQuestItemRules(1);
+    ASSERT_EQ("got", context->StateName());
+}
+
+TEST_F(QuestRuleTest, CheckQuestItemRules_ChecksWeightRulesForAnyItem)
+{
+    auto quest = LoadQuest(
+        "state begin { rule StatGreater(\"weight\", 4) goto heavy }\n"
+        "state heavy { }\n");
+
+    auto context = Start(quest);
+    ASSERT_EQ("begin", context->StateName());
+
+    character->weight = 5;
+
+    character->CheckQuestItemRules(7);
+    ASSERT_EQ("heavy", context->StateName());
+}
+
+TEST_F(QuestRuleTest, CheckQuestItemRules_SkipsRulesTheInventoryCannotChange)
+{
+    auto quest = LoadQuest(
+        "state begin { rule StatGreater(\"level\", 4) goto strong }\n"
+        "state strong { }\n");
+
+    auto context = Start(quest);
+
+    character->level = 5;
+
+    character->CheckQuestItemRules(7);
+    ASSERT_EQ("begin", context->StateName());
+
+    character->CheckQuestRules(QUEST_EVENT_CHARACTER);
+    ASSERT_EQ("strong", context->StateName());
+}
@@ -46,6 +46,18 @@ public:
 
         return this->RawQuery(fullQuery.c_str(), false, false);
     }
+
+    virtual Database_Statement_Result ExecuteStatement(const char *format, const std::vector<util::variant>& params) override
+    {
+        // prepared statements go through RawQuery like Query does, so tests can verify either the same way
+        auto fullQuery = std::accumulate(params.begin(), params.end(), this->ParseStatementQuery(format).first,
+            [](std::string a, const util::variant& b)
+            {
+                return std::move(a) + ", " + b.GetString();
+            });
+
+        return Database_Statement_Result(this->RawQuery(fullQuery.c_str(), false, false));
+    }
 };
 
 class MockClient : public EOClient
@@ -1,9 +1,19 @@
 #pragma once
 
+#include <memory>
+#include <string>
 #include <thread>
+#include <unordered_map>
 
+#include "character.hpp"
 #include "config.hpp"
+#include "console.hpp"
 #include "eoserv_config.hpp"
+#include "player.hpp"
+#include "world.hpp"
+#include "util/async.hpp"
+
+#include "mocks.hpp"
 
 static void CreateConfigWithTestDefaults(Config& config, Config& admin_config)
 {
@@ -38,15 +48,10 @@ static std::shared_ptr<Database> CreateMockDatabase()
     std::shared_ptr<Database> mockDatabase(new MockDatabase(Database::Engine::SqlServer));
 
     // set up responses to database queries
-    Database_Result banCheckResult;
-    std::unordered_map<std::string, util::variant> banCheckColumns;
-    banCheckColumns["expires"] = util::variant(-1);
-    banCheckResult.push_back(banCheckColumns);
-
     // no bans by default
     EXPECT_CALL(*dynamic_cast<MockDatabase*>(mockDatabase.get()),
                 RawQuery(HasSubstr("FROM bans"), _, _))
-        .WillRepeatedly(Return(banCheckResult));
+        .WillRepeatedly(Return(Database_Result()));
 
     // no accounts by default
     EXPECT_CALL(*dynamic_cast<MockDatabase*>(mockDatabase.get()),
@@ -78,3 +83,48 @@ static std::shared_ptr<DatabaseFactory> CreateMockDatabaseFactory(std::shared_pt
             }));
     return mockDatabaseFactory;
 }
+
+// Async operation callbacks only run when the main thread drains them (normally in EOServer::Tick)
+// Keep draining for a while so work still running on the thread pool gets its callbacks run too
+static void RunAsyncCompletionsFor(std::chrono::milliseconds duration)
+{
+    auto end = std::chrono::steady_clock::now() + duration;
+
+    do
+    {
+        AsyncCompletionQueue::Drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    } while (std::chrono::steady_clock::now() < end);
+
+    AsyncCompletionQueue::Drain();
+}
+
+// A world on the mock database with one character built from a characters table row, owned by a player but not on a map
+class WorldCharacterTest : public testing::Test
+{
+protected:
+    WorldCharacterTest(const std::unordered_map<std::string, util::variant>& row)
+    {
+        Console::SuppressOutput(true);
+
+        Config config, aConfig;
+        CreateConfigWithTestDefaults(config, aConfig);
+
+        database = CreateMockDatabase();
+        databaseFactory = CreateMockDatabaseFactory(database);
+        world = std::make_shared<World>(databaseFactory, config, aConfig);
+
+        EXPECT_CALL(*dynamic_cast<MockDatabase*>(database.get()), RawQuery(HasSubstr("FROM guilds"), _, _))
+            .WillRepeatedly(Return(Database_Result()));
+
+        player = std::make_shared<Player>("account");
+        character = std::make_shared<Character>(row, world.get());
+        character->player = player.get();
+    }
+
+    std::shared_ptr<Database> database;
+    std::shared_ptr<DatabaseFactory> databaseFactory;
+    std::shared_ptr<World> world;
+    std::shared_ptr<Player> player;
+    std::shared_ptr<Character> character;
+};
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "timer.hpp"
+
+static void CountTick(void *param)
+{
+    ++*static_cast<int *>(param);
+}
+
+static void WaitForClock()
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+}
+
+GTEST_TEST(TimerTests, OneShotEvent_FiresOnce)
+{
+    Timer timer;
+    int ticks = 0;
+
+    timer.Register(new TimeEvent(CountTick, &ticks, 0.0, 1));
+
+    WaitForClock();
+    timer.Tick();
+    WaitForClock();
+    timer.Tick();
+
+    ASSERT_EQ(1, ticks);
+}
+
+GTEST_TEST(TimerTests, EventBehindSchedule_TicksOncePerTick)
+{
+    Timer timer;
+    int ticks = 0;
+
+    TimeEvent *event = new TimeEvent(CountTick, &ticks, 0.001, Timer::FOREVER);
+    timer.Register(event);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    timer.Tick();
+    ASSERT_EQ(1, ticks);
+
+    timer.Tick();
+    ASSERT_EQ(2, ticks);
+
+    delete event;
+}
+
+GTEST_TEST(TimerTests, OnlyDueEventsFire)
+{
+    Timer timer;
+    int due_ticks = 0;
+    int later_ticks = 0;
+
+    for (int i = 0; i < 100; ++i)
+        timer.Register(new TimeEvent(CountTick, &later_ticks, 1000.0 + i, Timer::FOREVER));
+
+    timer.Register(new TimeEvent(CountTick, &due_ticks, 0.0, 3));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        WaitForClock();
+        timer.Tick();
+    }
+
+    ASSERT_EQ(3, due_ticks);
+    ASSERT_EQ(0, later_ticks);
+}
+
+struct DeleteOtherEvent
+{
+    TimeEvent *other;
+    int ticks;
+};
+
+static void DeleteOtherTick(void *param)
+{
+    DeleteOtherEvent *state = static_cast<DeleteOtherEvent *>(param);
+    delete state->other;
+    state->other = nullptr;
+}
+
+GTEST_TEST(TimerTests, EventDeletedByEarlierCallback_DoesNotFire)
+{
+    Timer timer;
+    DeleteOtherEvent state = { nullptr, 0 };
+
+    timer.Register(new TimeEvent(DeleteOtherTick, &state, 0.0, 1));
+    state.other = new TimeEvent(CountTick, &state.ticks, 0.001, 1);
+    timer.Register(state.other);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    timer.Tick();
+
+    ASSERT_EQ(nullptr, state.other);
+    ASSERT_EQ(0, state.ticks);
+}
+
+GTEST_TEST(TimerTests, UnregisteredEvent_DoesNotFire)
+{
+    Timer timer;
+    int ticks = 0;
+
+    TimeEvent *event = new TimeEvent(CountTick, &ticks, 0.0, Timer::FOREVER);
+    timer.Register(event);
+    timer.Unregister(event);
+
+    WaitForClock();
+    timer.Tick();
+
+    ASSERT_EQ(0, ticks);
+    delete event;
+}
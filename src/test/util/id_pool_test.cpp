@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include "util/id_pool.hpp"
+
+using IDPool = util::IDPool;
+
+GTEST_TEST(IDPoolTests, AcquireHandsOutLowestFreeID)
+{
+    IDPool pool;
+
+    ASSERT_EQ(1u, pool.Acquire());
+    ASSERT_EQ(2u, pool.Acquire());
+    ASSERT_EQ(3u, pool.Acquire());
+
+    pool.Release(2);
+    ASSERT_EQ(2u, pool.Next());
+    ASSERT_EQ(2u, pool.Acquire());
+    ASSERT_EQ(4u, pool.Acquire());
+}
+
+GTEST_TEST(IDPoolTests, TakeReservesKnownIDs)
+{
+    IDPool pool;
+
+    pool.Take(1);
+    pool.Take(3);
+
+    ASSERT_TRUE(pool.InUse(3));
+    ASSERT_FALSE(pool.InUse(2));
+    ASSERT_EQ(2u, pool.Acquire());
+    ASSERT_EQ(4u, pool.Acquire());
+}
+
+GTEST_TEST(IDPoolTests, ReusesIDsAcrossWords)
+{
+    IDPool pool;
+
+    for (unsigned int i = 1; i <= 200; ++i)
+        ASSERT_EQ(i, pool.Acquire());
+
+    pool.Release(150);
+    pool.Release(10);
+
+    ASSERT_EQ(10u, pool.Acquire());
+    ASSERT_EQ(150u, pool.Acquire());
+    ASSERT_EQ(201u, pool.Acquire());
+}
+
+GTEST_TEST(IDPoolTests, IgnoresIDsBelowFirst)
+{
+    IDPool pool(1);
+
+    pool.Take(0);
+    pool.Release(0);
+
+    ASSERT_FALSE(pool.InUse(0));
+    ASSERT_EQ(1u, pool.Acquire());
+
+    pool.Clear();
+    ASSERT_EQ(1u, pool.Next());
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "util/mpsc_queue.hpp"
+
+GTEST_TEST(MPSCQueueTests, PopsInPushOrder)
+{
+    util::MPSCQueue<int> queue;
+    int out = 0;
+
+    ASSERT_FALSE(queue.Pop(out));
+
+    queue.Push(1);
+    queue.Push(2);
+    queue.Push(3);
+
+    ASSERT_TRUE(queue.Pop(out));
+    ASSERT_EQ(1, out);
+    ASSERT_TRUE(queue.Pop(out));
+    ASSERT_EQ(2, out);
+
+    queue.Push(4);
+
+    ASSERT_TRUE(queue.Pop(out));
+    ASSERT_EQ(3, out);
+    ASSERT_TRUE(queue.Pop(out));
+    ASSERT_EQ(4, out);
+    ASSERT_FALSE(queue.Pop(out));
+}
+
+GTEST_TEST(MPSCQueueTests, DestructorFreesQueuedItems)
+{
+    auto item = std::make_shared<int>(5);
+
+    {
+        util::MPSCQueue<std::shared_ptr<int>> queue;
+        queue.Push(item);
+        queue.Push(item);
+        ASSERT_EQ(3, item.use_count());
+    }
+
+    ASSERT_EQ(1, item.use_count());
+}
+
+GTEST_TEST(MPSCQueueTests, ManyProducersOneConsumer)
+{
+    const int Producers = 4;
+    const int PerProducer = 10000;
+
+    util::MPSCQueue<int> queue;
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < Producers; ++p)
+    {
+        threads.emplace_back([&queue, p]()
+        {
+            for (int i = 0; i < PerProducer; ++i)
+                queue.Push(p * PerProducer + i);
+        });
+    }
+
+    // Each producer's items must come out in the order that producer pushed them
+    std::vector<int> next(Producers, 0);
+    int received = 0;
+    bool ordered = true;
+
+    while (received < Producers * PerProducer)
+    {
+        int value;
+
+        if (!queue.Pop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        int p = value / PerProducer;
+        ordered = ordered && next[p] == value % PerProducer;
+        ++next[p];
+        ++received;
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    ASSERT_TRUE(ordered);
+
+    int value;
+    ASSERT_FALSE(queue.Pop(value));
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "util/nav_grid.hpp"
+
+using NavGrid = util::NavGrid;
+using Point = NavGrid::Point;
+
+// Builds a grid from rows of text, where '#' is a wall
+static NavGrid MakeGrid(const std::vector<std::string>& rows)
+{
+    NavGrid grid;
+    grid.Reset(int(rows[0].length()), int(rows.size()));
+
+    for (int y = 0; y < int(rows.size()); ++y)
+        for (int x = 0; x < int(rows[y].length()); ++x)
+            grid.SetWalkable(x, y, rows[y][x] != '#');
+
+    return grid;
+}
+
+static void AssertConnected(Point start, const std::vector<Point>& path)
+{
+    Point last = start;
+
+    for (const Point& step : path)
+    {
+        ASSERT_EQ(1, std::abs(step.x - last.x) + std::abs(step.y - last.y));
+        last = step;
+    }
+}
+
+GTEST_TEST(NavGridTests, FindPath_StraightLine)
+{
+    NavGrid grid = MakeGrid({
+        ".....",
+    });
+
+    std::vector<Point> path;
+    ASSERT_TRUE(grid.FindPath({0, 0}, {4, 0}, 100, path));
+    ASSERT_EQ(4u, path.size());
+    ASSERT_EQ((Point{4, 0}), path.back());
+    AssertConnected({0, 0}, path);
+}
+
+GTEST_TEST(NavGridTests, FindPath_GoesAroundWalls)
+{
+    NavGrid grid = MakeGrid({
+        ".....",
+        "####.",
+        ".....",
+    });
+
+    std::vector<Point> path;
+    ASSERT_TRUE(grid.FindPath({0, 0}, {0, 2}, 100, path));
+    ASSERT_EQ(10u, path.size());
+    ASSERT_EQ((Point{0, 2}), path.back());
+    AssertConnected({0, 0}, path);
+
+    for (const Point& step : path)
+        ASSERT_TRUE(grid.Walkable(step.x, step.y));
+}
+
+GTEST_TEST(NavGridTests, FindPath_GoalMayBeUnwalkable)
+{
+    NavGrid grid = MakeGrid({
+        "...#",
+    });
+
+    std::vector<Point> path;
+    ASSERT_TRUE(grid.FindPath({0, 0}, {3, 0}, 100, path));
+    ASSERT_EQ((Point{3, 0}), path.back());
+}
+
+GTEST_TEST(NavGridTests, FindPath_FailsWhenUnreachableOrOverBudget)
+{
+    NavGrid grid = MakeGrid({
+        "..#..",
+        "..#..",
+        "..#..",
+    });
+
+    std::vector<Point> path;
+    ASSERT_FALSE(grid.FindPath({0, 0}, {4, 0}, 100, path));
+    ASSERT_TRUE(path.empty());
+
+    NavGrid open = MakeGrid({
+        "..........",
+    });
+
+    ASSERT_FALSE(open.FindPath({0, 0}, {9, 0}, 3, path));
+    ASSERT_TRUE(open.FindPath({0, 0}, {9, 0}, 20, path));
+}
+
+GTEST_TEST(NavGridTests, FindPath_AvoidsBlockedTiles)
+{
+    NavGrid grid = MakeGrid({
+        "...",
+        "...",
+    });
+
+    std::vector<Point> path;
+    ASSERT_TRUE(grid.FindPath({0, 0}, {2, 0}, 100, path, [](int x, int y) { return x == 1 && y == 0; }));
+    ASSERT_EQ(4u, path.size());
+    AssertConnected({0, 0}, path);
+
+    for (const Point& step : path)
+        ASSERT_NE((Point{1, 0}), step);
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "util/ring_buffer.hpp"
+
+using RingBuffer = util::RingBuffer;
+
+static std::string ReadAll(RingBuffer& buffer)
+{
+    std::string out(buffer.Size(), '\0');
+    buffer.Read(&out[0], out.length());
+    return out;
+}
+
+GTEST_TEST(RingBufferTests, WriteAndReadWrapAround)
+{
+    RingBuffer buffer(8);
+
+    ASSERT_TRUE(buffer.Write("abcdef", 6));
+
+    char out[4];
+    ASSERT_EQ(4u, buffer.Read(out, 4));
+    ASSERT_EQ(0, std::memcmp(out, "abcd", 4));
+
+    ASSERT_TRUE(buffer.Write("ghijk", 5));
+    ASSERT_EQ(7u, buffer.Size());
+    ASSERT_EQ('e', buffer[0]);
+    ASSERT_EQ('k', buffer[6]);
+    ASSERT_EQ("efghijk", ReadAll(buffer));
+    ASSERT_TRUE(buffer.Empty());
+}
+
+GTEST_TEST(RingBufferTests, WriteIsAllOrNothing)
+{
+    RingBuffer buffer(4);
+
+    ASSERT_TRUE(buffer.Write("abc", 3));
+    ASSERT_FALSE(buffer.Write("de", 2));
+    ASSERT_EQ(3u, buffer.Size());
+
+    ASSERT_TRUE(buffer.Write("d", 1));
+    ASSERT_TRUE(buffer.Full());
+    ASSERT_EQ("abcd", ReadAll(buffer));
+}
+
+GTEST_TEST(RingBufferTests, PeekDoesNotConsume)
+{
+    RingBuffer buffer(8);
+    buffer.Write("abcdef", 6);
+
+    char out[4] = {};
+    ASSERT_EQ(3u, buffer.Peek(out, 3, 2));
+    ASSERT_EQ(0, std::memcmp(out, "cde", 3));
+    ASSERT_EQ(2u, buffer.Peek(out, 4, 4));
+    ASSERT_EQ(0u, buffer.Peek(out, 1, 6));
+    ASSERT_EQ(6u, buffer.Size());
+}
+
+GTEST_TEST(RingBufferTests, SegmentsSplitAtEndOfBuffer)
+{
+    RingBuffer buffer(8);
+    buffer.Write("abcdef", 6);
+    buffer.Consume(5);
+
+    RingBuffer::Segments free = buffer.WriteSegments();
+    ASSERT_EQ(2u, free[0].length);
+    ASSERT_EQ(5u, free[1].length);
+
+    std::memcpy(free[0].data, "gh", 2);
+    std::memcpy(free[1].data, "ij", 2);
+    buffer.Commit(4);
+
+    RingBuffer::Segments data = buffer.ReadSegments();
+    ASSERT_EQ(std::string("fgh"), std::string(data[0].data, data[0].length));
+    ASSERT_EQ(std::string("ij"), std::string(data[1].data, data[1].length));
+
+    buffer.Consume(data[0].length + data[1].length);
+    ASSERT_TRUE(buffer.Empty());
+    ASSERT_EQ(8u, buffer.WriteSegments()[0].length);
+}
+
+GTEST_TEST(RingBufferTests, CapacityMustBePowerOfTwo)
+{
+    ASSERT_THROW(RingBuffer(12), std::runtime_error);
+    ASSERT_NO_THROW(RingBuffer(16));
+
+    RingBuffer buffer(4);
+    ASSERT_THROW(buffer.Commit(5), std::runtime_error);
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "util/rpn.hpp"
+
+using rpn_formula = util::rpn_formula;
+using rpn_symbols = util::rpn_symbols;
+
+static double EvalUncompiled(const std::string& expr, const std::unordered_map<std::string, double>& vars)
+{
+    return util::rpn_eval(util::rpn_parse(expr), vars);
+}
+
+GTEST_TEST(RpnTests, SymbolsAssignStableSlots)
+{
+    rpn_symbols symbols;
+
+    auto a = symbols.add("a");
+    auto b = symbols.add("b");
+
+    ASSERT_EQ(a, symbols.add("a"));
+    ASSERT_NE(a, b);
+    ASSERT_EQ(b, symbols.find("b"));
+    ASSERT_EQ(rpn_symbols::npos, symbols.find("c"));
+    ASSERT_EQ(2u, symbols.vars().size());
+}
+
+GTEST_TEST(RpnTests, CompiledFormulaMatchesRpnEval)
+{
+    rpn_symbols symbols;
+    auto level = symbols.add("level");
+    auto str = symbols.add("str");
+
+    std::vector<double> vars = symbols.vars();
+    vars[level] = 12;
+    vars[str] = 7;
+
+    const std::unordered_map<std::string, double> named_vars = { { "level", 12 }, { "str", 7 } };
+
+    const std::string exprs[] = {
+        "10 2.5 level * 2.5 str * + +",
+        "2 1 str - /",
+        "0 str 10 level > ?",
+        "3 str min 5 level / floor max",
+        "5 level %",
+    };
+
+    for (const auto& expr : exprs)
+    {
+        ASSERT_DOUBLE_EQ(EvalUncompiled(expr, named_vars), rpn_formula(expr, symbols).eval(vars)) << expr;
+    }
+}
+
+GTEST_TEST(RpnTests, CompiledFormulaUsesUpdatedVariables)
+{
+    rpn_symbols symbols;
+    auto damage = symbols.add("damage");
+    rpn_formula formula("2 damage *", symbols);
+
+    std::vector<double> vars = symbols.vars();
+
+    vars[damage] = 3;
+    ASSERT_DOUBLE_EQ(6.0, formula.eval(vars));
+
+    vars[damage] = 10;
+    ASSERT_DOUBLE_EQ(20.0, formula.eval(vars));
+}
+
+GTEST_TEST(RpnTests, EmptyFormulaEvaluatesToZero)
+{
+    rpn_symbols symbols;
+
+    ASSERT_TRUE(rpn_formula().empty());
+    ASSERT_TRUE(rpn_formula("", symbols).empty());
+    ASSERT_DOUBLE_EQ(0.0, rpn_formula("", symbols).eval(symbols.vars()));
+}
+
+GTEST_TEST(RpnTests, CompileThrowsOnStackUnderflow)
+{
+    rpn_symbols symbols;
+
+    ASSERT_THROW(rpn_formula("1 +", symbols), std::runtime_error);
+}
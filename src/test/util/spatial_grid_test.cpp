@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "util/spatial_grid.hpp"
+
+using SpatialGrid = util::SpatialGrid<int>;
+
+static std::vector<int> Visit(const SpatialGrid& grid, int x, int y, int range)
+{
+    std::vector<int> visited;
+    grid.ForEach(x, y, range, [&visited](int obj) { visited.push_back(obj); });
+    std::sort(visited.begin(), visited.end());
+    return visited;
+}
+
+GTEST_TEST(SpatialGridTests, ForEachVisitsObjectsInNearbyCells)
+{
+    SpatialGrid grid;
+    grid.Reset(64, 64);
+
+    grid.Update(1, 0, 0);
+    grid.Update(2, 10, 10);
+    grid.Update(3, 60, 60);
+
+    ASSERT_EQ(std::vector<int>({1, 2}), Visit(grid, 5, 5, 5));
+    ASSERT_EQ(std::vector<int>({3}), Visit(grid, 63, 63, 0));
+}
+
+GTEST_TEST(SpatialGridTests, UpdateMovesObjectBetweenCells)
+{
+    SpatialGrid grid;
+    grid.Reset(64, 64);
+
+    grid.Update(1, 0, 0);
+    grid.Update(1, 40, 40);
+
+    ASSERT_EQ(1u, grid.Size());
+    ASSERT_TRUE(Visit(grid, 0, 0, 0).empty());
+    ASSERT_EQ(std::vector<int>({1}), Visit(grid, 40, 40, 0));
+}
+
+GTEST_TEST(SpatialGridTests, RemoveDeletesObject)
+{
+    SpatialGrid grid;
+    grid.Reset(64, 64);
+
+    grid.Update(1, 5, 5);
+    grid.Update(2, 5, 5);
+    grid.Remove(1);
+    grid.Remove(1);
+
+    ASSERT_FALSE(grid.Contains(1));
+    ASSERT_EQ(std::vector<int>({2}), Visit(grid, 5, 5, 0));
+}
+
+GTEST_TEST(SpatialGridTests, OutOfBoundsPositionsAreClamped)
+{
+    SpatialGrid grid;
+    grid.Reset(20, 20);
+
+    grid.Update(1, 255, 255);
+
+    ASSERT_EQ(std::vector<int>({1}), Visit(grid, 19, 19, 0));
+    ASSERT_EQ(std::vector<int>({1}), Visit(grid, -10, 300, 400));
+}
+
+GTEST_TEST(SpatialGridTests, EmptyGridIgnoresUpdates)
+{
+    SpatialGrid grid;
+
+    grid.Update(1, 0, 0);
+
+    ASSERT_EQ(0u, grid.Size());
+    ASSERT_TRUE(Visit(grid, 0, 0, 10).empty());
+}
@@ -1,5 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "util/semaphore.hpp"
 #include "util/threadpool.hpp"
 
@@ -16,14 +21,25 @@ public:
     TestThreadPool(size_t numThreads = 4)
         : ThreadPool(numThreads) { }
 
-    void QueueWork(const util::ThreadPool::WorkFunc workFunc, const void * state)
+    void QueueWork(const util::ThreadPool::WorkFunc workFunc, const void * state, Priority priority = Interactive)
     {
-        this->queueInternal(workFunc, state);
+        this->queueInternal(workFunc, state, priority);
     }
 
-    size_t GetNumThreads() const { return this->_threads.size(); }
+    size_t GetNumThreads() const { return this->_numWorkers; }
+
+    bool IsShutdown() const
+    {
+        for (auto& worker : this->_workers)
+        {
+            if (worker->thread.joinable())
+                return false;
+        }
+
+        return this->_terminating;
+    }
 
-    bool IsShutdown() const { return this->_workReadySemaphore.Count() == this->_threads.size() && this->_terminating; }
+    Stats GetStats() const { return this->getStatsInternal(); }
 
     void SetNumThreads(size_t numThreads)
     {
@@ -39,7 +55,6 @@ public:
     void JoinAll()
     {
         this->Shutdown();
-        this->_threads.clear();
     }
 };
 
@@ -279,3 +294,142 @@ GTEST_TEST(ThreadPoolTests, ShutdownPreventsStateChanges)
 
     testThreadPool.JoinAll();
 }
+
+GTEST_TEST(ThreadPoolTests, InteractiveWorkRunsBeforeBackgroundWork)
+{
+    TestThreadPool testThreadPool(1);
+
+    Semaphore blocker(0);
+    std::mutex orderLock;
+    std::vector<int> order;
+
+    auto record = [&order, &orderLock](const void * state)
+    {
+        std::lock_guard<std::mutex> guard(orderLock);
+        order.push_back(*reinterpret_cast<const int*>(state));
+    };
+
+    const int first = 1, second = 2, third = 3;
+
+    // Keep the only worker busy so everything else is waiting in the queues
+    testThreadPool.QueueWork([&blocker](const void *) { blocker.Wait(std::chrono::milliseconds(1000)); }, nullptr);
+    SLEEP_MS(50);
+
+    testThreadPool.QueueWork(record, &first, ThreadPool::Background);
+    testThreadPool.QueueWork(record, &second, ThreadPool::Interactive);
+    testThreadPool.QueueWork(record, &third, ThreadPool::Interactive);
+
+    blocker.Release();
+    SLEEP_MS(100);
+
+    std::lock_guard<std::mutex> guard(orderLock);
+    ASSERT_EQ((std::vector<int>{second, third, first}), order) << "Expected interactive work to run before background work";
+
+    testThreadPool.JoinAll();
+}
+
+GTEST_TEST(ThreadPoolTests, BackgroundWorkRunsFirstOnceItHasWaitedTooLong)
+{
+    TestThreadPool testThreadPool(1);
+
+    Semaphore blocker(0);
+    std::mutex orderLock;
+    std::vector<int> order;
+
+    auto record = [&order, &orderLock](const void * state)
+    {
+        std::lock_guard<std::mutex> guard(orderLock);
+        order.push_back(*reinterpret_cast<const int*>(state));
+    };
+
+    const int first = 1, second = 2, third = 3;
+
+    testThreadPool.QueueWork([&blocker](const void *) { blocker.Wait(std::chrono::milliseconds(2000)); }, nullptr);
+    SLEEP_MS(50);
+
+    testThreadPool.QueueWork(record, &first, ThreadPool::Background);
+    SLEEP_MS(ThreadPool::MAX_BACKGROUND_WAIT.count() + 100);
+
+    testThreadPool.QueueWork(record, &second, ThreadPool::Interactive);
+    testThreadPool.QueueWork(record, &third, ThreadPool::Interactive);
+
+    blocker.Release();
+    SLEEP_MS(100);
+
+    std::lock_guard<std::mutex> guard(orderLock);
+    ASSERT_EQ((std::vector<int>{first, second, third}), order) << "Expected background work to stop waiting behind interactive work once it is overdue";
+
+    testThreadPool.JoinAll();
+}
+
+GTEST_TEST(ThreadPoolTests, ResizeLessThreadsKeepsQueuedWork)
+{
+    const size_t defaultMaxThreads = 4;
+    const unsigned queuedWork = 12;
+
+    TestThreadPool testThreadPool(defaultMaxThreads);
+
+    Semaphore blocker(0);
+    std::atomic<unsigned> workCounter(0);
+
+    for (size_t i = 0; i < defaultMaxThreads; ++i)
+        testThreadPool.QueueWork([&blocker](const void *) { blocker.Wait(std::chrono::milliseconds(1000)); }, nullptr);
+
+    // Spread across every worker's queue, including the ones about to be retired
+    for (unsigned i = 0; i < queuedWork; ++i)
+        testThreadPool.QueueWork([&workCounter](const void *) { ++workCounter; }, nullptr);
+
+    std::thread releaser([&blocker, defaultMaxThreads]()
+    {
+        SLEEP_MS(100);
+        blocker.Release(defaultMaxThreads);
+    });
+
+    testThreadPool.SetNumThreads(1);
+    releaser.join();
+
+    SLEEP_MS(100);
+    ASSERT_EQ(1u, testThreadPool.GetNumThreads());
+    ASSERT_EQ(queuedWork, workCounter) << "Expected work queued before the resize to still run";
+
+    testThreadPool.JoinAll();
+}
+
+GTEST_TEST(ThreadPoolTests, StatsCountQueuedAndCompletedWork)
+{
+    TestThreadPool testThreadPool(2);
+
+    Semaphore workDone(0, 5);
+    auto workFunc = [&workDone](const void *)
+    {
+        SLEEP_MS(10);
+        workDone.Release();
+    };
+
+    for (int i = 0; i < 3; ++i)
+        testThreadPool.QueueWork(workFunc, nullptr, ThreadPool::Interactive);
+
+    for (int i = 0; i < 2; ++i)
+        testThreadPool.QueueWork(workFunc, nullptr, ThreadPool::Background);
+
+    while (workDone.Count() < workDone.MaxCount())
+        SLEEP_MS(10);
+
+    SLEEP_MS(50);
+
+    ThreadPool::Stats stats = testThreadPool.GetStats();
+    const ThreadPool::LaneStats& interactive = stats.lanes[ThreadPool::Interactive];
+    const ThreadPool::LaneStats& background = stats.lanes[ThreadPool::Background];
+
+    ASSERT_EQ(2u, stats.threads);
+    ASSERT_EQ(3u, interactive.queued);
+    ASSERT_EQ(3u, interactive.completed);
+    ASSERT_EQ(0u, interactive.depth);
+    ASSERT_EQ(2u, background.queued);
+    ASSERT_EQ(2u, background.completed);
+    ASSERT_EQ(0u, background.depth);
+    ASSERT_GE(interactive.run_total_us, 3u * 10000u);
+    ASSERT_GE(interactive.wait_max_us * 3, interactive.wait_total_us);
+
+    testThreadPool.JoinAll();
+}
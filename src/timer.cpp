@@ -12,11 +12,14 @@
 #include "socket.hpp"
 #include "util.hpp"
 
+#include <algorithm>
+#include <cstddef>
 #include <ctime>
 #include <exception>
 #include <memory>
 #include <stdexcept>
 #include <mutex>
+#include <vector>
 
 #include "platform.h"
 
@@ -107,6 +110,9 @@ void Clock::SetMaxDelta(int max_delta)
 
 std::unique_ptr<Clock> Timer::clock;
 
+const std::size_t Timer::NOT_QUEUED = std::size_t(-1);
+const std::size_t Timer::DEFERRED = std::size_t(-2);
+
 struct Timer::impl_t
 {
 	std::mutex m;
@@ -157,8 +163,6 @@ Timer::Timer()
 	};
 
 	this->resolution = sum / 100.0 - first;
-
-	this->changed = true;
 }
 
 double Timer::GetTime()
@@ -177,82 +181,179 @@ void Timer::SetMaxDelta(int max_delta)
 		clock->SetMaxDelta(max_delta);
 }
 
+void Timer::QueuePush(TimeEvent *timer)
+{
+	timer->queue_index = this->queue.size();
+	this->queue.push_back(timer);
+	this->QueueSiftUp(timer->queue_index);
+}
+
+void Timer::QueueRemove(std::size_t index)
+{
+	TimeEvent *removed = this->queue[index];
+	TimeEvent *last = this->queue.back();
+	this->queue.pop_back();
+
+	if (removed != last)
+	{
+		this->queue[index] = last;
+		last->queue_index = index;
+		this->QueueSiftUp(index);
+		this->QueueSiftDown(last->queue_index);
+	}
+
+	removed->queue_index = Timer::NOT_QUEUED;
+}
+
+void Timer::QueueSiftUp(std::size_t index)
+{
+	TimeEvent *timer = this->queue[index];
+
+	while (index > 0)
+	{
+		std::size_t parent = (index - 1) / 2;
+
+		if (!(timer->deadline < this->queue[parent]->deadline))
+			break;
+
+		this->queue[index] = this->queue[parent];
+		this->queue[index]->queue_index = index;
+		index = parent;
+	}
+
+	this->queue[index] = timer;
+	timer->queue_index = index;
+}
+
+void Timer::QueueSiftDown(std::size_t index)
+{
+	TimeEvent *timer = this->queue[index];
+	std::size_t size = this->queue.size();
+
+	while (true)
+	{
+		std::size_t child = index * 2 + 1;
+
+		if (child >= size)
+			break;
+
+		if (child + 1 < size && this->queue[child + 1]->deadline < this->queue[child]->deadline)
+			++child;
+
+		if (!(this->queue[child]->deadline < timer->deadline))
+			break;
+
+		this->queue[index] = this->queue[child];
+		this->queue[index]->queue_index = index;
+		index = child;
+	}
+
+	this->queue[index] = timer;
+	timer->queue_index = index;
+}
+
+void Timer::Dequeue(TimeEvent *timer)
+{
+	if (timer->queue_index == Timer::DEFERRED)
+	{
+		this->deferred.erase(std::find(UTIL_RANGE(this->deferred), timer));
+		timer->queue_index = Timer::NOT_QUEUED;
+	}
+	else if (timer->queue_index != Timer::NOT_QUEUED)
+	{
+		this->QueueRemove(timer->queue_index);
+	}
+}
+
 void Timer::Tick()
 {
 	double currenttime = Timer::GetTime();
 
 	impl->lock();
-	if (this->changed)
-	{
-		this->execlist = this->timers;
-		this->changed = false;
-	}
 
-	UTIL_FOREACH(this->execlist, timer)
+	while (!this->queue.empty() && this->queue.front()->deadline < currenttime)
 	{
-		if (this->timers.find(timer) == this->timers.end())
-			continue;
+		TimeEvent *timer = this->queue.front();
+		this->QueueRemove(0);
+
+		timer->lasttime += timer->speed;
+		timer->deadline = timer->lasttime + timer->speed;
+
+		bool expired = false;
 
-		if (timer->lasttime + timer->speed < currenttime)
+		if (timer->lifetime != Timer::FOREVER)
 		{
-			impl->unlock();
-			timer->lasttime += timer->speed;
+			--timer->lifetime;
+			expired = (timer->lifetime == 0);
+		}
 
-			if (timer->lifetime != Timer::FOREVER)
-			{
-				--timer->lifetime;
+		if (expired)
+		{
+			timer->manager = 0;
+		}
+		else if (timer->deadline < currenttime)
+		{
+			timer->queue_index = Timer::DEFERRED;
+			this->deferred.push_back(timer);
+		}
+		else
+		{
+			this->QueuePush(timer);
+		}
 
-				if (timer->lifetime == 0)
-				{
-					this->Unregister(timer);
-				}
-			}
+		impl->unlock();
 
 #ifndef DEBUG_EXCEPTIONS
-			try
-			{
+		try
+		{
 #endif // DEBUG_EXCEPTIONS
-				timer->callback(timer->param);
+			timer->callback(timer->param);
 #ifndef DEBUG_EXCEPTIONS
-			}
-			catch (Socket_Exception& e)
-			{
-				Console::Err("Timer callback caused an exception");
-				Console::Err("%s: %s", e.what(), e.error());
-			}
-			catch (Database_Exception& e)
-			{
-				Console::Err("Timer callback caused an exception");
-				Console::Err("%s: %s", e.what(), e.error());
-			}
-			catch (std::runtime_error& e)
-			{
-				Console::Err("Timer callback caused an exception");
-				Console::Err("Runtime Error: %s", e.what());
-			}
-			catch (std::logic_error& e)
-			{
-				Console::Err("Timer callback caused an exception");
-				Console::Err("Logic Error: %s", e.what());
-			}
-			catch (std::exception& e)
-			{
-				Console::Err("Timer callback caused an exception");
-				Console::Err("Uncaught Exception: %s", e.what());
-			}
-			catch (...)
-			{
-				Console::Err("Timer callback caused an exception");
-			}
+		}
+		catch (Socket_Exception& e)
+		{
+			Console::Err("Timer callback caused an exception");
+			Console::Err("%s: %s", e.what(), e.error());
+		}
+		catch (Database_Exception& e)
+		{
+			Console::Err("Timer callback caused an exception");
+			Console::Err("%s: %s", e.what(), e.error());
+		}
+		catch (std::runtime_error& e)
+		{
+			Console::Err("Timer callback caused an exception");
+			Console::Err("Runtime Error: %s", e.what());
+		}
+		catch (std::logic_error& e)
+		{
+			Console::Err("Timer callback caused an exception");
+			Console::Err("Logic Error: %s", e.what());
+		}
+		catch (std::exception& e)
+		{
+			Console::Err("Timer callback caused an exception");
+			Console::Err("Uncaught Exception: %s", e.what());
+		}
+		catch (...)
+		{
+			Console::Err("Timer callback caused an exception");
+		}
 #endif // DEBUG_EXCEPTIONS
 
-			if (timer->manager == 0)
-				delete timer;
+		if (timer->manager == 0)
+			delete timer;
 
-			impl->lock();
-		}
+		impl->lock();
+	}
+
+	UTIL_FOREACH(this->deferred, timer)
+	{
+		this->QueuePush(timer);
 	}
 
+	this->deferred.clear();
+
 	impl->unlock();
 }
 
@@ -263,20 +364,28 @@ void Timer::Register(TimeEvent *timer)
 		return;
 	}
 
-	timer->lasttime = Timer::GetTime();
-	timer->manager = this;
+	double currenttime = Timer::GetTime();
 
 	impl->lock();
-	this->changed = true;
-	this->timers.insert(timer);
+
+	if (timer->manager == this)
+		this->Dequeue(timer);
+
+	timer->lasttime = currenttime;
+	timer->deadline = timer->lasttime + timer->speed;
+	timer->manager = this;
+	this->QueuePush(timer);
+
 	impl->unlock();
 }
 
 void Timer::Unregister(TimeEvent *timer)
 {
 	impl->lock();
-	this->changed = true;
-	this->timers.erase(timer);
+
+	if (timer->manager == this)
+		this->Dequeue(timer);
+
 	impl->unlock();
 	timer->manager = 0;
 }
@@ -284,12 +393,18 @@ void Timer::Unregister(TimeEvent *timer)
 Timer::~Timer()
 {
 	impl->lock();
-	UTIL_FOREACH(this->timers, timer)
+
+	this->queue.insert(this->queue.end(), UTIL_RANGE(this->deferred));
+	this->deferred.clear();
+
+	UTIL_FOREACH(this->queue, timer)
 	{
 		timer->manager = 0;
+		timer->queue_index = Timer::NOT_QUEUED;
 		delete timer;
 	}
-	this->timers.clear();
+
+	this->queue.clear();
 	impl->unlock();
 
 #ifdef WIN32
@@ -306,7 +421,10 @@ TimeEvent::TimeEvent(TimerCallback callback, void *param, double speed, int life
 	this->callback = callback;
 	this->param = param;
 	this->speed = speed;
+	this->lasttime = 0.0;
 	this->lifetime = lifetime;
+	this->deadline = 0.0;
+	this->queue_index = Timer::NOT_QUEUED;
 	this->manager = 0;
 }
 
@@ -317,3 +435,56 @@ TimeEvent::~TimeEvent()
 		this->manager->Unregister(this);
 	}
 }
+
+// Recycled TimeEvent storage. Events are created from the SLN thread as well, so access is locked.
+// The pool is never destroyed, so events deleted during static destruction are still safe.
+struct time_event_pool_t
+{
+	std::mutex m;
+	std::vector<void *> blocks;
+	static const std::size_t max_blocks = 1024;
+};
+
+static time_event_pool_t& time_event_pool()
+{
+	static time_event_pool_t *pool = new time_event_pool_t;
+	return *pool;
+}
+
+void *TimeEvent::operator new(std::size_t size)
+{
+	if (size == sizeof(TimeEvent))
+	{
+		time_event_pool_t& pool = time_event_pool();
+		std::lock_guard<std::mutex> lock(pool.m);
+
+		if (!pool.blocks.empty())
+		{
+			void *ptr = pool.blocks.back();
+			pool.blocks.pop_back();
+			return ptr;
+		}
+	}
+
+	return ::operator new(size);
+}
+
+void TimeEvent::operator delete(void *ptr, std::size_t size)
+{
+	if (!ptr)
+		return;
+
+	if (size == sizeof(TimeEvent))
+	{
+		time_event_pool_t& pool = time_event_pool();
+		std::lock_guard<std::mutex> lock(pool.m);
+
+		if (pool.blocks.size() < time_event_pool_t::max_blocks)
+		{
+			pool.blocks.push_back(ptr);
+			return;
+		}
+	}
+
+	::operator delete(ptr);
+}
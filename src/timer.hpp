@@ -9,8 +9,9 @@
 
 #include "fwd/timer.hpp"
 
+#include <cstddef>
 #include <memory>
-#include <set>
+#include <vector>
 
 #include "platform.h"
 
@@ -47,19 +48,25 @@ class Timer
 
 	protected:
 		/**
-		 * List of TimeEvent objects a Timer controls
+		 * TimeEvent objects a Timer controls, as a binary min-heap ordered by when they are next due
 		 */
-		std::set<TimeEvent *> timers;
+		std::vector<TimeEvent *> queue;
 
 		/**
-		 * Copy of timers which is used to allow timers to unregister themselves safely
+		 * TimeEvent objects that already ticked during the current Tick() but are still behind
+		 * They rejoin the queue once Tick() finishes, so an event never ticks twice in one Tick()
 		 */
-		std::set<TimeEvent *> execlist;
+		std::vector<TimeEvent *> deferred;
+
+		void QueuePush(TimeEvent *);
+		void QueueRemove(std::size_t index);
+		void QueueSiftUp(std::size_t index);
+		void QueueSiftDown(std::size_t index);
 
 		/**
-		 * Used to track when execlist needs to be remade
+		 * Removes a TimeEvent from the queue or deferred list, whichever it's in
 		 */
-		bool changed;
+		void Dequeue(TimeEvent *);
 
 	public:
 		/**
@@ -67,6 +74,16 @@ class Timer
 		 */
 		static const int FOREVER = -1;
 
+		/**
+		 * TimeEvent::queue_index of an event that isn't waiting in a Timer
+		 */
+		static const std::size_t NOT_QUEUED;
+
+		/**
+		 * TimeEvent::queue_index of an event waiting in the deferred list
+		 */
+		static const std::size_t DEFERRED;
+
 		double resolution;
 
 		Timer();
@@ -80,7 +97,8 @@ class Timer
 		static void SetMaxDelta(int max_delta);
 
 		/**
-		 * Check all contained TimeEvent objects and call any which are ready
+		 * Call any contained TimeEvent objects which are ready
+		 * Only events which are due are visited, so the cost doesn't grow with the number of registered events
 		 */
 		void Tick();
 
@@ -136,6 +154,16 @@ struct TimeEvent
 	 */
 	int lifetime;
 
+	/**
+	 * Time the event is next due to tick (lasttime + speed)
+	 */
+	double deadline;
+
+	/**
+	 * Position in the owning Timer's queue
+	 */
+	std::size_t queue_index;
+
 	/**
 	 * Construct a new TimeEvent object
 	 */
@@ -145,6 +173,12 @@ struct TimeEvent
 	 * Unregister the object from it's owning Timer object if it has one
 	 */
 	~TimeEvent();
+
+	/**
+	 * TimeEvent objects are created and destroyed constantly, so their storage is recycled through a free list
+	 */
+	static void *operator new(std::size_t size);
+	static void operator delete(void *ptr, std::size_t size);
 };
 
 #endif // TIMER_HPP_INCLUDED
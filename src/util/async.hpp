@@ -6,11 +6,64 @@
 
 #pragma once
 
+#include <cstddef>
+#include <exception>
 #include <functional>
 
+#include "mpsc_queue.hpp"
 #include "threadpool.hpp"
+#include "../console.hpp"
 #include "../eoclient.hpp"
 
+/**
+ * Work handed back to the main thread by other threads, such as the callbacks of a finished AsyncOperation.
+ * EOServer::Tick drains it, so anything posted here can safely touch clients and the world.
+ */
+class AsyncCompletionQueue
+{
+public:
+    /**
+     * Queues a function to run on the main thread. Safe to call from any thread.
+     */
+    static void Post(std::function<void()> completion)
+    {
+        Queue().Push(std::move(completion));
+    }
+
+    /**
+     * Runs everything posted so far. Must only be called from the main thread.
+     * Returns the number of completions that were run.
+     */
+    static std::size_t Drain()
+    {
+        std::function<void()> completion;
+        std::size_t count = 0;
+
+        while (Queue().Pop(completion))
+        {
+            ++count;
+
+            try
+            {
+                completion();
+            }
+            catch (const std::exception& e)
+            {
+                Console::Err("Exception in async completion: %s", e.what());
+            }
+        }
+
+        return count;
+    }
+
+private:
+    static util::MPSCQueue<std::function<void()>>& Queue()
+    {
+        static util::MPSCQueue<std::function<void()>> queue;
+        return queue;
+    }
+};
+
 template<typename TState, typename TResult = int>
 class AsyncOperation
 {
@@ -41,6 +94,33 @@ public:
         return this;
     }
 
+    // Called instead of any other callback if the operation is dropped before it starts, when the client may already be gone
+    AsyncOperation* OnCancel(std::function<void(void)> callback)
+    {
+        this->_cancelCallbacks.push_back(callback);
+        return this;
+    }
+
+    // Deletes an operation that was never started. With notify set the cancel callbacks are run first.
+    void Cancel(bool notify = true)
+    {
+        if (notify)
+        {
+            for (auto& cb : this->_cancelCallbacks)
+                cb();
+        }
+
+        delete this;
+    }
+
+    // Lets the owner decide when the operation starts. The dispatcher is called on the main thread with a function that
+    //   queues the operation on the threadpool, and must call it exactly once unless the operation is deleted instead.
+    AsyncOperation* DispatchWith(std::function<void(std::function<void()>)> dispatcher)
+    {
+        this->_dispatcher = dispatcher;
+        return this;
+    }
+
     void Execute(const std::shared_ptr<TState>& state);
 
     virtual ~AsyncOperation()
@@ -48,6 +128,7 @@ public:
         this->_successCallbacks.clear();
         this->_failureCallbacks.clear();
         this->_completeCallbacks.clear();
+        this->_cancelCallbacks.clear();
     }
 
 private:
@@ -56,11 +137,13 @@ private:
 
     EOClient* _client;
     std::function<TResult(std::shared_ptr<TState>)> _operation;
+    std::function<void(std::function<void()>)> _dispatcher;
     TResult _successCode, _result;
 
     std::list<std::function<void(EOClient*)>> _successCallbacks;
     std::list<std::function<void(EOClient*, TResult)>> _failureCallbacks;
     std::list<std::function<void(void)>> _completeCallbacks;
+    std::list<std::function<void(void)>> _cancelCallbacks;
 };
 
 template<typename TState, typename TResult>
@@ -73,14 +156,11 @@ void AsyncOperation<TState, TResult>::Execute(const std::shared_ptr<TState>& sta
 
     this->_client->AsyncOpPending(true);
 
-    auto workerProc = [this, state](const void*)
+    // Runs the callbacks and cleans up. Always runs on the main thread, either directly or through AsyncCompletionQueue.
+    auto complete = [this]()
     {
         try
         {
-            this->_result = this->_operation
-                ? this->_operation(state)
-                : this->_result;
-
             if (this->_result == this->_successCode)
             {
                 for (auto& cb : this->_successCallbacks)
@@ -91,27 +171,6 @@ void AsyncOperation<TState, TResult>::Execute(const std::shared_ptr<TState>& sta
                 for (auto& cb : this->_failureCallbacks)
                     cb(this->_client, this->_result);
             }
-
-            this->_client->AsyncOpPending(false);
-            for (auto& cb : this->_completeCallbacks)
-                cb();
-
-            // why `delete this`?
-            //
-            // AsyncOperation *must* be allocated with new in order for the long-running operation to keep going even after the calling
-            // context goes out of scope. In order to clean up these objects, we either have to rely on the caller to manually delete the
-            // object that is returned, or we can clean it up automatically here. Alternatively we could introduce a GC-like mechanism that
-            // periodically audits any AsyncOperation objects to see if they're still running and then deletes them, but that introduces
-            // tight coupling with AsyncOperation to other classes (World probably).
-            //
-            // Two assumptions:
-            // 1. The caller does not use AsyncOperation after it has completed its work (unlikely anyway)
-            // 2. The creator of AsyncOperation uses new to allocate it so delete doesn't corrupt the stack (hopefully they see this comment)
-            //
-            // This is very dangerous and I still don't like it but I think it's the best option available for dealing with how to clean
-            // up the memory. At this point the operation is done and there shouldn't be a reference to it anymore anyway so I think it should be fine.
-            //
-            delete this;
         }
         catch (std::exception&)
         {
@@ -122,13 +181,67 @@ void AsyncOperation<TState, TResult>::Execute(const std::shared_ptr<TState>& sta
             delete this;
             throw;
         }
+
+        this->_client->AsyncOpPending(false);
+        for (auto& cb : this->_completeCallbacks)
+            cb();
+
+        // why `delete this`?
+        //
+        // AsyncOperation *must* be allocated with new in order for the long-running operation to keep going even after the calling
+        // context goes out of scope. In order to clean up these objects, we either have to rely on the caller to manually delete the
+        // object that is returned, or we can clean it up automatically here. Alternatively we could introduce a GC-like mechanism that
+        // periodically audits any AsyncOperation objects to see if they're still running and then deletes them, but that introduces
+        // tight coupling with AsyncOperation to other classes (World probably).
+        //
+        // Two assumptions:
+        // 1. The caller does not use AsyncOperation after it has completed its work (unlikely anyway)
+        // 2. The creator of AsyncOperation uses new to allocate it so delete doesn't corrupt the stack (hopefully they see this comment)
+        //
+        // This is very dangerous and I still don't like it but I think it's the best option available for dealing with how to clean
+        // up the memory. At this point the operation is done and there shouldn't be a reference to it anymore anyway so I think it should be fine.
+        //
+        delete this;
     };
 
     // If there is an operation, queue it on the threadpool
     // There may not be an operation if the result is already known, in that case
-    //   invoke the procedure synchronously so the callbacks still get called
-    if (this->_operation != nullptr)
-        util::ThreadPool::Queue(workerProc, nullptr);
-    else
-        workerProc(nullptr);
+    //   invoke the callbacks synchronously so they still get called
+    if (this->_operation == nullptr)
+    {
+        complete();
+        return;
+    }
+
+    // The worker thread only does the blocking work, the callbacks are handed back to the main thread
+    auto workerProc = [this, state, complete](const void*)
+    {
+        try
+        {
+            this->_result = this->_operation(state);
+        }
+        catch (std::exception&)
+        {
+            AsyncCompletionQueue::Post([this]()
+            {
+                this->_client->AsyncOpPending(false);
+                for (auto& cb : this->_completeCallbacks)
+                    cb();
+
+                delete this;
+            });
+
+            throw;
+        }
+
+        AsyncCompletionQueue::Post(complete);
+    };
+
+    if (this->_dispatcher)
+    {
+        this->_dispatcher([workerProc]() { util::ThreadPool::Queue(workerProc, nullptr, util::ThreadPool::Interactive); });
+        return;
+    }
+
+    util::ThreadPool::Queue(workerProc, nullptr, util::ThreadPool::Interactive);
 }
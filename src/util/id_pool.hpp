@@ -0,0 +1,120 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace util
+{
+
+/**
+ * Hands out the lowest unused ID, starting from a fixed first ID.
+ * IDs in use are tracked in a bitmap, and the first word with a free bit is remembered so finding the next ID doesn't rescan full words.
+ * IDs below the first ID are ignored.
+ */
+class IDPool
+{
+public:
+    explicit IDPool(unsigned int first = 1)
+        : _first(first)
+        , _hint(0) { }
+
+    /**
+     * Returns the lowest free ID without taking it
+     */
+    unsigned int Next() const
+    {
+        if (this->_hint == this->_used.size())
+            return this->_first + static_cast<unsigned int>(this->_used.size() * WordBits);
+
+        const std::uint64_t word = this->_used[this->_hint];
+        unsigned int bit = 0;
+
+        while (word & (std::uint64_t(1) << bit))
+            ++bit;
+
+        return this->_first + static_cast<unsigned int>(this->_hint * WordBits) + bit;
+    }
+
+    /**
+     * Takes and returns the lowest free ID
+     */
+    unsigned int Acquire()
+    {
+        const unsigned int id = this->Next();
+        this->Take(id);
+        return id;
+    }
+
+    /**
+     * Marks an ID as in use, for objects created with a known ID
+     */
+    void Take(unsigned int id)
+    {
+        if (id < this->_first)
+            return;
+
+        const std::size_t word = (id - this->_first) / WordBits;
+
+        if (word >= this->_used.size())
+            this->_used.resize(word + 1, 0);
+
+        this->_used[word] |= std::uint64_t(1) << ((id - this->_first) % WordBits);
+
+        while (this->_hint < this->_used.size() && this->_used[this->_hint] == ~std::uint64_t(0))
+            ++this->_hint;
+    }
+
+    /**
+     * Marks an ID as free so it can be handed out again
+     */
+    void Release(unsigned int id)
+    {
+        if (id < this->_first)
+            return;
+
+        const std::size_t word = (id - this->_first) / WordBits;
+
+        if (word >= this->_used.size())
+            return;
+
+        this->_used[word] &= ~(std::uint64_t(1) << ((id - this->_first) % WordBits));
+
+        if (word < this->_hint)
+            this->_hint = word;
+    }
+
+    bool InUse(unsigned int id) const
+    {
+        if (id < this->_first)
+            return false;
+
+        const std::size_t word = (id - this->_first) / WordBits;
+
+        return word < this->_used.size() && (this->_used[word] & (std::uint64_t(1) << ((id - this->_first) % WordBits)));
+    }
+
+    /**
+     * Frees every ID
+     */
+    void Clear()
+    {
+        this->_used.clear();
+        this->_hint = 0;
+    }
+
+private:
+    static const std::size_t WordBits = 64;
+
+    std::vector<std::uint64_t> _used;
+    unsigned int _first;
+    std::size_t _hint;
+};
+
+}
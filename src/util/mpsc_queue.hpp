@@ -0,0 +1,89 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace util
+{
+
+/**
+ * Lock-free queue that any number of threads can push to and a single thread pops from.
+ * Pushing is one atomic exchange, so producers never wait on each other or on the consumer.
+ * An item whose push is still in progress may not be visible to Pop until the next call.
+ */
+template <class T>
+class MPSCQueue
+{
+public:
+    MPSCQueue()
+        : _head(new Node())
+        , _tail(_head.load()) { }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    ~MPSCQueue()
+    {
+        T discard;
+
+        while (this->Pop(discard))
+            ;
+
+        delete this->_tail;
+    }
+
+    /**
+     * Adds an item to the back of the queue. Safe to call from any thread.
+     */
+    void Push(T value)
+    {
+        Node *node = new Node(std::move(value));
+        Node *prev = this->_head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * Takes the item at the front of the queue. Must only be called from the consuming thread.
+     */
+    bool Pop(T& out)
+    {
+        Node *tail = this->_tail;
+        Node *next = tail->next.load(std::memory_order_acquire);
+
+        if (!next)
+            return false;
+
+        // next becomes the new empty stub node
+        out = std::move(next->value);
+        this->_tail = next;
+        delete tail;
+
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node *> next;
+        T value;
+
+        Node()
+            : next(nullptr) { }
+
+        explicit Node(T&& value)
+            : next(nullptr)
+            , value(std::move(value)) { }
+    };
+
+    // Producers swap themselves in at the head, the consumer walks from the tail
+    std::atomic<Node *> _head;
+    Node *_tail;
+};
+
+}
@@ -0,0 +1,156 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "nav_grid.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <queue>
+#include <tuple>
+
+namespace util
+{
+
+void NavGrid::Reset(int width, int height)
+{
+    this->_width = std::max(width, 0);
+    this->_height = std::max(height, 0);
+
+    const std::size_t tiles = std::size_t(this->_width) * this->_height;
+
+    this->_walkable.assign((tiles + 63) / 64, 0);
+
+    // Scratch space is only allocated by the first search, most grids are never searched
+    std::vector<std::uint32_t>().swap(this->_seen);
+    std::vector<int>().swap(this->_cost);
+    std::vector<int>().swap(this->_parent);
+    this->_generation = 0;
+}
+
+void NavGrid::SetWalkable(int x, int y, bool walkable)
+{
+    if (x < 0 || y < 0 || x >= this->_width || y >= this->_height)
+        return;
+
+    const std::size_t i = this->Index(x, y);
+
+    if (walkable)
+        this->_walkable[i / 64] |= std::uint64_t(1) << (i % 64);
+    else
+        this->_walkable[i / 64] &= ~(std::uint64_t(1) << (i % 64));
+}
+
+bool NavGrid::Walkable(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= this->_width || y >= this->_height)
+        return false;
+
+    const std::size_t i = this->Index(x, y);
+
+    return this->_walkable[i / 64] & (std::uint64_t(1) << (i % 64));
+}
+
+bool NavGrid::FindPath(Point start, Point goal, std::size_t max_nodes, std::vector<Point>& path, const BlockedFunc& blocked) const
+{
+    path.clear();
+
+    if (start.x < 0 || start.y < 0 || start.x >= this->_width || start.y >= this->_height
+     || goal.x < 0 || goal.y < 0 || goal.x >= this->_width || goal.y >= this->_height)
+        return false;
+
+    if (start == goal)
+        return true;
+
+    const std::size_t tiles = std::size_t(this->_width) * this->_height;
+
+    if (this->_seen.size() != tiles)
+    {
+        this->_seen.assign(tiles, 0);
+        this->_cost.assign(tiles, 0);
+        this->_parent.assign(tiles, -1);
+    }
+
+    if (++this->_generation == 0)
+    {
+        std::fill(this->_seen.begin(), this->_seen.end(), 0);
+        this->_generation = 1;
+    }
+
+    auto heuristic = [&goal](int x, int y) { return std::abs(x - goal.x) + std::abs(y - goal.y); };
+
+    // (estimated total cost, estimate remaining, tile index), smallest first. Ties prefer tiles closer to the goal.
+    using Node = std::tuple<int, int, int>;
+    std::priority_queue<Node, std::vector<Node>, std::greater<Node>> open;
+
+    const int start_index = int(this->Index(start.x, start.y));
+    const int goal_index = int(this->Index(goal.x, goal.y));
+
+    this->_seen[start_index] = this->_generation;
+    this->_cost[start_index] = 0;
+    this->_parent[start_index] = -1;
+    open.emplace(heuristic(start.x, start.y), heuristic(start.x, start.y), start_index);
+
+    static const int step_x[4] = {0, -1, 0, 1};
+    static const int step_y[4] = {1, 0, -1, 0};
+
+    std::size_t expanded = 0;
+
+    while (!open.empty() && expanded < max_nodes)
+    {
+        const int f = std::get<0>(open.top());
+        const int h = std::get<1>(open.top());
+        const int index = std::get<2>(open.top());
+        open.pop();
+
+        const int cost = this->_cost[index];
+
+        // Stale entry for a tile that has since been reached more cheaply
+        if (f - h != cost)
+            continue;
+
+        if (index == goal_index)
+        {
+            for (int i = goal_index; i != start_index; i = this->_parent[i])
+                path.push_back({i % this->_width, i / this->_width});
+
+            std::reverse(path.begin(), path.end());
+            return true;
+        }
+
+        ++expanded;
+
+        const int x = index % this->_width;
+        const int y = index / this->_width;
+
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            const int nx = x + step_x[dir];
+            const int ny = y + step_y[dir];
+
+            if (nx < 0 || ny < 0 || nx >= this->_width || ny >= this->_height)
+                continue;
+
+            const int next = int(this->Index(nx, ny));
+
+            if (next != goal_index && (!this->Walkable(nx, ny) || (blocked && blocked(nx, ny))))
+                continue;
+
+            if (this->_seen[next] == this->_generation && this->_cost[next] <= cost + 1)
+                continue;
+
+            this->_seen[next] = this->_generation;
+            this->_cost[next] = cost + 1;
+            this->_parent[next] = index;
+
+            const int next_h = heuristic(nx, ny);
+            open.emplace(cost + 1 + next_h, next_h, next);
+        }
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,77 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace util
+{
+
+/**
+ * Walkability bitmap of a tile map with a bounded A* search over it.
+ * Movement is in the four cardinal directions only, each step costing the same.
+ * Walkability takes one bit per tile. Search scratch space is allocated by the first search and kept between calls,
+ * so a grid must not be searched from more than one thread at a time.
+ */
+class NavGrid
+{
+public:
+    struct Point
+    {
+        int x;
+        int y;
+
+        bool operator==(const Point& other) const { return this->x == other.x && this->y == other.y; }
+        bool operator!=(const Point& other) const { return !(*this == other); }
+    };
+
+    /**
+     * Extra tiles to avoid during a single search, such as ones occupied by other NPCs
+     */
+    using BlockedFunc = std::function<bool(int x, int y)>;
+
+    NavGrid()
+        : _width(0)
+        , _height(0)
+        , _generation(0) { }
+
+    /**
+     * Resizes the grid and marks every tile as unwalkable
+     */
+    void Reset(int width, int height);
+
+    int Width() const { return this->_width; }
+    int Height() const { return this->_height; }
+
+    void SetWalkable(int x, int y, bool walkable);
+    bool Walkable(int x, int y) const;
+
+    /**
+     * Finds a shortest path from start to goal, expanding at most max_nodes tiles.
+     * On success path holds every step after start, ending with goal, and true is returned.
+     * The goal itself does not have to be walkable, so a path can lead up to something standing on an unwalkable tile.
+     */
+    bool FindPath(Point start, Point goal, std::size_t max_nodes, std::vector<Point>& path, const BlockedFunc& blocked = nullptr) const;
+
+private:
+    std::size_t Index(int x, int y) const { return std::size_t(y) * this->_width + x; }
+
+    int _width;
+    int _height;
+    std::vector<std::uint64_t> _walkable;
+
+    // Search scratch space, entries are only valid where _seen matches _generation
+    mutable std::vector<std::uint32_t> _seen;
+    mutable std::vector<int> _cost;
+    mutable std::vector<int> _parent;
+    mutable std::uint32_t _generation;
+};
+
+}
@@ -0,0 +1,120 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#include "ring_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace util
+{
+
+RingBuffer::RingBuffer(std::size_t capacity)
+    : RingBuffer()
+{
+    this->Reset(capacity);
+}
+
+void RingBuffer::Reset(std::size_t capacity)
+{
+    if ((capacity & (capacity - 1)) != 0)
+        throw std::runtime_error("Buffer size must be a power of two");
+
+    this->_buffer.assign(capacity, char());
+    this->Clear();
+}
+
+void RingBuffer::Clear()
+{
+    this->_head = 0;
+    this->_used = 0;
+}
+
+bool RingBuffer::Write(const char *data, std::size_t length)
+{
+    if (length > this->Free())
+        return false;
+
+    auto segments = this->WriteSegments(length);
+
+    std::memcpy(segments[0].data, data, segments[0].length);
+
+    if (segments[1].length > 0)
+        std::memcpy(segments[1].data, data + segments[0].length, segments[1].length);
+
+    this->_used += length;
+
+    return true;
+}
+
+std::size_t RingBuffer::Read(char *out, std::size_t length)
+{
+    length = this->Peek(out, length);
+    this->Consume(length);
+
+    return length;
+}
+
+std::size_t RingBuffer::Peek(char *out, std::size_t length, std::size_t offset) const
+{
+    if (offset >= this->_used)
+        return 0;
+
+    length = std::min(length, this->_used - offset);
+
+    const std::size_t pos = (this->_head + offset) & this->Mask();
+    const std::size_t first = std::min(length, this->_buffer.size() - pos);
+
+    std::memcpy(out, &this->_buffer[pos], first);
+
+    if (first < length)
+        std::memcpy(out + first, &this->_buffer[0], length - first);
+
+    return length;
+}
+
+void RingBuffer::Consume(std::size_t length)
+{
+    length = std::min(length, this->_used);
+
+    this->_head = (this->_head + length) & this->Mask();
+    this->_used -= length;
+
+    // Keep reads contiguous for as long as possible
+    if (this->_used == 0)
+        this->_head = 0;
+}
+
+RingBuffer::Segments RingBuffer::ReadSegments(std::size_t length)
+{
+    return this->MakeSegments(this->_head, std::min(length, this->_used));
+}
+
+RingBuffer::Segments RingBuffer::WriteSegments(std::size_t length)
+{
+    return this->MakeSegments((this->_head + this->_used) & this->Mask(), std::min(length, this->Free()));
+}
+
+void RingBuffer::Commit(std::size_t length)
+{
+    if (length > this->Free())
+        throw std::runtime_error("Ring buffer overflow");
+
+    this->_used += length;
+}
+
+RingBuffer::Segments RingBuffer::MakeSegments(std::size_t pos, std::size_t length)
+{
+    if (length == 0)
+        return {{ { nullptr, 0 }, { nullptr, 0 } }};
+
+    const std::size_t first = std::min(length, this->_buffer.size() - pos);
+
+    return {{ { &this->_buffer[pos], first }, { &this->_buffer[0], length - first } }};
+}
+
+}
@@ -0,0 +1,112 @@
+
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace util
+{
+
+/**
+ * Fixed capacity byte queue backed by a power of two sized buffer.
+ * Data is copied in and out as at most two contiguous blocks, and the blocks can be handed to readv/writev directly.
+ */
+class RingBuffer
+{
+public:
+    struct Segment
+    {
+        char *data;
+        std::size_t length;
+    };
+
+    /**
+     * Up to two contiguous blocks of the buffer, in order. The second is empty unless the range wraps around.
+     */
+    using Segments = std::array<Segment, 2>;
+
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+    RingBuffer()
+        : _head(0)
+        , _used(0) { }
+
+    explicit RingBuffer(std::size_t capacity);
+
+    /**
+     * Changes the capacity and discards the contents. Throws std::runtime_error if capacity is not a power of two.
+     */
+    void Reset(std::size_t capacity);
+
+    /**
+     * Discards the contents without changing the capacity
+     */
+    void Clear();
+
+    std::size_t Capacity() const { return this->_buffer.size(); }
+    std::size_t Size() const { return this->_used; }
+    std::size_t Free() const { return this->_buffer.size() - this->_used; }
+
+    bool Empty() const { return this->_used == 0; }
+    bool Full() const { return this->_used == this->_buffer.size(); }
+
+    /**
+     * Returns the byte offset bytes from the front. offset must be less than Size().
+     */
+    char operator[](std::size_t offset) const { return this->_buffer[(this->_head + offset) & this->Mask()]; }
+
+    /**
+     * Appends all of data, or nothing if there is not enough room. Returns false if there was not enough room.
+     */
+    bool Write(const char *data, std::size_t length);
+
+    /**
+     * Removes up to length bytes from the front and copies them to out. Returns the number of bytes copied.
+     */
+    std::size_t Read(char *out, std::size_t length);
+
+    /**
+     * Copies up to length bytes starting offset bytes from the front, without removing them.
+     * Returns the number of bytes copied.
+     */
+    std::size_t Peek(char *out, std::size_t length, std::size_t offset = 0) const;
+
+    /**
+     * Removes up to length bytes from the front without copying them
+     */
+    void Consume(std::size_t length);
+
+    /**
+     * Returns the first length bytes of data (or all of it) without removing them.
+     * Call Consume() with the number of bytes used afterwards.
+     */
+    Segments ReadSegments(std::size_t length = npos);
+
+    /**
+     * Returns up to length bytes of free space after the end of the data.
+     * Call Commit() with the number of bytes written afterwards.
+     */
+    Segments WriteSegments(std::size_t length = npos);
+
+    /**
+     * Appends length bytes previously written in to the space returned by WriteSegments()
+     */
+    void Commit(std::size_t length);
+
+private:
+    std::size_t Mask() const { return this->_buffer.size() - 1; }
+
+    Segments MakeSegments(std::size_t pos, std::size_t length);
+
+    std::vector<char> _buffer;
+    std::size_t _head;
+    std::size_t _used;
+};
+
+}
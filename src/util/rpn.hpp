@@ -9,9 +9,11 @@
 
 #include "../util/variant.hpp"
 
+#include <cstddef>
 #include <stack>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace util
 {
@@ -22,6 +24,74 @@ static const double rpn_cmp_epsilon_2 = rpn_cmp_epsilon / 2.0;
 std::stack<util::variant> rpn_parse(std::string expr);
 double rpn_eval(std::stack<util::variant>, std::unordered_map<std::string, double> vars);
 
+struct rpn_function;
+
+/**
+ * Assigns fixed slot numbers to variable names used by compiled formulas
+ */
+class rpn_symbols
+{
+	private:
+		std::unordered_map<std::string, std::size_t> slots;
+		std::vector<double> defaults;
+
+	public:
+		static const std::size_t npos = static_cast<std::size_t>(-1);
+
+		/**
+		 * Returns the slot of a variable, allocating a new one if it does not exist yet
+		 */
+		std::size_t add(const std::string &name);
+
+		/**
+		 * Returns the slot of a variable, or npos if it does not exist
+		 */
+		std::size_t find(const std::string &name) const;
+
+		std::size_t size() const { return this->defaults.size(); }
+
+		/**
+		 * Returns a list of values for every slot, set to what rpn_eval would use for an unbound variable
+		 */
+		const std::vector<double> &vars() const { return this->defaults; }
+};
+
+/**
+ * An RPN expression parsed once in to a list of instructions.
+ * Variables are resolved to slots from an rpn_symbols table so evaluating does no string handling.
+ * An empty formula evaluates to 0.
+ */
+class rpn_formula
+{
+	private:
+		struct instruction
+		{
+			const rpn_function *func;
+			std::size_t slot;
+			double value;
+		};
+
+		std::vector<instruction> code;
+		std::size_t max_depth;
+
+	public:
+		rpn_formula() : max_depth(0) { }
+
+		/**
+		 * Compiles an expression with the same semantics as rpn_parse and rpn_eval
+		 * @throw std::runtime_error if the expression would underflow the stack
+		 */
+		rpn_formula(const std::string &expr, const rpn_symbols &symbols);
+
+		bool empty() const { return this->code.empty(); }
+
+		/**
+		 * Evaluates the formula
+		 * @param vars Variable values indexed by the slots of the rpn_symbols the formula was compiled with
+		 */
+		double eval(const std::vector<double> &vars) const;
+};
+
 }
 
 #endif // UTIL_RPN_HPP_INCLUDED
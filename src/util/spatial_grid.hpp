@@ -0,0 +1,163 @@
+/* $Id$
+ * EOSERV is released under the zlib license.
+ * See LICENSE.txt for more info.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace util
+{
+
+/**
+ * Buckets objects by tile position in to fixed size square cells so range queries only visit nearby objects.
+ * Visited objects are not filtered by their exact position, callers are expected to do that themselves.
+ */
+template <class T>
+class SpatialGrid
+{
+public:
+    static const int CellSize = 8;
+
+    SpatialGrid()
+        : _width(0)
+        , _height(0) { }
+
+    /**
+     * Resizes the grid to cover an area of tiles and removes all objects from it
+     */
+    void Reset(int width, int height)
+    {
+        this->_width = (std::max(width, 0) + CellSize - 1) / CellSize;
+        this->_height = (std::max(height, 0) + CellSize - 1) / CellSize;
+        this->_cells.assign(this->_width * this->_height, std::vector<T>());
+        this->_location.clear();
+    }
+
+    /**
+     * Removes all objects from the grid without changing its size
+     */
+    void Clear()
+    {
+        for (auto& cell : this->_cells)
+            cell.clear();
+
+        this->_location.clear();
+    }
+
+    /**
+     * Inserts an object at a position, or moves it there if it is already in the grid
+     */
+    void Update(const T& obj, int x, int y)
+    {
+        if (this->_cells.empty())
+            return;
+
+        const std::size_t cell = this->CellIndex(x, y);
+        auto it = this->_location.find(obj);
+
+        if (it != this->_location.end())
+        {
+            if (it->second == cell)
+                return;
+
+            this->EraseFromCell(it->second, obj);
+            it->second = cell;
+        }
+        else
+        {
+            this->_location.emplace(obj, cell);
+        }
+
+        this->_cells[cell].push_back(obj);
+    }
+
+    /**
+     * Removes an object from the grid. Does nothing if the object is not in the grid.
+     */
+    void Remove(const T& obj)
+    {
+        auto it = this->_location.find(obj);
+
+        if (it == this->_location.end())
+            return;
+
+        this->EraseFromCell(it->second, obj);
+        this->_location.erase(it);
+    }
+
+    bool Contains(const T& obj) const
+    {
+        return this->_location.find(obj) != this->_location.end();
+    }
+
+    std::size_t Size() const
+    {
+        return this->_location.size();
+    }
+
+    /**
+     * Calls f for every object in a cell which overlaps the square of tiles within range of (x, y).
+     * The grid must not be modified by f.
+     */
+    template <class F>
+    void ForEach(int x, int y, int range, F f) const
+    {
+        if (this->_cells.empty())
+            return;
+
+        const int x1 = this->ClampX(x - range);
+        const int x2 = this->ClampX(x + range);
+        const int y1 = this->ClampY(y - range);
+        const int y2 = this->ClampY(y + range);
+
+        for (int cy = y1; cy <= y2; ++cy)
+        {
+            for (int cx = x1; cx <= x2; ++cx)
+            {
+                for (const T& obj : this->_cells[cy * this->_width + cx])
+                    f(obj);
+            }
+        }
+    }
+
+private:
+    int _width;
+    int _height;
+
+    std::vector<std::vector<T>> _cells;
+    std::unordered_map<T, std::size_t> _location;
+
+    int ClampX(int x) const
+    {
+        return std::min(std::max(x, 0) / CellSize, this->_width - 1);
+    }
+
+    int ClampY(int y) const
+    {
+        return std::min(std::max(y, 0) / CellSize, this->_height - 1);
+    }
+
+    std::size_t CellIndex(int x, int y) const
+    {
+        return this->ClampY(y) * this->_width + this->ClampX(x);
+    }
+
+    void EraseFromCell(std::size_t cell, const T& obj)
+    {
+        std::vector<T>& objs = this->_cells[cell];
+        auto it = std::find(objs.begin(), objs.end(), obj);
+
+        if (it != objs.end())
+        {
+            *it = objs.back();
+            objs.pop_back();
+        }
+    }
+};
+
+}
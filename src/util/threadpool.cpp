@@ -5,6 +5,7 @@
  */
 
 #include <future>
+#include <utility>
 
 #include "../console.hpp"
 #include "../database.hpp"
@@ -17,13 +18,23 @@ namespace util
     // Otherwise, they aren't in the object file in unity build mode and test linking fails
     const size_t ThreadPool::MAX_THREADS = 32;
     const size_t ThreadPool::DEFAULT_THREADS = 4;
+    const std::chrono::milliseconds ThreadPool::MAX_BACKGROUND_WAIT(500);
 
     // There should really only be a single thread pool per application
     static ThreadPool threadPoolInstance;
 
-    void ThreadPool::Queue(const WorkFunc workerFunction, const void* state)
+    // Lets work queued from inside a worker go straight onto that worker's own deque
+    static thread_local const ThreadPool* currentPool = nullptr;
+    static thread_local size_t currentWorker = 0;
+
+    static std::uint64_t elapsed_us(std::chrono::steady_clock::time_point since, std::chrono::steady_clock::time_point until)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(until - since).count();
+    }
+
+    void ThreadPool::Queue(const WorkFunc workerFunction, const void* state, Priority priority)
     {
-        threadPoolInstance.queueInternal(workerFunction, state);
+        threadPoolInstance.queueInternal(workerFunction, state, priority);
     }
 
     void ThreadPool::SetNumThreads(size_t numThreads)
@@ -36,20 +47,45 @@ namespace util
         threadPoolInstance.shutdownInternal();
     }
 
+    ThreadPool::Stats ThreadPool::GetStats()
+    {
+        return threadPoolInstance.getStatsInternal();
+    }
+
+    ThreadPool::Worker::Worker()
+        : retiring(false)
+    {
+        for (auto& depth : this->depth)
+            depth = 0;
+    }
+
+    ThreadPool::LaneCounters::LaneCounters()
+        : queued(0)
+        , completed(0)
+        , wait_total_us(0)
+        , wait_max_us(0)
+        , run_total_us(0)
+    { }
+
     ThreadPool::ThreadPool(size_t numThreads)
         : _terminating(false)
-        , _workReadySemaphore(0)
+        , _numWorkers(0)
+        , _nextWorker(0)
+        , _pending(0)
+        , _steals(0)
     {
         if (numThreads == 0 || numThreads > MAX_THREADS)
         {
             numThreads = DEFAULT_THREADS;
         }
 
+        for (size_t i = 0; i < MAX_THREADS; ++i)
+            this->_workers.push_back(std::make_unique<Worker>());
+
         for (size_t i = 0; i < numThreads; i++)
-        {
-            auto newThread = std::thread([this, i]() { this->_workerProc(i); });
-            this->_threads.push_back(std::move(newThread));
-        }
+            this->startWorker(i);
+
+        this->_numWorkers = numThreads;
     }
 
     ThreadPool::~ThreadPool()
@@ -57,19 +93,36 @@ namespace util
         this->shutdownInternal();
     }
 
-    void ThreadPool::queueInternal(const ThreadPool::WorkFunc workerFunction, const void* state)
+    void ThreadPool::queueInternal(const ThreadPool::WorkFunc workerFunction, const void* state, Priority priority)
     {
         if (this->_terminating)
         {
             throw std::runtime_error("Unable to queue work while ThreadPool is terminating");
         }
 
-        std::lock_guard<std::mutex> queueGuard(this->_workQueueLock);
+        if (priority < Interactive || priority >= PriorityCount)
+            priority = Interactive;
+
+        size_t target = (currentPool == this)
+            ? currentWorker
+            : this->_nextWorker++ % this->_numWorkers;
 
-        auto newPair = std::make_pair(workerFunction, state);
-        this->_work.emplace(std::move(newPair));
+        Worker& worker = *this->_workers[target];
 
-        this->_workReadySemaphore.Release();
+        {
+            std::lock_guard<std::mutex> workerGuard(worker.lock);
+            worker.lanes[priority].push_back(Task{workerFunction, state, std::chrono::steady_clock::now()});
+            ++worker.depth[priority];
+        }
+
+        ++this->_counters[priority].queued;
+
+        {
+            std::lock_guard<std::mutex> wakeGuard(this->_wakeLock);
+            ++this->_pending;
+        }
+
+        this->_wakeCondition.notify_one();
     }
 
     void ThreadPool::setNumThreadsInternal(size_t numWorkers)
@@ -79,7 +132,11 @@ namespace util
             numWorkers = DEFAULT_THREADS;
         }
 
-        if (numWorkers == this->_threads.size())
+        std::lock_guard<std::mutex> resizeGuard(this->_resizeLock);
+
+        const size_t current = this->_numWorkers;
+
+        if (numWorkers == current)
             return;
 
         if (this->_terminating)
@@ -87,83 +144,230 @@ namespace util
             throw std::runtime_error("Unable to set number of threads while ThreadPool is terminating");
         }
 
-        std::lock_guard<std::mutex> queueGuard(this->_workQueueLock);
-
-        if (numWorkers < this->_threads.size())
+        if (numWorkers > current)
         {
-            while (!this->_work.empty())
-                this->_work.pop();
+            for (size_t i = current; i < numWorkers; ++i)
+                this->startWorker(i);
 
-            this->_terminating = true;
-            this->_workReadySemaphore.Release(this->_threads.size());
+            this->_numWorkers = numWorkers;
+            return;
+        }
 
-            for (auto& thread : this->_threads)
-                thread.join();
+        this->_numWorkers = numWorkers;
+
+        {
+            std::lock_guard<std::mutex> wakeGuard(this->_wakeLock);
 
-            this->_threads.clear();
-            this->_terminating = false;
+            for (size_t i = numWorkers; i < current; ++i)
+                this->_workers[i]->retiring = true;
         }
 
-        this->_workReadySemaphore.Reset(0);
+        this->_wakeCondition.notify_all();
 
-        for (size_t i = this->_threads.size(); i < numWorkers; ++i)
+        for (size_t i = numWorkers; i < current; ++i)
+            this->_workers[i]->thread.join();
+
+        // Hand anything still queued on the retired workers to the ones that remain
+        size_t next = 0;
+
+        for (size_t i = numWorkers; i < current; ++i)
         {
-            auto newThread = std::thread([this, i]() { this->_workerProc(i); });
-            this->_threads.push_back(std::move(newThread));
+            Worker& retired = *this->_workers[i];
+
+            for (int lane = 0; lane < PriorityCount; ++lane)
+            {
+                std::deque<Task> moving;
+
+                {
+                    std::lock_guard<std::mutex> retiredGuard(retired.lock);
+                    std::swap(moving, retired.lanes[lane]);
+                    retired.depth[lane] = 0;
+                }
+
+                for (Task& task : moving)
+                {
+                    Worker& worker = *this->_workers[next++ % numWorkers];
+                    std::lock_guard<std::mutex> workerGuard(worker.lock);
+                    worker.lanes[lane].push_back(std::move(task));
+                    ++worker.depth[lane];
+                }
+            }
         }
+
+        // Wake-ups that went to a retiring worker were lost with it
+        this->_wakeCondition.notify_all();
     }
 
     void ThreadPool::shutdownInternal()
     {
-        if (!this->_terminating)
+        std::lock_guard<std::mutex> resizeGuard(this->_resizeLock);
+
         {
+            std::lock_guard<std::mutex> wakeGuard(this->_wakeLock);
+
+            if (this->_terminating)
+                return;
+
             this->_terminating = true;
-            this->_workReadySemaphore.Release(this->_threads.size());
+        }
+
+        this->_wakeCondition.notify_all();
+
+        for (auto& worker : this->_workers)
+        {
+            if (worker->thread.joinable())
+                worker->thread.join();
+        }
+    }
+
+    ThreadPool::Stats ThreadPool::getStatsInternal() const
+    {
+        Stats stats;
+        stats.threads = this->_numWorkers;
+        stats.steals = this->_steals;
+
+        for (int lane = 0; lane < PriorityCount; ++lane)
+        {
+            const LaneCounters& counters = this->_counters[lane];
+            LaneStats& laneStats = stats.lanes[lane];
+
+            laneStats.queued = counters.queued;
+            laneStats.completed = counters.completed;
+            laneStats.wait_total_us = counters.wait_total_us;
+            laneStats.wait_max_us = counters.wait_max_us;
+            laneStats.run_total_us = counters.run_total_us;
+            laneStats.depth = 0;
+
+            for (auto& worker : this->_workers)
+                laneStats.depth += worker->depth[lane];
+        }
+
+        return stats;
+    }
 
-            for (auto& thread : this->_threads)
+    void ThreadPool::startWorker(size_t threadNum)
+    {
+        Worker& worker = *this->_workers[threadNum];
+        worker.retiring = false;
+        worker.thread = std::thread([this, threadNum]() { this->_workerProc(threadNum); });
+    }
+
+    bool ThreadPool::takeWork(size_t threadNum, Task& task, Priority& priority)
+    {
+        // Background work that has waited too long goes first, so a steady stream of interactive work can't starve it
+        if (this->takeFromLane(threadNum, Background, std::chrono::steady_clock::now() - MAX_BACKGROUND_WAIT, task))
+        {
+            priority = Background;
+            return true;
+        }
+
+        // Otherwise all interactive work, starting with this worker's own, goes before any background work
+        for (int lane = 0; lane < PriorityCount; ++lane)
+        {
+            if (this->takeFromLane(threadNum, lane, std::chrono::steady_clock::time_point::max(), task))
             {
-                thread.join();
+                priority = static_cast<Priority>(lane);
+                return true;
             }
         }
+
+        return false;
+    }
+
+    bool ThreadPool::takeFromLane(size_t threadNum, int lane, std::chrono::steady_clock::time_point queuedBy, Task& task)
+    {
+        for (size_t offset = 0; offset < MAX_THREADS; ++offset)
+        {
+            Worker& worker = *this->_workers[(threadNum + offset) % MAX_THREADS];
+
+            if (worker.depth[lane] == 0)
+                continue;
+
+            std::lock_guard<std::mutex> workerGuard(worker.lock);
+
+            if (worker.lanes[lane].empty() || worker.lanes[lane].front().queued > queuedBy)
+                continue;
+
+            task = std::move(worker.lanes[lane].front());
+            worker.lanes[lane].pop_front();
+            --worker.depth[lane];
+
+            if (offset != 0)
+                ++this->_steals;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void ThreadPool::runWork(size_t threadNum, Task& task, Priority priority)
+    {
+        LaneCounters& counters = this->_counters[priority];
+        auto started = std::chrono::steady_clock::now();
+        std::uint64_t wait = elapsed_us(task.queued, started);
+
+        counters.wait_total_us += wait;
+
+        std::uint64_t wait_max = counters.wait_max_us;
+        while (wait > wait_max && !counters.wait_max_us.compare_exchange_weak(wait_max, wait))
+            ;
+
+        try
+        {
+            task.func(task.state);
+        }
+        catch (const Socket_Exception& se)
+        {
+            Console::Err("Exception on thread %d: %s: %s", threadNum, se.what(), se.error());
+        }
+        catch (const Database_Exception& dbe)
+        {
+            Console::Err("Exception on thread %d: %s: %s", threadNum, dbe.what(), dbe.error());
+        }
+        catch (const std::exception& e)
+        {
+            Console::Err("Exception on thread %d: %s", threadNum, e.what());
+        }
+
+        counters.run_total_us += elapsed_us(started, std::chrono::steady_clock::now());
+        ++counters.completed;
     }
 
     void ThreadPool::_workerProc(size_t threadNum)
     {
-        while (!this->_terminating)
+        currentPool = this;
+        currentWorker = threadNum;
+
+        Worker& worker = *this->_workers[threadNum];
+
+        while (true)
         {
-            this->_workReadySemaphore.Wait();
+            {
+                std::unique_lock<std::mutex> wakeGuard(this->_wakeLock);
+                this->_wakeCondition.wait(wakeGuard, [this, &worker]()
+                {
+                    return this->_terminating || worker.retiring || this->_pending > 0;
+                });
+
+                if (this->_terminating || worker.retiring)
+                    break;
+
+                --this->_pending;
+            }
 
 #if DEBUG
             Console::Dbg("Thread %d starting work", threadNum);
 #endif
 
-            if (this->_terminating)
-                break;
+            // The claimed task is already in a deque, but may be mid-move during a resize
+            Task task;
+            Priority priority;
 
-            std::unique_ptr<WorkFuncWithState> workPair;
+            while (!this->takeWork(threadNum, task, priority))
+                std::this_thread::yield();
 
-            {
-                std::lock_guard<std::mutex> queueGuard(this->_workQueueLock);
-                workPair = std::make_unique<WorkFuncWithState>(std::move(this->_work.front()));
-                this->_work.pop();
-            }
-
-            try
-            {
-                workPair->first(workPair->second);
-            }
-            catch (const Socket_Exception& se)
-            {
-                Console::Err("Exception on thread %d: %s: %s", threadNum, se.what(), se.error());
-            }
-            catch (const Database_Exception& dbe)
-            {
-                Console::Err("Exception on thread %d: %s: %s", threadNum, dbe.what(), dbe.error());
-            }
-            catch (const std::exception& e)
-            {
-                Console::Err("Exception on thread %d: %s", threadNum, e.what());
-            }
+            this->runWork(threadNum, task, priority);
 
 #if DEBUG
             Console::Dbg("Thread %d completed work", threadNum);
@@ -174,4 +378,4 @@ namespace util
         Console::Dbg("Thread %d terminating", threadNum);
 #endif
     }
-}
\ No newline at end of file
+}
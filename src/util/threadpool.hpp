@@ -6,15 +6,17 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
-#include <queue>
+#include <mutex>
 #include <thread>
 #include <vector>
 
-#include "semaphore.hpp"
-
 namespace util
 {
     class ThreadPool
@@ -22,15 +24,45 @@ namespace util
     public:
         typedef std::function<void(const void*)> WorkFunc;
 
+        // Work in the Interactive lane runs before any Background work that is waiting, until that work is older than MAX_BACKGROUND_WAIT
+        enum Priority
+        {
+            Interactive,
+            Background,
+            PriorityCount
+        };
+
+        struct LaneStats
+        {
+            std::uint64_t queued;
+            std::uint64_t completed;
+            std::uint64_t depth;
+
+            // Time between queueing and starting, and time spent running, in microseconds
+            std::uint64_t wait_total_us;
+            std::uint64_t wait_max_us;
+            std::uint64_t run_total_us;
+        };
+
+        struct Stats
+        {
+            size_t threads;
+            std::uint64_t steals;
+            LaneStats lanes[PriorityCount];
+        };
+
         // Queue work on the thread pool. Memory allocated and passed to 'state' must be freed by the caller.
-        static void Queue(const WorkFunc workerFunction, const void * state);
+        static void Queue(const WorkFunc workerFunction, const void * state, Priority priority = Interactive);
 
-        // Set the number of threads in the thread pool. Any queued work will be removed. In-progress work will be allowed to complete.
+        // Set the number of threads in the thread pool. Queued work is kept and handed to the remaining threads. In-progress work will be allowed to complete.
         static void SetNumThreads(size_t numThreads);
 
         // Shut down the threadpool
         static void Shutdown();
 
+        // Snapshot of the thread pool counters since startup
+        static Stats GetStats();
+
     public:
         ThreadPool(size_t numThreads = DEFAULT_THREADS);
         ThreadPool(const ThreadPool&) = delete;
@@ -39,23 +71,66 @@ namespace util
 
         static const size_t MAX_THREADS;
         static const size_t DEFAULT_THREADS;
+        static const std::chrono::milliseconds MAX_BACKGROUND_WAIT;
 
     private:
-        typedef std::pair<const WorkFunc, const void*> WorkFuncWithState;
+        struct Task
+        {
+            WorkFunc func;
+            const void * state;
+            std::chrono::steady_clock::time_point queued;
+        };
+
+        // Each worker owns a deque per lane so submitters and idle workers rarely contend on the same lock
+        struct Worker
+        {
+            std::mutex lock;
+            std::deque<Task> lanes[PriorityCount];
+            std::atomic<size_t> depth[PriorityCount];
+            std::thread thread;
+            bool retiring;
+
+            Worker();
+        };
+
+        struct LaneCounters
+        {
+            std::atomic<std::uint64_t> queued;
+            std::atomic<std::uint64_t> completed;
+            std::atomic<std::uint64_t> wait_total_us;
+            std::atomic<std::uint64_t> wait_max_us;
+            std::atomic<std::uint64_t> run_total_us;
+
+            LaneCounters();
+        };
+
+        void startWorker(size_t threadNum);
+        bool takeWork(size_t threadNum, Task& task, Priority& priority);
+        bool takeFromLane(size_t threadNum, int lane, std::chrono::steady_clock::time_point queuedBy, Task& task);
+        void runWork(size_t threadNum, Task& task, Priority priority);
 
     protected:
-        void queueInternal(const WorkFunc workerFunction, const void * state);
+        void queueInternal(const WorkFunc workerFunction, const void * state, Priority priority = Interactive);
         void setNumThreadsInternal(size_t numWorkers);
         void shutdownInternal();
+        Stats getStatsInternal() const;
 
         void _workerProc(size_t threadNum);
 
-        volatile bool _terminating;
+        std::atomic<bool> _terminating;
+
+        // Worker slots are allocated once up to MAX_THREADS so they can be scanned for stealing without locking
+        std::vector<std::unique_ptr<Worker>> _workers;
+        std::atomic<size_t> _numWorkers;
+        std::atomic<size_t> _nextWorker;
+        std::mutex _resizeLock;
 
-        Semaphore _workReadySemaphore;
-        std::mutex _workQueueLock;
-        std::queue<WorkFuncWithState> _work;
+        // Every queued task adds one to _pending and a worker claims one before it goes looking for work
+        std::mutex _wakeLock;
+        std::condition_variable _wakeCondition;
+        size_t _pending;
 
-        std::vector<std::thread> _threads;
+        LaneCounters _counters[PriorityCount];
+        std::atomic<std::uint64_t> _steals;
     };
-}
\ No newline at end of file
+}
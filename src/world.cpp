@@ -41,7 +41,9 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -51,20 +53,12 @@ void world_spawn_npcs(void *world_void)
 {
 	World *world(static_cast<World *>(world_void));
 
-	double spawnrate = world->config["SpawnRate"];
 	double current_time = Timer::GetTime();
 	UTIL_FOREACH(world->maps, map)
 	{
-		UTIL_FOREACH(map->npcs, npc)
+		if (map->Activity(current_time) != Map::ActivityDormant)
 		{
-			if ((!npc->alive && npc->dead_since + (double(npc->spawn_time) * spawnrate) < current_time)
-			 && (!npc->ENF().child || (npc->parent && npc->parent->alive && world->config["RespawnBossChildren"])))
-			{
-#ifdef DEBUG
-				Console::Dbg("Spawning NPC %i on map %i", npc->id, map->id);
-#endif // DEBUG
-				npc->Spawn();
-			}
+			map->SpawnNPCs(current_time);
 		}
 	}
 }
@@ -76,12 +70,9 @@ void world_act_npcs(void *world_void)
 	double current_time = Timer::GetTime();
 	UTIL_FOREACH(world->maps, map)
 	{
-		UTIL_FOREACH(map->npcs, npc)
+		if (map->Activity(current_time) != Map::ActivityDormant)
 		{
-			if (npc->alive && npc->last_act + npc->act_speed < current_time)
-			{
-				npc->Act();
-			}
+			map->ActNPCs(current_time);
 		}
 	}
 }
@@ -93,12 +84,10 @@ void world_talk_npcs(void *world_void)
 	double current_time = Timer::GetTime();
 	UTIL_FOREACH(world->maps, map)
 	{
-		UTIL_FOREACH(map->npcs, npc)
+		// Nobody is around to hear NPCs on an empty map
+		if (map->Activity(current_time) == Map::ActivityHot)
 		{
-			if (npc->alive && npc->last_talk + npc->Data().talk_speed < current_time)
-			{
-				npc->Talk();
-			}
+			map->TalkNPCs(current_time);
 		}
 	}
 }
@@ -199,12 +188,12 @@ void world_warp_suck(void *world_void)
 				if (!test || !map->InBounds(x, y))
 					return;
 
-				const Map_Warp& warp = map->GetWarp(x, y);
+				const Map_Warp *warp = map->GetWarp(x, y);
 
-				if (!warp || warp.levelreq > character->level || (warp.spec != Map_Warp::Door && warp.spec != Map_Warp::NoDoor))
+				if (!warp || warp->levelreq > character->level || (warp->spec != Map_Warp::Door && warp->spec != Map_Warp::NoDoor))
 					return;
 
-				actions.push_back({character, warp.map, warp.x, warp.y});
+				actions.push_back({character, warp->map, warp->x, warp->y});
 			};
 
 			character->last_walk = now;
@@ -249,6 +238,32 @@ void world_despawn_items(void *world_void)
 	}
 }
 
+void world_refresh_bans(void *world_void)
+{
+	World *world = static_cast<World *>(world_void);
+
+	world->RefreshBans();
+}
+
+// Runs every few seconds until the bans have been loaded once
+void world_retry_load_bans(void *world_void)
+{
+	World *world = static_cast<World *>(world_void);
+
+	if (world->BansLoaded())
+		return;
+
+	world->RefreshBans();
+	world->timer.Register(new TimeEvent(world_retry_load_bans, world, 5.0, 1));
+}
+
+void world_expire_db_connections(void *world_void)
+{
+	World *world = static_cast<World *>(world_void);
+
+	world->ExpireDatabaseConnections();
+}
+
 void world_timed_save(void *world_void)
 {
 	World *world = static_cast<World *>(world_void);
@@ -256,26 +271,79 @@ void world_timed_save(void *world_void)
 	if (!world->config["TimedSave"])
 		return;
 
-	world->db->BeginTransaction();
+	world->TimedSave();
+}
 
-	UTIL_FOREACH(world->characters, character)
+static void world_save_command_audit(Database& db, const std::vector<std::tuple<std::time_t, std::string, std::string, std::vector<std::string>>>& entries)
+{
+	UTIL_FOREACH_CREF(entries, entry)
 	{
-		character->Save();
+		std::time_t timestamp = std::get<0>(entry);
+		const std::string& source = std::get<1>(entry);
+		const std::string& command = std::get<2>(entry);
+		const std::vector<std::string>& arguments = std::get<3>(entry);
+
+		// Serialize arguments as space-separated string
+		std::string args_str;
+		for (std::size_t i = 0; i < arguments.size(); ++i)
+		{
+			if (i > 0)
+				args_str += " ";
+			args_str += arguments[i];
+		}
+
+		try
+		{
+			db.Query("INSERT INTO `command_audit` (`time`, `source`, `command`, `arguments`) VALUES (#, '$', '$', '$')",
+				static_cast<int>(timestamp), source.c_str(), command.c_str(), args_str.c_str());
+		}
+		catch (Database_Exception& e)
+		{
+			Console::Err("Could not save command audit to database.");
+			Console::Err("%s", e.error());
+		}
 	}
+}
+
+void World_Save_Batch::Save(Database& db) const
+{
+	db.BeginTransaction();
+
+	try
+	{
+		UTIL_FOREACH_CREF(this->characters, character)
+		{
+			character.Save(db);
+		}
 
-	world->guildmanager->SaveAll();
+		UTIL_FOREACH_CREF(this->guilds, guild)
+		{
+			guild.Save(db);
+		}
 
-	world->SaveCommandAudit();
+		world_save_command_audit(db, this->command_audit);
 
+		db.Commit();
+	}
+	catch (...)
+	{
+		db.Rollback();
+		throw;
+	}
+}
+
+static bool world_save_batch(Database& db, const World_Save_Batch& batch)
+{
 	try
 	{
-		world->db->Commit();
+		batch.Save(db);
+		return true;
 	}
 	catch (Database_Exception& e)
 	{
-		(void)e;
 		Console::Wrn("Database commit failed - no data was saved!");
-		world->db->Rollback();
+		Console::Wrn("%s", e.error());
+		return false;
 	}
 }
 
@@ -312,6 +380,35 @@ void world_quakes(void *world_void)
 void World::UpdateConfig()
 {
 	this->timer.SetMaxDelta(this->config["ClockMaxDelta"]);
+	this->loginManager->UpdateConfig();
+
+	this->settings.see_distance = int(this->config["SeeDistance"]);
+	this->settings.ghost_timer = double(this->config["GhostTimer"]);
+	this->settings.ghost_arena = bool(this->config["GhostArena"]);
+	this->settings.spike_damage = double(this->config["SpikeDamage"]);
+	this->settings.global_pk = bool(this->config["GlobalPK"]);
+	this->settings.ranged_distance = int(this->config["RangedDistance"]);
+	this->settings.critical_rate = double(this->config["CriticalRate"]);
+	this->settings.critical_first_hit = bool(this->config["CriticalFirstHit"]);
+	this->settings.mob_rate = double(this->config["MobRate"]);
+	this->settings.pk_rate = double(this->config["PKRate"]);
+	this->settings.limit_damage = bool(this->config["LimitDamage"]);
+
+	this->settings.enforce_timestamps = bool(this->config["EnforceTimestamps"]);
+	this->settings.enforce_sequence = bool(this->config["EnforceSequence"]);
+	this->settings.enforce_weight = int(this->config["EnforceWeight"]);
+	this->settings.limit_attack = int(this->config["LimitAttack"]);
+	this->settings.use_duty_admin = bool(this->config["UseDutyAdmin"]);
+	this->settings.packet_queue_max = std::size_t(int(this->config["PacketQueueMax"]));
+
+	this->settings.npc_chase_mode = int(this->config["NPCChaseMode"]);
+	this->settings.npc_chase_distance = int(this->config["NPCChaseDistance"]);
+	this->settings.npc_bored_timer = double(this->config["NPCBoredTimer"]);
+	this->settings.npc_idle_time = double(this->config["NPCIdleTime"]);
+	this->settings.npc_adjust_max_dam = int(this->config["NPCAdjustMaxDam"]);
+
+	this->settings.admin_nowall = int(this->admin_config["nowall"]);
+	this->settings.admin_killnpc = int(this->admin_config["killnpc"]);
 
 	double rate_face = this->config["PacketRateFace"];
 	double rate_walk = this->config["PacketRateWalk"];
@@ -368,6 +465,10 @@ void World::UpdateConfig()
 
 World::World(std::shared_ptr<DatabaseFactory> databaseFactory, const Config &eoserv_config, const Config &admin_config)
 	: databaseFactory(databaseFactory)
+	, save_pending(false)
+	, save_failed(false)
+	, ban_index(std::make_shared<BanIndex>())
+	, avatar_generation(1)
 	, config(eoserv_config)
 	, admin_config(admin_config)
 	, i18n(eoserv_config.find("ServerLanguage")->second)
@@ -407,8 +508,10 @@ void World::Initialize()
 		Console::Wrn(e.what());
 	}
 
+	this->formulas.Compile(this->formulas_config);
 	this->UpdateConfig();
 	this->LoadHome();
+	++this->avatar_generation;
 
 	this->eif = new EIF(this->config["EIF"]);
 	this->enf = new ENF(this->config["ENF"]);
@@ -457,6 +560,11 @@ void World::Initialize()
 	}
 	Console::Out("%i/%i quests loaded.", static_cast<int>(this->quests.size()), max_quest);
 
+	this->LoadBans();
+
+	if (!this->BansLoaded())
+		this->timer.Register(new TimeEvent(world_retry_load_bans, this, 5.0, 1));
+
 	this->last_character_id = 0;
 
 	TimeEvent *event = new TimeEvent(world_spawn_npcs, this, 1.0, Timer::FOREVER);
@@ -498,6 +606,18 @@ void World::Initialize()
 		this->timer.Register(event);
 	}
 
+	if (this->config["DBPoolCheckInterval"])
+	{
+		event = new TimeEvent(world_expire_db_connections, this, static_cast<double>(this->config["DBPoolCheckInterval"]), Timer::FOREVER);
+		this->timer.Register(event);
+	}
+
+	if (this->config["BanRefreshRate"])
+	{
+		event = new TimeEvent(world_refresh_bans, this, static_cast<double>(this->config["BanRefreshRate"]), Timer::FOREVER);
+		this->timer.Register(event);
+	}
+
 	if (this->config["SpikeTime"])
 	{
 		event = new TimeEvent(world_spikes, this, static_cast<double>(this->config["SpikeTime"]), Timer::FOREVER);
@@ -852,6 +972,9 @@ void World::RestoreFromDump(const std::string& fileName)
 				i["y"].get<unsigned char>(),
 				0, 0));
 
+		(*map)->item_grid.Update((*map)->items.back().get(), (*map)->items.back()->x, (*map)->items.back()->y);
+		(*map)->item_ids.Take((*map)->items.back()->uid);
+
 #ifdef DEBUG
 		Console::Dbg("Restored item:     %dx%d", i["itemId"].get<int>(), i["amount"].get<int>());
 #endif
@@ -927,36 +1050,126 @@ void World::SaveCommandAudit()
 	if (this->command_audit_uncommitted.empty())
 		return;
 
-	UTIL_FOREACH(this->command_audit_uncommitted, entry)
+	std::shared_ptr<World_Save_Batch> batch = std::make_shared<World_Save_Batch>();
+	batch->command_audit = this->command_audit_uncommitted;
+
+	if (!this->QueueSave(batch))
+		world_save_command_audit(*this->db, this->command_audit_uncommitted);
+
+	this->command_audit.insert(this->command_audit.end(), this->command_audit_uncommitted.begin(), this->command_audit_uncommitted.end());
+	this->command_audit_uncommitted.clear();
+}
+
+void World::TimedSave()
+{
+	bool save_all;
+
 	{
-		std::time_t timestamp = std::get<0>(entry);
-		const std::string& source = std::get<1>(entry);
-		const std::string& command = std::get<2>(entry);
-		const std::vector<std::string>& arguments = std::get<3>(entry);
+		std::lock_guard<std::mutex> lock(this->save_mutex);
 
-		// Serialize arguments as space-separated string
-		std::string args_str;
-		for (std::size_t i = 0; i < arguments.size(); ++i)
+		if (this->save_pending)
 		{
-			if (i > 0)
-				args_str += " ";
-			args_str += arguments[i];
+			// Anything that changed will still differ from its last save next time
+			Console::Wrn("Previous timed save is still in progress, skipping");
+			return;
 		}
 
+		// Nothing from a failed save is known to have been written
+		save_all = this->save_failed;
+		this->save_failed = false;
+	}
+
+	std::shared_ptr<World_Save_Batch> batch = std::make_shared<World_Save_Batch>();
+
+	UTIL_FOREACH(this->characters, character)
+	{
+		Character_Save_Data data = character->SaveData();
+
+		if (!save_all && character->last_save && *character->last_save == data)
+			continue;
+
+		character->last_save = std::make_shared<const Character_Save_Data>(data);
+		batch->characters.push_back(std::move(data));
+	}
+
+	batch->guilds = this->guildmanager->TakeSaveData(save_all);
+
+	batch->command_audit.swap(this->command_audit_uncommitted);
+	this->command_audit.insert(this->command_audit.end(), batch->command_audit.begin(), batch->command_audit.end());
+
+	if (batch->empty())
+		return;
+
+	if (DatabaseFactory::SharesConnection(this->config))
+	{
+		if (!world_save_batch(*this->db, *batch))
+			this->FinishSave(true);
+
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->save_mutex);
+		this->save_pending = true;
+	}
+
+	// Rehash rewrites this->config on the main thread while the save may still be running, so the worker connects with a snapshot
+	std::shared_ptr<Config> db_config = std::make_shared<Config>(this->config);
+	std::shared_ptr<DatabaseFactory> factory = this->databaseFactory;
+
+	util::ThreadPool::Queue([this, batch, db_config, factory](const void *)
+	{
+		std::shared_ptr<Database> database;
+
 		try
 		{
-			this->db->Query("INSERT INTO `command_audit` (`time`, `source`, `command`, `arguments`) VALUES (#, '$', '$', '$')",
-				static_cast<int>(timestamp), source.c_str(), command.c_str(), args_str.c_str());
+			database = factory->GetDatabase(*db_config);
 		}
-		catch (Database_Exception& e)
+		catch (std::exception& e)
 		{
-			Console::Err("Could not save command audit to database.");
-			Console::Err("%s", e.error());
+			Console::Wrn("Timed save could not connect to the database: %s", e.what());
+		}
+
+		for (std::shared_ptr<World_Save_Batch> next = batch; next; )
+		{
+			bool failed = !database || !world_save_batch(*database, *next);
+			next = this->FinishSave(failed);
 		}
+	}, nullptr, util::ThreadPool::Background);
+}
+
+std::shared_ptr<World_Save_Batch> World::FinishSave(bool failed)
+{
+	std::lock_guard<std::mutex> lock(this->save_mutex);
+	this->save_failed = this->save_failed || failed;
+
+	if (!this->save_queue.empty())
+	{
+		std::shared_ptr<World_Save_Batch> next = std::move(this->save_queue.front());
+		this->save_queue.pop_front();
+		return next;
 	}
 
-	this->command_audit.insert(this->command_audit.end(), this->command_audit_uncommitted.begin(), this->command_audit_uncommitted.end());
-	this->command_audit_uncommitted.clear();
+	this->save_pending = false;
+	this->save_done.notify_all();
+	return nullptr;
+}
+
+bool World::QueueSave(std::shared_ptr<World_Save_Batch> batch)
+{
+	std::lock_guard<std::mutex> lock(this->save_mutex);
+
+	if (!this->save_pending)
+		return false;
+
+	this->save_queue.push_back(std::move(batch));
+	return true;
+}
+
+void World::WaitForSave()
+{
+	std::unique_lock<std::mutex> lock(this->save_mutex);
+	this->save_done.wait(lock, [this]() { return !this->save_pending; });
 }
 
 void World::LoadCommandAudit()
@@ -997,6 +1210,105 @@ void World::LoadCommandAudit()
 	}
 }
 
+static std::vector<BanIndex::Ban> world_load_bans(Database& db)
+{
+	Database_Result res = db.Query("SELECT username, ip, hdid, expires FROM bans WHERE expires > # OR expires = 0", int(std::time(0)));
+
+	std::vector<BanIndex::Ban> bans;
+	bans.reserve(res.size());
+
+	UTIL_FOREACH_CREF(res, row)
+	{
+		// NULL columns come back as an empty string or 0, which the index skips
+		bans.push_back(BanIndex::Ban{
+			static_cast<std::string>(row.at("username")),
+			static_cast<int>(row.at("ip")),
+			static_cast<int>(row.at("hdid")),
+			static_cast<int>(row.at("expires"))
+		});
+	}
+
+	return bans;
+}
+
+void World::LoadBans()
+{
+	try
+	{
+		this->ban_index->Replace(world_load_bans(*this->db), int(std::time(0)));
+	}
+	catch (Database_Exception& e)
+	{
+		Console::Wrn("Could not load bans from database.");
+		Console::Wrn("%s", e.error());
+
+		if (!this->ban_index->Loaded())
+			Console::Wrn("Refusing logins until the bans can be loaded.");
+	}
+}
+
+bool World::BansLoaded() const
+{
+	return this->ban_index->Loaded();
+}
+
+void World::ExpireDatabaseConnections()
+{
+	this->databaseFactory->ExpireIdle(this->config);
+}
+
+void World::RefreshBans()
+{
+	if (this->ban_index->Refreshing())
+		return;
+
+	if (DatabaseFactory::SharesConnection(this->config))
+	{
+		this->LoadBans();
+		return;
+	}
+
+	this->ban_index->BeginRefresh();
+
+	// The World can be destroyed before the reload finishes, so the worker holds its own connection settings and only a weak reference to the index
+	std::shared_ptr<Config> db_config = std::make_shared<Config>(this->config);
+	std::shared_ptr<DatabaseFactory> factory = this->databaseFactory;
+	std::weak_ptr<BanIndex> weak_index = this->ban_index;
+
+	util::ThreadPool::Queue([db_config, factory, weak_index](const void *)
+	{
+		std::shared_ptr<std::vector<BanIndex::Ban>> bans;
+
+		try
+		{
+			std::shared_ptr<Database> database = factory->GetDatabase(*db_config);
+			bans = std::make_shared<std::vector<BanIndex::Ban>>(world_load_bans(*database));
+		}
+		catch (Database_Exception& e)
+		{
+			Console::Wrn("Could not refresh bans from database: %s", e.error());
+		}
+		catch (std::exception& e)
+		{
+			Console::Wrn("Could not refresh bans from database: %s", e.what());
+		}
+
+		// The World may be gone by the time this runs
+		AsyncCompletionQueue::Post([weak_index, bans]()
+		{
+			std::shared_ptr<BanIndex> ban_index = weak_index.lock();
+
+			if (!ban_index)
+				return;
+
+			if (bans)
+				ban_index->FinishRefresh(*bans, int(std::time(0)));
+			else
+				ban_index->AbortRefresh();
+		});
+	}, nullptr, util::ThreadPool::Background);
+}
+
 void World::LoadHome()
 {
 	this->homes.clear();
@@ -1092,44 +1404,38 @@ int World::GenerateCharacterID()
 
 unsigned short World::GenerateOperationID(std::function<unsigned short(const EOClient *)> get_id) const
 {
-	unsigned short candidate_id = static_cast<unsigned int>(util::rand(20000, 60000)) - 1;
-	std::list<Client*>::const_iterator matching_client;
+	std::unordered_set<unsigned short> used_ids;
+	used_ids.reserve(this->server->clients.size());
 
-	do
+	UTIL_FOREACH(this->server->clients, client)
 	{
-		candidate_id++;
-		matching_client = std::find_if(this->server->clients.cbegin(),
-			this->server->clients.cend(),
-			[&candidate_id, get_id](const Client * c)
-			{
-				auto client = dynamic_cast<const EOClient*>(c);
-				return get_id(client) == candidate_id;
-			});
-	} while (matching_client != this->server->clients.cend());
+		used_ids.insert(get_id(static_cast<const EOClient *>(client)));
+	}
+
+	unsigned short candidate_id = static_cast<unsigned int>(util::rand(20000, 60000));
+
+	while (used_ids.count(candidate_id))
+	{
+		++candidate_id;
+	}
 
 	return candidate_id;
 }
 
 int World::GenerateClientID()
 {
-	unsigned int lowest_free_id = 1;
-	restart_loop:
-	UTIL_FOREACH(this->server->clients, client)
-	{
-		EOClient *eoclient = static_cast<EOClient *>(client);
+	return this->client_ids.Acquire();
+}
 
-		if (eoclient->id == lowest_free_id)
-		{
-			lowest_free_id = eoclient->id + 1;
-			goto restart_loop;
-		}
-	}
-	return lowest_free_id;
+void World::ReleaseClientID(int id)
+{
+	this->client_ids.Release(id);
 }
 
 void World::Login(Character *character)
 {
 	this->characters.push_back(character);
+	this->character_index.Add(character);
 
 	if (this->GetMap(character->mapid)->relog_x || this->GetMap(character->mapid)->relog_y)
 	{
@@ -1174,6 +1480,8 @@ void World::Logout(Character *character)
 		std::remove(UTIL_RANGE(this->characters), character),
 		this->characters.end()
 	);
+
+	this->character_index.Remove(character);
 }
 
 void World::Msg(Command_Source *from, std::string message, bool echo)
@@ -1186,6 +1494,8 @@ void World::Msg(Command_Source *from, std::string message, bool echo)
 	builder.AddBreakString(from_str);
 	builder.AddBreakString(message);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		character->AddChatLog("~", from_str, message);
@@ -1195,7 +1505,7 @@ void World::Msg(Command_Source *from, std::string message, bool echo)
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 }
 
@@ -1209,6 +1519,8 @@ void World::AdminMsg(Command_Source *from, std::string message, int minlevel, bo
 	builder.AddBreakString(from_str);
 	builder.AddBreakString(message);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		character->AddChatLog("+", from_str, message);
@@ -1218,7 +1530,7 @@ void World::AdminMsg(Command_Source *from, std::string message, int minlevel, bo
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 }
 
@@ -1232,6 +1544,8 @@ void World::AnnounceMsg(Command_Source *from, std::string message, bool echo)
 	builder.AddBreakString(from_str);
 	builder.AddBreakString(message);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		character->AddChatLog("@", from_str, message);
@@ -1241,7 +1555,7 @@ void World::AnnounceMsg(Command_Source *from, std::string message, bool echo)
 			continue;
 		}
 
-		character->Send(builder);
+		character->Send(packet);
 	}
 }
 
@@ -1252,9 +1566,11 @@ void World::ServerMsg(std::string message)
 	PacketBuilder builder(PACKET_TALK, PACKET_SERVER, message.length());
 	builder.AddString(message);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
-		character->Send(builder);
+		character->Send(packet);
 	}
 }
 
@@ -1269,11 +1585,13 @@ void World::AdminReport(Character *from, std::string reportee, std::string messa
 	builder.AddBreakString(message);
 	builder.AddBreakString(reportee);
 
+	PacketBroadcast packet(builder);
+
 	UTIL_FOREACH(this->characters, character)
 	{
 		if (character->SourceAccess() >= static_cast<int>(this->admin_config["reports"]))
 		{
-			character->Send(builder);
+			character->Send(packet);
 		}
 	}
 
@@ -1387,10 +1705,14 @@ void World::Rehash(Command_Source *from)
 		Console::Err(e.what());
 	}
 
+	this->formulas.Compile(this->formulas_config);
 	this->UpdateConfig();
 	this->LoadHome();
 	this->server->UpdateConfig();
 
+	// Cached avatars depend on settings such as ShowLevel
+	++this->avatar_generation;
+
 	UTIL_FOREACH(this->maps, map)
 	{
 		map->LoadArena();
@@ -1417,6 +1739,13 @@ void World::ReloadPub(bool quiet)
 	this->esf->Read(this->config["ESF"]);
 	this->ecf->Read(this->config["ECF"]);
 
+	this->file_cache.Invalidate(this->config["EIF"]);
+	this->file_cache.Invalidate(this->config["ENF"]);
+	this->file_cache.Invalidate(this->config["ESF"]);
+	this->file_cache.Invalidate(this->config["ECF"]);
+
+	++this->avatar_generation;
+
 	if (eif_id != this->eif->rid || enf_id != this->enf->rid
 	 || esf_id != this->esf->rid || ecf_id != this->ecf->rid)
 	{
@@ -1560,58 +1889,22 @@ void World::ReloadQuests()
 
 Character *World::GetCharacter(std::string name)
 {
-	name = util::lowercase(name);
-
-	UTIL_FOREACH(this->characters, character)
-	{
-		if (character->SourceName() == name)
-		{
-			return character;
-		}
-	}
-
-	return 0;
+	return this->character_index.GetName(util::lowercase(name));
 }
 
 Character *World::GetCharacterReal(std::string real_name)
 {
-	real_name = util::lowercase(real_name);
-
-	UTIL_FOREACH(this->characters, character)
-	{
-		if (character->real_name == real_name)
-		{
-			return character;
-		}
-	}
-
-	return 0;
+	return this->character_index.GetRealName(util::lowercase(real_name));
 }
 
 Character *World::GetCharacterPID(unsigned int id)
 {
-	UTIL_FOREACH(this->characters, character)
-	{
-		if (character->PlayerID() == id)
-		{
-			return character;
-		}
-	}
-
-	return 0;
+	return this->character_index.GetPID(id);
 }
 
 Character *World::GetCharacterCID(unsigned int id)
 {
-	UTIL_FOREACH(this->characters, character)
-	{
-		if (character->id == id)
-		{
-			return character;
-		}
-	}
-
-	return 0;
+	return this->character_index.GetCID(id);
 }
 
 Map *World::GetMap(short id)
@@ -1735,20 +2028,24 @@ void World::DeleteCharacter(std::string name)
 	this->db->Query("DELETE FROM `characters` WHERE name = '$'", name.c_str());
 }
 
-Player *World::PlayerFactory(std::string username)
+AsyncOperation<AccountCredentials, LoginReply>* World::CheckCredential(EOClient* client, const std::string& username)
 {
-	auto database = this->databaseFactory->CreateDatabase(this->config);
-	return new Player(username, this, database.get());
-}
-
-AsyncOperation<AccountCredentials, LoginReply>* World::CheckCredential(EOClient* client)
-{
-	if (this->loginManager->LoginBusy())
+	if (!this->loginManager->AdmitLogin(client->GetRemoteAddr(), username))
 	{
 		return AsyncOperation<AccountCredentials, LoginReply>::FromResult(LOGIN_BUSY, client, LOGIN_OK);
 	}
 
-	return this->loginManager->CheckLoginAsync(client);
+	return this->loginManager->CheckLoginAsync(client, username);
+}
+
+void World::CancelLogins(const EOClient* client)
+{
+	this->loginManager->CancelLogins(client);
+}
+
+LoginManager::Stats World::LoginStats() const
+{
+	return this->loginManager->GetStats();
 }
 
 AsyncOperation<PasswordChangeInfo, bool>* World::ChangePassword(EOClient* client)
@@ -1797,39 +2094,14 @@ bool World::PlayerOnline(std::string username)
 
 void World::SetPendingLogin(const std::string& username, bool is_pending)
 {
-	this->pending_logins_mutex.lock();
-
-	try
-	{
-		this->pending_logins.insert_or_assign(username, is_pending);
-	}
-	catch (...)
-	{
-		this->pending_logins_mutex.unlock();
-		throw;
-	}
-
-	this->pending_logins_mutex.unlock();
+	this->pending_logins.insert_or_assign(username, is_pending);
 }
 
 bool World::GetPendingLogin(const std::string& username)
 {
-	this->pending_logins_mutex.lock();
+	auto it = this->pending_logins.find(username);
 
-	bool result = false;
-	try
-	{
-		result = this->pending_logins.find(username) != this->pending_logins.end()
-			  && this->pending_logins[username];
-	}
-	catch (...)
-	{
-		this->pending_logins_mutex.unlock();
-		throw;
-	}
-
-	this->pending_logins_mutex.unlock();
-	return result;
+	return it != this->pending_logins.end() && it->second;
 }
 
 void World::Kick(Command_Source *from, Character *victim, bool announce)
@@ -1877,21 +2149,23 @@ void World::Ban(Command_Source *from, Character *victim, int duration, bool anno
 	if (announce)
 		this->ServerMsg(i18n.Format("announce_removed", victim->SourceName(), from_str, i18n.Format("banned")));
 
-	std::string query("INSERT INTO bans (username, ip, hdid, expires, setter) VALUES ");
+	int now = int(std::time(0));
 
-	query += "('" + db->Escape(victim->player->username) + "', ";
-	query += util::to_string(static_cast<int>(victim->player->client->GetRemoteAddr())) + ", ";
-	query += util::to_string(victim->player->client->hdid) + ", ";
+	BanIndex::Ban ban{
+		victim->player->username,
+		static_cast<int>(victim->player->client->GetRemoteAddr()),
+		victim->player->client->hdid,
+		(duration == -1) ? 0 : now + duration
+	};
 
-	if (duration == -1)
-	{
-		query += "0";
-	}
-	else
-	{
-		query += util::to_string(int(std::time(0) + duration));
-	}
+	this->ban_index->Add(ban, now);
+
+	std::string query("INSERT INTO bans (username, ip, hdid, expires, setter) VALUES ");
 
+	query += "('" + db->Escape(ban.username) + "', ";
+	query += util::to_string(ban.ip) + ", ";
+	query += util::to_string(ban.hdid) + ", ";
+	query += util::to_string(ban.expires);
 	query += ", '" + db->Escape(from_str) + "')";
 
 	try
@@ -1917,37 +2191,16 @@ void World::Mute(Command_Source *from, Character *victim, bool announce)
 
 int World::CheckBan(const std::string *username, const IPAddress *address, const int *hdid)
 {
-	std::string query("SELECT COALESCE(MAX(expires),-1) AS expires FROM bans WHERE (");
-
-	if (!username && !address && !hdid)
-	{
-		return -1;
-	}
-
-	if (username)
-	{
-		query += "username = '";
-		query += db->Escape(*username);
-		query += "' OR ";
-	}
+	int ip = 0;
 
 	if (address)
-	{
-		query += "ip = ";
-		query += util::to_string(static_cast<int>(*const_cast<IPAddress *>(address)));
-		query += " OR ";
-	}
+		ip = static_cast<int>(*const_cast<IPAddress *>(address));
 
-	if (hdid)
-	{
-		query += "hdid = ";
-		query += util::to_string(*hdid);
-		query += " OR ";
-	}
-
-	Database_Result res = db->Query((query.substr(0, query.length()-4) + ") AND (expires > # OR expires = 0)").c_str(), int(std::time(0)));
+	// Nobody is known to be banned yet, callers refuse logins as busy until BansLoaded
+	if (!this->ban_index->Loaded())
+		return -1;
 
-	return static_cast<int>(res[0]["expires"]);
+	return this->ban_index->Check(username, address ? &ip : 0, hdid, int(std::time(0)));
 }
 
 static std::list<int> PKExceptUnserialize(std::string serialized)
@@ -1999,6 +2252,8 @@ bool World::IsInstrument(int graphic_id)
 
 World::~World()
 {
+	this->WaitForSave();
+
 	UTIL_FOREACH(this->maps, map)
 	{
 		delete map;
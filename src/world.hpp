@@ -19,23 +19,37 @@
 #include "fwd/party.hpp"
 #include "fwd/player.hpp"
 #include "fwd/quest.hpp"
+#include "ban_index.hpp"
+#include "character.hpp"
+#include "character_index.hpp"
 #include "config.hpp"
 #include "database.hpp"
+#include "filecache.hpp"
+#include "formulas.hpp"
+#include "guild.hpp"
 #include "i18n.hpp"
 #include "hash.hpp"
 #include "map.hpp"
 #include "loginmanager.hpp"
+#include "quest_index.hpp"
 #include "timer.hpp"
 
 #include "fwd/socket.hpp"
 #include "util/secure_string.hpp"
 #include "util/async.hpp"
+#include "util/id_pool.hpp"
 
 #include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <ctime>
+#include <deque>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <vector>
 
 struct Board_Post
@@ -76,6 +90,65 @@ struct Home
 			 sleep_map(0), sleep_x(0), sleep_y(0) { }
 };
 
+/**
+ * Rows collected by World::TimedSave to be written on a background database connection
+ */
+struct World_Save_Batch
+{
+	std::vector<Character_Save_Data> characters;
+	std::vector<Guild_Save_Data> guilds;
+	std::vector<std::tuple<std::time_t, std::string, std::string, std::vector<std::string>>> command_audit;
+
+	bool empty() const { return characters.empty() && guilds.empty() && command_audit.empty(); }
+
+	/**
+	 * Writes every row in a single transaction
+	 * @throw Database_Exception
+	 */
+	void Save(Database& db) const;
+};
+
+/**
+ * Config values read on hot paths, converted once by World::UpdateConfig so they can be read without a Config lookup
+ */
+struct World_Settings
+{
+	int see_distance;
+	double ghost_timer;
+	bool ghost_arena;
+	double spike_damage;
+	bool global_pk;
+	int ranged_distance;
+	double critical_rate;
+	bool critical_first_hit;
+	double mob_rate;
+	double pk_rate;
+	bool limit_damage;
+
+	bool enforce_timestamps;
+	bool enforce_sequence;
+	int enforce_weight;
+	int limit_attack;
+	bool use_duty_admin;
+	std::size_t packet_queue_max;
+
+	int npc_chase_mode;
+	int npc_chase_distance;
+	double npc_bored_timer;
+	double npc_idle_time;
+	int npc_adjust_max_dam;
+
+	int admin_nowall;
+	int admin_killnpc;
+
+	World_Settings() : see_distance(0), ghost_timer(0.0), ghost_arena(false), spike_damage(0.0), global_pk(false), ranged_distance(0),
+	                   critical_rate(0.0), critical_first_hit(false), mob_rate(0.0), pk_rate(0.0), limit_damage(false),
+	                   enforce_timestamps(false), enforce_sequence(false), enforce_weight(0), limit_attack(0),
+	                   use_duty_admin(false), packet_queue_max(0),
+	                   npc_chase_mode(0), npc_chase_distance(0), npc_bored_timer(0.0), npc_idle_time(0.0), npc_adjust_max_dam(0),
+	                   admin_nowall(0), admin_killnpc(0) { }
+};
+
 /**
  * Object which holds and manages all maps and characters on the server, as well as timed events
  * Only one of these should exist per server
@@ -87,10 +160,25 @@ class World
 		std::unique_ptr<LoginManager> loginManager;
 		std::shared_ptr<DatabaseFactory> databaseFactory;
 
+		// Only touched on the main thread, async login callbacks arrive through AsyncCompletionQueue
 		std::map<std::string, bool> pending_logins;
-		std::mutex pending_logins_mutex;
+
+		std::mutex save_mutex;
+		std::condition_variable save_done;
+		bool save_pending;
+		bool save_failed;
+		std::deque<std::shared_ptr<World_Save_Batch>> save_queue;
+
+		std::shared_ptr<World_Save_Batch> FinishSave(bool failed);
 	protected:
 		int last_character_id;
+		util::IDPool client_ids;
+
+		// Index of characters, kept in sync by Login and Logout
+		CharacterIndex character_index;
+
+		// Active bans, loaded at startup, updated by Ban and reloaded by RefreshBans so CheckBan never queries the database
+		std::shared_ptr<BanIndex> ban_index;
 
 		void UpdateConfig();
 
@@ -109,16 +197,24 @@ class World
 
 		std::vector<std::unique_ptr<NPC_Data>> npc_data;
 
+		FileCache file_cache;
+
+		// Bumped when config or pub files are reloaded, so cached Character avatar data is rebuilt
+		unsigned int avatar_generation;
+
 		Config config;
 		Config admin_config;
 		Config drops_config;
 		Config shops_config;
 		Config arenas_config;
 		Config formulas_config;
+		Formulas formulas;
 		Config home_config;
 		Config skills_config;
 		Config speech_config;
 
+		World_Settings settings;
+
 		I18N i18n;
 
 		std::vector<Character *> characters;
@@ -127,6 +223,9 @@ class World
 		std::vector<std::shared_ptr<Home>> homes;
 		std::map<short, std::shared_ptr<Quest>> quests;
 
+		// Index of quest states waiting on a specific NPC, item or spell, kept in sync by Quest_Context
+		QuestTriggerIndex quest_triggers;
+
 		std::array<Board *, 8> boards;
 
 		std::array<int, 254> exp_table;
@@ -155,6 +254,7 @@ class World
 		int GenerateCharacterID();
 		unsigned short GenerateOperationID(std::function<unsigned short(const EOClient *)> get_id) const;
 		int GenerateClientID();
+		void ReleaseClientID(int id);
 
 		void Login(Character *);
 		void Logout(Character *);
@@ -195,8 +295,9 @@ class World
 		Character *CreateCharacter(Player *, std::string name, Gender, int hairstyle, int haircolor, Skin);
 		void DeleteCharacter(std::string name);
 
-		Player *PlayerFactory(std::string username);
-		AsyncOperation<AccountCredentials, LoginReply>* CheckCredential(EOClient* client);
+		AsyncOperation<AccountCredentials, LoginReply>* CheckCredential(EOClient* client, const std::string& username);
+		void CancelLogins(const EOClient* client);
+		LoginManager::Stats LoginStats() const;
 		AsyncOperation<PasswordChangeInfo, bool>* ChangePassword(EOClient* client);
 
 		AsyncOperation<AccountCreateInfo, bool>* CreateAccount(EOClient* client);
@@ -214,6 +315,40 @@ class World
 		void LoadCommandAudit();
 		void SaveCommandAudit();
 
+		/**
+		 * Loads the active bans from the database. If they have never been loaded every connection is refused
+		 * until RefreshBans succeeds, rather than letting banned players in.
+		 */
+		void LoadBans();
+		bool BansLoaded() const;
+
+		/**
+		 * Reloads the active bans on a background database connection, picking up bans added or removed outside the server
+		 */
+		void RefreshBans();
+
+		/**
+		 * Closes pooled database connections that background threads have stopped using
+		 */
+		void ExpireDatabaseConnections();
+
+		/**
+		 * Collects characters and guilds that changed since they were last saved, along with the command audit log,
+		 * and writes them on a background database connection
+		 */
+		void TimedSave();
+
+		/**
+		 * Hands the batch to the background save if one is running, so it is written after it on the same connection
+		 * @return false if no save is running and the caller should write the batch itself
+		 */
+		bool QueueSave(std::shared_ptr<World_Save_Batch> batch);
+
+		/**
+		 * Blocks until a background save started by TimedSave, and anything queued behind it, has finished
+		 */
+		void WaitForSave();
+
 		~World();
 };
 
@@ -4,8 +4,11 @@
  * See LICENSE.txt for more info.
  */
 
+#include "../src/ban_index.cpp"
 #include "../src/character.cpp"
+#include "../src/character_index.cpp"
 #include "../src/command_source.cpp"
+#include "../src/formulas.cpp"
 #include "../src/map.cpp"
 #include "../src/npc.cpp"
 #include "../src/npc_data.cpp"
@@ -8,6 +8,7 @@
 #include "../src/dialog.cpp"
 #include "../src/guild.cpp"
 #include "../src/quest.cpp"
+#include "../src/quest_index.cpp"
 #include "../src/commands/commands.cpp"
 #include "../src/handlers/handlers.cpp"
 #include "../src/extra/seose_compat.cpp"
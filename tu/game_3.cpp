@@ -8,5 +8,6 @@
 #include "../src/eodata.cpp"
 #include "../src/eoserv_config.cpp"
 #include "../src/eoserver.cpp"
+#include "../src/filecache.cpp"
 #include "../src/packet.cpp"
 #include "../src/sln.cpp"
@@ -14,6 +14,8 @@
 #include "../src/socket.cpp"
 #include "../src/timer.cpp"
 #include "../src/util.cpp"
+#include "../src/util/nav_grid.cpp"
+#include "../src/util/ring_buffer.cpp"
 #include "../src/util/rpn.cpp"
 #include "../src/util/semaphore.cpp"
 #include "../src/util/threadpool.cpp"